@@ -1,5 +1,6 @@
 #include "PrecompiledHeader.h"
 #include "hlslmath.h"
+#include "Utilities/Ref.h"
 
 namespace PK::Math
 {
@@ -416,14 +417,14 @@ namespace PK::Math
 						aabb.max.z + paddingRU.z) * worldToLocal;
 	}
 
-	float Functions::GetShadowCascadeMatrices(const float4x4& worldToLocal, const float4x4& inverseViewProjection, const float* zPlanes, float zPadding, uint count, float4x4* matrices)
+	float Functions::GetShadowCascadeMatrices(const float4x4& worldToLocal, const float4x4& inverseViewProjection, const float* zPlanes, float zPadding, uint count, float4x4* matrices, const BoundingBox* receiverBounds)
 	{
 		auto matrix = worldToLocal * inverseViewProjection;
 		auto minNear = std::numeric_limits<float>().max();
 		auto maxFar = -std::numeric_limits<float>().max();
 		auto zrange = zPlanes[count] - zPlanes[0];
 
-		BoundingBox* aabbs = reinterpret_cast<BoundingBox*>(alloca(sizeof(BoundingBox) * count));
+		auto* aabbs = PK_STACK_ALLOC(BoundingBox, count);
 
 		for (auto i = 0u; i < count; ++i)
 		{
@@ -432,6 +433,23 @@ namespace PK::Math
 
 			aabbs[i] = Functions::GetInverseFrustumBounds(matrix, lnear, lfar);
 
+			if (receiverBounds != nullptr && receiverBounds[i].min.x <= receiverBounds[i].max.x)
+			{
+				// Nothing past the receivers of the slice needs to be covered. The near plane is left as is for casters.
+				auto receivers = Functions::BoundsTransform(worldToLocal, receiverBounds[i]);
+				auto clamped = aabbs[i];
+				clamped.min.x = glm::max(clamped.min.x, receivers.min.x);
+				clamped.min.y = glm::max(clamped.min.y, receivers.min.y);
+				clamped.max.x = glm::min(clamped.max.x, receivers.max.x);
+				clamped.max.y = glm::min(clamped.max.y, receivers.max.y);
+				clamped.max.z = glm::max(glm::min(clamped.max.z, receivers.max.z), clamped.min.z);
+
+				if (clamped.min.x < clamped.max.x && clamped.min.y < clamped.max.y)
+				{
+					aabbs[i] = clamped;
+				}
+			}
+
 			if (aabbs[i].min.z < minNear)
 			{
 				minNear = aabbs[i].min.z;
@@ -458,6 +476,73 @@ namespace PK::Math
 		return maxFar - minNear;
 	}
 
+	float Functions::GetStableShadowCascadeMatrices(const float4x4& worldToLocal, const float4x4& inverseViewProjection, const float* zPlanes, float zPadding, uint resolution, uint count, float4x4* matrices)
+	{
+		float3 frustumNear[4];
+		float3 frustumFar[4];
+
+		for (auto i = 0u; i < 4u; ++i)
+		{
+			auto x = i & 1u ? 1.0f : -1.0f;
+			auto y = i & 2u ? 1.0f : -1.0f;
+			auto pnear = inverseViewProjection * float4(x, y, -1, 1);
+			auto pfar = inverseViewProjection * float4(x, y, 1, 1);
+			frustumNear[i] = float3(pnear.xyz) / pnear.w;
+			frustumFar[i] = float3(pfar.xyz) / pfar.w;
+		}
+
+		auto zrange = zPlanes[count] - zPlanes[0];
+		auto* spheres = PK_STACK_ALLOC(float4, count);
+		auto maxRadius = 0.0f;
+
+		for (auto i = 0u; i < count; ++i)
+		{
+			float3 corners[8];
+			auto center = PK_FLOAT3_ZERO;
+
+			for (auto j = 0u; j < 4u; ++j)
+			{
+				corners[j] = glm::mix(frustumNear[j], frustumFar[j], zPlanes[i] / zrange);
+				corners[j + 4] = glm::mix(frustumNear[j], frustumFar[j], zPlanes[i + 1] / zrange);
+				center += (corners[j] + corners[j + 4]) / 8.0f;
+			}
+
+			auto radius = 0.0f;
+
+			for (auto j = 0u; j < 8u; ++j)
+			{
+				radius = glm::max(radius, glm::length(corners[j] - center));
+			}
+
+			// The radius only depends on the projection. Rounding removes float noise from camera movement.
+			radius = glm::ceil(radius * 16.0f) / 16.0f;
+			maxRadius = glm::max(maxRadius, radius);
+			spheres[i] = float4(center, radius);
+		}
+
+		// A shared depth range lets every cascade be placed independently of the others.
+		auto depthRange = 2.0f * maxRadius - zPadding;
+
+		for (auto i = 0u; i < count; ++i)
+		{
+			auto radius = spheres[i].w;
+			auto texelSize = 2.0f * radius / resolution;
+			auto center = float3(worldToLocal * float4(float3(spheres[i].xyz), 1.0f));
+			center = glm::floor(center / texelSize) * texelSize;
+			auto znear = center.z - radius + zPadding;
+
+			matrices[i] = Functions::GetOrtho(
+				center.x - radius,
+				center.x + radius,
+				center.y - radius,
+				center.y + radius,
+				znear,
+				znear + depthRange) * worldToLocal;
+		}
+
+		return depthRange;
+	}
+
 	size_t Functions::GetNextExponentialSize(size_t start, size_t min)
 	{
 		if (start < 1)
@@ -658,6 +743,87 @@ namespace PK::Math
 		}
 	}
 
+	uint Functions::GetShadowCasterCullingPlanes(const float4x4& inverseViewProjection, const float4& light, float4* planes)
+	{
+		// Corner index bits select the x, y & z side of the frustum.
+		float3 corners[8];
+		float3 center = PK_FLOAT3_ZERO;
+
+		for (auto i = 0u; i < 8u; ++i)
+		{
+			auto corner = inverseViewProjection * float4(i & 1u ? 1 : -1, i & 2u ? 1 : -1, i & 4u ? 1 : -1, 1);
+			corners[i] = float3(corner.xyz) / corner.w;
+			center += corners[i] / 8.0f;
+		}
+
+		// Faces are ordered by axis & side. Each plane faces the inside of the frustum.
+		float4 faces[6];
+		bool facesLight[6];
+		auto count = 0u;
+
+		for (auto face = 0u; face < 6u; ++face)
+		{
+			auto axis = face / 2u;
+			auto side = (face & 1u) << axis;
+			auto b = 1u << ((axis + 1u) % 3u);
+			auto c = 1u << ((axis + 2u) % 3u);
+			auto normal = glm::normalize(glm::cross(corners[side | b] - corners[side], corners[side | c] - corners[side]));
+			faces[face] = float4(normal, -glm::dot(normal, corners[side]));
+
+			if (PlaneDistanceToPoint(faces[face], center) < 0.0f)
+			{
+				faces[face] = -faces[face];
+			}
+
+			// Casters behind a face that the light is on the inside of cannot cast shadows into the frustum.
+			facesLight[face] = glm::dot(float3(faces[face].xyz), float3(light.xyz)) + faces[face].w * light.w >= 0.0f;
+
+			if (facesLight[face])
+			{
+				planes[count++] = faces[face];
+			}
+		}
+
+		// Silhouette edges are shared by a face that faces the light & one that does not. Extrude them towards the light.
+		for (auto axis = 0u; axis < 3u; ++axis)
+		{
+			auto axisB = (axis + 1u) % 3u;
+			auto axisC = (axis + 2u) % 3u;
+
+			for (auto i = 0u; i < 8u; ++i)
+			{
+				if (i & (1u << axis))
+				{
+					continue;
+				}
+
+				auto faceB = axisB * 2u + ((i >> axisB) & 1u);
+				auto faceC = axisC * 2u + ((i >> axisC) & 1u);
+
+				if (facesLight[faceB] == facesLight[faceC])
+				{
+					continue;
+				}
+
+				auto& e0 = corners[i];
+				auto& e1 = corners[i | (1u << axis)];
+				auto normal = glm::cross(e1 - e0, float3(light.xyz) - e0 * light.w);
+				auto length = glm::length(normal);
+
+				if (length < 1e-6f)
+				{
+					continue;
+				}
+
+				normal /= length;
+				auto plane = float4(normal, -glm::dot(normal, e0));
+				planes[count++] = PlaneDistanceToPoint(plane, center) < 0.0f ? -plane : plane;
+			}
+		}
+
+		return count;
+	}
+
 	float Functions::PlaneDistanceToAABB(const float4& plane, const BoundingBox& aabb)
 	{
 		auto bx = plane.x > 0 ? aabb.max.x : aabb.min.x;
@@ -174,6 +174,8 @@ namespace PK::Math
     constexpr float PK_FLOAT_2PI = 2.0f * 3.14159274F;
     constexpr float PK_FLOAT_DEG2RAD = 0.0174532924F;
     constexpr float PK_FLOAT_RAD2DEG = 57.29578F;
+    // 6 frustum faces & 12 silhouette edges.
+    constexpr uint PK_MAX_SHADOW_CASTER_PLANES = 18;
     
     struct FrustumPlanes
     {
@@ -221,7 +223,12 @@ namespace PK::Math
         float4x4 GetOffsetPerspective(float left, float right, float bottom, float top, float fovy, float aspect, float zNear, float zFar);
         float4x4 GetPerspectiveSubdivision(int index, const int3& gridSize, float fovy, float aspect, float znear, float zfar);
         float4x4 GetFrustumBoundingOrthoMatrix(const float4x4& worldToLocal, const float4x4& inverseViewProjection, const float3& paddingLD, const float3& paddingRU, float* outZnear, float* outZFar);
-        float GetShadowCascadeMatrices(const float4x4& worldToLocal, const float4x4& inverseViewProjection, const float* zPlanes, float zPadding, uint count, float4x4* matrices);
+        // Cascade bounds are clamped to the light space bounds of the receivers of each cascade when they are given. One receiver bounds per cascade.
+        // Cascades with inverted receiver bounds or receivers outside of their slice keep the bounds of the slice.
+        float GetShadowCascadeMatrices(const float4x4& worldToLocal, const float4x4& inverseViewProjection, const float* zPlanes, float zPadding, uint count, float4x4* matrices, const BoundingBox* receiverBounds = nullptr);
+        // Cascades are fit to bounding spheres of the frustum slices & snapped to texels of the given resolution so that they do not shimmer.
+        // Each cascade only depends on its own slice. All cascades share the returned depth range.
+        float GetStableShadowCascadeMatrices(const float4x4& worldToLocal, const float4x4& inverseViewProjection, const float* zPlanes, float zPadding, uint resolution, uint count, float4x4* matrices);
 
         inline color HexToRGB(uint hex) { return color((hex >> 24) & 0xFF, (hex >> 16) & 0xFF, (hex >> 8) & 0xFF, 255.0f) / 255.0f; }
         color HueToRGB(float hue);
@@ -259,6 +266,10 @@ namespace PK::Math
 
         void NormalizePlane(float4* plane);
         void ExtractFrustrumPlanes(const float4x4 viewprojection, FrustumPlanes* frustrum, bool normalize);
+
+        // Planes of the convex hull of a frustum & a light. Objects outside of it cannot cast shadows into the frustum.
+        // The light is a position when light.w is 1 & a direction towards the light when light.w is 0.
+        uint GetShadowCasterCullingPlanes(const float4x4& inverseViewProjection, const float4& light, float4* planes);
     
         float PlaneDistanceToAABB(const float4& plane, const BoundingBox& aabb);
         
@@ -0,0 +1,38 @@
+#version 460
+#pragma PROGRAM_COMPUTE
+#include includes/PKCommon.glsl
+
+#define OCCLUSION_DEPTH_SIZE_X 256
+#define OCCLUSION_DEPTH_SIZE_Y 128
+
+PK_DECLARE_BUFFER(uint, pk_OcclusionDepths);
+
+layout(local_size_x = 16, local_size_y = 16, local_size_z = 1) in;
+void main()
+{
+    uint2 texel = gl_GlobalInvocationID.xy;
+    uint2 size = uint2(OCCLUSION_DEPTH_SIZE_X, OCCLUSION_DEPTH_SIZE_Y);
+
+    if (any(greaterThanEqual(texel, size)))
+    {
+        return;
+    }
+
+    // Conservative footprint. Every screen pixel that overlaps this texel contributes to its max depth.
+    int2 resolution = int2(pk_ScreenParams.xy);
+    int2 pxmin = int2((texel * uint2(resolution)) / size);
+    int2 pxmax = min(int2(((texel + 1u) * uint2(resolution) + size - 1u) / size), resolution) - 1;
+    pxmax = max(pxmax, pxmin);
+
+    float depth = 0.0f;
+
+    for (int y = pxmin.y; y <= pxmax.y; ++y)
+    {
+        for (int x = pxmin.x; x <= pxmax.x; ++x)
+        {
+            depth = max(depth, texelFetch(pk_ScreenDepth, int2(x, y), 0).r);
+        }
+    }
+
+    PK_BUFFER_DATA(pk_OcclusionDepths, texel.x + texel.y * OCCLUSION_DEPTH_SIZE_X) = floatBitsToUint(depth);
+}
\ No newline at end of file
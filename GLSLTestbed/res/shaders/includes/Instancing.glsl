@@ -6,6 +6,48 @@
 
 #if defined(PK_ENABLE_INSTANCING)
     PK_DECLARE_READONLY_BUFFER(uint, pk_InstancingPropertyIndices);
+
+    // float4s per instance. 4 for column major matrices, 3 for the first three rows of affine matrices & 2 for position, rotation & scale.
+    uniform uint pk_InstancingTransformStride;
+    PK_DECLARE_READONLY_BUFFER(float4, pk_InstancingMatrices);
+
+    // float4(position, half2(scale.xy)) & float4(half2(rotation.xy), half2(rotation.zw), half2(scale.z, 0), 0)
+    float4x4 pk_DecodeCompactTransform(float4 v0, float4 v1)
+    {
+        float2 scaleXY = unpackHalf2x16(floatBitsToUint(v0.w));
+        float scaleZ = unpackHalf2x16(floatBitsToUint(v1.z)).x;
+        float4 q = normalize(float4(unpackHalf2x16(floatBitsToUint(v1.x)), unpackHalf2x16(floatBitsToUint(v1.y))));
+        float3 q2 = q.xyz * 2.0f;
+        float xx = q.x * q2.x, yy = q.y * q2.y, zz = q.z * q2.z;
+        float xy = q.x * q2.y, xz = q.x * q2.z, yz = q.y * q2.z;
+        float wx = q.w * q2.x, wy = q.w * q2.y, wz = q.w * q2.z;
+
+        return float4x4(float4(1.0f - (yy + zz), xy + wz, xz - wy, 0.0f) * scaleXY.x,
+                        float4(xy - wz, 1.0f - (xx + zz), yz + wx, 0.0f) * scaleXY.y,
+                        float4(xz + wy, yz - wx, 1.0f - (xx + yy), 0.0f) * scaleZ,
+                        float4(v0.xyz, 1.0f));
+    }
+
+    float4x4 pk_LoadInstancingMatrix(uint index)
+    {
+        uint offset = index * pk_InstancingTransformStride;
+        float4 v0 = PK_BUFFER_DATA(pk_InstancingMatrices, offset + 0);
+        float4 v1 = PK_BUFFER_DATA(pk_InstancingMatrices, offset + 1);
+
+        if (pk_InstancingTransformStride == 2)
+        {
+            return pk_DecodeCompactTransform(v0, v1);
+        }
+
+        float4 v2 = PK_BUFFER_DATA(pk_InstancingMatrices, offset + 2);
+
+        if (pk_InstancingTransformStride == 3)
+        {
+            return transpose(float4x4(v0, v1, v2, float4(0, 0, 0, 1)));
+        }
+
+        return float4x4(v0, v1, v2, PK_BUFFER_DATA(pk_InstancingMatrices, offset + 3));
+    }
     
     #if defined(SHADER_STAGE_VERTEX)
 
@@ -43,7 +43,14 @@ void SampleScreenSpaceGI(inout PKIndirect indirect, float2 uv)
 
 float SampleLightShadowmap(uint shadowmapIndex, float2 uv, float lightDistance)
 {
-    float2 moments = tex2D(pk_ShadowmapArray, float3(uv, shadowmapIndex)).xy;
+    // Shadowmap index packs the atlas layer with the quadtree level & tile coordinates of the light's tile.
+    uint layer = bitfieldExtract(shadowmapIndex, 0, 16);
+    float scale = 1.0f / float(1u << bitfieldExtract(shadowmapIndex, 16, 4));
+    float2 tile = float2(bitfieldExtract(shadowmapIndex, 20, 6), bitfieldExtract(shadowmapIndex, 26, 6));
+    float border = 0.5f / (textureSize(pk_ShadowmapArray, 0).x * scale);
+    uv = (tile + clamp(uv, border.xx, 1.0f - border.xx)) * scale;
+
+    float2 moments = tex2D(pk_ShadowmapArray, float3(uv, layer)).xy;
     float variance = moments.y - moments.x * moments.x;
     float difference = lightDistance - moments.x;
     return difference > 0.1f ? LBR(variance / (variance + difference * difference)) : 1.0f;
@@ -86,9 +86,8 @@ PK_DECLARE_CBUFFER(pk_PerFrameConstants)
 };
 
 #if defined(PK_ENABLE_INSTANCING)
-    PK_DECLARE_READONLY_BUFFER(float4x4, pk_InstancingMatrices);
-    #define pk_MATRIX_M PK_BUFFER_DATA(pk_InstancingMatrices, PK_INSTANCE_OFFSET_ID)
-    #define pk_MATRIX_I_M inverse(PK_BUFFER_DATA(pk_InstancingMatrices, PK_INSTANCE_OFFSET_ID))
+    #define pk_MATRIX_M pk_LoadInstancingMatrix(PK_INSTANCE_OFFSET_ID)
+    #define pk_MATRIX_I_M inverse(pk_LoadInstancingMatrix(PK_INSTANCE_OFFSET_ID))
 #else
     // Current model matrix.
     uniform float4x4 pk_MATRIX_M;
@@ -4,6 +4,9 @@
 layout(binding = 0) uniform highp samplerCubeArray _ShadowmapBatchCube;
 layout(binding = 1) uniform highp sampler2DArray _ShadowmapBatch0;
 layout(binding = 2) uniform highp sampler2DArray _ShadowmapBatch1;
+uniform uint pk_ShadowmapScratchLayer;
+// Scratch layers are only filled up to the resolution of the tile being resolved.
+uniform float pk_ShadowmapSourceScale;
 
 #define SAMPLE_COUNT 5u
 #define SAMPLE_COUNT_INV 0.2f
@@ -78,7 +81,7 @@ void SHADOW_SET_VERTEX_STATE_ATTRIBUTES(float4 position, float2 baseuv, out uint
         gl_Position = position;        
         sampleLayer = gl_InstanceID;
         #if defined(SHADOW_BLUR_PASS1)
-            sampleLayer += gl_BaseInstance + SHADOW_MAP_BATCH_SIZE;
+            sampleLayer += pk_ShadowmapScratchLayer;
         #endif
         gl_Layer = gl_BaseInstance + gl_InstanceID;                                                     
         gl_ViewportIndex = 1;                                                                           
@@ -112,6 +115,7 @@ const int2 sample_offsets_v1[4] = { int2( 0,-3), int2(0, 0), int2(0,3), int2(0,0
 #else
     float2 SAMPLE_SRC(float3 uvw)
     {
+        uvw.xy *= pk_ShadowmapSourceScale;
         float4 valueR0 = textureGatherOffsets(_ShadowmapBatch1, uvw, sample_offsets_v0, 0);
         float4 valueG0 = textureGatherOffsets(_ShadowmapBatch1, uvw, sample_offsets_v0, 1);
         float3 valueR1 = textureGatherOffsets(_ShadowmapBatch1, uvw, sample_offsets_v1, 0).xyz;
@@ -126,7 +130,7 @@ const int2 sample_offsets_v1[4] = { int2( 0,-3), int2(0, 0), int2(0,3), int2(0,0
 
     float2 SAMPLE_SRC_OCT(float3 H, float layer) 
     {
-        float3 uvw = float3(OctaUV(H), layer);
+        float3 uvw = float3(OctaUV(H) * pk_ShadowmapSourceScale, layer);
         return float2(dot(textureGatherOffsets(_ShadowmapBatch1, uvw, sample_offsets, 0), 0.25f.xxxx), dot(textureGatherOffsets(_ShadowmapBatch1, uvw, sample_offsets, 1), 0.25f.xxxx));
     }
 #endif
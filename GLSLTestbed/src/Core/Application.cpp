@@ -3,12 +3,16 @@
 #include "Utilities/Log.h"
 #include "Utilities/StringHashID.h"
 #include "Utilities/HashCache.h"
+#include "Utilities/FrameAllocator.h"
 #include "Core/Input.h"
 #include "Core/UpdateStep.h"
 #include "Core/Application.h"
+#include "Core/AssetCooker.h"
 #include "Core/ApplicationConfig.h"
 #include "Core/CommandConfig.h"
 #include "Rendering/RenderPipeline.h"
+#include "Rendering/TextureStreamer.h"
+#include "Rendering/TextureTranscoding.h"
 #include "Rendering/GizmoRenderer.h"
 #include "ECS/Contextual/Engines/EngineEditorCamera.h"
 #include "ECS/Contextual/Engines/EngineDebug.h"
@@ -16,6 +20,7 @@
 #include "ECS/Contextual/Engines/EngineScreenshot.h"
 #include "ECS/Contextual/Engines/EngineUpdateTransforms.h"
 #include "Rendering/GraphicsAPI.h"
+#include "Rendering/GPUProfiler.h"
 #include <math.h>
 
 namespace PK::Core
@@ -45,6 +50,14 @@ namespace PK::Core
 		auto config = assetDatabase->Find<ApplicationConfig>("Active");
 		auto commandConfig = assetDatabase->Find<CommandConfig>("Active");
 
+		// Configs are always imported from source as they are edited by hand.
+		auto assetCooker = m_services->Create<AssetCooker>(AssetCooker::DefaultDirectory, config->TextureCacheDirectory.value);
+
+		if (config->EnableCookedAssets)
+		{
+			assetDatabase->SetAssetCooker(assetCooker);
+		}
+
 		auto time = m_services->Create<Time>(sequencer, config->TimeScale);
 		auto input = m_services->Create<Input>(sequencer);
 
@@ -56,8 +69,13 @@ namespace PK::Core
 		m_window->OnClose = PK_BIND_FUNCTION(Application::Close);
 		
 		assetDatabase->LoadDirectory<Shader>("res/shaders/");
+
+		// Fills the transcoded texture cache in parallel so that material loads only read from it.
+		TextureTranscoding::SetCacheDirectory(config->TextureCacheDirectory.value);
+		TextureTranscoding::TranscodeDirectory("res/textures/", std::thread::hardware_concurrency());
 	
-		auto renderPipeline = m_services->Create<RenderPipeline>(assetDatabase, entityDb, config);
+		auto textureStreamer = m_services->Create<TextureStreamer>(assetDatabase, config);
+		auto renderPipeline = m_services->Create<RenderPipeline>(assetDatabase, entityDb, textureStreamer, config);
 		auto engineEditorCamera = m_services->Create<ECS::Engines::EngineEditorCamera>(time, config);
 		auto engineUpdateTransforms = m_services->Create<ECS::Engines::EngineUpdateTransforms>(entityDb);
 		auto engineScreenshot = m_services->Create<ECS::Engines::EngineScreenshot>();
@@ -70,13 +88,13 @@ namespace PK::Core
 			{
 				sequencer->GetRoot(),
 				{
-					{ (int)UpdateStep::OpenFrame,		{ PK_STEP_S(renderPipeline), time }},
-					{ (int)UpdateStep::UpdateInput,		{ input } },
+					{ (int)UpdateStep::OpenFrame,		{ PK_STEP_S(renderPipeline), PK_STEP_S(time) }},
+					{ (int)UpdateStep::UpdateInput,		{ PK_STEP_S(input) } },
 					{ (int)UpdateStep::UpdateEngines,	{ PK_STEP_S(engineDebug), PK_STEP_S(engineUpdateTransforms) }},
-					{ (int)UpdateStep::PreRender,		{ PK_STEP_S(renderPipeline) }},
+					{ (int)UpdateStep::PreRender,		{ PK_STEP_S(renderPipeline->GetCullingStep()), PK_STEP_S(renderPipeline) }},
 					{ (int)UpdateStep::Render,			{ PK_STEP_S(renderPipeline), PK_STEP_S(gizmoRenderer), PK_STEP_S(engineScreenshot) }},
 					{ (int)UpdateStep::PostRender,		{ PK_STEP_S(renderPipeline) }},
-					{ (int)UpdateStep::CloseFrame,		{ PK_STEP_S(renderPipeline), input, time }},
+					{ (int)UpdateStep::CloseFrame,		{ PK_STEP_S(renderPipeline), PK_STEP_S(input), PK_STEP_S(time) }},
 				}
 			},
 			{
@@ -93,6 +111,7 @@ namespace PK::Core
 					PK_STEP_T(engineEditorCamera, ConsoleCommandToken),
 					PK_STEP_T(gizmoRenderer, ConsoleCommandToken),
 					PK_STEP_T(engineScreenshot, ConsoleCommandToken),
+					PK_STEP_T(renderPipeline, ConsoleCommandToken),
 				}
 			},
 			{
@@ -115,6 +134,30 @@ namespace PK::Core
 			(int)UpdateStep::PostRender,
 			(int)UpdateStep::CloseFrame
 		});
+
+		auto graphicsContext = ECS::GetTypeId<Structs::GraphicsContext>();
+		auto transforms = ECS::GetTypeId<ECS::Components::Transform>();
+		auto bounds = ECS::GetTypeId<ECS::Components::Bounds>();
+		auto renderHandles = ECS::GetTypeId<ECS::Components::RenderableHandle>();
+		auto lights = ECS::GetTypeId<ECS::Components::Light>();
+		auto cullingStep = renderPipeline->GetCullingStep();
+
+		// Engine steps that touch no graphics state. They are still ordered against each other through the transform components.
+		sequencer->SetStepAccess(engineDebug, { entityDb, time }, { transforms });
+		sequencer->SetStepAccess(engineUpdateTransforms, { entityDb }, { transforms, bounds });
+
+		// Camera culling runs on a worker once transforms are updated. It overlaps with the frame setup of the pipeline.
+		// The culling results are members of the culling step, so steps that read them declare the step as a read resource.
+		sequencer->SetStepAccess(cullingStep, { entityDb, transforms, bounds }, { cullingStep, renderHandles });
+
+		// Graphics steps run on the main thread. The pipeline prepares the frame before culling results are needed.
+		// Batching, light culling & shadow rendering follow in the render step, which reads the culling results.
+		sequencer->SetStepAccess(renderPipeline, { entityDb, transforms, bounds, lights, cullingStep }, { renderPipeline, renderHandles, graphicsContext }, true);
+		sequencer->SetStepAccess(renderPipeline, (int)UpdateStep::PreRender, { time }, { renderPipeline, graphicsContext }, true);
+		sequencer->SetStepAccess(time, { }, { time, renderPipeline }, true);
+		sequencer->SetStepAccess(gizmoRenderer, { entityDb, transforms, bounds, lights }, { gizmoRenderer, graphicsContext }, true);
+		sequencer->SetStepAccess(engineScreenshot, { }, { engineScreenshot, graphicsContext }, true);
+		sequencer->SetExecutionMode(config->EnableParallelSteps ? ECS::ExecutionMode::Parallel : ECS::ExecutionMode::Serial);
 	}
 	
 	Application::~Application()
@@ -122,8 +165,10 @@ namespace PK::Core
 		m_window = nullptr;
 		GetService<ECS::Sequencer>()->Release();
 		GetService<AssetDatabase>()->Unload();
+		GPUProfiler::Release();
 		GraphicsAPI::Terminate();
 		m_services->Clear();
+		FrameAllocator::Release();
 	}
 	
 	void Application::Run()
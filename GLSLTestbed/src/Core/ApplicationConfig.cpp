@@ -32,8 +32,23 @@ namespace PK::Core
 			&TimeScale,
 			&RandomSeed,
 			&ZCullLights,
+			&EnableCPULightAssignment,
+			&EnableOcclusionCulling,
+			&EnableOccluderRasterization,
+			&EnableParallelSteps,
+			&InstanceTransformFormat,
+			&EnableTextureStreaming,
+			&TextureStreamingBudget,
+			&TextureStreamingTailSize,
+			&TextureCacheDirectory,
+			&EnableCookedAssets,
 			&LightCount,
 			&ShadowmapTileSize,
+			&EnableShadowmapCaching,
+			&EnableSinglePassShadowCulling,
+			&EnableShadowCasterCameraCulling,
+			&EnableStableShadowCascades,
+			&ShadowCascadeUpdateInterval,
 			&ShadowmapTileCount,
 			&CameraFocalLength,
 			&CameraFNumber,
@@ -34,8 +34,23 @@ namespace PK::Core
 		BoxedValue<float> TimeScale	= BoxedValue<float>("TimeScale", 1.0f);
 
 		BoxedValue<bool> ZCullLights = BoxedValue<bool>("ZCullLights", true);
+		BoxedValue<bool> EnableCPULightAssignment = BoxedValue<bool>("EnableCPULightAssignment", false);
+		BoxedValue<bool> EnableOcclusionCulling = BoxedValue<bool>("EnableOcclusionCulling", true);
+		BoxedValue<bool> EnableOccluderRasterization = BoxedValue<bool>("EnableOccluderRasterization", true);
+		BoxedValue<bool> EnableParallelSteps = BoxedValue<bool>("EnableParallelSteps", true);
+		BoxedValue<std::string> InstanceTransformFormat = BoxedValue<std::string>("InstanceTransformFormat", "Float3x4");
+		BoxedValue<bool> EnableTextureStreaming = BoxedValue<bool>("EnableTextureStreaming", true);
+		BoxedValue<uint> TextureStreamingBudget = BoxedValue<uint>("TextureStreamingBudget", 256u);
+		BoxedValue<uint> TextureStreamingTailSize = BoxedValue<uint>("TextureStreamingTailSize", 128u);
+		BoxedValue<std::string> TextureCacheDirectory = BoxedValue<std::string>("TextureCacheDirectory", "res/cache/textures/");
+		BoxedValue<bool> EnableCookedAssets = BoxedValue<bool>("EnableCookedAssets", true);
 		BoxedValue<uint> LightCount = BoxedValue<uint>("LightCount", 0u);
 		BoxedValue<uint> ShadowmapTileSize = BoxedValue<uint>("ShadowmapTileSize", 512);
+		BoxedValue<bool> EnableShadowmapCaching = BoxedValue<bool>("EnableShadowmapCaching", true);
+		BoxedValue<bool> EnableSinglePassShadowCulling = BoxedValue<bool>("EnableSinglePassShadowCulling", false);
+		BoxedValue<bool> EnableShadowCasterCameraCulling = BoxedValue<bool>("EnableShadowCasterCameraCulling", true);
+		BoxedValue<bool> EnableStableShadowCascades = BoxedValue<bool>("EnableStableShadowCascades", true);
+		BoxedValue<uint> ShadowCascadeUpdateInterval = BoxedValue<uint>("ShadowCascadeUpdateInterval", 4u);
 		BoxedValue<uint> ShadowmapTileCount = BoxedValue<uint>("ShadowmapTileCount", 32);
 	
 		BoxedValue<float> CameraFocalLength	= BoxedValue<float>("CameraFocalLength", 0.05f);
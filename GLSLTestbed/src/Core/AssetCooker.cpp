@@ -0,0 +1,518 @@
+#include "PrecompiledHeader.h"
+#include "Core/AssetCooker.h"
+#include "Core/Profiler.h"
+#include "Core/ServiceRegister.h"
+#include "Core/ApplicationConfig.h"
+#include "ECS/Sequencer.h"
+#include "Utilities/Log.h"
+#include "Utilities/StringHashID.h"
+#include "Utilities/HashCache.h"
+#include "Utilities/StringUtilities.h"
+#include "Utilities/ThreadPool.h"
+#include "Rendering/TextureTranscoding.h"
+#include "Rendering/Objects/Shader.h"
+#include "Rendering/Objects/Mesh.h"
+#include "Rendering/Objects/Material.h"
+#include <fstream>
+
+namespace PK::Core
+{
+	using namespace PK::Rendering::Objects;
+
+	static constexpr uint BlobMagic = 0x4B4F4F43u; // "COOK"
+	static constexpr const char* ManifestName = "manifest.txt";
+	static constexpr const char* ManifestHeader = "PKCookManifest";
+
+	struct BlobHeader
+	{
+		uint magic;
+		uint formatVersion;
+		ulong key;
+	};
+
+	static ulong Hash(ulong hash, const void* data, size_t size)
+	{
+		// FNV-1a
+		auto bytes = reinterpret_cast<const unsigned char*>(data);
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	static std::string NormalizePath(const std::string& filepath)
+	{
+		return std::filesystem::path(filepath).lexically_normal().generic_string();
+	}
+
+	// Without a trailing separator, so that it compares equal to the paths of a directory iterator.
+	static std::filesystem::path NormalizeDirectory(const std::string& directory)
+	{
+		auto path = std::filesystem::path(directory).lexically_normal();
+		return path.has_filename() ? path : path.parent_path();
+	}
+
+	static bool TryGetFileTimes(const std::string& filepath, ulong* size, long long* modifiedTime)
+	{
+		std::error_code error;
+		*size = (ulong)std::filesystem::file_size(filepath, error);
+
+		if (error)
+		{
+			return false;
+		}
+
+		*modifiedTime = (long long)std::filesystem::last_write_time(filepath, error).time_since_epoch().count();
+		return !error;
+	}
+
+	AssetCooker::AssetCooker(const std::string& directory, const std::string& textureCacheDirectory) : m_directory(directory), m_textureCacheDirectory(textureCacheDirectory)
+	{
+		Register<Mesh>("Mesh", 1u);
+		Register<Shader>("Shader", 1u, [](const std::string& filepath, std::vector<std::string>* dependencies) { return Utilities::String::ReadFileRecursiveInclude(filepath, dependencies); });
+		Register<Material>("Material", 2u);
+
+		ReadManifest();
+	}
+
+	uint AssetCooker::Cook(const std::string& sourceDirectory, uint threadCount)
+	{
+		PK_PROFILE_FUNCTION();
+
+		auto startTime = Profiler::GetTimestamp();
+		auto cookDirectory = NormalizeDirectory(m_directory);
+		auto textureCacheDirectory = m_textureCacheDirectory.empty() ? std::filesystem::path() : NormalizeDirectory(m_textureCacheDirectory);
+		std::error_code error;
+
+		std::filesystem::create_directories(m_directory, error);
+		m_jobs.clear();
+
+		for (auto iterator = std::filesystem::recursive_directory_iterator(sourceDirectory, error); iterator != std::filesystem::recursive_directory_iterator(); iterator.increment(error))
+		{
+			auto& path = iterator->path();
+
+			if (iterator->is_directory() && (path.lexically_normal() == cookDirectory || path.lexically_normal() == textureCacheDirectory))
+			{
+				iterator.disable_recursion_pending();
+				continue;
+			}
+
+			if (!iterator->is_regular_file() || !path.has_extension())
+			{
+				continue;
+			}
+
+			auto cooker = FindCooker(path.extension());
+
+			if (cooker != nullptr)
+			{
+				CookJob job;
+				job.filepath = NormalizePath(path.string());
+				job.cooker = cooker;
+				m_jobs.push_back(job);
+			}
+		}
+
+		if (!m_jobs.empty())
+		{
+			// The pool finishes its queue before it is destroyed.
+			Utilities::ThreadPool threadPool(threadCount > 0u ? threadCount : 1u);
+
+			for (auto i = 0u; i < m_jobs.size(); ++i)
+			{
+				threadPool.Enqueue({ ExecuteCookJob, this, i });
+			}
+		}
+
+		auto cookedCount = 0u;
+		auto skippedCount = 0u;
+		auto failedCount = 0u;
+		ulong cookedSize = 0ull;
+		std::unordered_set<std::string> blobPaths;
+
+		m_manifest.clear();
+
+		for (auto& job : m_jobs)
+		{
+			cookedCount += job.isCooked ? 1u : 0u;
+			skippedCount += job.isSkipped ? 1u : 0u;
+			cookedSize += job.blobSize;
+
+			if (job.isFailed)
+			{
+				failedCount++;
+				continue;
+			}
+
+			m_manifest[job.filepath] = job.entry;
+
+			if (job.entry.hasBlob)
+			{
+				blobPaths.insert(NormalizePath(GetBlobPath(job.entry.key)));
+			}
+		}
+
+		WriteManifest();
+
+		// Blobs that no source refers to anymore & leftovers from interrupted writes.
+		auto removedCount = 0u;
+
+		for (const auto& entry : std::filesystem::directory_iterator(m_directory, error))
+		{
+			auto extension = entry.path().extension();
+
+			if ((extension.compare(".bin") == 0 && blobPaths.count(NormalizePath(entry.path().string())) == 0) || extension.compare(".tmp") == 0)
+			{
+				removedCount += std::filesystem::remove(entry.path(), error) ? 1u : 0u;
+			}
+		}
+
+		auto milliseconds = (Profiler::GetTimestamp() - startTime) / 1000000ull;
+		PK_CORE_LOG("Cooked %u assets (%.2f MB) in %llu ms. %u were up to date, %u failed & %u stale blobs were removed.", cookedCount, cookedSize / (1024.0 * 1024.0), milliseconds, skippedCount, failedCount, removedCount);
+
+		m_jobs.clear();
+		return cookedCount;
+	}
+
+	bool AssetCooker::TryImport(const std::string& filepath, std::type_index type, const Ref<Asset>& asset) const
+	{
+		auto entry = m_manifest.find(NormalizePath(filepath));
+
+		if (entry == m_manifest.end() || !entry->second.hasBlob)
+		{
+			return false;
+		}
+
+		auto cooker = FindCooker(std::filesystem::path(filepath).extension());
+
+		if (cooker == nullptr || cooker->type != type)
+		{
+			return false;
+		}
+
+		ulong size;
+		long long modifiedTime;
+
+		if (!TryGetFileTimes(filepath, &size, &modifiedTime) || size != entry->second.size || modifiedTime != entry->second.modifiedTime)
+		{
+			return false;
+		}
+
+		for (auto& dependency : entry->second.dependencies)
+		{
+			if (!TryGetFileTimes(dependency.filepath, &size, &modifiedTime) || size != dependency.size || modifiedTime != dependency.modifiedTime)
+			{
+				return false;
+			}
+		}
+
+		std::ifstream file(GetBlobPath(entry->second.key), std::ios::in | std::ios::binary | std::ios::ate);
+
+		if (!file)
+		{
+			return false;
+		}
+
+		std::vector<char> data((size_t)file.tellg());
+		file.seekg(0, std::ios::beg);
+		file.read(data.data(), data.size());
+
+		BlobHeader header;
+
+		if (!file || data.size() < sizeof(BlobHeader))
+		{
+			return false;
+		}
+
+		memcpy(&header, data.data(), sizeof(BlobHeader));
+
+		if (header.magic != BlobMagic || header.formatVersion != FormatVersion || header.key != entry->second.key)
+		{
+			PK_CORE_LOG_WARNING("Cooked blob for (%s) is invalid. Importing from source.", filepath.c_str());
+			return false;
+		}
+
+		cooker->import(filepath, data.data() + sizeof(BlobHeader), data.size() - sizeof(BlobHeader), asset);
+		return true;
+	}
+
+	bool AssetCooker::TryParseArguments(int argc, char** argv)
+	{
+		for (auto i = 1; i < argc; ++i)
+		{
+			if (strcmp(argv[i], "-cook") == 0)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void AssetCooker::Run(uint threadCount)
+	{
+		auto services = CreateScope<ServiceRegister>();
+		services->Create<StringHashID>();
+		services->Create<HashCache>();
+		auto sequencer = services->Create<ECS::Sequencer>();
+		auto assetDatabase = services->Create<AssetDatabase>(sequencer);
+
+		assetDatabase->LoadDirectory<ApplicationConfig>("res/configs/");
+		auto config = assetDatabase->Find<ApplicationConfig>("Active");
+
+		Rendering::TextureTranscoding::SetCacheDirectory(config->TextureCacheDirectory.value);
+		Rendering::TextureTranscoding::TranscodeDirectory("res/textures/", threadCount);
+
+		AssetCooker cooker(DefaultDirectory, config->TextureCacheDirectory.value);
+		cooker.Cook("res/", threadCount);
+	}
+
+	std::string AssetCooker::ReadFileSource(const std::string& filepath, std::vector<std::string>* dependencies)
+	{
+		std::ifstream file(filepath, std::ios::in | std::ios::binary | std::ios::ate);
+
+		if (!file)
+		{
+			return std::string();
+		}
+
+		std::string source;
+		source.resize((size_t)file.tellg());
+		file.seekg(0, std::ios::beg);
+		file.read(source.data(), source.size());
+		return source;
+	}
+
+	void AssetCooker::ExecuteCookJob(void* context, uint32_t index)
+	{
+		auto cooker = reinterpret_cast<AssetCooker*>(context);
+		auto& job = cooker->m_jobs.at(index);
+
+		// Parsers throw on malformed sources. One broken asset must not take down the pool.
+		try
+		{
+			CookAsset(cooker, job, index);
+		}
+		catch (const std::exception& exception)
+		{
+			PK_CORE_LOG_WARNING("Failed to cook asset (%s): %s", job.filepath.c_str(), exception.what());
+			job.isCooked = false;
+			job.isSkipped = false;
+			job.isFailed = true;
+		}
+	}
+
+	void AssetCooker::CookAsset(AssetCooker* cooker, CookJob& job, uint32_t index)
+	{
+		auto& entry = job.entry;
+
+		if (!TryGetFileTimes(job.filepath, &entry.size, &entry.modifiedTime))
+		{
+			PK_CORE_LOG_WARNING("Failed to read asset (%s) for cooking.", job.filepath.c_str());
+			job.isFailed = true;
+			return;
+		}
+
+		std::vector<std::string> dependencies;
+		auto source = job.cooker->readSource(job.filepath, &dependencies);
+
+		for (auto& filepath : dependencies)
+		{
+			Dependency dependency;
+			dependency.filepath = NormalizePath(filepath);
+
+			if (!TryGetFileTimes(dependency.filepath, &dependency.size, &dependency.modifiedTime))
+			{
+				PK_CORE_LOG_WARNING("Failed to read dependency (%s) of asset (%s) for cooking.", dependency.filepath.c_str(), job.filepath.c_str());
+				job.isFailed = true;
+				return;
+			}
+
+			entry.dependencies.push_back(dependency);
+		}
+
+		entry.key = Hash(14695981039346656037ull, source.data(), source.size());
+		entry.key = Hash(entry.key, job.cooker->name.data(), job.cooker->name.size());
+		entry.key = Hash(entry.key, &job.cooker->version, sizeof(job.cooker->version));
+		entry.key = Hash(entry.key, &FormatVersion, sizeof(FormatVersion));
+
+		auto blobPath = cooker->GetBlobPath(entry.key);
+		auto previous = cooker->m_manifest.find(job.filepath);
+
+		// Sources with identical contents share a blob, so an existing blob is only reused for the key it was written with.
+		if (previous != cooker->m_manifest.end() && previous->second.key == entry.key && previous->second.hasBlob && std::filesystem::exists(blobPath))
+		{
+			entry.hasBlob = true;
+			job.isSkipped = true;
+			return;
+		}
+
+		std::vector<char> data(sizeof(BlobHeader));
+		BlobHeader header = { BlobMagic, FormatVersion, entry.key };
+		memcpy(data.data(), &header, sizeof(BlobHeader));
+
+		{
+			PK_PROFILE_TRACE_SCOPE(job.filepath, "cook");
+
+			if (!job.cooker->cook(job.filepath, source, data))
+			{
+				PK_CORE_LOG_WARNING("Failed to cook asset (%s).", job.filepath.c_str());
+				job.isFailed = true;
+				return;
+			}
+		}
+
+		// Written to a temporary file first so that an interrupted cook is never read as a blob. The job index keeps sources with identical contents from writing to the same file.
+		auto temporaryPath = blobPath + "." + std::to_string(index) + ".tmp";
+		std::error_code error;
+
+		{
+			std::ofstream file(temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc);
+			file.write(data.data(), data.size());
+
+			if (!file)
+			{
+				file.close();
+				std::filesystem::remove(temporaryPath, error);
+				PK_CORE_LOG_WARNING("Failed to write cooked asset (%s).", job.filepath.c_str());
+				job.isFailed = true;
+				return;
+			}
+		}
+
+		std::filesystem::rename(temporaryPath, blobPath, error);
+
+		if (error)
+		{
+			std::filesystem::remove(temporaryPath, error);
+			PK_CORE_LOG_WARNING("Failed to move cooked asset (%s) to (%s).", job.filepath.c_str(), blobPath.c_str());
+			job.isFailed = true;
+			return;
+		}
+
+		entry.hasBlob = true;
+		job.isCooked = true;
+		job.blobSize = data.size();
+	}
+
+	const AssetCooker::Cooker* AssetCooker::FindCooker(const std::filesystem::path& extension) const
+	{
+		for (auto& cooker : m_cookers)
+		{
+			if (cooker.isValidExtension(extension))
+			{
+				return &cooker;
+			}
+		}
+
+		return nullptr;
+	}
+
+	std::string AssetCooker::GetBlobPath(ulong key) const
+	{
+		char filename[32];
+		snprintf(filename, sizeof(filename), "%016llx.bin", key);
+		return (std::filesystem::path(m_directory) / filename).string();
+	}
+
+	void AssetCooker::ReadManifest()
+	{
+		m_manifest.clear();
+
+		std::ifstream file(std::filesystem::path(m_directory) / ManifestName);
+
+		if (!file)
+		{
+			return;
+		}
+
+		std::string header;
+		uint formatVersion = 0u;
+		file >> header >> formatVersion;
+
+		// Blobs of an older format are cooked again & the stale ones are removed by the next cook.
+		if (header != ManifestHeader || formatVersion != FormatVersion)
+		{
+			return;
+		}
+
+		std::string line;
+
+		// Each entry is followed by one line per dependency. An entry with missing dependency lines is dropped & cooked again.
+		while (std::getline(file, line))
+		{
+			std::istringstream stream(line);
+			ManifestEntry entry;
+			std::string key;
+			int hasBlob = 0;
+			uint dependencyCount = 0u;
+			std::string path;
+
+			if (!(stream >> key >> hasBlob >> entry.size >> entry.modifiedTime >> dependencyCount) || !std::getline(stream >> std::ws, path))
+			{
+				continue;
+			}
+
+			for (auto i = 0u; i < dependencyCount && std::getline(file, line); ++i)
+			{
+				std::istringstream dependencyStream(line);
+				Dependency dependency;
+
+				if (dependencyStream >> dependency.size >> dependency.modifiedTime && std::getline(dependencyStream >> std::ws, dependency.filepath))
+				{
+					entry.dependencies.push_back(dependency);
+				}
+			}
+
+			if (entry.dependencies.size() != dependencyCount)
+			{
+				continue;
+			}
+
+			entry.key = std::stoull(key, nullptr, 16);
+			entry.hasBlob = hasBlob != 0;
+			m_manifest[path] = entry;
+		}
+	}
+
+	void AssetCooker::WriteManifest() const
+	{
+		auto manifestPath = (std::filesystem::path(m_directory) / ManifestName).string();
+		auto temporaryPath = manifestPath + ".tmp";
+		std::error_code error;
+
+		{
+			std::ofstream file(temporaryPath, std::ios::out | std::ios::trunc);
+			file << ManifestHeader << " " << FormatVersion << "\n";
+
+			for (auto& kv : m_manifest)
+			{
+				char key[32];
+				snprintf(key, sizeof(key), "%016llx", kv.second.key);
+				file << key << " " << (kv.second.hasBlob ? 1 : 0) << " " << kv.second.size << " " << kv.second.modifiedTime << " " << kv.second.dependencies.size() << " " << kv.first << "\n";
+
+				for (auto& dependency : kv.second.dependencies)
+				{
+					file << dependency.size << " " << dependency.modifiedTime << " " << dependency.filepath << "\n";
+				}
+			}
+
+			if (!file)
+			{
+				PK_CORE_LOG_WARNING("Failed to write the cook manifest (%s).", manifestPath.c_str());
+				return;
+			}
+		}
+
+		std::filesystem::rename(temporaryPath, manifestPath, error);
+	}
+
+	bool AssetDatabase::TryImportCooked(const std::string& filepath, std::type_index type, const Ref<Asset>& asset) const
+	{
+		return m_assetCooker != nullptr && m_assetCooker->TryImport(filepath, type, asset);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+#include "Core/IService.h"
+#include "Core/AssetDataBase.h"
+#include <functional>
+#include <typeindex>
+
+namespace PK::Core
+{
+    // Converts source assets into blobs that import without parsing. Started with -cook, which cooks everything under res/ into DefaultDirectory.
+    // Blobs are content addressed by a hash of the source & the cooker version. Unchanged sources are skipped, so repeated cooks only redo what was edited.
+    // The manifest maps source paths to blobs. A blob is only imported while its source & every file it includes still have the size & modification time it was cooked from.
+    // Transcoded ktx 2 textures are not cooked. They are kept in the texture transcoding cache, which the cook skips & fills.
+    class AssetCooker : public IService
+    {
+        public:
+            static constexpr const char* DefaultDirectory = "res/cooked/";
+            // Bumped whenever the blob or manifest layout changes.
+            static constexpr uint FormatVersion = 2u;
+
+        private:
+            struct Cooker
+            {
+                std::type_index type = std::type_index(typeid(void));
+                std::string name;
+                uint version = 0u;
+                std::function<bool(const std::filesystem::path& extension)> isValidExtension;
+                // Files that the source pulls in are appended to dependencies.
+                std::function<std::string(const std::string& filepath, std::vector<std::string>* dependencies)> readSource;
+                std::function<bool(const std::string& filepath, const std::string& source, std::vector<char>& data)> cook;
+                std::function<void(const std::string& filepath, const char* data, size_t size, const Ref<Asset>& asset)> import;
+            };
+
+            struct Dependency
+            {
+                std::string filepath;
+                ulong size = 0ull;
+                long long modifiedTime = 0ll;
+            };
+
+            struct ManifestEntry
+            {
+                ulong key = 0ull;
+                bool hasBlob = false;
+                ulong size = 0ull;
+                long long modifiedTime = 0ll;
+                std::vector<Dependency> dependencies;
+            };
+
+            struct CookJob
+            {
+                std::string filepath;
+                const Cooker* cooker = nullptr;
+                ManifestEntry entry;
+                bool isCooked = false;
+                bool isSkipped = false;
+                bool isFailed = false;
+                ulong blobSize = 0ull;
+            };
+
+        public:
+            // Sources under textureCacheDirectory are transcoding output & are never cooked.
+            AssetCooker(const std::string& directory, const std::string& textureCacheDirectory);
+
+            // Cooks every asset in the directory tree that has changed since the previous cook. Returns the number of cooked assets.
+            uint Cook(const std::string& sourceDirectory, uint threadCount);
+
+            // Returns false if there is no up to date blob for the file, in which case it should be imported from its source.
+            bool TryImport(const std::string& filepath, std::type_index type, const Ref<Asset>& asset) const;
+
+            static bool TryParseArguments(int argc, char** argv);
+
+            // Fills the texture transcoding cache & cooks everything under res/.
+            static void Run(uint threadCount);
+
+        private:
+            template<typename T>
+            void Register(const std::string& name, uint version, std::function<std::string(const std::string& filepath, std::vector<std::string>* dependencies)> readSource = ReadFileSource)
+            {
+                Cooker cooker;
+                cooker.type = std::type_index(typeid(T));
+                cooker.name = name;
+                cooker.version = version;
+                cooker.isValidExtension = AssetImporters::IsValidExtension<T>;
+                cooker.readSource = readSource;
+                cooker.cook = AssetImporters::Cook<T>;
+                cooker.import = [](const std::string& filepath, const char* data, size_t size, const Ref<Asset>& asset)
+                {
+                    auto typedAsset = std::static_pointer_cast<T>(asset);
+                    AssetImporters::ImportCooked<T>(filepath, data, size, typedAsset);
+                };
+
+                m_cookers.push_back(cooker);
+            }
+
+            static std::string ReadFileSource(const std::string& filepath, std::vector<std::string>* dependencies);
+            static void ExecuteCookJob(void* context, uint32_t index);
+            static void CookAsset(AssetCooker* cooker, CookJob& job, uint32_t index);
+
+            const Cooker* FindCooker(const std::filesystem::path& extension) const;
+            std::string GetBlobPath(ulong key) const;
+            void ReadManifest();
+            void WriteManifest() const;
+
+            std::string m_directory;
+            std::string m_textureCacheDirectory;
+            std::vector<Cooker> m_cookers;
+            std::unordered_map<std::string, ManifestEntry> m_manifest;
+            std::vector<CookJob> m_jobs;
+    };
+}
\ No newline at end of file
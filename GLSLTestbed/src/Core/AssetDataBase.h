@@ -6,6 +6,7 @@
 #include "Utilities/Log.h"
 #include "Core/ServiceRegister.h"
 #include "Core/NoCopy.h"
+#include "Core/Profiler.h"
 #include "ECS/Sequencer.h"
 #include <filesystem>
 
@@ -52,7 +53,16 @@ namespace PK::Core
 
         template<typename T>
         void Import(const std::string& filepath, Ref<T>& asset);
+
+        // Only needed by types that are registered with the AssetCooker. Returns false if the asset could not be cooked.
+        template<typename T>
+        bool Cook(const std::string& filepath, const std::string& source, std::vector<char>& data);
+
+        template<typename T>
+        void ImportCooked(const std::string& filepath, const char* data, size_t size, Ref<T>& asset);
     };
+
+    class AssetCooker;
     
     class AssetDatabase : public IService
     {
@@ -74,7 +84,14 @@ namespace PK::Core
                 collection[assetId] = asset;
                 std::static_pointer_cast<Asset>(asset)->m_assetId = assetId;
     
-                AssetImporters::Import<T>(filepath, asset);
+                {
+                    PK_PROFILE_TRACE_SCOPE(filepath, "asset");
+
+                    if (!TryImportCooked(filepath, std::type_index(typeid(T)), asset))
+                    {
+                        AssetImporters::Import<T>(filepath, asset);
+                    }
+                }
     
                 AssetImportToken<T> importToken = { this, asset.get() };
                 m_sequencer->Next(this, &importToken, (int)AssetImportType::IMPORT);
@@ -102,7 +119,10 @@ namespace PK::Core
                     std::static_pointer_cast<Asset>(asset)->m_assetId = assetId;
                 }
     
-                AssetImporters::Import<T>(filepath, asset);
+                {
+                    PK_PROFILE_TRACE_SCOPE(filepath, "asset");
+                    AssetImporters::Import<T>(filepath, asset);
+                }
     
                 AssetImportToken<T> importToken = { this, asset.get() };
                 m_sequencer->Next(this, &importToken, (int)AssetImportType::RELOAD);
@@ -113,6 +133,9 @@ namespace PK::Core
         public:
             AssetDatabase(ECS::Sequencer* sequencer) : m_sequencer(sequencer) {}
 
+            // Loads import cooked blobs when the cooker has an up to date one. Reloads always use the regular importers as they follow edits to the source files.
+            inline void SetAssetCooker(const AssetCooker* assetCooker) { m_assetCooker = assetCooker; }
+
             template<typename T, typename ... Args>
             T* CreateProcedural(std::string name, Args&& ... args)
             {
@@ -331,7 +354,10 @@ namespace PK::Core
             }
 
         private:
+            bool TryImportCooked(const std::string& filepath, std::type_index type, const Ref<Asset>& asset) const;
+
             std::unordered_map<std::type_index, std::unordered_map<AssetID, Ref<Asset>>> m_assets;
             ECS::Sequencer* m_sequencer;
+            const AssetCooker* m_assetCooker = nullptr;
     };
 }
\ No newline at end of file
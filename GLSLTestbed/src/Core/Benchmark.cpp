@@ -0,0 +1,661 @@
+#include "PrecompiledHeader.h"
+#include "Utilities/Log.h"
+#include "Utilities/StringHashID.h"
+#include "Utilities/HashCache.h"
+#include "Utilities/FrameAllocator.h"
+#include "Core/Benchmark.h"
+#include "Core/BenchmarkSuites.h"
+#include "Core/Profiler.h"
+#include "Core/ServiceRegister.h"
+#include "Core/ApplicationConfig.h"
+#include "Core/UpdateStep.h"
+#include "ECS/EntityDatabase.h"
+#include "ECS/Sequencer.h"
+#include "ECS/Contextual/Implementers/Implementers.h"
+#include "ECS/Contextual/EntityViews/EntityViews.h"
+#include "ECS/Contextual/Builders/Builders.h"
+#include "ECS/Contextual/Engines/EngineUpdateTransforms.h"
+#include "Rendering/NullGraphicsBackend.h"
+#include "Rendering/GraphicsAPI.h"
+#include "Rendering/MeshUtility.h"
+#include "Rendering/Batching.h"
+#include "Rendering/Culling.h"
+#include "Rendering/FrameSetup.h"
+#include "Rendering/LightsManager.h"
+#include <atomic>
+
+#if defined(PK_DEBUG)
+#include <crtdbg.h>
+#endif
+
+static std::atomic<bool> s_countAllocations = false;
+static std::atomic<uint64_t> s_allocationCount = 0;
+static std::atomic<uint64_t> s_allocationBytes = 0;
+
+#if defined(PK_DEBUG)
+// Observes the debug heap instead of replacing operator new, so the leak tracking enabled in main stays intact.
+// Release builds have no allocation hook & report allocations as unavailable.
+static constexpr bool s_allocationCountingAvailable = true;
+
+static int CountAllocation(int allocType, void* userData, size_t size, int blockType, long requestNumber, const unsigned char* filename, int lineNumber)
+{
+	if ((allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC) && blockType != _CRT_BLOCK && s_countAllocations.load(std::memory_order_relaxed))
+	{
+		s_allocationCount.fetch_add(1ull, std::memory_order_relaxed);
+		s_allocationBytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	return TRUE;
+}
+#else
+static constexpr bool s_allocationCountingAvailable = false;
+#endif
+
+namespace PK::Core::Benchmark
+{
+	using namespace PK::Utilities;
+	using namespace PK::Rendering;
+	using namespace PK::Rendering::Objects;
+	using namespace PK::Rendering::Structs;
+	using namespace PK::ECS;
+	using namespace PK::Math;
+
+	enum class Stage
+	{
+		Transforms,
+		Culling,
+		Batching,
+		Lights,
+		Draw,
+		Count
+	};
+
+	static const char* StageNames[(int)Stage::Count] = { "Transforms", "Culling", "Batching", "Lights", "Draw" };
+
+	struct Measurement
+	{
+		uint32_t entityCount = 0;
+		uint64_t stageNanoseconds[(int)Stage::Count] = {};
+		uint64_t stageMinNanoseconds[(int)Stage::Count] = {};
+		uint64_t allocations = 0;
+		uint64_t allocationBytes = 0;
+		uint64_t frameAllocatorBytes = 0;
+		uint64_t frameAllocatorHeapAllocations = 0;
+		uint64_t visibleCount = 0;
+		uint64_t drawCallCount = 0;
+		NullGraphicsBackend::Counters backend;
+		GraphicsAPI::StateCacheCounters stateCache;
+	};
+
+	static void CreateMeshRenderable(EntityDatabase* entityDb, const float3& position, const float3& rotation, float size, Mesh* mesh, Material* material)
+	{
+		auto egid = EGID(entityDb->ReserveEntityId(), (uint)ENTITY_GROUPS::ACTIVE);
+		auto implementer = entityDb->ResereveImplementer<Implementers::MeshRenderableImplementer>();
+		auto transformView = entityDb->ReserveEntityView<EntityViews::TransformView>(egid);
+		auto baseView = entityDb->ReserveEntityView<EntityViews::BaseRenderable>(egid);
+		auto meshView = entityDb->ReserveEntityView<EntityViews::MeshRenderable>(egid);
+
+		transformView->bounds = static_cast<Components::Bounds*>(implementer);
+		transformView->transform = static_cast<Components::Transform*>(implementer);
+		baseView->bounds = static_cast<Components::Bounds*>(implementer);
+		baseView->handle = static_cast<Components::RenderableHandle*>(implementer);
+		meshView->materials = static_cast<Components::Materials*>(implementer);
+		meshView->mesh = static_cast<Components::MeshReference*>(implementer);
+		meshView->transform = static_cast<Components::Transform*>(implementer);
+
+		implementer->localAABB = mesh->GetLocalBounds();
+		implementer->isCullable = true;
+		implementer->isVisible = false;
+		implementer->position = position;
+		implementer->rotation = glm::quat(rotation * PK_FLOAT_DEG2RAD);
+		implementer->scale = PK_FLOAT3_ONE * size;
+		implementer->sharedMaterials.push_back(material);
+		implementer->sharedMesh = mesh;
+		implementer->flags = Components::RenderHandleFlags::Renderer | Components::RenderHandleFlags::ShadowCaster;
+	}
+
+	static void CreateLight(EntityDatabase* entityDb, const float3& position, const float3& rotation, const color& color, bool castShadows, LightType type)
+	{
+		auto egid = EGID(entityDb->ReserveEntityId(), (uint)ENTITY_GROUPS::ACTIVE);
+		auto implementer = entityDb->ResereveImplementer<Implementers::LightImplementer>();
+		auto transformView = entityDb->ReserveEntityView<EntityViews::TransformView>(egid);
+		auto baseView = entityDb->ReserveEntityView<EntityViews::BaseRenderable>(egid);
+		auto lightView = entityDb->ReserveEntityView<EntityViews::LightRenderable>(egid);
+
+		transformView->bounds = static_cast<Components::Bounds*>(implementer);
+		transformView->transform = static_cast<Components::Transform*>(implementer);
+		baseView->bounds = static_cast<Components::Bounds*>(implementer);
+		baseView->handle = static_cast<Components::RenderableHandle*>(implementer);
+		lightView->light = static_cast<Components::Light*>(implementer);
+		lightView->transform = static_cast<Components::Transform*>(implementer);
+
+		implementer->position = position;
+		implementer->rotation = glm::quat(rotation * PK_FLOAT_DEG2RAD);
+
+		if (type == LightType::Directional)
+		{
+			ECS::Builders::InitializeLightValues(implementer, color, type, LightCookie::NoCookie, castShadows, 90.0f, 50.0f);
+			implementer->color = color;
+			return;
+		}
+
+		ECS::Builders::InitializeLightValues(implementer, color, type, LightCookie::NoCookie, castShadows, 90.0f);
+	}
+
+	static void CreateScene(AssetDatabase* assetDatabase, EntityDatabase* entityDb, const Settings& settings, Scene* scene)
+	{
+		scene->entityDb = entityDb;
+		scene->meshes.push_back(assetDatabase->RegisterProcedural<Mesh>("Benchmark_Sphere", MeshUtility::GetSphere(PK_FLOAT3_ZERO, 1.0f)));
+		scene->meshes.push_back(assetDatabase->RegisterProcedural<Mesh>("Benchmark_Box", MeshUtility::GetBox(PK_FLOAT3_ZERO, PK_FLOAT3_ONE)));
+		scene->meshes.push_back(assetDatabase->RegisterProcedural<Mesh>("Benchmark_Plane", MeshUtility::GetPlane(PK_FLOAT2_ZERO, PK_FLOAT2_ONE, { 4, 4 })));
+
+		auto shader = assetDatabase->Find<Shader>("SH_WS_PBR_Forward");
+
+		for (auto i = 0u; i < settings.materialCount; ++i)
+		{
+			auto material = assetDatabase->RegisterProcedural("Benchmark_Material_" + std::to_string(i), CreateRef<Material>(shader));
+			material->SetFloat4(HashCache::Get()->_Color, Functions::HueToRGB(i / (float)settings.materialCount));
+			scene->materials.push_back(material);
+		}
+
+		srand(settings.randomSeed);
+
+		for (auto i = 0u; i < settings.lightCount; ++i)
+		{
+			auto type = (i & 1) ? LightType::Point : LightType::Spot;
+			auto color = Functions::HueToRGB(Functions::RandomRangeFloat(0.0f, 1.0f)) * Functions::RandomRangeFloat(2.0f, 6.0f);
+			CreateLight(entityDb, Functions::RandomRangeFloat3(SceneMin, SceneMax), Functions::RandomEuler(), color, (i & 2) == 0, type);
+		}
+
+		CreateLight(entityDb, PK_FLOAT3_ZERO, { 25, -35, 0 }, Functions::HexToRGB(0xFFA575FF) * 2.0f, true, LightType::Directional);
+	}
+
+	// Entities are only ever added so each measurement reuses the scene of the previous one.
+	static void GrowScene(Scene* scene, uint32_t entityCount)
+	{
+		for (; scene->entityCount < entityCount; ++scene->entityCount)
+		{
+			auto mesh = scene->meshes.at(rand() % scene->meshes.size());
+			auto material = scene->materials.at(rand() % scene->materials.size());
+			CreateMeshRenderable(scene->entityDb, Functions::RandomRangeFloat3(SceneMin, SceneMax), Functions::RandomEuler(), Functions::RandomRangeFloat(0.5f, 2.0f), mesh, material);
+		}
+	}
+
+	void GetCameraMatrices(uint32_t frameIndex, float4x4* view, float4x4* proj)
+	{
+		const auto fieldOfView = 75.0f;
+		const auto aspect = 16.0f / 9.0f;
+		const auto zNear = 0.1f;
+		const auto zFar = 200.0f;
+		const auto orbitRadius = 60.0f;
+
+		auto yaw = frameIndex * 0.02f;
+		auto rotation = glm::quat(float3(20.0f * PK_FLOAT_DEG2RAD, yaw, 0.0f));
+		auto position = rotation * float3(0.0f, 0.0f, -orbitRadius);
+		*view = Functions::GetMatrixInvTRS(position, rotation, PK_FLOAT3_ONE);
+		*proj = Functions::GetPerspective(fieldOfView, aspect, zNear, zFar);
+	}
+
+	static void SetCamera(uint32_t frameIndex)
+	{
+		float4x4 view, proj;
+		GetCameraMatrices(frameIndex, &view, &proj);
+		GraphicsAPI::SetViewProjectionMatrices(view, proj);
+	}
+
+	class StageTimer : public NoCopy
+	{
+		public:
+			StageTimer(Measurement* measurement, Stage stage) : m_measurement(measurement), m_stage((int)stage)
+			{
+				m_allocationCount = s_allocationCount.load(std::memory_order_relaxed);
+				m_allocationBytes = s_allocationBytes.load(std::memory_order_relaxed);
+				s_countAllocations.store(true, std::memory_order_relaxed);
+				m_begin = Profiler::GetTimestamp();
+			}
+
+			~StageTimer()
+			{
+				auto duration = Profiler::GetTimestamp() - m_begin;
+				s_countAllocations.store(false, std::memory_order_relaxed);
+				m_measurement->stageNanoseconds[m_stage] += duration;
+				m_measurement->stageMinNanoseconds[m_stage] = duration < m_measurement->stageMinNanoseconds[m_stage] ? duration : m_measurement->stageMinNanoseconds[m_stage];
+				m_measurement->allocations += s_allocationCount.load(std::memory_order_relaxed) - m_allocationCount;
+				m_measurement->allocationBytes += s_allocationBytes.load(std::memory_order_relaxed) - m_allocationBytes;
+			}
+
+		private:
+			Measurement* m_measurement;
+			int m_stage;
+			uint64_t m_begin;
+			uint64_t m_allocationCount;
+			uint64_t m_allocationBytes;
+	};
+
+	// Runs the same frame setup as RenderPipeline without occlusion culling & texture streaming.
+	static void ExecuteFrame(Scene* scene,
+		const GraphicsContext* context,
+		ECS::Engines::EngineUpdateTransforms* engineUpdateTransforms,
+		Culling::VisibilityCache* visibilityCache,
+		Batching::DynamicBatchCollection* batches,
+		LightsManager* lightsManager,
+		Measurement* measurement)
+	{
+		auto* hashCache = HashCache::Get();
+		auto* entityDb = scene->entityDb;
+		const uint2 resolution = { 1920, 1080 };
+		auto viewProjection = GraphicsAPI::GetActiveViewProjectionMatrix();
+
+		{
+			StageTimer timer(measurement, Stage::Transforms);
+			engineUpdateTransforms->Step((int)UpdateStep::UpdateEngines);
+		}
+
+		{
+			StageTimer timer(measurement, Stage::Culling);
+			FrameSetup::CullCameraFrustum(entityDb, visibilityCache, viewProjection, (ushort)(Components::RenderHandleFlags::Renderer | Components::RenderHandleFlags::Light));
+		}
+
+		const float4 projParams = *context->ShaderProperties.GetPropertyPtr<float4>(hashCache->pk_ProjectionParams);
+		const float4x4& projection = *context->ShaderProperties.GetPropertyPtr<float4x4>(hashCache->pk_MATRIX_P);
+		ShadowCascadeReceivers receivers(lightsManager->GetCascadeZSplits(projParams.x, projParams.y));
+
+		{
+			StageTimer timer(measurement, Stage::Batching);
+			FrameSetup::BuildDynamicBatches(entityDb, visibilityCache, nullptr, nullptr, viewProjection, 0.5f * resolution.y * projection[1][1], nullptr, batches, &receivers);
+		}
+
+		{
+			StageTimer timer(measurement, Stage::Lights);
+			FrameSetup::PreprocessLights(lightsManager, entityDb, visibilityCache, context->ShaderProperties, resolution, &receivers);
+		}
+
+		{
+			StageTimer timer(measurement, Stage::Draw);
+			Batching::DrawBatches(batches);
+			Batching::DrawTransparent(batches);
+		}
+
+		measurement->visibleCount += visibilityCache->GetList(Culling::CullingGroup::CameraFrustum, (ushort)Components::RenderHandleFlags::Renderer).count;
+		measurement->drawCallCount += batches->TotalDrawCallCount + batches->TransparentDrawCallCount;
+	}
+
+	static void LogMeasurements(const std::vector<Measurement>& measurements, const Settings& settings)
+	{
+		PK::Utilities::Debug::InsertNewLine();
+		auto transformFormat = Batching::GetInstanceTransformFormatName(Batching::GetInstanceTransformFormat());
+		PK_CORE_LOG_HEADER("Benchmark: %u frames, %u lights, %u materials, %s instance transforms. Stage times are ns/frame (avg / min).", settings.frameCount, settings.lightCount, settings.materialCount, transformFormat);
+		PK_CORE_LOG("%-9s %-9s %-21s %-21s %-21s %-21s %-21s %-11s %-8s %-10s %-9s %-9s %-10s %-10s %-9s", "Entities", "Visible", StageNames[0], StageNames[1], StageNames[2], StageNames[3], StageNames[4], "Total", "ns/ent", "Allocs", "KB alloc", "KB frame", "Frame heap", "GL calls", "KB upload");
+
+		for (auto& m : measurements)
+		{
+			char stages[(int)Stage::Count][32];
+			uint64_t total = 0ull;
+
+			for (auto i = 0; i < (int)Stage::Count; ++i)
+			{
+				snprintf(stages[i], sizeof(stages[i]), "%llu / %llu", m.stageNanoseconds[i] / settings.frameCount, m.stageMinNanoseconds[i]);
+				total += m.stageNanoseconds[i] / settings.frameCount;
+			}
+
+			char allocations[16] = "-";
+			char allocationKilobytes[16] = "-";
+
+			if (s_allocationCountingAvailable)
+			{
+				snprintf(allocations, sizeof(allocations), "%.1f", m.allocations / (double)settings.frameCount);
+				snprintf(allocationKilobytes, sizeof(allocationKilobytes), "%.1f", m.allocationBytes / (1024.0 * settings.frameCount));
+			}
+
+			PK_CORE_LOG("%-9u %-9llu %-21s %-21s %-21s %-21s %-21s %-11llu %-8.1f %-10s %-9s %-9.1f %-10llu %-10llu %-9.1f",
+				m.entityCount,
+				m.visibleCount / settings.frameCount,
+				stages[0], stages[1], stages[2], stages[3], stages[4],
+				total,
+				total / (double)m.entityCount,
+				allocations,
+				allocationKilobytes,
+				m.frameAllocatorBytes / (1024.0 * settings.frameCount),
+				m.frameAllocatorHeapAllocations,
+				m.backend.calls / settings.frameCount,
+				m.backend.uploadBytes / (1024.0 * settings.frameCount));
+		}
+
+		PK::Utilities::Debug::InsertNewLine();
+		PK_CORE_LOG_HEADER("Redundant state per frame. Elided calls are skipped by the state cache, redundant calls reached the backend without changing state.");
+		PK_CORE_LOG("%-9s %-10s %-10s %-10s %-10s %-10s %-10s %-10s", "Entities", "Draws", "Binds", "Elided", "Redundant", "Uniforms", "Elided", "Redundant");
+
+		for (auto& m : measurements)
+		{
+			PK_CORE_LOG("%-9u %-10llu %-10llu %-10llu %-10llu %-10llu %-10llu %-10llu",
+				m.entityCount,
+				m.backend.drawCalls / settings.frameCount,
+				m.stateCache.programBinds / settings.frameCount,
+				m.stateCache.programBindsElided / settings.frameCount,
+				m.backend.redundantProgramBinds / settings.frameCount,
+				m.stateCache.uniformWrites / settings.frameCount,
+				m.stateCache.uniformWritesElided / settings.frameCount,
+				m.backend.redundantUniformWrites / settings.frameCount);
+		}
+	}
+
+	static void WriteMeasurements(const std::vector<Measurement>& measurements, const Settings& settings, const char* filepath)
+	{
+		std::ofstream file(filepath);
+
+		if (!file.is_open())
+		{
+			PK_CORE_LOG_WARNING("Failed to write benchmark results to: %s", filepath);
+			return;
+		}
+
+		file << "entities,visible";
+
+		for (auto i = 0; i < (int)Stage::Count; ++i)
+		{
+			file << "," << StageNames[i] << "_ns," << StageNames[i] << "_min_ns";
+		}
+
+		file << ",allocations,allocation_bytes,frame_allocator_bytes,frame_allocator_heap_allocations,draw_calls,gl_calls,state_changes,upload_bytes";
+		file << ",program_binds,program_binds_elided,redundant_program_binds,uniform_writes,uniform_writes_elided,redundant_uniform_writes\n";
+
+		for (auto& m : measurements)
+		{
+			file << m.entityCount << "," << m.visibleCount / settings.frameCount;
+
+			for (auto i = 0; i < (int)Stage::Count; ++i)
+			{
+				file << "," << m.stageNanoseconds[i] / settings.frameCount << "," << m.stageMinNanoseconds[i];
+			}
+
+			// Allocation columns are left empty when the build has no allocation hook.
+			if (s_allocationCountingAvailable)
+			{
+				file << "," << m.allocations / settings.frameCount << "," << m.allocationBytes / settings.frameCount;
+			}
+			else
+			{
+				file << ",,";
+			}
+
+			file << "," << m.frameAllocatorBytes / settings.frameCount
+				 << "," << m.frameAllocatorHeapAllocations
+				 << "," << m.drawCallCount / settings.frameCount
+				 << "," << m.backend.calls / settings.frameCount
+				 << "," << m.backend.stateChanges / settings.frameCount
+				 << "," << m.backend.uploadBytes / settings.frameCount
+				 << "," << m.stateCache.programBinds / settings.frameCount
+				 << "," << m.stateCache.programBindsElided / settings.frameCount
+				 << "," << m.backend.redundantProgramBinds / settings.frameCount
+				 << "," << m.stateCache.uniformWrites / settings.frameCount
+				 << "," << m.stateCache.uniformWritesElided / settings.frameCount
+				 << "," << m.backend.redundantUniformWrites / settings.frameCount << "\n";
+		}
+
+		PK_CORE_LOG("Benchmark results written to: %s", filepath);
+	}
+
+	static bool TryParseUInt(const char* value, uint32_t* result)
+	{
+		char* end = nullptr;
+		auto parsed = strtoul(value, &end, 10);
+
+		if (end == value || parsed == 0)
+		{
+			return false;
+		}
+
+		*result = (uint32_t)parsed;
+		return true;
+	}
+
+	bool TryParseArguments(int argc, char** argv, Settings* settings)
+	{
+		auto isBenchmark = false;
+
+		for (auto i = 1; i < argc; ++i)
+		{
+			std::string argument = argv[i];
+			auto value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+			if (argument == "-benchmark")
+			{
+				isBenchmark = true;
+				continue;
+			}
+
+			if (value == nullptr)
+			{
+				continue;
+			}
+
+			if (argument == "-entities")
+			{
+				settings->entityCounts.clear();
+				std::stringstream stream(value);
+				std::string token;
+				uint32_t count = 0;
+
+				while (std::getline(stream, token, ','))
+				{
+					if (TryParseUInt(token.c_str(), &count))
+					{
+						settings->entityCounts.push_back(count);
+					}
+				}
+
+				std::sort(settings->entityCounts.begin(), settings->entityCounts.end());
+				++i;
+			}
+			else if (argument == "-lights" || argument == "-frames" || argument == "-materials" || argument == "-seed" || argument == "-bindings" || argument == "-sequences" || argument == "-textures")
+			{
+				uint32_t parsed = 0;
+
+				if (!TryParseUInt(value, &parsed))
+				{
+					PK_CORE_LOG_WARNING("Invalid value for %s: %s", argument.c_str(), value);
+				}
+				else if (argument == "-lights") settings->lightCount = parsed;
+				else if (argument == "-frames") settings->frameCount = parsed;
+				else if (argument == "-materials") settings->materialCount = parsed;
+				else if (argument == "-bindings") settings->propertyBlockIterations = parsed;
+				else if (argument == "-sequences") settings->sequencerIterations = parsed;
+				else if (argument == "-textures") settings->textureCount = parsed;
+				else settings->randomSeed = parsed;
+
+				++i;
+			}
+		}
+
+		return isBenchmark;
+	}
+
+	uint32_t Run(const Settings& settings)
+	{
+		if (settings.entityCounts.empty())
+		{
+			PK_CORE_LOG_WARNING("Benchmark has no entity counts to measure.");
+			return 1u;
+		}
+
+		NullGraphicsBackend::Initialize();
+
+		auto services = CreateScope<ServiceRegister>();
+		services->Create<StringHashID>();
+		services->Create<HashCache>();
+		auto entityDb = services->Create<ECS::EntityDatabase>();
+		auto sequencer = services->Create<ECS::Sequencer>();
+		auto assetDatabase = services->Create<AssetDatabase>(sequencer);
+
+		assetDatabase->LoadDirectory<ApplicationConfig>("res/configs/");
+		assetDatabase->LoadDirectory<Shader>("res/shaders/");
+		auto config = assetDatabase->Find<ApplicationConfig>("Active");
+
+		auto engineUpdateTransforms = services->Create<ECS::Engines::EngineUpdateTransforms>(entityDb);
+		Batching::SetInstanceTransformFormat(Batching::GetInstanceTransformFormatFromString(config->InstanceTransformFormat.value, Batching::InstanceTransformFormat::Float3x4));
+
+		std::vector<Measurement> measurements;
+		auto failureCount = 0u;
+
+#if defined(PK_DEBUG)
+		auto previousAllocationHook = _CrtSetAllocHook(CountAllocation);
+#endif
+
+		{
+			GraphicsContext context;
+			context.BlitQuad = MeshUtility::GetQuad2D({ -1.0f,-1.0f }, { 1.0f, 1.0f });
+			context.BlitShader = assetDatabase->Find<Shader>("SH_VS_Internal_Blit");
+
+			Culling::VisibilityCache visibilityCache;
+			Batching::DynamicBatchCollection batches;
+			LightsManager lightsManager(assetDatabase, config);
+
+			Scene scene;
+			CreateScene(assetDatabase, entityDb, settings, &scene);
+
+			auto frameIndex = 0u;
+
+			auto runFrame = [&](uint32_t cameraFrameIndex, Measurement* measurement)
+			{
+				GraphicsAPI::OpenContext(&context);
+				GraphicsAPI::ResetResourceBindings();
+				SetCamera(cameraFrameIndex);
+				ExecuteFrame(&scene, &context, engineUpdateTransforms, &visibilityCache, &batches, &lightsManager, measurement);
+				GraphicsAPI::CloseContext();
+				Profiler::NextFrame();
+				FrameAllocator::NextFrame();
+			};
+
+			for (auto entityCount : settings.entityCounts)
+			{
+				GrowScene(&scene, entityCount);
+
+				Measurement measurement;
+				measurement.entityCount = entityCount;
+
+				for (auto i = 0u; i < settings.warmupFrameCount + settings.frameCount; ++i)
+				{
+					if (i == settings.warmupFrameCount)
+					{
+						measurement = Measurement();
+						measurement.entityCount = entityCount;
+						memset(measurement.stageMinNanoseconds, 0xFF, sizeof(measurement.stageMinNanoseconds));
+						NullGraphicsBackend::ResetCounters();
+						GraphicsAPI::ResetStateCacheCounters();
+					}
+
+					runFrame(frameIndex++, &measurement);
+
+					auto frameAllocatorStatistics = FrameAllocator::GetStatistics();
+					measurement.frameAllocatorBytes += frameAllocatorStatistics.frameBytes;
+					measurement.frameAllocatorHeapAllocations += frameAllocatorStatistics.frameHeapAllocations;
+				}
+
+				measurement.backend = NullGraphicsBackend::GetCounters();
+				measurement.stateCache = GraphicsAPI::GetStateCacheCounters();
+				measurements.push_back(measurement);
+				PK_CORE_LOG("Measured %u entities.", entityCount);
+			}
+
+			// The last frame is rendered again without state caching & then with caching & validation enabled.
+			// Validation reads skipped state back from the null backend. Equal draw state hashes mean that no draw saw different state.
+			{
+				Measurement discarded;
+				auto validationFrameIndex = frameIndex - 1;
+				NullGraphicsBackend::SetDrawStateHashing(true);
+
+				GraphicsAPI::SetStateCaching(false);
+				NullGraphicsBackend::ResetCounters();
+				runFrame(validationFrameIndex, &discarded);
+				auto uncachedHash = NullGraphicsBackend::GetCounters().drawStateHash;
+
+				GraphicsAPI::SetStateCaching(true, true);
+				GraphicsAPI::ResetStateCacheCounters();
+				NullGraphicsBackend::ResetCounters();
+				runFrame(validationFrameIndex, &discarded);
+				auto cachedHash = NullGraphicsBackend::GetCounters().drawStateHash;
+				auto stateCache = GraphicsAPI::GetStateCacheCounters();
+
+				if (cachedHash == uncachedHash && stateCache.validationFailures == 0)
+				{
+					PK_CORE_LOG("State cache validated: %llu program binds & %llu uniform writes elided.", stateCache.programBindsElided, stateCache.uniformWritesElided);
+				}
+				else
+				{
+					PK_CORE_LOG_WARNING("State cache validation failed: %llu mismatching values, draw state hash %llx != %llx.", stateCache.validationFailures, cachedHash, uncachedHash);
+					++failureCount;
+				}
+
+				GraphicsAPI::SetStateCaching(true);
+				NullGraphicsBackend::SetDrawStateHashing(false);
+			}
+
+			if (settings.propertyBlockIterations > 0)
+			{
+				auto* material = scene.materials.at(0);
+				PK::Utilities::Debug::InsertNewLine();
+				PK_CORE_LOG_HEADER("SetPropertyBlock throughput: %u calls per block, ns/call.", settings.propertyBlockIterations);
+				PK_CORE_LOG("%-10s %-11s %-13s %-13s", "Block", "Properties", "Uncached", "Cached");
+				GraphicsAPI::OpenContext(&context);
+				MeasurePropertyBlock(material->GetShader(), *material, "Material", settings.propertyBlockIterations);
+				MeasurePropertyBlock(material->GetShader(), context.ShaderProperties, "Global", settings.propertyBlockIterations);
+				GraphicsAPI::CloseContext();
+				MeasureVariantResolution(material, settings.propertyBlockIterations);
+			}
+
+			if (settings.sequencerIterations > 0)
+			{
+				PK::Utilities::Debug::InsertNewLine();
+				MeasureSequencerDispatch(settings.sequencerIterations);
+				failureCount += ValidateSequencerDeterminism(settings.frameCount * 10u, settings.randomSeed);
+			}
+
+			PK::Utilities::Debug::InsertNewLine();
+			failureCount += MeasureClusterLightAssignment(&lightsManager, settings.frameCount, settings.randomSeed);
+
+			PK::Utilities::Debug::InsertNewLine();
+			failureCount += MeasureMaskedOcclusion(&scene, frameIndex, settings.frameCount);
+			failureCount += ValidateDepthPyramid(settings.randomSeed);
+
+			PK::Utilities::Debug::InsertNewLine();
+			failureCount += ValidateShadowCasterCulling(&lightsManager, frameIndex, settings.randomSeed);
+			failureCount += ValidateShadowVolumeCulling(&scene, &lightsManager, frameIndex, settings.randomSeed);
+			failureCount += ValidateShadowCascadeStability(&lightsManager, frameIndex, settings.randomSeed);
+
+			PK::Utilities::Debug::InsertNewLine();
+			failureCount += ValidateInstanceTransforms(65536u, settings.randomSeed);
+
+			PK::Utilities::Debug::InsertNewLine();
+			failureCount += ValidateShadowmapCache(settings.frameCount * 10u, settings.randomSeed);
+
+			PK::Utilities::Debug::InsertNewLine();
+			failureCount += ValidateTextureStreaming(settings.randomSeed);
+
+			if (settings.textureCount > 0)
+			{
+				PK::Utilities::Debug::InsertNewLine();
+				failureCount += MeasureTextureFormats(config->TextureCacheDirectory.value, settings.textureCount);
+			}
+		}
+
+#if defined(PK_DEBUG)
+		_CrtSetAllocHook(previousAllocationHook);
+#endif
+
+		LogMeasurements(measurements, settings);
+		WriteMeasurements(measurements, settings, "BenchmarkResults.csv");
+
+		sequencer->Release();
+		assetDatabase->Unload();
+		services->Clear();
+		FrameAllocator::Release();
+		NullGraphicsBackend::Terminate();
+
+		if (failureCount > 0)
+		{
+			PK_CORE_LOG_WARNING("Benchmark finished with %u failed validations.", failureCount);
+		}
+
+		return failureCount;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Headless run of the cpu side of a frame against the null graphics backend. Started with -benchmark.
+// A procedural scene is grown through each entity count & every stage is timed over a fixed number of frames.
+// Example: -benchmark -entities 1024,4096,16384 -lights 64 -frames 200
+namespace PK::Core::Benchmark
+{
+    struct Settings
+    {
+        std::vector<uint32_t> entityCounts = { 1024, 2048, 4096, 8192, 16384 };
+        uint32_t lightCount = 32;
+        uint32_t frameCount = 120;
+        uint32_t warmupFrameCount = 8;
+        uint32_t materialCount = 8;
+        uint32_t randomSeed = 1337;
+        // SetPropertyBlock calls per block in the binding microbenchmark.
+        uint32_t propertyBlockIterations = 100000;
+        // Root sequence executions in the sequencer dispatch microbenchmark.
+        uint32_t sequencerIterations = 100000;
+        // Ktx textures compared against their ktx 2 versions. These are encoded on the first run, which takes a while.
+        uint32_t textureCount = 8;
+    };
+
+    bool TryParseArguments(int argc, char** argv, Settings* settings);
+
+    // Returns the number of failed validations.
+    uint32_t Run(const Settings& settings);
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "PrecompiledHeader.h"
+#include "Utilities/Log.h"
+#include "Core/Profiler.h"
+#include "Rendering/Batching.h"
+#include "Core/BenchmarkSuites.h"
+
+namespace PK::Core::Benchmark
+{
+	using namespace PK::Utilities;
+	using namespace PK::Rendering;
+	using namespace PK::Rendering::Objects;
+	using namespace PK::Rendering::Structs;
+	using namespace PK::ECS;
+	using namespace PK::Math;
+
+	// Encodes random transforms in every instance transform format & decodes them with the cpu reference of the shader decoder.
+	// Basis error is relative to the largest axis scale of a transform. Compact transforms store rotation & scale as halfs.
+	uint32_t ValidateInstanceTransforms(uint32_t count, uint32_t randomSeed)
+	{
+		const Batching::InstanceTransformFormat formats[] = { Batching::InstanceTransformFormat::Float4x4, Batching::InstanceTransformFormat::Float3x4, Batching::InstanceTransformFormat::Compact };
+		const uint32_t strides[] = { 16u, 12u, 8u };
+		const float tolerances[] = { 1e-6f, 1e-6f, 2e-3f };
+		auto failureCount = 0u;
+
+		srand(randomSeed);
+		std::vector<float4x4> matrices(count);
+		std::vector<Batching::Drawcall> drawcalls(count);
+		std::vector<float4x4> encoded(count);
+
+		for (auto i = 0u; i < count; ++i)
+		{
+			auto scale = Functions::RandomRangeFloat3(float3(0.1f), float3(10.0f));
+
+			if ((i & 7u) == 7u)
+			{
+				scale.x = -scale.x;
+			}
+
+			matrices[i] = Functions::GetMatrixTRS(Functions::RandomRangeFloat3(float3(-100.0f), float3(100.0f)), Functions::RandomEuler(), scale);
+			drawcalls[i] = { &matrices[i], 0.0f };
+		}
+
+		// Degenerate cases for the quaternion extraction.
+		if (count >= 3)
+		{
+			matrices[0] = float4x4(1.0f);
+			matrices[1] = Functions::GetMatrixTRS(float3(0.0f), glm::angleAxis(glm::pi<float>(), glm::normalize(float3(1.0f, -1.0f, 0.0f))), float3(1.0f));
+			matrices[2] = Functions::GetMatrixTRS(float3(1.0f), float3(0.0f), float3(-1.0f, 2.0f, 0.5f));
+		}
+
+		auto previousFormat = Batching::GetInstanceTransformFormat();
+		PK_CORE_LOG_HEADER("Instance transform round trip: %u transforms.", count);
+		PK_CORE_LOG("%-10s %-7s %-13s %-13s %-10s", "Format", "Bytes", "Basis error", "Pos error", "ns/encode");
+
+		for (auto f = 0u; f < 3u; ++f)
+		{
+			Batching::SetInstanceTransformFormat(formats[f]);
+
+			auto begin = Profiler::GetTimestamp();
+			Batching::WriteInstanceTransforms(reinterpret_cast<float*>(encoded.data()), drawcalls.data(), count);
+			auto nanoseconds = Profiler::GetTimestamp() - begin;
+
+			auto basisError = 0.0f;
+			auto positionError = 0.0f;
+			auto source = reinterpret_cast<const float*>(encoded.data());
+
+			for (auto i = 0u; i < count; ++i)
+			{
+				auto decoded = Batching::ReadInstanceTransform(source + i * strides[f]);
+				auto& reference = matrices[i];
+				auto maxScale = 0.0f;
+				auto maxDelta = 0.0f;
+
+				for (auto c = 0u; c < 3u; ++c)
+				{
+					auto length = glm::length(float3(reference[c]));
+					auto delta = glm::length(float3(decoded[c]) - float3(reference[c]));
+					maxScale = length > maxScale ? length : maxScale;
+					maxDelta = delta > maxDelta ? delta : maxDelta;
+				}
+
+				auto relativeDelta = maxDelta / maxScale;
+				auto translationDelta = glm::length(float3(decoded[3]) - float3(reference[3]));
+				basisError = relativeDelta > basisError ? relativeDelta : basisError;
+				positionError = translationDelta > positionError ? translationDelta : positionError;
+			}
+
+			auto name = Batching::GetInstanceTransformFormatName(formats[f]);
+			PK_CORE_LOG("%-10s %-7u %-13.6f %-13.6f %-10.2f", name, strides[f] * 4u, basisError, positionError, nanoseconds / (double)count);
+
+			if (basisError > tolerances[f] || positionError > tolerances[f] * 100.0f)
+			{
+				PK_CORE_LOG_WARNING("%s instance transforms exceed the expected error: %f basis, %f position.", name, basisError, positionError);
+				++failureCount;
+			}
+		}
+
+		Batching::SetInstanceTransformFormat(previousFormat);
+		return failureCount;
+	}
+}
\ No newline at end of file
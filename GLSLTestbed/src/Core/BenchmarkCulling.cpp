@@ -0,0 +1,287 @@
+#include "PrecompiledHeader.h"
+#include "Utilities/Log.h"
+#include "Utilities/FrameAllocator.h"
+#include "Core/Profiler.h"
+#include "ECS/Contextual/EntityViews/EntityViews.h"
+#include "Rendering/Culling.h"
+#include "Rendering/FrameSetup.h"
+#include "Rendering/MaskedOcclusionBuffer.h"
+#include "Rendering/OcclusionCulling.h"
+#include "Core/BenchmarkSuites.h"
+
+namespace PK::Core::Benchmark
+{
+	using namespace PK::Utilities;
+	using namespace PK::Rendering;
+	using namespace PK::Rendering::Objects;
+	using namespace PK::Rendering::Structs;
+	using namespace PK::ECS;
+	using namespace PK::Math;
+
+	// Triangles of a box spanning the bounds. Occluders are rasterized double sided, so the winding does not matter.
+	static void GetBoxOccluder(const BoundingBox& bounds, float3* vertices, uint* indices)
+	{
+		const uint faces[6][4] = { { 0, 2, 6, 4 }, { 1, 3, 7, 5 }, { 0, 1, 5, 4 }, { 2, 3, 7, 6 }, { 0, 1, 3, 2 }, { 4, 5, 7, 6 } };
+
+		for (auto i = 0u; i < 8u; ++i)
+		{
+			vertices[i] = float3(i & 1 ? bounds.max.x : bounds.min.x, i & 2 ? bounds.max.y : bounds.min.y, i & 4 ? bounds.max.z : bounds.min.z);
+		}
+
+		for (auto i = 0u; i < 6u; ++i)
+		{
+			uint quad[6] = { faces[i][0], faces[i][1], faces[i][2], faces[i][0], faces[i][2], faces[i][3] };
+			memcpy(indices + i * 6u, quad, sizeof(quad));
+		}
+	}
+
+	// Mirrors RenderOccluders of the render pipeline. Boxes are the only procedural meshes whose bounds are exact, so they are used as the occluders.
+	// A wall in front of the camera is validated first: bounds behind it must be occluded & bounds in front of or beside it must not.
+	uint32_t MeasureMaskedOcclusion(Scene* scene, uint32_t frameIndex, uint32_t frameCount)
+	{
+		const uint bufferWidth = 320;
+		const uint bufferHeight = 192;
+		const uint triangleBudget = 8192;
+
+		Culling::MaskedOcclusionBuffer buffer;
+		buffer.Resize(bufferWidth, bufferHeight);
+		auto failureCount = 0u;
+
+		{
+			float3 wall[8];
+			uint wallIndices[36];
+			GetBoxOccluder(Functions::CreateBoundsMinMax(float3(-5.0f, -5.0f, 10.0f), float3(5.0f, 5.0f, 10.5f)), wall, wallIndices);
+
+			buffer.SetViewProjection(Functions::GetPerspective(60.0f, bufferWidth / (float)bufferHeight, 0.1f, 100.0f));
+			buffer.Clear();
+			buffer.RenderOccluder(PK_FLOAT4X4_IDENTITY, wall, wallIndices, 36u);
+
+			auto isBehindOccluded = buffer.IsOccluded(Functions::CreateBoundsMinMax(float3(-1.0f, -1.0f, 20.0f), float3(1.0f, 1.0f, 22.0f)));
+			auto isFrontOccluded = buffer.IsOccluded(Functions::CreateBoundsMinMax(float3(-1.0f, -1.0f, 5.0f), float3(1.0f, 1.0f, 6.0f)));
+			auto isBesideOccluded = buffer.IsOccluded(Functions::CreateBoundsMinMax(float3(20.0f, -1.0f, 20.0f), float3(22.0f, 1.0f, 22.0f)));
+			auto isIntersectingOccluded = buffer.IsOccluded(Functions::CreateBoundsMinMax(float3(-1.0f, -1.0f, 9.0f), float3(1.0f, 1.0f, 12.0f)));
+
+			if (!isBehindOccluded || isFrontOccluded || isBesideOccluded || isIntersectingOccluded)
+			{
+				PK_CORE_LOG_WARNING("Masked occlusion validation failed: behind %i, front %i, beside %i, intersecting %i.", isBehindOccluded, isFrontOccluded, isBesideOccluded, isIntersectingOccluded);
+				++failureCount;
+			}
+		}
+
+		auto* entityDb = scene->entityDb;
+		auto* boxMesh = scene->meshes.at(1);
+		float3 box[8];
+		uint boxIndices[36];
+		GetBoxOccluder(boxMesh->GetLocalBounds(), box, boxIndices);
+
+		Culling::VisibilityCache visibilityCache;
+		std::vector<std::pair<float, uint>> queue;
+		uint64_t rasterNanoseconds = 0ull;
+		uint64_t testNanoseconds = 0ull;
+		uint64_t triangleCount = 0ull;
+		uint64_t occluderCount = 0ull;
+		uint64_t testCount = 0ull;
+		uint64_t occludedCount = 0ull;
+
+		for (auto frame = 0u; frame < frameCount; ++frame)
+		{
+			float4x4 view, proj;
+			GetCameraMatrices(frameIndex + frame, &view, &proj);
+			auto viewProjection = proj * view;
+
+			FrameSetup::CullCameraFrustum(entityDb, &visibilityCache, viewProjection, (ushort)Components::RenderHandleFlags::Renderer);
+			auto visible = visibilityCache.GetList(Culling::CullingGroup::CameraFrustum, (ushort)Components::RenderHandleFlags::Renderer);
+
+			auto begin = Profiler::GetTimestamp();
+			buffer.SetViewProjection(viewProjection);
+			buffer.Clear();
+			queue.clear();
+
+			for (uint i = 0; i < visible.count; ++i)
+			{
+				if (entityDb->Query<EntityViews::MeshRenderable>(visible[i])->mesh->sharedMesh == boxMesh)
+				{
+					auto clip = viewProjection * float4(entityDb->Query<EntityViews::BaseRenderable>(visible[i])->bounds->worldAABB.GetCenter(), 1.0f);
+					queue.push_back({ clip.w, i });
+				}
+			}
+
+			std::sort(queue.begin(), queue.end());
+
+			for (auto& item : queue)
+			{
+				if (buffer.GetTriangleCount() >= triangleBudget)
+				{
+					break;
+				}
+
+				buffer.RenderOccluder(entityDb->Query<EntityViews::MeshRenderable>(visible[item.second])->transform->localToWorld, box, boxIndices, 36u);
+				occluderCount++;
+			}
+
+			rasterNanoseconds += Profiler::GetTimestamp() - begin;
+			triangleCount += buffer.GetTriangleCount();
+			begin = Profiler::GetTimestamp();
+
+			for (uint i = 0; i < visible.count; ++i)
+			{
+				occludedCount += buffer.IsOccluded(entityDb->Query<EntityViews::BaseRenderable>(visible[i])->bounds->worldAABB) ? 1ull : 0ull;
+			}
+
+			testNanoseconds += Profiler::GetTimestamp() - begin;
+			testCount += visible.count;
+			FrameAllocator::NextFrame();
+		}
+
+		frameCount = frameCount > 0 ? frameCount : 1u;
+		testCount = testCount > 0 ? testCount : 1ull;
+
+		PK_CORE_LOG_HEADER("Masked occlusion: %ux%u buffer, %u entities, %u frames.", buffer.GetWidth(), buffer.GetHeight(), scene->entityCount, frameCount);
+		PK_CORE_LOG("%llu occluders & %llu triangles per frame, %.3f ms raster, %.1f ns/test, %.1f%% of visible renderables occluded.",
+			occluderCount / frameCount,
+			triangleCount / frameCount,
+			rasterNanoseconds * 1e-6 / frameCount,
+			testNanoseconds / (double)testCount,
+			100.0 * occludedCount / (double)testCount);
+
+		return failureCount;
+	}
+
+	static float GetProjectedDepth(const float4x4& viewProjection, float viewDepth)
+	{
+		auto clip = viewProjection * float4(0.0f, 0.0f, viewDepth, 1.0f);
+		return clip.z / clip.w * 0.5f + 0.5f;
+	}
+
+	// Builds a pyramid from a synthetic depth buffer with random depths around a wall on one half of the screen & one far half.
+	// Every mip texel must be the max of the base texels that it covers. Bounds reported as occluded must be behind every base texel of their screen rect.
+	// Odd sizes check the clamped edges of the mip chain.
+	uint32_t ValidateDepthPyramid(uint32_t randomSeed)
+	{
+		const uint width = 250;
+		const uint height = 126;
+		const uint boundsCount = 65536;
+		auto viewProjection = Functions::GetPerspective(60.0f, width / (float)height, 0.1f, 100.0f);
+		auto failureCount = 0u;
+
+		// Wall texels have a uv.x below 0.5. Positive view space x may project to either side.
+		auto wallSide = (viewProjection * float4(1.0f, 0.0f, 10.0f, 1.0f)).x > 0.0f ? -1.0f : 1.0f;
+		auto wallDepthMin = GetProjectedDepth(viewProjection, 8.0f);
+		auto wallDepthMax = GetProjectedDepth(viewProjection, 12.0f);
+		auto farDepthMin = GetProjectedDepth(viewProjection, 40.0f);
+
+		srand(randomSeed);
+		Culling::DepthPyramid pyramid;
+		pyramid.Resize(width, height);
+		auto* base = pyramid.GetBaseLevel();
+
+		for (auto y = 0u; y < height; ++y)
+		{
+			for (auto x = 0u; x < width; ++x)
+			{
+				base[x + y * width] = x < width / 2 ? Functions::RandomRangeFloat(wallDepthMin, wallDepthMax) : Functions::RandomRangeFloat(farDepthMin, 1.0f);
+			}
+		}
+
+		std::vector<float> baseDepths(base, base + width * height);
+		pyramid.BuildMipChain(viewProjection);
+		auto mipFailures = 0u;
+
+		for (auto level = 1u; level < pyramid.GetLevelCount(); ++level)
+		{
+			for (auto y = 0u; y < ((height - 1u) >> level) + 1u; ++y)
+			{
+				for (auto x = 0u; x < ((width - 1u) >> level) + 1u; ++x)
+				{
+					auto depth = 0.0f;
+
+					for (auto by = y << level; by < glm::min((y + 1u) << level, height); ++by)
+					{
+						for (auto bx = x << level; bx < glm::min((x + 1u) << level, width); ++bx)
+						{
+							depth = glm::max(depth, baseDepths[bx + by * width]);
+						}
+					}
+
+					mipFailures += pyramid.GetDepth(level, x, y) != depth ? 1u : 0u;
+				}
+			}
+		}
+
+		// Bounds with x measured away from the center towards the wall side.
+		auto isOccludedOnWallSide = [&pyramid, wallSide](float x0, float x1, float z0, float z1)
+		{
+			auto min = float3(glm::min(x0 * wallSide, x1 * wallSide), -1.0f, z0);
+			auto max = float3(glm::max(x0 * wallSide, x1 * wallSide), 1.0f, z1);
+			return pyramid.IsOccluded(Functions::CreateBoundsMinMax(min, max));
+		};
+
+		auto isBehindOccluded = isOccludedOnWallSide(10.0f, 12.0f, 20.0f, 22.0f);
+		auto isFrontOccluded = isOccludedOnWallSide(2.0f, 3.0f, 5.0f, 6.0f);
+		auto isFarSideOccluded = isOccludedOnWallSide(-12.0f, -10.0f, 20.0f, 22.0f);
+		auto isIntersectingOccluded = isOccludedOnWallSide(2.0f, 4.0f, 9.0f, 20.0f);
+
+		if (!isBehindOccluded || isFrontOccluded || isFarSideOccluded || isIntersectingOccluded)
+		{
+			PK_CORE_LOG_WARNING("Depth pyramid validation failed: behind %i, front %i, far side %i, intersecting %i.", isBehindOccluded, isFrontOccluded, isFarSideOccluded, isIntersectingOccluded);
+			++failureCount;
+		}
+
+		auto occludedCount = 0u;
+		auto falseOcclusions = 0u;
+
+		for (auto i = 0u; i < boundsCount; ++i)
+		{
+			auto center = Functions::RandomRangeFloat3(float3(-30.0f, -10.0f, 2.0f), float3(30.0f, 10.0f, 60.0f));
+			auto extents = Functions::RandomRangeFloat3(float3(0.1f), float3(3.0f));
+			auto aabb = Functions::CreateBoundsMinMax(center - extents, center + extents);
+
+			if (!pyramid.IsOccluded(aabb))
+			{
+				continue;
+			}
+
+			++occludedCount;
+
+			// Occluded bounds are in front of the near plane & project into the buffer.
+			auto uvmin = float2(1.0f);
+			auto uvmax = float2(0.0f);
+			auto zmin = 1.0f;
+
+			for (auto j = 0u; j < 8u; ++j)
+			{
+				auto corner = float3(j & 1 ? aabb.max.x : aabb.min.x, j & 2 ? aabb.max.y : aabb.min.y, j & 4 ? aabb.max.z : aabb.min.z);
+				auto clip = viewProjection * float4(corner, 1.0f);
+				auto ndc = float3(clip.xyz) / clip.w;
+				uvmin = glm::min(uvmin, glm::clamp(float2(ndc.xy) * 0.5f + 0.5f, 0.0f, 1.0f));
+				uvmax = glm::max(uvmax, glm::clamp(float2(ndc.xy) * 0.5f + 0.5f, 0.0f, 1.0f));
+				zmin = glm::min(zmin, ndc.z * 0.5f + 0.5f);
+			}
+
+			auto x1 = glm::min((uint)(uvmax.x * width), width - 1u);
+			auto y1 = glm::min((uint)(uvmax.y * height), height - 1u);
+			auto isBehind = true;
+
+			for (auto y = glm::min((uint)(uvmin.y * height), height - 1u); y <= y1 && isBehind; ++y)
+			{
+				for (auto x = glm::min((uint)(uvmin.x * width), width - 1u); x <= x1 && isBehind; ++x)
+				{
+					isBehind = zmin > baseDepths[x + y * width];
+				}
+			}
+
+			falseOcclusions += isBehind ? 0u : 1u;
+		}
+
+		PK_CORE_LOG_HEADER("Depth pyramid: %ux%u base, %u levels, %u random bounds.", width, height, pyramid.GetLevelCount(), boundsCount);
+		PK_CORE_LOG("%.1f%% of bounds occluded, %u false occlusions, %u mismatching mip texels.", 100.0 * occludedCount / boundsCount, falseOcclusions, mipFailures);
+
+		if (mipFailures > 0 || falseOcclusions > 0)
+		{
+			PK_CORE_LOG_WARNING("Depth pyramid validation failed: %u mismatching mip texels, %u false occlusions.", mipFailures, falseOcclusions);
+			++failureCount;
+		}
+
+		return failureCount;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include "PrecompiledHeader.h"
+#include "Utilities/Log.h"
+#include "Utilities/ThreadPool.h"
+#include "Core/Profiler.h"
+#include "Rendering/LightsManager.h"
+#include "Rendering/ClusterLightAssignment.h"
+#include "Core/BenchmarkSuites.h"
+
+namespace PK::Core::Benchmark
+{
+	using namespace PK::Utilities;
+	using namespace PK::Rendering;
+	using namespace PK::Rendering::Objects;
+	using namespace PK::Rendering::Structs;
+	using namespace PK::ECS;
+	using namespace PK::Math;
+
+	// Scalar port of CS_ClusteredLightAssignment. Every cluster tests the lights in order & keeps the first maxLightsPerCluster that intersect it.
+	// Tiles hold the count & cascade bits of pk_LightTiles without an offset. Indices are stored in fixed size slots per cluster.
+	static void AssignClusterLightsReference(const ClusterLightAssignment::ClusterLight* lights,
+		uint lightCount,
+		const uint3& gridSize,
+		uint maxLightsPerCluster,
+		const float4x4& worldToView,
+		const float4x4& inverseProjection,
+		float zNear,
+		float zFar,
+		const float* cascadeSplits,
+		const float* tileMaxDepths,
+		std::vector<uint>* tiles,
+		std::vector<uint>* indices)
+	{
+		struct SharedLight
+		{
+			float3 position;
+			float3 direction;
+			float radius;
+			float angle;
+			uint type;
+		};
+
+		std::vector<SharedLight> sharedLights(lightCount);
+
+		for (auto i = 0u; i < lightCount; ++i)
+		{
+			sharedLights[i].position = float3(worldToView * float4(lights[i].position, 1.0f));
+			sharedLights[i].direction = float3(worldToView * float4(lights[i].direction, 0.0f));
+			sharedLights[i].radius = lights[i].radius;
+			sharedLights[i].angle = lights[i].angle;
+			sharedLights[i].type = lights[i].type;
+		}
+
+		auto clusterCount = gridSize.x * gridSize.y * gridSize.z;
+		tiles->assign(clusterCount, 0u);
+		indices->assign((size_t)clusterCount * maxLightsPerCluster, 0u);
+		auto invstep = float2(1.0f / gridSize.x, 1.0f / gridSize.y);
+		auto scale = float2(inverseProjection[0][0], inverseProjection[1][1]);
+
+		for (auto z = 0u; z < gridSize.z; ++z)
+		for (auto y = 0u; y < gridSize.y; ++y)
+		for (auto x = 0u; x < gridSize.x; ++x)
+		{
+			auto depthTileIndex = x + y * gridSize.x;
+			auto cellNear = zNear * glm::pow(zFar / zNear, (float)z / gridSize.z);
+			auto cellFar = zNear * glm::pow(zFar / zNear, (z + 1.0f) / gridSize.z);
+			auto maxFar = tileMaxDepths != nullptr ? tileMaxDepths[depthTileIndex] : zFar + 1.0f;
+			cellFar = glm::min(cellFar, maxFar);
+
+			auto screenmin = float2(x, y) * invstep;
+			auto screenmax = float2(x + 1.0f, y + 1.0f) * invstep;
+			auto min00 = float3((screenmin * 2.0f - 1.0f) * scale, 1.0f) * cellNear;
+			auto max00 = float3((screenmin * 2.0f - 1.0f) * scale, 1.0f) * cellFar;
+			auto min11 = float3((screenmax * 2.0f - 1.0f) * scale, 1.0f) * cellNear;
+			auto max11 = float3((screenmax * 2.0f - 1.0f) * scale, 1.0f) * cellFar;
+			auto aabbmin = glm::min(glm::min(min00, max00), glm::min(min11, max11));
+			auto aabbmax = glm::max(glm::max(min00, max00), glm::max(min11, max11));
+			auto extents = (aabbmax - aabbmin) * 0.5f;
+			auto center = aabbmin + extents;
+			auto cellRadius = glm::length(extents);
+
+			auto clusterIndex = depthTileIndex + z * gridSize.x * gridSize.y;
+			auto* clusterIndices = indices->data() + (size_t)clusterIndex * maxLightsPerCluster;
+			auto count = 0u;
+
+			for (auto i = 0u; i < lightCount && cellNear <= maxFar && count < maxLightsPerCluster; ++i)
+			{
+				auto& light = sharedLights[i];
+
+				auto d = glm::abs(light.position - center) - extents;
+				auto dmin = glm::min(d, float3(0.0f));
+				auto r = light.radius - glm::max(glm::max(dmin.x, dmin.y), dmin.z);
+				d = glm::max(d, float3(0.0f));
+				auto pointPass = light.radius > 0.0f && d.x * d.x + d.y * d.y + d.z * d.z <= r * r;
+
+				auto V = center - light.position;
+				auto VlenSq = V.x * V.x + V.y * V.y + V.z * V.z;
+				auto V1len = V.x * light.direction.x + V.y * light.direction.y + V.z * light.direction.z;
+				auto distanceClosestPoint = glm::cos(light.angle * 0.5f) * glm::sqrt(VlenSq - V1len * V1len) - V1len * glm::sin(light.angle * 0.5f);
+				auto spotPass = !(distanceClosestPoint > cellRadius || V1len > cellRadius + light.radius || V1len < -cellRadius);
+
+				auto pass = false;
+
+				switch (light.type)
+				{
+					case (uint)LightType::Point: pass = pointPass; break;
+					case (uint)LightType::Spot: pass = pointPass && spotPass; break;
+					case (uint)LightType::Directional: pass = true; break;
+				}
+
+				if (pass)
+				{
+					clusterIndices[count++] = i;
+				}
+			}
+
+			auto depth = cellNear + (cellFar - cellNear) * 0.5f;
+			auto cascade = depth > cascadeSplits[1] ? depth > cascadeSplits[2] ? depth > cascadeSplits[3] ? 3u : 2u : 1u : 0u;
+			(*tiles)[clusterIndex] = ((count & 0xFFu) << 20u) | (cascade << 28u);
+		}
+	}
+
+	// Compares the cpu cluster assignment against the shader port with & without depth tiles, then times both over increasing light counts.
+	// Offsets differ by design as the shader allocates them with an atomic counter. Counts, cascades & the light order within a cluster must match.
+	uint32_t MeasureClusterLightAssignment(const LightsManager* lightsManager, uint32_t frameCount, uint32_t randomSeed)
+	{
+		const uint3 gridSize = { 16u, 9u, 24u };
+		const uint maxLightsPerCluster = 128u;
+		const uint lightCounts[] = { 100u, 250u, 500u, 1000u, 2500u, 5000u, 10000u };
+		const auto zNear = 0.1f;
+		const auto zFar = 200.0f;
+
+		float4x4 worldToView, projection;
+		GetCameraMatrices(0u, &worldToView, &projection);
+		auto inverseProjection = glm::inverse(projection);
+		auto cascades = lightsManager->GetCascadeZSplits(zNear, zFar);
+		auto threadCount = ThreadPool::GetShared()->GetThreadCount() + 1u;
+		auto iterations = glm::max(1u, frameCount / 10u);
+		auto failureCount = 0u;
+
+		srand(randomSeed);
+		std::vector<ClusterLightAssignment::ClusterLight> lights(lightCounts[(sizeof(lightCounts) / sizeof(uint)) - 1]);
+
+		for (auto i = 0u; i < lights.size(); ++i)
+		{
+			auto type = (i % 64u) == 63u ? LightType::Directional : (i & 1) ? LightType::Point : LightType::Spot;
+			lights[i].position = Functions::RandomRangeFloat3(SceneMin * 1.5f, SceneMax * 1.5f);
+			lights[i].radius = Functions::RandomRangeFloat(1.0f, 12.0f);
+			lights[i].direction = glm::quat(Functions::RandomEuler() * PK_FLOAT_DEG2RAD) * PK_FLOAT3_FORWARD;
+			lights[i].angle = Functions::RandomRangeFloat(15.0f, 120.0f) * PK_FLOAT_DEG2RAD;
+			lights[i].type = (uint)type;
+		}
+
+		std::vector<float> tileMaxDepths(gridSize.x * gridSize.y);
+
+		for (auto& depth : tileMaxDepths)
+		{
+			depth = Functions::RandomRangeFloat(zNear, zFar);
+		}
+
+		ClusterLightAssignment assignment(gridSize.x, gridSize.y, gridSize.z, maxLightsPerCluster);
+		std::vector<uint> referenceTiles;
+		std::vector<uint> referenceIndices;
+
+		PK_CORE_LOG_HEADER("Cluster light assignment: %ux%ux%u clusters, %u threads, ms per assignment.", gridSize.x, gridSize.y, gridSize.z, threadCount);
+		PK_CORE_LOG("%-8s %-10s %-10s %-10s %-12s %-10s", "Lights", "Reference", "Serial", "Parallel", "Avg/cluster", "Mismatch");
+
+		for (auto lightCount : lightCounts)
+		{
+			uint64_t nanoseconds[3] = {};
+			auto mismatchCount = 0u;
+			auto averageCount = 0.0;
+
+			for (auto useDepthTiles = 0u; useDepthTiles < 2u; ++useDepthTiles)
+			{
+				auto* depths = useDepthTiles ? tileMaxDepths.data() : nullptr;
+				assignment.Execute(lights.data(), lightCount, worldToView, inverseProjection, zNear, zFar, cascades.planes, depths, threadCount);
+
+				// The port is too slow to be timed over several iterations at high light counts.
+				auto begin = Profiler::GetTimestamp();
+				AssignClusterLightsReference(lights.data(), lightCount, gridSize, maxLightsPerCluster, worldToView, inverseProjection, zNear, zFar, cascades.planes, depths, &referenceTiles, &referenceIndices);
+				auto referenceNanoseconds = Profiler::GetTimestamp() - begin;
+
+				auto* tiles = assignment.GetLightTiles();
+				auto* indices = assignment.GetLightIndices();
+
+				for (auto i = 0u; i < assignment.GetClusterCount(); ++i)
+				{
+					auto count = (tiles[i] >> 20u) & 0xFFu;
+					auto offset = tiles[i] & 0xFFFFFu;
+					auto isMatch = (tiles[i] & 0xFFF00000u) == referenceTiles[i] && offset + count <= assignment.GetLightIndexCount();
+					isMatch = isMatch && memcmp(indices + offset, referenceIndices.data() + (size_t)i * maxLightsPerCluster, count * sizeof(uint)) == 0;
+					mismatchCount += isMatch ? 0u : 1u;
+				}
+
+				if (!useDepthTiles)
+				{
+					nanoseconds[0] = referenceNanoseconds;
+					averageCount = assignment.GetLightIndexCount() / (double)assignment.GetClusterCount();
+				}
+			}
+
+			for (auto t = 0u; t < 2u; ++t)
+			{
+				auto begin = Profiler::GetTimestamp();
+
+				for (auto i = 0u; i < iterations; ++i)
+				{
+					assignment.Execute(lights.data(), lightCount, worldToView, inverseProjection, zNear, zFar, cascades.planes, nullptr, t == 0 ? 1u : threadCount);
+				}
+
+				nanoseconds[1 + t] = Profiler::GetTimestamp() - begin;
+			}
+
+			PK_CORE_LOG("%-8u %-10.3f %-10.3f %-10.3f %-12.1f %-10u",
+				lightCount,
+				nanoseconds[0] * 1e-6,
+				nanoseconds[1] * 1e-6 / iterations,
+				nanoseconds[2] * 1e-6 / iterations,
+				averageCount,
+				mismatchCount);
+
+			if (mismatchCount > 0)
+			{
+				PK_CORE_LOG_WARNING("Cluster light assignment differs from the shader port in %u clusters with %u lights.", mismatchCount, lightCount);
+				++failureCount;
+			}
+		}
+
+		return failureCount;
+	}
+}
\ No newline at end of file
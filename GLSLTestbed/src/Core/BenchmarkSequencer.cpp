@@ -0,0 +1,302 @@
+#include "PrecompiledHeader.h"
+#include "Utilities/Log.h"
+#include "Core/Profiler.h"
+#include "ECS/Sequencer.h"
+#include "Core/BenchmarkSuites.h"
+#include <atomic>
+#include <thread>
+
+namespace PK::Core::Benchmark
+{
+	using namespace PK::Utilities;
+	using namespace PK::Rendering;
+	using namespace PK::Rendering::Objects;
+	using namespace PK::Rendering::Structs;
+	using namespace PK::ECS;
+	using namespace PK::Math;
+
+	class SequencerBenchmarkStep : public ISimpleStep
+	{
+		public:
+			void Step(int condition) override { value += condition; }
+			uint64_t value = 0;
+	};
+
+	// Root sequence dispatch as it was before steps were resolved at registration: a map lookup per condition & two dynamic casts per step.
+	static void ExecuteLegacyRootSequence(const std::unordered_map<int, std::vector<IBaseStep*>>& steps, const std::vector<int>& sequence)
+	{
+		for (auto condition : sequence)
+		{
+			if (steps.count(condition) < 1)
+			{
+				continue;
+			}
+
+			for (auto* i : steps.at(condition))
+			{
+				PK_PROFILE_TRACE_SCOPE(typeid(*i).name(), "step", condition);
+
+				if (auto* conditionalStep = dynamic_cast<IConditionalStep<void>*>(i))
+				{
+					conditionalStep->Step(nullptr, condition);
+				}
+
+				if (auto* step = dynamic_cast<IStep<void>*>(i))
+				{
+					step->Step(nullptr);
+				}
+			}
+		}
+	}
+
+	// Same shape as the root sequence of the application: 7 conditions with 1 to 3 steps each.
+	void MeasureSequencerDispatch(uint32_t iterations)
+	{
+		SequencerBenchmarkStep s[3];
+		Sequencer sequencer;
+		sequencer.SetSteps(
+		{
+			{
+				sequencer.GetRoot(),
+				{
+					{ 0, { PK_STEP_S(&s[0]), PK_STEP_S(&s[1]) }},
+					{ 1, { PK_STEP_S(&s[0]) }},
+					{ 2, { PK_STEP_S(&s[1]), PK_STEP_S(&s[2]) }},
+					{ 3, { PK_STEP_S(&s[0]) }},
+					{ 4, { PK_STEP_S(&s[0]), PK_STEP_S(&s[1]), PK_STEP_S(&s[2]) }},
+					{ 5, { PK_STEP_S(&s[0]) }},
+					{ 6, { PK_STEP_S(&s[0]), PK_STEP_S(&s[1]), PK_STEP_S(&s[2]) }},
+				}
+			}
+		});
+		sequencer.SetRootSequence({ 0, 1, 2, 3, 4, 5, 6 });
+
+		std::unordered_map<int, std::vector<IBaseStep*>> legacySteps =
+		{
+			{ 0, { &s[0], &s[1] }},
+			{ 1, { &s[0] }},
+			{ 2, { &s[1], &s[2] }},
+			{ 3, { &s[0] }},
+			{ 4, { &s[0], &s[1], &s[2] }},
+			{ 5, { &s[0] }},
+			{ 6, { &s[0], &s[1], &s[2] }},
+		};
+		std::vector<int> legacySequence = { 0, 1, 2, 3, 4, 5, 6 };
+
+		std::vector<std::pair<ISimpleStep*, int>> directCalls;
+
+		for (auto condition : legacySequence)
+		{
+			for (auto* step : legacySteps.at(condition))
+			{
+				directCalls.push_back({ static_cast<SequencerBenchmarkStep*>(step), condition });
+			}
+		}
+
+		uint64_t nanoseconds[3] = {};
+		auto begin = Profiler::GetTimestamp();
+
+		for (auto i = 0u; i < iterations; ++i)
+		{
+			ExecuteLegacyRootSequence(legacySteps, legacySequence);
+		}
+
+		nanoseconds[0] = Profiler::GetTimestamp() - begin;
+		begin = Profiler::GetTimestamp();
+
+		for (auto i = 0u; i < iterations; ++i)
+		{
+			sequencer.ExecuteRootSequence();
+		}
+
+		nanoseconds[1] = Profiler::GetTimestamp() - begin;
+		begin = Profiler::GetTimestamp();
+
+		for (auto i = 0u; i < iterations; ++i)
+		{
+			for (auto& call : directCalls)
+			{
+				call.first->Step(call.second);
+			}
+		}
+
+		nanoseconds[2] = Profiler::GetTimestamp() - begin;
+		sequencer.Release();
+
+		PK_CORE_LOG("Root sequence dispatch (%zu steps): %.1f ns legacy, %.1f ns sequencer, %.1f ns virtual calls. (checksum %llu)",
+			directCalls.size(),
+			nanoseconds[0] / (double)iterations,
+			nanoseconds[1] / (double)iterations,
+			nanoseconds[2] / (double)iterations,
+			s[0].value + s[1].value + s[2].value);
+	}
+
+	static std::atomic<uint32_t> s_activeSteps = 0;
+	static std::atomic<uint32_t> s_maxActiveSteps = 0;
+	static std::atomic<uint32_t> s_mainThreadViolations = 0;
+	static std::thread::id s_mainThreadId;
+
+	// Mixes the resources it reads into the resources it writes. Any reordering of conflicting steps changes the result.
+	// Resources are per condition so that a step can be declared differently for each root step it appears in.
+	class DeterminismStep : public ISimpleStep
+	{
+		public:
+			void Step(int condition) override
+			{
+				auto active = s_activeSteps.fetch_add(1u) + 1u;
+				auto max = s_maxActiveSteps.load();
+
+				while (active > max && !s_maxActiveSteps.compare_exchange_weak(max, active)) {}
+
+				if (isMainThread && std::this_thread::get_id() != s_mainThreadId)
+				{
+					++s_mainThreadViolations;
+				}
+
+				auto value = index * 0x9E3779B97F4A7C15ull + (uint64_t)condition;
+
+				for (auto i = 0u; i < 256u; ++i)
+				{
+					for (auto* read : reads[condition])
+					{
+						value = (value ^ *read) * 1099511628211ull;
+					}
+				}
+
+				for (auto* write : writes[condition])
+				{
+					*write = *write * 31ull + value;
+				}
+
+				s_activeSteps.fetch_sub(1u);
+			}
+
+			uint64_t index = 0;
+			bool isMainThread = false;
+			std::vector<uint64_t*> reads[4];
+			std::vector<uint64_t*> writes[4];
+	};
+
+	static void AddRandomAccess(DeterminismStep* step, uint64_t* resources, uint32_t resourceCount, int condition)
+	{
+		step->reads[condition].push_back(&resources[rand() % resourceCount]);
+		step->reads[condition].push_back(&resources[rand() % resourceCount]);
+
+		if (rand() % 3 != 0)
+		{
+			step->writes[condition].push_back(&resources[rand() % resourceCount]);
+		}
+	}
+
+	static StepAccess GetDeterminismAccess(const DeterminismStep& step, int condition)
+	{
+		StepAccess access;
+		access.reads.assign(step.reads[condition].begin(), step.reads[condition].end());
+		access.writes.assign(step.writes[condition].begin(), step.writes[condition].end());
+		access.isMainThread = step.isMainThread;
+		return access;
+	}
+
+	// Runs a root sequence of steps with random resource access in serial & parallel mode. Both must produce the same resource values.
+	// The last step appears in every root step with access declared per condition. Some steps are declared as main thread steps.
+	uint32_t ValidateSequencerDeterminism(uint32_t frameCount, uint32_t randomSeed)
+	{
+		const uint32_t resourceCount = 8;
+		const uint32_t stepCount = 17;
+		uint64_t resources[resourceCount];
+		DeterminismStep steps[stepCount];
+		Sequencer sequencer;
+
+		srand(randomSeed);
+		s_mainThreadId = std::this_thread::get_id();
+		s_mainThreadViolations = 0;
+
+		for (auto i = 0u; i < stepCount - 1; ++i)
+		{
+			steps[i].index = i;
+			steps[i].isMainThread = i % 5 == 2;
+			AddRandomAccess(&steps[i], resources, resourceCount, i / 4);
+		}
+
+		steps[16].index = 16;
+
+		for (auto condition = 0; condition < 4; ++condition)
+		{
+			AddRandomAccess(&steps[16], resources, resourceCount, condition);
+		}
+
+		sequencer.SetSteps(
+		{
+			{
+				sequencer.GetRoot(),
+				{
+					{ 0, { PK_STEP_S(&steps[0]), PK_STEP_S(&steps[1]), PK_STEP_S(&steps[2]), PK_STEP_S(&steps[3]), PK_STEP_S(&steps[16]) }},
+					{ 1, { PK_STEP_S(&steps[4]), PK_STEP_S(&steps[5]), PK_STEP_S(&steps[16]), PK_STEP_S(&steps[6]), PK_STEP_S(&steps[7]) }},
+					{ 2, { PK_STEP_S(&steps[8]), PK_STEP_S(&steps[9]), PK_STEP_S(&steps[10]), PK_STEP_S(&steps[11]), PK_STEP_S(&steps[16]) }},
+					{ 3, { PK_STEP_S(&steps[16]), PK_STEP_S(&steps[12]), PK_STEP_S(&steps[13]), PK_STEP_S(&steps[14]), PK_STEP_S(&steps[15]) }},
+				}
+			}
+		});
+		sequencer.SetRootSequence({ 0, 1, 2, 3 });
+
+		// Step 9 has no declared access & acts as a barrier on the main thread.
+		for (auto i = 0u; i < stepCount - 1; ++i)
+		{
+			if (i != 9)
+			{
+				sequencer.SetStepAccess(&steps[i], GetDeterminismAccess(steps[i], i / 4));
+			}
+		}
+
+		for (auto condition = 0; condition < 4; ++condition)
+		{
+			sequencer.SetStepAccess(&steps[16], condition, GetDeterminismAccess(steps[16], condition));
+		}
+
+		uint64_t hashes[2] = {};
+
+		for (auto mode = 0; mode < 2; ++mode)
+		{
+			sequencer.SetExecutionMode(mode == 0 ? ExecutionMode::Serial : ExecutionMode::Parallel);
+			s_maxActiveSteps = 0;
+
+			for (auto i = 0u; i < resourceCount; ++i)
+			{
+				resources[i] = i;
+			}
+
+			for (auto i = 0u; i < frameCount; ++i)
+			{
+				sequencer.ExecuteRootSequence();
+			}
+
+			hashes[mode] = 14695981039346656037ull;
+
+			for (auto i = 0u; i < resourceCount; ++i)
+			{
+				hashes[mode] = (hashes[mode] ^ resources[i]) * 1099511628211ull;
+			}
+		}
+
+		sequencer.Release();
+		auto failureCount = 0u;
+
+		if (hashes[0] == hashes[1])
+		{
+			PK_CORE_LOG("Sequencer determinism validated over %u frames: %llx, up to %u concurrent steps.", frameCount, hashes[0], s_maxActiveSteps.load());
+		}
+		else
+		{
+			PK_CORE_LOG_WARNING("Sequencer determinism failed: parallel %llx != serial %llx.", hashes[1], hashes[0]);
+			++failureCount;
+		}
+
+		if (s_mainThreadViolations > 0)
+		{
+			PK_CORE_LOG_WARNING("Sequencer ran main thread steps on a worker %u times.", s_mainThreadViolations.load());
+			++failureCount;
+		}
+
+		return failureCount;
+	}
+}
\ No newline at end of file
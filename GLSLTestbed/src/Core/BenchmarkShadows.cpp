@@ -0,0 +1,659 @@
+#include "PrecompiledHeader.h"
+#include "Utilities/Log.h"
+#include "Core/Profiler.h"
+#include "ECS/Contextual/EntityViews/EntityViews.h"
+#include "Rendering/Culling.h"
+#include "Rendering/LightsManager.h"
+#include "Rendering/ShadowmapCache.h"
+#include "Rendering/ShadowCascadeCache.h"
+#include "Core/BenchmarkSuites.h"
+
+namespace PK::Core::Benchmark
+{
+	using namespace PK::Utilities;
+	using namespace PK::Rendering;
+	using namespace PK::Rendering::Objects;
+	using namespace PK::Rendering::Structs;
+	using namespace PK::ECS;
+	using namespace PK::Math;
+
+	static bool IsInsideFrustum(const FrustumPlanes& frustum, const float3& point, float margin)
+	{
+		for (auto i = 0u; i < 6u; ++i)
+		{
+			if (Functions::PlaneDistanceToPoint(frustum.planes[i], point) < margin)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Checks the shadow caster hull & receiver clamped cascades against random cameras & lights.
+	// Points outside of a caster hull are marched away from the light & must never enter the camera frustum.
+	// Random receivers that are visible must be inside of the cascades that cover their depth.
+	uint32_t ValidateShadowCasterCulling(const LightsManager* lightsManager, uint32_t frameIndex, uint32_t randomSeed)
+	{
+		const uint cameraCount = 8;
+		const uint pointCount = 2048;
+		const uint receiverCount = 256;
+		const uint marchStepCount = 600;
+		const float marchDistance = 600.0f;
+		const float cascadePadding = -50.0f;
+		// Hull planes are built from frustum corners that are up to zFar away. Points closer to a plane than this are not classified.
+		const float tolerance = 1e-2f;
+		const auto cascadeCount = ShadowCascadeCache::MaxCascadeCount;
+
+		srand(randomSeed);
+		auto hullFailures = 0u;
+		auto shadowFailures = 0u;
+		auto receiverFailures = 0u;
+		auto culledPointCount = 0u;
+		auto clampedArea = 0.0;
+		auto unionArea = 0.0;
+
+		for (auto c = 0u; c < cameraCount; ++c)
+		{
+			float4x4 view, projection;
+			GetCameraMatrices(frameIndex + c * 97u, &view, &projection);
+			auto viewProjection = projection * view;
+			auto inverseViewProjection = glm::inverse(viewProjection);
+			FrustumPlanes frustum;
+			Functions::ExtractFrustrumPlanes(viewProjection, &frustum, true);
+
+			// Caster hulls of a point light & a directional light.
+			for (auto l = 0u; l < 2u; ++l)
+			{
+				auto light = l == 0u ?
+					float4(Functions::RandomRangeFloat3(SceneMin * 2.0f, SceneMax * 2.0f), 1.0f) :
+					float4(glm::quat(Functions::RandomEuler() * PK_FLOAT_DEG2RAD) * -PK_FLOAT3_FORWARD, 0.0f);
+
+				float4 planes[PK_MAX_SHADOW_CASTER_PLANES];
+				auto planeCount = Functions::GetShadowCasterCullingPlanes(inverseViewProjection, light, planes);
+
+				for (auto p = 0u; p < pointCount; ++p)
+				{
+					auto point = Functions::RandomRangeFloat3(float3(-250.0f), float3(250.0f));
+					auto hullDistance = std::numeric_limits<float>().max();
+
+					for (auto i = 0u; i < planeCount; ++i)
+					{
+						hullDistance = glm::min(hullDistance, Functions::PlaneDistanceToPoint(planes[i], point));
+					}
+
+					if (hullDistance >= -tolerance)
+					{
+						continue;
+					}
+
+					++culledPointCount;
+					hullFailures += IsInsideFrustum(frustum, point, tolerance) ? 1u : 0u;
+					auto direction = light.w > 0.0f ? glm::normalize(point - float3(light.xyz)) : -float3(light.xyz);
+
+					for (auto s = 1u; s <= marchStepCount; ++s)
+					{
+						if (IsInsideFrustum(frustum, point + direction * (marchDistance * s / marchStepCount), tolerance))
+						{
+							++shadowFailures;
+							break;
+						}
+					}
+				}
+			}
+
+			// Cascades clamped to the receivers of each cascade & to the union of all receivers.
+			auto cascades = lightsManager->GetCascadeZSplits(Functions::GetZNearFromProj(projection), Functions::GetZFarFromProj(projection));
+			auto worldToLocal = Functions::GetMatrixInvTRS(PK_FLOAT3_ZERO, glm::quat(Functions::RandomEuler() * PK_FLOAT_DEG2RAD), PK_FLOAT3_ONE);
+			ShadowCascadeReceivers receivers(cascades);
+			BoundingBox unionBounds[cascadeCount];
+			std::vector<BoundingBox> visibleReceivers;
+
+			for (auto i = 0u; i < receiverCount; ++i)
+			{
+				auto center = Functions::RandomRangeFloat3(SceneMin, SceneMax);
+				auto extents = Functions::RandomRangeFloat3(float3(0.5f), float3(4.0f));
+				auto aabb = BoundingBox(center - extents, center + extents);
+
+				if (!Functions::IntersectPlanesAABB(frustum.planes, 6, aabb))
+				{
+					continue;
+				}
+
+				receivers.Add(aabb, Functions::PlaneDistanceToPoint(frustum.planes[4], center));
+
+				for (auto j = 0u; j < cascadeCount; ++j)
+				{
+					if (visibleReceivers.empty())
+					{
+						unionBounds[j] = aabb;
+					}
+					else
+					{
+						Functions::BoundsEncapsulate(unionBounds + j, aabb);
+					}
+				}
+
+				visibleReceivers.push_back(aabb);
+			}
+
+			if (visibleReceivers.empty())
+			{
+				continue;
+			}
+
+			float4x4 matrices[cascadeCount];
+			float4x4 unionMatrices[cascadeCount];
+			Functions::GetShadowCascadeMatrices(worldToLocal, inverseViewProjection, cascades.planes, cascadePadding, cascadeCount, matrices, receivers.bounds);
+			Functions::GetShadowCascadeMatrices(worldToLocal, inverseViewProjection, cascades.planes, cascadePadding, cascadeCount, unionMatrices, unionBounds);
+
+			for (auto& aabb : visibleReceivers)
+			{
+				for (auto k = 0u; k < 9u; ++k)
+				{
+					auto point = k < 8u ? float3(k & 1u ? aabb.max.x : aabb.min.x, k & 2u ? aabb.max.y : aabb.min.y, k & 4u ? aabb.max.z : aabb.min.z) : aabb.GetCenter();
+					auto depth = Functions::PlaneDistanceToPoint(frustum.planes[4], point);
+
+					if (!IsInsideFrustum(frustum, point, 0.0f))
+					{
+						continue;
+					}
+
+					for (auto j = 0u; j < cascadeCount; ++j)
+					{
+						if (depth < cascades.planes[j] + 1e-2f || depth > cascades.planes[j + 1] - 1e-2f)
+						{
+							continue;
+						}
+
+						auto clip = matrices[j] * float4(point, 1.0f);
+						receiverFailures += glm::abs(clip.x) > 1.001f || glm::abs(clip.y) > 1.001f || glm::abs(clip.z) > 1.001f ? 1u : 0u;
+					}
+				}
+			}
+
+			// Ortho x & y scales are 2 / width & 2 / height.
+			for (auto j = 0u; j < cascadeCount; ++j)
+			{
+				clampedArea += 4.0 / ((double)glm::length(float3(matrices[j][0][0], matrices[j][1][0], matrices[j][2][0])) * glm::length(float3(matrices[j][0][1], matrices[j][1][1], matrices[j][2][1])));
+				unionArea += 4.0 / ((double)glm::length(float3(unionMatrices[j][0][0], unionMatrices[j][1][0], unionMatrices[j][2][0])) * glm::length(float3(unionMatrices[j][0][1], unionMatrices[j][1][1], unionMatrices[j][2][1])));
+			}
+		}
+
+		PK_CORE_LOG_HEADER("Shadow caster culling: %u cameras, %u points per light, %u receivers per camera.", cameraCount, pointCount, receiverCount);
+		PK_CORE_LOG("%u points outside of caster hulls, per cascade receiver bounds cover %.1f%% of the cascade area of union bounds.", culledPointCount, unionArea > 0.0 ? 100.0 * clampedArea / unionArea : 100.0);
+
+		if (hullFailures > 0 || shadowFailures > 0 || receiverFailures > 0)
+		{
+			PK_CORE_LOG_WARNING("Shadow caster culling failed: %u culled points inside of the camera frustum, %u culled points shadowing the frustum, %u receiver points outside of their cascade.", hullFailures, shadowFailures, receiverFailures);
+			return 1u;
+		}
+
+		return 0u;
+	}
+
+	static void CountShadowVolumeItem(EntityDatabase* entityDb, EGID egid, uint volumeIndex, uint clipIndex, float depth, void* context)
+	{
+		++reinterpret_cast<uint*>(context)[volumeIndex];
+	}
+
+	// Culling all shadow volumes of a frame in a single pass must find the same casters & rejections per volume as culling each volume on its own.
+	uint32_t ValidateShadowVolumeCulling(Scene* scene, const LightsManager* lightsManager, uint32_t frameIndex, uint32_t randomSeed)
+	{
+		const uint volumeCount = 9;
+		const float volumeRange = 30.0f;
+
+		float4x4 view, projection;
+		GetCameraMatrices(frameIndex, &view, &projection);
+		auto inverseViewProjection = glm::inverse(projection * view);
+		auto cascades = lightsManager->GetCascadeZSplits(Functions::GetZNearFromProj(projection), Functions::GetZFarFromProj(projection));
+		const ushort cullingMask = (ushort)(Components::RenderHandleFlags::Renderer | Components::RenderHandleFlags::ShadowCaster);
+
+		srand(randomSeed);
+		std::vector<Culling::CullingVolume> volumes(volumeCount);
+
+		for (auto i = 0u; i < volumeCount; ++i)
+		{
+			auto& volume = volumes[i];
+			auto position = Functions::RandomRangeFloat3(SceneMin, SceneMax);
+			auto rotation = glm::quat(Functions::RandomEuler() * PK_FLOAT_DEG2RAD);
+			auto light = float4(position, 1.0f);
+
+			switch (i % 3u)
+			{
+				case 0u:
+					volume.type = Culling::CullingVolumeType::CubeFaces;
+					volume.aabb = BoundingBox(position - float3(volumeRange), position + float3(volumeRange));
+					volume.frustumCount = 0;
+					break;
+				case 1u:
+					volume.type = Culling::CullingVolumeType::Frustum;
+					volume.frustumCount = 1;
+					Functions::ExtractFrustrumPlanes(Functions::GetPerspective(90.0f, 1.0f, 0.1f, volumeRange) * Functions::GetMatrixInvTRS(position, rotation, PK_FLOAT3_ONE), volume.frustums, true);
+					break;
+				case 2u:
+				{
+					float4x4 matrices[ShadowCascadeCache::MaxCascadeCount];
+					Functions::GetShadowCascadeMatrices(Functions::GetMatrixInvTRS(PK_FLOAT3_ZERO, rotation, PK_FLOAT3_ONE), inverseViewProjection, cascades.planes, -50.0f, ShadowCascadeCache::MaxCascadeCount, matrices);
+					volume.type = Culling::CullingVolumeType::Cascades;
+					volume.frustumCount = ShadowCascadeCache::MaxCascadeCount;
+
+					for (auto j = 0u; j < volume.frustumCount; ++j)
+					{
+						Functions::ExtractFrustrumPlanes(matrices[j], volume.frustums + j, true);
+					}
+
+					light = float4(rotation * -PK_FLOAT3_FORWARD, 0.0f);
+					break;
+				}
+			}
+
+			volume.casterPlaneCount = Functions::GetShadowCasterCullingPlanes(inverseViewProjection, light, volume.casterPlanes);
+		}
+
+		std::vector<uint> singlePassCounts(volumeCount, 0u);
+		std::vector<uint> singlePassRejections(volumeCount, 0u);
+		std::vector<uint> counts(volumeCount, 0u);
+		std::vector<uint> rejections(volumeCount, 0u);
+
+		Culling::ExecuteOnVisibleItemsVolumes(scene->entityDb, volumes.data(), volumeCount, cullingMask, CountShadowVolumeItem, singlePassCounts.data(), singlePassRejections.data());
+
+		for (auto i = 0u; i < volumeCount; ++i)
+		{
+			Culling::ExecuteOnVisibleItemsVolumes(scene->entityDb, volumes.data() + i, 1, cullingMask, CountShadowVolumeItem, counts.data() + i, rejections.data() + i);
+		}
+
+		auto mismatchCount = 0u;
+		auto drawCount = 0u;
+		auto rejectedCount = 0u;
+
+		for (auto i = 0u; i < volumeCount; ++i)
+		{
+			mismatchCount += singlePassCounts[i] != counts[i] || singlePassRejections[i] != rejections[i] ? 1u : 0u;
+			drawCount += counts[i];
+			rejectedCount += rejections[i];
+		}
+
+		PK_CORE_LOG_HEADER("Shadow volume culling: %u volumes, %u caster draws, %u casters rejected by the camera frustum.", volumeCount, drawCount, rejectedCount);
+
+		if (mismatchCount > 0)
+		{
+			PK_CORE_LOG_WARNING("Single pass shadow volume culling differs from per volume culling in %u volumes.", mismatchCount);
+			return 1u;
+		}
+
+		return 0u;
+	}
+
+	// Moves a camera in sub texel steps & checks that stable cascades stay snapped to the texels of their shadowmap.
+	// World space points must keep their sub texel position, cascade scales must not change & matrices may only change when a texel boundary is crossed.
+	// Cached cascades that are updated at a lower frequency must match the solved cascades on their update frames.
+	uint32_t ValidateShadowCascadeStability(const LightsManager* lightsManager, uint32_t frameIndex, uint32_t randomSeed)
+	{
+		const uint resolution = 2048;
+		const uint stepCount = 512;
+		const uint pointCount = 16;
+		const uint updateInterval = 8;
+		const float stepTexels = 0.1f;
+		const float cascadePadding = -50.0f;
+		const auto cascadeCount = ShadowCascadeCache::MaxCascadeCount;
+
+		float4x4 view, projection;
+		GetCameraMatrices(frameIndex, &view, &projection);
+		auto cascades = lightsManager->GetCascadeZSplits(Functions::GetZNearFromProj(projection), Functions::GetZFarFromProj(projection));
+		auto worldToLocal = Functions::GetMatrixInvTRS(PK_FLOAT3_ZERO, glm::quat(float3(25.0f, -35.0f, 0.0f) * PK_FLOAT_DEG2RAD), PK_FLOAT3_ONE);
+		auto cameraToWorld = glm::inverse(view);
+		auto inverseProjection = glm::inverse(projection);
+		ShadowCascadeCache cache(cascadeCount, resolution, updateInterval, true);
+
+		srand(randomSeed);
+		float3 points[pointCount];
+
+		for (auto& point : points)
+		{
+			point = Functions::RandomRangeFloat3(SceneMin, SceneMax);
+		}
+
+		float4x4 matrices[cascadeCount];
+		float4x4 previousMatrices[cascadeCount];
+		float2 firstTexels[cascadeCount][pointCount];
+		float texelSizes[cascadeCount];
+		uint changeCounts[cascadeCount] = {};
+		uint lastUpdateFrames[cascadeCount] = {};
+		auto snapFailures = 0u;
+		auto scaleFailures = 0u;
+		auto cacheFailures = 0u;
+		auto offset = PK_FLOAT3_ZERO;
+		auto step = PK_FLOAT3_ZERO;
+		auto distance = 0.0f;
+
+		for (auto frame = 0u; frame <= stepCount; ++frame)
+		{
+			auto inverseViewProjection = Functions::GetMatrixTRS(offset, PK_QUATERNION_IDENTITY, PK_FLOAT3_ONE) * cameraToWorld * inverseProjection;
+			Functions::GetStableShadowCascadeMatrices(worldToLocal, inverseViewProjection, cascades.planes, cascadePadding, resolution, cascadeCount, matrices);
+
+			cache.BeginFrame();
+			auto& cached = cache.Update(0u, worldToLocal, inverseViewProjection, cascades.planes, cascadePadding, nullptr);
+
+			for (auto i = 0u; i < cascadeCount; ++i)
+			{
+				// Ortho x scale is 1 / radius & a cascade spans the resolution.
+				auto texelSize = 2.0f / (glm::length(float3(matrices[i][0][0], matrices[i][1][0], matrices[i][2][0])) * resolution);
+
+				if (frame == 0u)
+				{
+					texelSizes[i] = texelSize;
+				}
+				else
+				{
+					scaleFailures += glm::abs(texelSize - texelSizes[i]) > texelSizes[i] * 1e-4f ? 1u : 0u;
+					changeCounts[i] += matrices[i] != previousMatrices[i] ? 1u : 0u;
+				}
+
+				for (auto j = 0u; j < pointCount; ++j)
+				{
+					auto clip = matrices[i] * float4(points[j], 1.0f);
+					auto texel = (float2(clip.xy) * 0.5f + 0.5f) * (float)resolution;
+					texel -= glm::floor(texel);
+
+					if (frame == 0u)
+					{
+						firstTexels[i][j] = texel;
+						continue;
+					}
+
+					auto delta = glm::abs(texel - firstTexels[i][j]);
+					delta = glm::min(delta, 1.0f - delta);
+					snapFailures += delta.x > 1e-2f || delta.y > 1e-2f ? 1u : 0u;
+				}
+
+				// A cascade that is due for an update matches the solved cascade. Others lag by less than their interval.
+				if (cached.matrices[i] == matrices[i])
+				{
+					lastUpdateFrames[i] = frame;
+				}
+
+				cacheFailures += (cached.dirtyMask & (1u << i)) != 0u && cached.matrices[i] != matrices[i] ? 1u : 0u;
+				cacheFailures += frame - lastUpdateFrames[i] >= cache.GetUpdateInterval(i) ? 1u : 0u;
+				previousMatrices[i] = matrices[i];
+			}
+
+			if (frame == 0u)
+			{
+				step = glm::normalize(Functions::RandomRangeFloat3(float3(-1.0f), float3(1.0f))) * texelSizes[0] * stepTexels;
+			}
+
+			offset += step;
+			distance += glm::length(step);
+		}
+
+		// Each texel boundary that the camera crosses can change the snapped center on every axis once.
+		auto changeFailures = 0u;
+
+		for (auto i = 0u; i < cascadeCount; ++i)
+		{
+			changeFailures += changeCounts[i] > (uint)(3.0f * distance / texelSizes[i]) + 3u ? 1u : 0u;
+		}
+
+		PK_CORE_LOG_HEADER("Shadow cascade stability: %u steps of %.2f texels, %u points per cascade.", stepCount, stepTexels, pointCount);
+		PK_CORE_LOG("Cascade matrix changes: %u, %u, %u, %u.", changeCounts[0], changeCounts[1], changeCounts[2], changeCounts[3]);
+
+		if (snapFailures > 0 || scaleFailures > 0 || changeFailures > 0 || cacheFailures > 0)
+		{
+			PK_CORE_LOG_WARNING("Shadow cascade stability failed: %u unsnapped points, %u scale changes, %u cascades changed too often, %u cache mismatches.", snapFailures, scaleFailures, changeFailures, cacheFailures);
+			return 1u;
+		}
+
+		return 0u;
+	}
+
+	struct ShadowmapAllocation
+	{
+		ShadowmapCache::Tile tile;
+		uint layerCount = 0;
+	};
+
+	// Rebuilds the atlas occupancy from the tiles of the lights that still own one & drops the ones that were evicted.
+	// Returns the number of cells covered more than once.
+	static uint CountShadowmapOverlaps(const ShadowmapCache& cache, std::unordered_map<uint, ShadowmapAllocation>* allocations, uint* coveredCellCount)
+	{
+		const uint cellsPerRow = 1u << ShadowmapCache::MaxLevel;
+		std::vector<uint> cells((size_t)cache.GetLayerCount() * cellsPerRow * cellsPerRow, 0u);
+
+		for (auto iter = allocations->begin(); iter != allocations->end();)
+		{
+			uint level;
+
+			if (!cache.TryGetLevel(iter->first, &level))
+			{
+				iter = allocations->erase(iter);
+				continue;
+			}
+
+			auto& tile = iter->second.tile;
+			auto size = 1u << (ShadowmapCache::MaxLevel - tile.level);
+
+			for (auto layer = tile.layer; layer < tile.layer + iter->second.layerCount; ++layer)
+			{
+				for (auto y = tile.y * size; y < (tile.y + 1) * size; ++y)
+				{
+					for (auto x = tile.x * size; x < (tile.x + 1) * size; ++x)
+					{
+						++cells[(layer * cellsPerRow + y) * cellsPerRow + x];
+					}
+				}
+			}
+
+			++iter;
+		}
+
+		auto overlapCount = 0u;
+		*coveredCellCount = 0u;
+
+		for (auto count : cells)
+		{
+			overlapCount += count > 1 ? 1u : 0u;
+			*coveredCellCount += count > 0 ? 1u : 0u;
+		}
+
+		return overlapCount;
+	}
+
+	// Fixed cases for the atlas packer, its least recently used eviction & tile invalidation followed by random allocations over many frames.
+	// Live tiles must never overlap & the allocated cell count must match the cells covered by live tiles.
+	uint32_t ValidateShadowmapCache(uint32_t frameCount, uint32_t randomSeed)
+	{
+		const uint layerCount = 4;
+		const uint cellsPerLayer = 1u << (2 * ShadowmapCache::MaxLevel);
+		const uint lightCount = 48;
+		auto failureCount = 0u;
+
+		auto expect = [&failureCount](bool condition, const char* description)
+		{
+			if (!condition)
+			{
+				++failureCount;
+				PK_CORE_LOG_WARNING("Shadowmap cache validation failed: %s", description);
+			}
+		};
+
+		ShadowmapCache::Tile tile;
+		uint coveredCellCount;
+
+		// Fill: cascades take whole layers from the end, small tiles fill partially used layers before starting empty ones.
+		{
+			ShadowmapCache cache(layerCount);
+			std::unordered_map<uint, ShadowmapAllocation> allocations;
+
+			expect(cache.Allocate(100u, 2u, 0u, &tile) && tile.layer == 2u, "cascade not packed at the end of the atlas");
+			allocations[100u] = { tile, 2u };
+
+			for (auto i = 0u; i < 2u * cellsPerLayer; ++i)
+			{
+				expect(cache.Allocate(i, 1u, ShadowmapCache::MaxLevel, &tile) && tile.layer == i / cellsPerLayer, "smallest tiles not packed layer by layer");
+				allocations[i] = { tile, 1u };
+			}
+
+			expect(!cache.Allocate(200u, 1u, ShadowmapCache::MaxLevel, &tile), "allocation succeeded in a full atlas");
+			expect(cache.GetEvictionCount() == 0u, "tiles used this frame were evicted");
+			expect(CountShadowmapOverlaps(cache, &allocations, &coveredCellCount) == 0u, "overlapping tiles after fill");
+			expect(coveredCellCount == layerCount * cellsPerLayer && cache.GetAllocatedCellCount() == coveredCellCount, "allocated cell count mismatch after fill");
+
+			// Eviction: light 17 was last used two frames ago, light 5 one frame ago. Only the older one is evicted.
+			cache.BeginFrame();
+
+			for (auto i = 0u; i < 2u * cellsPerLayer; ++i)
+			{
+				if (i != 5u && i != 17u)
+				{
+					cache.Allocate(i, 1u, ShadowmapCache::MaxLevel, &tile);
+				}
+			}
+
+			cache.Allocate(100u, 2u, 0u, &tile);
+			cache.BeginFrame();
+
+			for (auto i = 0u; i < 2u * cellsPerLayer; ++i)
+			{
+				if (i != 17u)
+				{
+					expect(cache.Allocate(i, 1u, ShadowmapCache::MaxLevel, &tile) && tile.layer == allocations[i].tile.layer && tile.x == allocations[i].tile.x && tile.y == allocations[i].tile.y, "reused tile moved");
+				}
+			}
+
+			cache.Allocate(100u, 2u, 0u, &tile);
+			uint level;
+			auto evictedTile = allocations[17u].tile;
+			expect(cache.Allocate(200u, 1u, ShadowmapCache::MaxLevel, &tile) && tile.layer == evictedTile.layer && tile.x == evictedTile.x && tile.y == evictedTile.y, "new tile did not replace the least recently used one");
+			allocations[200u] = { tile, 1u };
+			expect(!cache.TryGetLevel(17u, &level) && cache.TryGetLevel(5u, &level) && cache.GetEvictionCount() == 1u, "wrong light evicted");
+			expect(!cache.Allocate(201u, 1u, ShadowmapCache::MaxLevel, &tile) && cache.GetEvictionCount() == 1u, "tile used this frame was evicted");
+			expect(CountShadowmapOverlaps(cache, &allocations, &coveredCellCount) == 0u && cache.GetAllocatedCellCount() == coveredCellCount, "overlapping tiles after eviction");
+		}
+
+		// Fragmentation: a checkerboard of free cells has half the layer free but no free quad for a larger tile.
+		{
+			ShadowmapCache cache(1u);
+			std::unordered_map<uint, ShadowmapAllocation> allocations;
+
+			for (auto i = 0u; i < cellsPerLayer; ++i)
+			{
+				cache.Allocate(i, 1u, ShadowmapCache::MaxLevel, &tile);
+				allocations[i] = { tile, 1u };
+			}
+
+			for (auto i = 0u; i < cellsPerLayer; ++i)
+			{
+				if (((allocations[i].tile.x ^ allocations[i].tile.y) & 1u) != 0u)
+				{
+					cache.Release(i);
+				}
+			}
+
+			expect(CountShadowmapOverlaps(cache, &allocations, &coveredCellCount) == 0u && coveredCellCount == cellsPerLayer / 2u && cache.GetAllocatedCellCount() == coveredCellCount, "release did not free its cells");
+			expect(!cache.Allocate(300u, 1u, ShadowmapCache::MaxLevel - 1u, &tile) && cache.GetEvictionCount() == 0u, "larger tile placed into a fragmented layer");
+
+			// Once the remaining lights of one quad go stale they are evicted to make room for the larger tile.
+			cache.BeginFrame();
+
+			for (auto& allocation : allocations)
+			{
+				if (allocation.second.tile.x > 1u || allocation.second.tile.y > 1u)
+				{
+					cache.Allocate(allocation.first, 1u, ShadowmapCache::MaxLevel, &tile);
+				}
+			}
+
+			expect(cache.Allocate(300u, 1u, ShadowmapCache::MaxLevel - 1u, &tile) && tile.x == 0u && tile.y == 0u && cache.GetEvictionCount() == 2u, "stale quad not evicted for a larger tile");
+			allocations[300u] = { tile, 1u };
+			expect(CountShadowmapOverlaps(cache, &allocations, &coveredCellCount) == 0u && cache.GetAllocatedCellCount() == coveredCellCount, "overlapping tiles after defragmenting eviction");
+			expect(!cache.Allocate(301u, 1u, 0u, &tile), "whole layer allocated over tiles used this frame");
+		}
+
+		// Invalidation: tiles are rendered again when their inputs change, after Invalidate & after they are reallocated.
+		{
+			ShadowmapCache cache(layerCount);
+			ulong hashes[2] = { 1ull, 2ull };
+
+			expect(cache.Validate(0u, 1ull), "unallocated light reported as valid");
+			cache.Allocate(0u, 1u, 1u, &tile);
+			expect(cache.Validate(0u, 1ull), "new tile reported as valid");
+			expect(!cache.Validate(0u, 1ull), "unchanged tile reported as dirty");
+			expect(cache.Validate(0u, 3ull) && !cache.Validate(0u, 3ull), "changed inputs not detected");
+			cache.Invalidate(0u);
+			expect(cache.Validate(0u, 3ull) && !cache.Validate(0u, 3ull), "invalidated tile reported as valid");
+			cache.Allocate(0u, 1u, 2u, &tile);
+			expect(cache.Validate(0u, 3ull), "reallocated tile reported as valid");
+
+			cache.Allocate(1u, 2u, 0u, &tile);
+			expect(cache.ValidateLayers(1u, hashes, 2u) == 3u && cache.ValidateLayers(1u, hashes, 2u) == 0u, "cascade layers not validated");
+			hashes[1] = 4ull;
+			expect(cache.ValidateLayers(1u, hashes, 2u) == 2u, "single cascade layer change not detected");
+			cache.Release(1u);
+			expect(cache.ValidateLayers(1u, hashes, 2u) == 3u, "released cascade reported as valid");
+		}
+
+		// Random allocations, releases & cascades over many frames.
+		srand(randomSeed);
+		ShadowmapCache cache(layerCount);
+		std::unordered_map<uint, ShadowmapAllocation> allocations;
+		auto failedAllocationCount = 0u;
+		auto allocationCount = 0u;
+		auto overlapFrames = 0u;
+		auto cellCountFrames = 0u;
+		auto nanoseconds = 0ull;
+
+		for (auto frame = 0u; frame < frameCount; ++frame)
+		{
+			cache.BeginFrame();
+			auto visibleCount = 1u + (uint)(rand() % 12);
+
+			for (auto i = 0u; i < visibleCount; ++i)
+			{
+				auto lightId = (uint)(rand() % lightCount);
+				auto isCascade = lightId < 4u;
+				auto lightLayerCount = isCascade ? 2u + lightId % 3u : 1u;
+				auto level = isCascade ? 0u : (uint)(rand() % ShadowmapCache::LevelCount);
+
+				auto begin = Profiler::GetTimestamp();
+				auto isAllocated = cache.Allocate(lightId, lightLayerCount, level, &tile);
+				nanoseconds += Profiler::GetTimestamp() - begin;
+				++allocationCount;
+
+				if (!isAllocated)
+				{
+					++failedAllocationCount;
+					allocations.erase(lightId);
+					continue;
+				}
+
+				auto tilesPerRow = 1u << level;
+				expect(tile.level == level && tile.x < tilesPerRow && tile.y < tilesPerRow && tile.layer + lightLayerCount <= layerCount, "tile out of bounds");
+				allocations[lightId] = { tile, lightLayerCount };
+			}
+
+			if (rand() % 8 == 0)
+			{
+				auto lightId = (uint)(rand() % lightCount);
+				cache.Release(lightId);
+				allocations.erase(lightId);
+			}
+
+			overlapFrames += CountShadowmapOverlaps(cache, &allocations, &coveredCellCount) > 0u ? 1u : 0u;
+			cellCountFrames += cache.GetAllocatedCellCount() != coveredCellCount ? 1u : 0u;
+		}
+
+		expect(overlapFrames == 0u, "overlapping tiles during random allocations");
+		expect(cellCountFrames == 0u, "allocated cell count mismatch during random allocations");
+
+		PK_CORE_LOG_HEADER("Shadowmap cache: %u layers, %u frames of random allocations.", layerCount, frameCount);
+		PK_CORE_LOG("%u allocations, %u failed, %u evictions, %.1f ns/allocation, %u validation failures.",
+			allocationCount,
+			failedAllocationCount,
+			cache.GetEvictionCount(),
+			nanoseconds / (double)allocationCount,
+			failureCount);
+
+		return failureCount;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+#include "ECS/EntityDatabase.h"
+#include "Rendering/Objects/Mesh.h"
+#include "Rendering/Objects/Material.h"
+#include "Rendering/Structs/ShaderPropertyBlock.h"
+#include "Rendering/LightsManager.h"
+#include <string>
+#include <vector>
+
+// Subsystem measurements & validations run by the benchmark after the frame measurements. Each validation returns its number of failures.
+namespace PK::Core::Benchmark
+{
+    using namespace PK::Math;
+
+    struct Scene
+    {
+        ECS::EntityDatabase* entityDb = nullptr;
+        std::vector<Rendering::Objects::Mesh*> meshes;
+        std::vector<Rendering::Objects::Material*> materials;
+        uint32_t entityCount = 0;
+    };
+
+    static const float3 SceneMin = float3(-70, -5, -70);
+    static const float3 SceneMax = float3(70, 5, 70);
+
+    // Camera of a frame of the benchmark. Orbits the scene.
+    void GetCameraMatrices(uint32_t frameIndex, float4x4* view, float4x4* proj);
+
+    // BenchmarkCulling.cpp
+    uint32_t MeasureMaskedOcclusion(Scene* scene, uint32_t frameIndex, uint32_t frameCount);
+    uint32_t ValidateDepthPyramid(uint32_t randomSeed);
+
+    // BenchmarkLighting.cpp
+    uint32_t MeasureClusterLightAssignment(const Rendering::LightsManager* lightsManager, uint32_t frameCount, uint32_t randomSeed);
+
+    // BenchmarkShaders.cpp
+    void MeasurePropertyBlock(Rendering::Objects::Shader* shader, const Rendering::Structs::ShaderPropertyBlock& propertyBlock, const char* name, uint32_t iterations);
+    void MeasureVariantResolution(const Rendering::Objects::Material* material, uint32_t iterations);
+
+    // BenchmarkSequencer.cpp
+    void MeasureSequencerDispatch(uint32_t iterations);
+    uint32_t ValidateSequencerDeterminism(uint32_t frameCount, uint32_t randomSeed);
+
+    // BenchmarkBatching.cpp
+    uint32_t ValidateInstanceTransforms(uint32_t count, uint32_t randomSeed);
+
+    // BenchmarkShadows.cpp
+    uint32_t ValidateShadowCasterCulling(const Rendering::LightsManager* lightsManager, uint32_t frameIndex, uint32_t randomSeed);
+    uint32_t ValidateShadowVolumeCulling(Scene* scene, const Rendering::LightsManager* lightsManager, uint32_t frameIndex, uint32_t randomSeed);
+    uint32_t ValidateShadowCascadeStability(const Rendering::LightsManager* lightsManager, uint32_t frameIndex, uint32_t randomSeed);
+    uint32_t ValidateShadowmapCache(uint32_t frameCount, uint32_t randomSeed);
+
+    // BenchmarkTextures.cpp
+    uint32_t ValidateTextureStreaming(uint32_t randomSeed);
+    uint32_t MeasureTextureFormats(const std::string& cacheDirectory, uint32_t textureCount);
+}
\ No newline at end of file
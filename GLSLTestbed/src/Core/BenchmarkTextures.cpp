@@ -0,0 +1,406 @@
+#include "PrecompiledHeader.h"
+#include "Utilities/Log.h"
+#include "Utilities/ThreadPool.h"
+#include "Core/Profiler.h"
+#include "Rendering/TextureStreamer.h"
+#include "Rendering/TextureStreamingCache.h"
+#include "Rendering/TextureTranscoding.h"
+#include "Core/BenchmarkSuites.h"
+#include <filesystem>
+#include <thread>
+
+namespace PK::Core::Benchmark
+{
+	using namespace PK::Utilities;
+	using namespace PK::Rendering;
+	using namespace PK::Rendering::Objects;
+	using namespace PK::Rendering::Structs;
+	using namespace PK::ECS;
+	using namespace PK::Math;
+
+	// Simulates texture streaming with random sets of visible textures that are occasionally occluded for a frame.
+	// Loads stay in flight for a random number of updates, so evictions can hit pending loads.
+	// The budget must hold, levels that a visible texture asks for must never be evicted & loads must be issued in order of their level deficit.
+	// Once every load has landed or been cancelled nothing may be left pending.
+	uint32_t ValidateTextureStreaming(uint32_t randomSeed)
+	{
+		const uint textureCount = 64;
+		const uint visibleCount = 16;
+		const uint levelCount = 11;
+		const uint tailLevel = 3;
+		const uint phaseCount = 6;
+		const uint framesPerPhase = 100;
+		const uint maxLoadLatency = 4;
+		// Small enough that evictions regularly hit textures with a load in flight.
+		const ulong budget = 16ull << 20ull;
+
+		srand(randomSeed);
+		ulong levelSizes[levelCount];
+
+		for (auto i = 0u; i < levelCount; ++i)
+		{
+			auto resolution = 1024ull >> i;
+			levelSizes[i] = resolution * resolution * 3ull;
+		}
+
+		TextureStreamingCache cache(budget);
+
+		for (auto i = 0u; i < textureCount; ++i)
+		{
+			cache.Register(i, levelSizes, levelCount, tailLevel);
+		}
+
+		std::vector<uint> desiredLevels(textureCount);
+		std::vector<uint> reportedLevels(textureCount);
+		std::vector<TextureStreamingCache::Request> loads;
+		std::vector<TextureStreamingCache::Request> evictions;
+		std::vector<std::pair<TextureStreamingCache::Request, uint>> pendingLoads;
+		auto frameIndex = 0u;
+		auto loadCount = 0ull;
+		auto peakSize = 0ull;
+		auto nanoseconds = 0ull;
+		auto budgetViolations = 0u;
+		auto wantedEvictions = 0u;
+		auto priorityViolations = 0u;
+		auto convergedCount = 0u;
+
+		for (auto phase = 0u; phase < phaseCount; ++phase)
+		{
+			std::fill(desiredLevels.begin(), desiredLevels.end(), ~0u);
+
+			for (auto i = 0u; i < visibleCount; ++i)
+			{
+				auto textureId = (uint)(rand() % textureCount);
+				auto texelsPerPixel = glm::exp2(Functions::RandomRangeFloat(0.0f, 6.0f));
+				auto level = TextureStreamingCache::GetDesiredLevel(texelsPerPixel, tailLevel);
+				desiredLevels[textureId] = level < desiredLevels[textureId] ? level : desiredLevels[textureId];
+			}
+
+			for (auto frame = 0u; frame < framesPerPhase; ++frame, ++frameIndex)
+			{
+				for (auto i = 0u; i < pendingLoads.size();)
+				{
+					if (pendingLoads[i].second > frameIndex)
+					{
+						++i;
+						continue;
+					}
+
+					cache.CompleteLoad(pendingLoads[i].first.textureId, pendingLoads[i].first.level);
+					pendingLoads[i] = pendingLoads.back();
+					pendingLoads.pop_back();
+				}
+
+				for (auto i = 0u; i < textureCount; ++i)
+				{
+					reportedLevels[i] = rand() % 8 != 0 ? desiredLevels[i] : ~0u;
+
+					if (reportedLevels[i] != ~0u)
+					{
+						cache.ReportUsage(i, glm::exp2((float)reportedLevels[i]));
+					}
+				}
+
+				loads.clear();
+				evictions.clear();
+				auto begin = Profiler::GetTimestamp();
+				cache.Update(TextureStreamer::MaxLoadCount, &loads, &evictions);
+				nanoseconds += Profiler::GetTimestamp() - begin;
+				cache.BeginFrame();
+
+				auto size = cache.GetResidentSize() + cache.GetPendingSize();
+				peakSize = size > peakSize ? size : peakSize;
+				budgetViolations += size > budget ? 1u : 0u;
+				loadCount += loads.size();
+
+				for (auto& eviction : evictions)
+				{
+					wantedEvictions += eviction.level >= reportedLevels[eviction.textureId] ? 1u : 0u;
+				}
+
+				for (auto i = 1u; i < loads.size(); ++i)
+				{
+					auto previousDeficit = loads[i - 1].level + 1 - reportedLevels[loads[i - 1].textureId];
+					auto deficit = loads[i].level + 1 - reportedLevels[loads[i].textureId];
+					priorityViolations += deficit > previousDeficit ? 1u : 0u;
+				}
+
+				for (auto& load : loads)
+				{
+					pendingLoads.push_back({ load, frameIndex + 1u + (uint)(rand() % maxLoadLatency) });
+				}
+			}
+
+			for (auto i = 0u; i < textureCount; ++i)
+			{
+				uint level;
+				convergedCount += desiredLevels[i] != ~0u && cache.TryGetResidentLevel(i, &level) && level == desiredLevels[i] ? 1u : 0u;
+			}
+		}
+
+		for (auto& load : pendingLoads)
+		{
+			cache.CompleteLoad(load.first.textureId, load.first.level);
+		}
+
+		auto leakedSize = cache.GetPendingSize();
+
+		PK_CORE_LOG_HEADER("Texture streaming: %u textures, %u visible per phase, %.1f MB budget.", textureCount, visibleCount, budget / (double)(1ull << 20ull));
+		PK_CORE_LOG("%llu loads, %u evictions, %.1f MB peak, %u textures at their desired level after %u phases, %.1f ns/update.",
+			loadCount,
+			cache.GetEvictionCount(),
+			peakSize / (double)(1ull << 20ull),
+			convergedCount,
+			phaseCount,
+			nanoseconds / (double)(phaseCount * framesPerPhase));
+
+		if (budgetViolations > 0 || wantedEvictions > 0 || priorityViolations > 0 || leakedSize > 0)
+		{
+			PK_CORE_LOG_WARNING("Texture streaming failed: %u frames over budget, %u evictions of wanted levels, %u loads out of priority order, %llu bytes left pending.", budgetViolations, wantedEvictions, priorityViolations, leakedSize);
+			return 1u;
+		}
+
+		return 0u;
+	}
+
+	// Ktx 1 level rows are padded to 4 bytes while the basis encoder takes tightly packed rows. Textures with padded levels are not converted.
+	static bool TryEncodeKTX2(const std::string& sourcePath, const std::string& targetPath, bool uastc)
+	{
+		if (std::filesystem::exists(targetPath))
+		{
+			return true;
+		}
+
+		ktxTexture1* source = nullptr;
+
+		if (ktxTexture1_CreateFromNamedFile(sourcePath.c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &source) != KTX_SUCCESS)
+		{
+			return false;
+		}
+
+		ktx_uint32_t vkFormat = 0u;
+		ktx_uint32_t componentCount = 0u;
+
+		switch (source->glInternalformat)
+		{
+			// VK_FORMAT_R8_UNORM, VK_FORMAT_R8G8B8_UNORM & VK_FORMAT_R8G8B8A8_UNORM
+			case GL_R8: vkFormat = 9u; componentCount = 1u; break;
+			case GL_RGB8: vkFormat = 23u; componentCount = 3u; break;
+			case GL_RGBA8: vkFormat = 37u; componentCount = 4u; break;
+		}
+
+		auto isValid = vkFormat != 0u && source->numDimensions == 2 && !source->isArray && !source->isCubemap;
+
+		for (auto level = 0u; isValid && level < source->numLevels; ++level)
+		{
+			auto width = source->baseWidth >> level;
+			isValid = ((width > 0u ? width : 1u) * componentCount) % 4u == 0u;
+		}
+
+		ktxTexture2* target = nullptr;
+		ktxTextureCreateInfo createInfo = {};
+		createInfo.vkFormat = vkFormat;
+		createInfo.baseWidth = source->baseWidth;
+		createInfo.baseHeight = source->baseHeight;
+		createInfo.baseDepth = 1u;
+		createInfo.numDimensions = 2u;
+		createInfo.numLevels = source->numLevels;
+		createInfo.numLayers = 1u;
+		createInfo.numFaces = 1u;
+		createInfo.isArray = KTX_FALSE;
+		createInfo.generateMipmaps = KTX_FALSE;
+
+		if (isValid)
+		{
+			isValid = ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE, &target) == KTX_SUCCESS;
+		}
+
+		for (auto level = 0u; isValid && level < source->numLevels; ++level)
+		{
+			ktx_size_t offset = 0;
+			ktxTexture_GetImageOffset(ktxTexture(source), level, 0, 0, &offset);
+			auto size = ktxTexture_GetImageSize(ktxTexture(source), level);
+			isValid = ktxTexture_SetImageFromMemory(ktxTexture(target), level, 0, 0, source->pData + offset, size) == KTX_SUCCESS;
+		}
+
+		ktxTexture_Destroy(ktxTexture(source));
+
+		if (isValid)
+		{
+			ktxBasisParams params = {};
+			params.structSize = sizeof(params);
+			params.uastc = uastc ? KTX_TRUE : KTX_FALSE;
+			params.threadCount = std::thread::hardware_concurrency();
+			params.compressionLevel = KTX_ETC1S_DEFAULT_COMPRESSION_LEVEL;
+			params.qualityLevel = 128u;
+			params.uastcFlags = KTX_PACK_UASTC_LEVEL_DEFAULT;
+			isValid = ktxTexture2_CompressBasisEx(target, &params) == KTX_SUCCESS;
+		}
+
+		if (isValid && uastc)
+		{
+			isValid = ktxTexture2_DeflateZstd(target, 18u) == KTX_SUCCESS;
+		}
+
+		if (isValid)
+		{
+			std::error_code error;
+			std::filesystem::create_directories(std::filesystem::path(targetPath).parent_path(), error);
+			isValid = ktxTexture_WriteToNamedFile(ktxTexture(target), targetPath.c_str()) == KTX_SUCCESS;
+		}
+
+		if (target != nullptr)
+		{
+			ktxTexture_Destroy(ktxTexture(target));
+		}
+
+		return isValid;
+	}
+
+	static ulong GetFileSize(const std::string& filepath)
+	{
+		std::error_code error;
+		auto size = std::filesystem::file_size(filepath, error);
+		return error ? 0ull : (ulong)size;
+	}
+
+	// Compares loading the ktx 1 textures against basis lz & uastc + zstd ktx 2 versions of them. Times are for all textures.
+	// The ktx 2 versions are encoded once & kept in the texture cache directory. Encoding is not timed.
+	// Ktx 2 textures are timed when transcoded serially, when transcoded by TranscodeFiles & when read back from the transcode cache.
+	uint32_t MeasureTextureFormats(const std::string& cacheDirectory, uint32_t textureCount)
+	{
+		auto encodeDirectory = std::filesystem::path(cacheDirectory.empty() ? "res/cache/textures/" : cacheDirectory) / "benchmark";
+		auto transcodeDirectory = (encodeDirectory / "transcoded").string();
+		const char* variantNames[] = { "KTX2 BasisLZ", "KTX2 UASTC+Zstd" };
+		const char* variantSuffixes[] = { "_basislz.ktx2", "_uastc.ktx2" };
+
+		std::vector<std::string> candidates;
+		std::vector<std::string> sources;
+		std::vector<std::string> variants[2];
+		auto variantFailureCount = 0u;
+
+		for (const auto& entry : std::filesystem::directory_iterator("res/textures/"))
+		{
+			if (entry.path().extension().compare(".ktx") == 0)
+			{
+				candidates.push_back(entry.path().string());
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end());
+
+		for (auto& candidate : candidates)
+		{
+			if (sources.size() >= textureCount)
+			{
+				break;
+			}
+
+			auto stem = std::filesystem::path(candidate).stem().string();
+			auto basisLZPath = (encodeDirectory / (stem + variantSuffixes[0])).string();
+			auto uastcPath = (encodeDirectory / (stem + variantSuffixes[1])).string();
+
+			if (TryEncodeKTX2(candidate, basisLZPath, false) && TryEncodeKTX2(candidate, uastcPath, true))
+			{
+				sources.push_back(candidate);
+				variants[0].push_back(basisLZPath);
+				variants[1].push_back(uastcPath);
+			}
+		}
+
+		if (sources.empty())
+		{
+			PK_CORE_LOG_WARNING("Texture formats: no convertible ktx textures found.");
+			return 0u;
+		}
+
+		auto previousCacheDirectory = TextureTranscoding::GetCacheDirectory();
+		auto threadCount = std::thread::hardware_concurrency();
+		auto sourceSize = 0ull;
+		auto sourceBegin = Profiler::GetTimestamp();
+
+		for (auto& source : sources)
+		{
+			ktxTexture* texture = nullptr;
+
+			if (ktxTexture_CreateFromNamedFile(source.c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &texture) == KTX_SUCCESS)
+			{
+				ktxTexture_Destroy(texture);
+			}
+
+			sourceSize += GetFileSize(source);
+		}
+
+		auto sourceNanoseconds = Profiler::GetTimestamp() - sourceBegin;
+
+		PK_CORE_LOG_HEADER("Texture formats: %zu textures, %u transcode threads. Sizes are MB, times are ms for all textures.", sources.size(), threadCount);
+		PK_CORE_LOG("%-16s %-8s %-10s %-10s %-10s %-8s", "Format", "Disk", "Load", "Parallel", "Cached", "Cache");
+		PK_CORE_LOG("%-16s %-8.2f %-10.2f %-10s %-10s %-8s", "KTX1", sourceSize / (double)(1ull << 20ull), sourceNanoseconds * 1e-6, "-", "-", "-");
+
+		TextureTranscoding::SetCacheDirectory(transcodeDirectory);
+
+		auto loadAll = [](const std::vector<std::string>& filepaths, uint* failureCount)
+		{
+			auto begin = Profiler::GetTimestamp();
+
+			for (auto& filepath : filepaths)
+			{
+				ktxTexture2* texture = nullptr;
+
+				if (TextureTranscoding::CreateTexture(filepath, &texture) != KTX_SUCCESS)
+				{
+					(*failureCount)++;
+					continue;
+				}
+
+				ktxTexture_Destroy(ktxTexture(texture));
+			}
+
+			return Profiler::GetTimestamp() - begin;
+		};
+
+		for (auto i = 0u; i < 2u; ++i)
+		{
+			std::error_code error;
+			auto failureCount = 0u;
+			auto variantSize = 0ull;
+			auto cacheSize = 0ull;
+
+			for (auto& variant : variants[i])
+			{
+				variantSize += GetFileSize(variant);
+			}
+
+			// Cold, transcoded serially.
+			std::filesystem::remove_all(transcodeDirectory, error);
+			auto serialNanoseconds = loadAll(variants[i], &failureCount);
+
+			// Cold, transcoded in parallel.
+			std::filesystem::remove_all(transcodeDirectory, error);
+			auto parallelBegin = Profiler::GetTimestamp();
+			auto transcodedCount = TextureTranscoding::TranscodeFiles(variants[i], threadCount);
+			auto parallelNanoseconds = Profiler::GetTimestamp() - parallelBegin;
+
+			// Warm, read from the cache.
+			auto cachedNanoseconds = loadAll(variants[i], &failureCount);
+
+			for (const auto& entry : std::filesystem::directory_iterator(transcodeDirectory, error))
+			{
+				cacheSize += GetFileSize(entry.path().string());
+			}
+
+			PK_CORE_LOG("%-16s %-8.2f %-10.2f %-10.2f %-10.2f %-8.2f", variantNames[i], variantSize / (double)(1ull << 20ull), serialNanoseconds * 1e-6, parallelNanoseconds * 1e-6, cachedNanoseconds * 1e-6, cacheSize / (double)(1ull << 20ull));
+
+			if (failureCount > 0 || transcodedCount != variants[i].size())
+			{
+				PK_CORE_LOG_WARNING("%s: %u textures failed to load, %u of %zu transcoded in parallel.", variantNames[i], failureCount, transcodedCount, variants[i].size());
+				++variantFailureCount;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::remove_all(transcodeDirectory, error);
+		TextureTranscoding::SetCacheDirectory(previousCacheDirectory);
+		return variantFailureCount;
+	}
+}
\ No newline at end of file
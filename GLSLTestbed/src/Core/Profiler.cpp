@@ -0,0 +1,416 @@
+#include "PrecompiledHeader.h"
+#include "Utilities/Log.h"
+#include "Core/Profiler.h"
+#include <chrono>
+#include <mutex>
+#include <string_view>
+#include <filesystem>
+
+namespace PK::Core::Profiler
+{
+	constexpr uint32_t MaxScopeDepth = 32;
+	constexpr double AverageWeight = 0.05;
+	constexpr uint32_t GpuTraceThreadId = 0xFFFF;
+
+	struct ThreadRecorder
+	{
+		SampleRing ring;
+		const char* openNames[MaxScopeDepth];
+		const char* openCategories[MaxScopeDepth];
+		int64_t openArguments[MaxScopeDepth];
+		uint64_t openBegins[MaxScopeDepth];
+		uint32_t depth = 0;
+		uint32_t index = 0;
+		std::atomic<bool> isActive = true;
+	};
+
+	struct CaptureEvent
+	{
+		Sample sample;
+		uint32_t threadIndex;
+	};
+
+	struct Capture
+	{
+		std::vector<CaptureEvent> events;
+		uint64_t begin = 0;
+		uint64_t frameBegin = 0;
+		uint32_t frameCount = 0;
+		uint32_t capturedFrameCount = 0;
+	};
+
+	// Threads that exit release their recorder so that short lived workers do not grow the registry every frame.
+	struct ThreadRecorderHandle
+	{
+		ThreadRecorder* recorder = nullptr;
+
+		~ThreadRecorderHandle()
+		{
+			if (recorder != nullptr)
+			{
+				recorder->isActive.store(false, std::memory_order_release);
+			}
+		}
+	};
+
+	struct ScopeStats
+	{
+		const char* name = nullptr;
+		uint32_t depth = 0;
+		// Begin of the first sample. Stats are listed in this order so that parents precede their children.
+		uint64_t firstBegin = 0;
+		uint64_t frameTotal = 0;
+		uint32_t frameCalls = 0;
+		uint32_t lastCalls = 0;
+		uint64_t frameCount = 0;
+		double lastMs = 0.0;
+		double avgMs = 0.0;
+		double maxMs = 0.0;
+	};
+
+	static std::mutex s_registryLock;
+	static std::vector<std::unique_ptr<ThreadRecorder>> s_recorders;
+	static std::vector<ScopeStats> s_stats[2];
+	static std::unordered_map<std::string_view, uint32_t> s_statIndices[2];
+	static uint64_t s_frameIndex = 0;
+	static Capture s_capture;
+	static std::atomic<bool> s_isCapturing = false;
+	static std::mutex s_internLock;
+	static std::unordered_set<std::string> s_internedNames;
+	static thread_local ThreadRecorderHandle t_recorder;
+
+	bool SampleRing::Push(const Sample& sample)
+	{
+		auto head = m_head.load(std::memory_order_relaxed);
+		auto tail = m_tail.load(std::memory_order_acquire);
+
+		if (head - tail >= Capacity)
+		{
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		m_samples[head & (Capacity - 1)] = sample;
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool SampleRing::Pop(Sample* sample)
+	{
+		auto tail = m_tail.load(std::memory_order_relaxed);
+		auto head = m_head.load(std::memory_order_acquire);
+
+		if (tail == head)
+		{
+			return false;
+		}
+
+		*sample = m_samples[tail & (Capacity - 1)];
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	static ThreadRecorder* GetRecorder()
+	{
+		if (t_recorder.recorder != nullptr)
+		{
+			return t_recorder.recorder;
+		}
+
+		std::lock_guard<std::mutex> lock(s_registryLock);
+
+		for (auto& recorder : s_recorders)
+		{
+			if (!recorder->isActive.load(std::memory_order_acquire))
+			{
+				recorder->isActive.store(true, std::memory_order_relaxed);
+				recorder->depth = 0;
+				t_recorder.recorder = recorder.get();
+				return t_recorder.recorder;
+			}
+		}
+
+		s_recorders.push_back(std::make_unique<ThreadRecorder>());
+		s_recorders.back()->index = (uint32_t)s_recorders.size() - 1u;
+		t_recorder.recorder = s_recorders.back().get();
+		return t_recorder.recorder;
+	}
+
+	static void WriteEscaped(std::ofstream& stream, const char* value)
+	{
+		for (; *value != '\0'; ++value)
+		{
+			if (*value == '"' || *value == '\\')
+			{
+				stream << '\\';
+			}
+
+			stream << *value;
+		}
+	}
+
+	static void WriteCapture(const Capture& capture)
+	{
+		auto filename = std::string("ProfileCapture0.json");
+		auto index = 0;
+
+		while (std::filesystem::exists(filename))
+		{
+			filename = std::string("ProfileCapture") + std::to_string(++index) + std::string(".json");
+		}
+
+		std::ofstream stream(filename);
+
+		if (!stream.is_open())
+		{
+			PK_CORE_LOG_WARNING("Could not open profile capture file: %s", filename.c_str());
+			return;
+		}
+
+		std::unordered_set<uint32_t> threadIds;
+		auto isFirst = true;
+		char timestamps[64];
+
+		stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+		for (auto& event : capture.events)
+		{
+			auto& sample = event.sample;
+			auto threadId = sample.timeline == Timeline::GPU ? GpuTraceThreadId : event.threadIndex;
+			auto* category = sample.category != nullptr ? sample.category : (sample.timeline == Timeline::GPU ? "gpu" : "cpu");
+			threadIds.insert(threadId);
+
+			// Chrome trace timestamps are in microseconds.
+			snprintf(timestamps, sizeof(timestamps), "\"ts\":%.3f,\"dur\":%.3f", (sample.begin - capture.begin) * 1e-3, (sample.end - sample.begin) * 1e-3);
+
+			stream << (isFirst ? "\n" : ",\n") << "{\"name\":\"";
+			WriteEscaped(stream, sample.name);
+			stream << "\",\"cat\":\"" << category << "\",\"ph\":\"X\"," << timestamps << ",\"pid\":0,\"tid\":" << threadId;
+
+			if (sample.argument >= 0)
+			{
+				stream << ",\"args\":{\"value\":" << sample.argument << "}";
+			}
+
+			stream << "}";
+			isFirst = false;
+		}
+
+		for (auto threadId : threadIds)
+		{
+			stream << (isFirst ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << threadId << ",\"args\":{\"name\":\"";
+			stream << (threadId == GpuTraceThreadId ? std::string("GPU") : std::string("Thread ") + std::to_string(threadId)) << "\"}}";
+			isFirst = false;
+		}
+
+		stream << "\n]}";
+
+		PK_CORE_LOG("Profile capture of %u frames & %u events written to: %s", capture.capturedFrameCount, (uint32_t)capture.events.size(), filename.c_str());
+	}
+
+	static void Accumulate(const Sample& sample)
+	{
+		auto timeline = (uint32_t)sample.timeline;
+		auto& indices = s_statIndices[timeline];
+		auto& stats = s_stats[timeline];
+		auto iter = indices.find(sample.name);
+
+		if (iter == indices.end())
+		{
+			iter = indices.emplace(std::string_view(sample.name), (uint32_t)stats.size()).first;
+			stats.emplace_back().name = sample.name;
+			stats.back().depth = sample.depth;
+			stats.back().firstBegin = sample.begin;
+		}
+
+		auto& stat = stats.at(iter->second);
+		stat.frameTotal += sample.end > sample.begin ? sample.end - sample.begin : 0ull;
+		stat.frameCalls++;
+	}
+
+	uint64_t GetTimestamp()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void BeginScope(const char* name, const char* category, int64_t argument)
+	{
+		auto* recorder = GetRecorder();
+
+		if (recorder->depth < MaxScopeDepth)
+		{
+			recorder->openNames[recorder->depth] = name;
+			recorder->openCategories[recorder->depth] = category;
+			recorder->openArguments[recorder->depth] = argument;
+			recorder->openBegins[recorder->depth] = GetTimestamp();
+		}
+
+		recorder->depth++;
+	}
+
+	void EndScope()
+	{
+		auto end = GetTimestamp();
+		auto* recorder = GetRecorder();
+
+		if (recorder->depth == 0 || --recorder->depth >= MaxScopeDepth)
+		{
+			return;
+		}
+
+		Sample sample;
+		sample.name = recorder->openNames[recorder->depth];
+		sample.category = recorder->openCategories[recorder->depth];
+		sample.argument = recorder->openArguments[recorder->depth];
+		sample.begin = recorder->openBegins[recorder->depth];
+		sample.end = end;
+		sample.depth = recorder->depth;
+		sample.timeline = Timeline::CPU;
+		recorder->ring.Push(sample);
+	}
+
+	void RecordSample(const Sample& sample)
+	{
+		GetRecorder()->ring.Push(sample);
+	}
+
+	void NextFrame()
+	{
+		std::lock_guard<std::mutex> lock(s_registryLock);
+
+		Sample sample;
+		auto isCapturing = s_isCapturing.load(std::memory_order_relaxed);
+
+		for (auto& recorder : s_recorders)
+		{
+			while (recorder->ring.Pop(&sample))
+			{
+				if (isCapturing && sample.begin >= s_capture.begin)
+				{
+					s_capture.events.push_back({ sample, recorder->index });
+				}
+
+				if (sample.category == nullptr)
+				{
+					Accumulate(sample);
+				}
+			}
+		}
+
+		++s_frameIndex;
+
+		if (isCapturing)
+		{
+			auto now = GetTimestamp();
+			Sample frame;
+			frame.name = "Frame";
+			frame.category = "frame";
+			frame.begin = s_capture.frameBegin;
+			frame.end = now;
+			frame.argument = (int64_t)s_frameIndex;
+			s_capture.events.push_back({ frame, t_recorder.recorder != nullptr ? t_recorder.recorder->index : 0u });
+			s_capture.frameBegin = now;
+
+			if (++s_capture.capturedFrameCount >= s_capture.frameCount)
+			{
+				s_isCapturing.store(false, std::memory_order_relaxed);
+				WriteCapture(s_capture);
+				s_capture = Capture();
+			}
+		}
+
+		for (auto& stats : s_stats)
+		{
+			for (auto& stat : stats)
+			{
+				if (stat.frameCalls == 0)
+				{
+					continue;
+				}
+
+				stat.lastMs = stat.frameTotal * 1e-6;
+				stat.lastCalls = stat.frameCalls;
+				stat.avgMs = stat.frameCount == 0 ? stat.lastMs : stat.avgMs + AverageWeight * (stat.lastMs - stat.avgMs);
+				stat.maxMs = stat.lastMs > stat.maxMs ? stat.lastMs : stat.maxMs;
+				stat.frameCount++;
+				stat.frameTotal = 0;
+				stat.frameCalls = 0;
+			}
+		}
+	}
+
+	void LogResults()
+	{
+		std::lock_guard<std::mutex> lock(s_registryLock);
+
+		const char* timelineNames[] = { "CPU", "GPU" };
+		auto droppedCount = 0ull;
+
+		for (auto& recorder : s_recorders)
+		{
+			droppedCount += recorder->ring.GetDroppedCount();
+		}
+
+		PK::Utilities::Debug::InsertNewLine();
+		PK_CORE_LOG_HEADER("Profiler: %llu frames, %u threads, %llu dropped samples", s_frameIndex, (uint32_t)s_recorders.size(), droppedCount);
+
+		for (auto timeline = 0u; timeline < 2u; ++timeline)
+		{
+			if (s_stats[timeline].empty())
+			{
+				continue;
+			}
+
+			auto& stats = s_stats[timeline];
+			std::vector<uint32_t> order(stats.size());
+
+			for (auto i = 0u; i < order.size(); ++i)
+			{
+				order[i] = i;
+			}
+
+			std::sort(order.begin(), order.end(), [&stats](uint32_t a, uint32_t b) { return stats.at(a).firstBegin < stats.at(b).firstBegin; });
+
+			PK_CORE_LOG_HEADER("%-40s %10s %10s %10s %6s", timelineNames[timeline], "LAST MS", "AVG MS", "MAX MS", "CALLS");
+
+			for (auto index : order)
+			{
+				auto& stat = stats.at(index);
+				auto indent = (int)(stat.depth < 8u ? stat.depth : 8u) * 2;
+				PK_CORE_LOG("%*s%-*s %10.3f %10.3f %10.3f %6u", indent, "", 40 - indent, stat.name, stat.lastMs, stat.avgMs, stat.maxMs, stat.lastCalls);
+				stat.maxMs = 0.0;
+			}
+		}
+
+		PK::Utilities::Debug::InsertNewLine();
+	}
+
+	void BeginCapture(uint32_t frameCount)
+	{
+		std::lock_guard<std::mutex> lock(s_registryLock);
+
+		if (s_isCapturing.load(std::memory_order_relaxed))
+		{
+			PK_CORE_LOG_WARNING("A profile capture is already in progress.");
+			return;
+		}
+
+		s_capture = Capture();
+		s_capture.begin = GetTimestamp();
+		s_capture.frameBegin = s_capture.begin;
+		s_capture.frameCount = frameCount > 0u ? frameCount : 1u;
+		s_isCapturing.store(true, std::memory_order_relaxed);
+		PK_CORE_LOG("Capturing a profile of %u frames.", s_capture.frameCount);
+	}
+
+	bool IsCapturing()
+	{
+		return s_isCapturing.load(std::memory_order_relaxed);
+	}
+
+	const char* InternName(const std::string& name)
+	{
+		std::lock_guard<std::mutex> lock(s_internLock);
+		return s_internedNames.insert(name).first->c_str();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+#include "Core/NoCopy.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// CPU timing scopes. Each recording thread writes completed scopes into its own single producer ring buffer.
+// Rings are drained & aggregated once per frame by the main thread. Has no graphics api dependencies.
+// A capture collects the drained samples of a window of frames & writes them as a Chrome trace event file.
+namespace PK::Core::Profiler
+{
+    enum class Timeline : uint8_t
+    {
+        CPU,
+        GPU
+    };
+
+    struct Sample
+    {
+        // Must outlive the profiler. Scope names are expected to be string literals.
+        const char* name = nullptr;
+        // Samples with a category are only recorded during a capture & are not aggregated.
+        const char* category = nullptr;
+        // Nanoseconds of the monotonic clock. Gpu samples are converted to it when they are resolved.
+        uint64_t begin = 0;
+        uint64_t end = 0;
+        // Written to the trace event args when not negative.
+        int64_t argument = -1;
+        uint32_t depth = 0;
+        Timeline timeline = Timeline::CPU;
+    };
+
+    // Single producer, single consumer. Full rings drop samples instead of blocking the recording thread.
+    class SampleRing : public NoCopy
+    {
+        public:
+            static constexpr uint32_t Capacity = 4096;
+
+            bool Push(const Sample& sample);
+            bool Pop(Sample* sample);
+
+            inline uint64_t GetDroppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+        private:
+            Sample m_samples[Capacity];
+            std::atomic<uint64_t> m_head = 0;
+            std::atomic<uint64_t> m_tail = 0;
+            std::atomic<uint64_t> m_dropped = 0;
+    };
+
+    uint64_t GetTimestamp();
+
+    void BeginScope(const char* name, const char* category = nullptr, int64_t argument = -1);
+    void EndScope();
+
+    // Records a sample that was measured elsewhere, e.g. a resolved gpu timer query.
+    void RecordSample(const Sample& sample);
+
+    // Drains the rings of all threads & folds the samples of the previous frame into the running statistics.
+    void NextFrame();
+
+    void LogResults();
+
+    // The trace is written once frameCount frames have been drained.
+    void BeginCapture(uint32_t frameCount);
+    bool IsCapturing();
+
+    // Returns a copy of the name that outlives the profiler. For trace scopes with runtime names.
+    const char* InternName(const std::string& name);
+
+    class Scope : public NoCopy
+    {
+        public:
+            inline Scope(const char* name) { BeginScope(name); }
+            inline ~Scope() { EndScope(); }
+    };
+
+    // Only records while capturing. Used for events that are too frequent or too numerous for the frame statistics.
+    class TraceScope : public NoCopy
+    {
+        public:
+            inline TraceScope(const char* name, const char* category, int64_t argument = -1) : m_isRecording(IsCapturing())
+            {
+                if (m_isRecording)
+                {
+                    BeginScope(name, category, argument);
+                }
+            }
+
+            inline TraceScope(const std::string& name, const char* category, int64_t argument = -1) : m_isRecording(IsCapturing())
+            {
+                if (m_isRecording)
+                {
+                    BeginScope(InternName(name), category, argument);
+                }
+            }
+
+            inline ~TraceScope()
+            {
+                if (m_isRecording)
+                {
+                    EndScope();
+                }
+            }
+
+        private:
+            const bool m_isRecording;
+    };
+}
+
+#define PK_PROFILE_CONCAT_INNER(a, b) a##b
+#define PK_PROFILE_CONCAT(a, b) PK_PROFILE_CONCAT_INNER(a, b)
+#define PK_PROFILE_SCOPE(name) PK::Core::Profiler::Scope PK_PROFILE_CONCAT(pk_profile_scope_, __LINE__)(name)
+#define PK_PROFILE_FUNCTION() PK_PROFILE_SCOPE(__FUNCTION__)
+#define PK_PROFILE_TRACE_SCOPE(...) PK::Core::Profiler::TraceScope PK_PROFILE_CONCAT(pk_profile_trace_scope_, __LINE__)(__VA_ARGS__)
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "PrecompiledHeader.h"
 #include "Utilities/Log.h"
 #include "Core/Time.h"
+#include "Core/Profiler.h"
 #include <ctime>
 #include <cstdlib>
 #include <Core/UpdateStep.h>
@@ -51,6 +52,7 @@ namespace PK::Core
             case PK::Core::UpdateStep::OpenFrame: 
             {
                 m_frameStart = std::chrono::steady_clock::now(); 
+                Profiler::NextFrame();
                 m_sequencer->Next<Time>(this, this, 0);
             }
             break;
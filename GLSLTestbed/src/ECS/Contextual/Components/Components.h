@@ -35,6 +35,7 @@ namespace PK::ECS::Components
         Light = 1 << 1,
         Static = 1 << 2,
         ShadowCaster = 1 << 3,
+        Occluder = 1 << 4,
     };
 
     inline RenderHandleFlags operator|(RenderHandleFlags a, RenderHandleFlags b)
@@ -2,8 +2,10 @@
 #include "EngineCommandInput.h"
 #include "Core/Application.h"
 #include "Core/ApplicationConfig.h"
+#include "Core/Profiler.h"
 #include "Rendering/GraphicsAPI.h"
 #include "Utilities/StringUtilities.h"
+#include "Utilities/FrameAllocator.h"
 #include "Rendering/Objects/TextureXD.h"
 
 namespace PK::ECS::Engines
@@ -20,6 +22,9 @@ namespace PK::ECS::Engines
         {std::string("variants"),   CommandArgument::Variants},
         {std::string("uniforms"),   CommandArgument::Uniforms},
         {std::string("gpu_memory"), CommandArgument::GPUMemory},
+        {std::string("profiler"),   CommandArgument::Profiler},
+        {std::string("profile"),    CommandArgument::Profile},
+        {std::string("capture"),    CommandArgument::Capture},
         {std::string("shader"),     CommandArgument::TypeShader},
         {std::string("mesh"),       CommandArgument::TypeMesh},
         {std::string("texture"),    CommandArgument::TypeTexture},
@@ -82,6 +87,27 @@ namespace PK::ECS::Engines
         PK_CORE_LOG("GPU Memory usage in kb: %i", Rendering::GraphicsAPI::GetMemoryUsageKB());
     }
 
+    void EngineCommandInput::QueryProfiler(const ConsoleCommand& arguments)
+    {
+        Core::Profiler::LogResults();
+        PK::Utilities::FrameAllocator::LogStatistics();
+    }
+
+    void EngineCommandInput::ProfileCapture(const ConsoleCommand& arguments)
+    {
+        auto frameCount = std::strtoul(arguments[2].c_str(), nullptr, 10);
+
+        if (frameCount == 0)
+        {
+            PK::Utilities::Debug::InsertNewLine();
+            PK_CORE_LOG_WARNING("Invalid frame count: %s", arguments[2].c_str());
+            PK::Utilities::Debug::InsertNewLine();
+            return;
+        }
+
+        Core::Profiler::BeginCapture((uint32_t)frameCount);
+    }
+
     void EngineCommandInput::ReloadTime(const ConsoleCommand& arguments)
     {
         Application::GetService<Time>()->Reset();
@@ -177,6 +203,8 @@ namespace PK::ECS::Engines
         m_commands[{CommandArgument::Query, CommandArgument::TypeShader, CommandArgument::StringParameter, CommandArgument::Variants}] = PK_BIND_FUNCTION(QueryShaderVariants);
         m_commands[{CommandArgument::Query, CommandArgument::TypeShader, CommandArgument::StringParameter, CommandArgument::Uniforms}] = PK_BIND_FUNCTION(QueryShaderUniforms);
         m_commands[{CommandArgument::Query, CommandArgument::GPUMemory}] = PK_BIND_FUNCTION(QueryGPUMemory);
+        m_commands[{CommandArgument::Query, CommandArgument::Profiler}] = PK_BIND_FUNCTION(QueryProfiler);
+        m_commands[{CommandArgument::Profile, CommandArgument::Capture, CommandArgument::StringParameter}] = PK_BIND_FUNCTION(ProfileCapture);
         m_commands[{CommandArgument::Query, CommandArgument::Assets, CommandArgument::TypeShader}] = PK_BIND_FUNCTION(QueryLoadedShaders);
         m_commands[{CommandArgument::Query, CommandArgument::Assets, CommandArgument::TypeMaterial}] = PK_BIND_FUNCTION(QueryLoadedMaterials);
         m_commands[{CommandArgument::Query, CommandArgument::Assets, CommandArgument::TypeMesh}] = PK_BIND_FUNCTION(QueryLoadedMeshes);
@@ -26,6 +26,9 @@ namespace PK::ECS::Engines
 		Variants,
 		Uniforms,
 		GPUMemory,
+		Profiler,
+		Profile,
+		Capture,
 		TypeShader,
 		TypeMesh,
 		TypeTexture,
@@ -53,6 +56,8 @@ namespace PK::ECS::Engines
 			void QueryShaderVariants(const ConsoleCommand& arguments);
 			void QueryShaderUniforms(const ConsoleCommand& arguments);
 			void QueryGPUMemory(const ConsoleCommand& arguments);
+			void QueryProfiler(const ConsoleCommand& arguments);
+			void ProfileCapture(const ConsoleCommand& arguments);
 			void ReloadTime(const ConsoleCommand& arguments);
 			void ReloadAppConfig(const ConsoleCommand& arguments);
 			void ReloadShaders(const ConsoleCommand& arguments);
@@ -48,6 +48,11 @@ namespace PK::ECS::Engines
 			implementer->flags = Components::RenderHandleFlags::Renderer;
 		}
 
+		if (mesh->HasOccluderGeometry() && material->IsOccluder())
+		{
+			implementer->flags = implementer->flags | Components::RenderHandleFlags::Occluder;
+		}
+
 		return egid;
 	}
 	
@@ -25,7 +25,7 @@ namespace PK::ECS
             inline uint entityID() const { return (uint)(_GID & 0xFFFFFFFF); }
             inline uint groupID() const { return (uint)(_GID >> 32); }
             EGID() : _GID(0) {}
-            EGID(const EGID& other) : _GID(other._GID) {}
+            EGID(const EGID& other) = default;
             EGID(ulong identifier) : _GID(identifier) {}
             EGID(uint entityID, uint groupID) : _GID((ulong)groupID << 32 | ((ulong)(uint)entityID & 0xFFFFFFFF)) {}
             inline bool IsValid() const { return _GID > 0; }
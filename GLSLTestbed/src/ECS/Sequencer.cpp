@@ -3,35 +3,361 @@
 
 namespace PK::ECS
 {
+    using namespace PK::Utilities;
+
     To::To(std::initializer_list<BranchSteps::value_type> branchSteps) : m_branchSteps(branchSteps) {}
     To::To(std::initializer_list<StepPtr> commonSteps) : m_commonSteps(commonSteps) {}
     To::To(std::initializer_list<BranchSteps::value_type> branchSteps, std::initializer_list<StepPtr> commonSteps) : m_branchSteps(branchSteps), m_commonSteps(commonSteps) {}
 
-    const std::vector<StepPtr>* To::GetSteps(int condition)
+    static void AddTokenType(std::vector<std::pair<const void*, const char*>>& tokenTypes, const std::vector<StepPtr>& steps)
     {
-        if (m_branchSteps.count(condition) < 1)
+        for (auto& step : steps)
         {
-            return nullptr;
+            if (std::find_if(tokenTypes.begin(), tokenTypes.end(), [&step](const std::pair<const void*, const char*>& tokenType) { return tokenType.first == step.tokenType; }) == tokenTypes.end())
+            {
+                tokenTypes.push_back({ step.tokenType, step.tokenName });
+            }
         }
+    }
+
+    static void AppendSteps(std::vector<StepPtr>& stepList, const std::vector<StepPtr>& steps, const void* tokenType, uint32_t* begin, uint32_t* end)
+    {
+        *begin = (uint32_t)stepList.size();
 
-        return &m_branchSteps.at(condition);
+        for (auto& step : steps)
+        {
+            if (step.tokenType == tokenType)
+            {
+                stepList.push_back(step);
+            }
+        }
+
+        *end = (uint32_t)stepList.size();
     }
 
     void Sequencer::SetSteps(std::initializer_list<Steps::value_type> steps)
     {
-        m_steps = Steps(steps);
+        m_stepList.clear();
+        m_sequences.clear();
+
+        std::vector<std::pair<const void*, const char*>> tokenTypes;
+
+        for (auto& kv : steps)
+        {
+            auto& target = kv.second;
+            auto& sequences = m_sequences[kv.first];
+
+            tokenTypes.clear();
+            AddTokenType(tokenTypes, target.GetCommonSteps());
+
+            for (auto& branch : target.GetBranchSteps())
+            {
+                AddTokenType(tokenTypes, branch.second);
+            }
+
+            for (auto& token : tokenTypes)
+            {
+                auto tokenType = token.first;
+                Sequence sequence;
+                sequence.tokenType = tokenType;
+                sequence.tokenName = token.second;
+
+                for (auto& branch : target.GetBranchSteps())
+                {
+                    StepRange range;
+                    AppendSteps(m_stepList, branch.second, tokenType, &range.begin, &range.end);
+
+                    if (range.end > range.begin)
+                    {
+                        sequence.branches.push_back({ branch.first, range });
+                    }
+                }
+
+                AppendSteps(m_stepList, target.GetCommonSteps(), tokenType, &sequence.common.begin, &sequence.common.end);
+                sequences.push_back(sequence);
+            }
+        }
+
+        m_sequenceStepCount = (uint32_t)m_stepList.size();
+        CompileRootSequence();
     }
 
     void Sequencer::SetRootSequence(std::initializer_list<int> sequence)
     {
         m_rootSequence = std::vector<int>(sequence);
+        CompileRootSequence();
+    }
+
+    void Sequencer::SetStepAccess(const void* step, const StepAccess& access)
+    {
+        m_stepAccess[step] = access;
+        BuildTaskGraph();
+    }
+
+    void Sequencer::SetStepAccess(const void* step, int condition, const StepAccess& access)
+    {
+        m_conditionStepAccess[{ step, condition }] = access;
+        BuildTaskGraph();
     }
 
     void Sequencer::ExecuteRootSequence()
     {
-        for (auto i : m_rootSequence)
+        if (m_executionMode == ExecutionMode::Parallel)
+        {
+            ExecuteTaskGraph();
+            return;
+        }
+
+        for (auto& root : m_rootSteps)
+        {
+            PK_PROFILE_TRACE_SCOPE("void", "sequencer", root.first);
+            InvokeSteps(root.second, nullptr, root.first);
+        }
+    }
+
+    void Sequencer::Release()
+    {
+        m_executionMode = ExecutionMode::Serial;
+        m_stepList.clear();
+        m_sequences.clear();
+        m_rootSteps.clear();
+        m_stepAccess.clear();
+        m_conditionStepAccess.clear();
+        m_tasks.clear();
+        m_taskSuccessors.clear();
+        m_sequenceStepCount = 0;
+    }
+
+    const Sequencer::Sequence* Sequencer::GetSequence(const void* engine, const void* tokenType) const
+    {
+        auto iterator = m_sequences.find(engine);
+
+        if (iterator == m_sequences.end())
         {
-            Next<void>(this, nullptr, i);
+            return nullptr;
         }
+
+        for (auto& sequence : iterator->second)
+        {
+            if (sequence.tokenType == tokenType)
+            {
+                return &sequence;
+            }
+        }
+
+        return nullptr;
     }
+
+    void Sequencer::CompileRootSequence()
+    {
+        m_stepList.resize(m_sequenceStepCount);
+        m_rootSteps.clear();
+
+        auto* sequence = GetSequence(GetRoot(), GetTypeId<void>());
+
+        if (sequence == nullptr)
+        {
+            return;
+        }
+
+        for (auto condition : m_rootSequence)
+        {
+            StepRange range;
+            range.begin = (uint32_t)m_stepList.size();
+            auto* branch = sequence->GetBranch(condition);
+
+            if (branch != nullptr)
+            {
+                for (auto i = branch->begin; i < branch->end; ++i)
+                {
+                    auto step = m_stepList[i];
+                    m_stepList.push_back(step);
+                }
+            }
+
+            for (auto i = sequence->common.begin; i < sequence->common.end; ++i)
+            {
+                auto step = m_stepList[i];
+                m_stepList.push_back(step);
+            }
+
+            range.end = (uint32_t)m_stepList.size();
+            m_rootSteps.push_back({ condition, range });
+        }
+
+        BuildTaskGraph();
+    }
+
+    static bool Overlaps(const std::vector<const void*>& a, const std::vector<const void*>& b)
+    {
+        for (auto resource : a)
+        {
+            if (std::find(b.begin(), b.end(), resource) != b.end())
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    const StepAccess* Sequencer::GetStepAccess(const void* step, int condition) const
+    {
+        auto conditionAccess = m_conditionStepAccess.find({ step, condition });
+
+        if (conditionAccess != m_conditionStepAccess.end())
+        {
+            return &conditionAccess->second;
+        }
+
+        auto access = m_stepAccess.find(step);
+        return access != m_stepAccess.end() ? &access->second : nullptr;
+    }
+
+    bool Sequencer::HasConflict(const Task& a, const Task& b) const
+    {
+        auto instanceA = m_stepList[a.step].instance;
+        auto instanceB = m_stepList[b.step].instance;
+        auto accessA = GetStepAccess(instanceA, a.condition);
+        auto accessB = GetStepAccess(instanceB, b.condition);
+
+        if (instanceA == instanceB || accessA == nullptr || accessB == nullptr)
+        {
+            return true;
+        }
+
+        return Overlaps(accessA->writes, accessB->writes) ||
+               Overlaps(accessA->writes, accessB->reads) ||
+               Overlaps(accessA->reads, accessB->writes);
+    }
+
+    void Sequencer::BuildTaskGraph()
+    {
+        m_tasks.clear();
+        m_taskSuccessors.clear();
+
+        for (auto& root : m_rootSteps)
+        {
+            for (auto i = root.second.begin; i < root.second.end; ++i)
+            {
+                Task task;
+                task.step = i;
+                task.condition = root.first;
+                auto access = GetStepAccess(m_stepList[i].instance, root.first);
+                task.isParallel = access != nullptr && !access->isMainThread;
+                m_tasks.push_back(task);
+            }
+        }
+
+        for (auto i = 0u; i < m_tasks.size(); ++i)
+        {
+            auto& task = m_tasks[i];
+            task.successorBegin = (uint32_t)m_taskSuccessors.size();
+
+            for (auto j = i + 1; j < m_tasks.size(); ++j)
+            {
+                if (HasConflict(task, m_tasks[j]))
+                {
+                    m_taskSuccessors.push_back(j);
+                    m_tasks[j].dependencyCount++;
+                }
+            }
+
+            task.successorEnd = (uint32_t)m_taskSuccessors.size();
+        }
+
+        m_pendingDependencies = std::vector<std::atomic<uint32_t>>(m_tasks.size());
+    }
+
+    void Sequencer::ExecuteTaskGraph()
+    {
+        PK_PROFILE_TRACE_SCOPE("TaskGraph", "sequencer");
+        auto taskCount = (uint32_t)m_tasks.size();
+
+        if (taskCount == 0)
+        {
+            return;
+        }
+
+        m_remainingTasks.store(taskCount, std::memory_order_relaxed);
+
+        for (auto i = 0u; i < taskCount; ++i)
+        {
+            m_pendingDependencies[i].store(m_tasks[i].dependencyCount, std::memory_order_relaxed);
+        }
+
+        for (auto i = 0u; i < taskCount; ++i)
+        {
+            if (m_tasks[i].dependencyCount == 0)
+            {
+                DispatchTask(i);
+            }
+        }
+
+        while (true)
+        {
+            uint32_t index = 0u;
+
+            {
+                std::unique_lock<std::mutex> lock(m_mainThreadLock);
+                m_mainThreadCondition.wait(lock, [this]() { return m_mainThreadTaskHead < m_mainThreadTasks.size() || m_remainingTasks.load(std::memory_order_acquire) == 0; });
+
+                if (m_mainThreadTaskHead == m_mainThreadTasks.size())
+                {
+                    m_mainThreadTasks.clear();
+                    m_mainThreadTaskHead = 0;
+                    return;
+                }
+
+                index = m_mainThreadTasks[m_mainThreadTaskHead++];
+            }
+
+            ExecuteTask(index);
+        }
+    }
+
+    void Sequencer::DispatchTask(uint32_t index)
+    {
+        if (m_tasks[index].isParallel)
+        {
+            ThreadPool::GetShared()->Enqueue({ ExecuteTaskJob, this, index });
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mainThreadLock);
+            m_mainThreadTasks.push_back(index);
+        }
+
+        m_mainThreadCondition.notify_one();
+    }
+
+    void Sequencer::ExecuteTask(uint32_t index)
+    {
+        auto& task = m_tasks[index];
+        auto& step = m_stepList[task.step];
+
+        {
+            PK_PROFILE_TRACE_SCOPE(step.name, "step", task.condition);
+            step.invoke(step.instance, nullptr, task.condition);
+        }
+
+        for (auto i = task.successorBegin; i < task.successorEnd; ++i)
+        {
+            auto successor = m_taskSuccessors[i];
+
+            if (m_pendingDependencies[successor].fetch_sub(1u, std::memory_order_acq_rel) == 1u)
+            {
+                DispatchTask(successor);
+            }
+        }
+
+        if (m_remainingTasks.fetch_sub(1u, std::memory_order_acq_rel) == 1u)
+        {
+            std::lock_guard<std::mutex> lock(m_mainThreadLock);
+            m_mainThreadCondition.notify_all();
+        }
+    }
+
+    void Sequencer::ExecuteTaskJob(void* context, uint32_t index) { static_cast<Sequencer*>(context)->ExecuteTask(index); }
 }
\ No newline at end of file
@@ -2,11 +2,13 @@
 #include "PrecompiledHeader.h"
 #include "Core/IService.h"
 #include "Utilities/Ref.h"
+#include "Core/Profiler.h"
+#include "Utilities/ThreadPool.h"
+#include <atomic>
 
-// @TODO Replace this nastyness with templates or smth.
-#define PK_STEP_T(S, D) static_cast<PK::ECS::IStep<D>*>(S)
-#define PK_STEP_C(S, D) static_cast<PK::ECS::IConditionalStep<D>*>(S)
-#define PK_STEP_S(S) static_cast<PK::ECS::ISimpleStep*>(S)
+#define PK_STEP_T(S, D) PK::ECS::Step<D>(S)
+#define PK_STEP_C(S, D) PK::ECS::ConditionalStep<D>(S)
+#define PK_STEP_S(S) PK::ECS::SimpleStep(S)
 
 namespace PK::ECS
 {
@@ -38,7 +40,46 @@ namespace PK::ECS
             void Step(void* token, int condition) { Step(condition); }
     };
 
-    typedef IBaseStep* StepPtr;
+    // The address of the instantiation identifies a token or component type without rtti.
+    template<typename T>
+    inline const void* GetTypeId()
+    {
+        static const char id = 0;
+        return &id;
+    }
+
+    // A step resolved against the concrete type of the step & the token type when it is registered.
+    // Invoking it is a single indirect call to a qualified (non virtual) Step.
+    struct StepPtr
+    {
+        void* instance = nullptr;
+        const void* tokenType = nullptr;
+        const char* tokenName = nullptr;
+        const char* name = nullptr;
+        void (*invoke)(void* instance, void* token, int condition) = nullptr;
+    };
+
+    template<typename TToken, typename TStep>
+    StepPtr Step(TStep* step)
+    {
+        static_assert(std::is_base_of<IStep<TToken>, TStep>::value, "Step does not implement IStep for the token type!");
+        return { step, GetTypeId<TToken>(), typeid(TToken).name(), typeid(TStep).name(), [](void* instance, void* token, int condition) { static_cast<TStep*>(instance)->TStep::Step(static_cast<TToken*>(token)); } };
+    }
+
+    template<typename TToken, typename TStep>
+    StepPtr ConditionalStep(TStep* step)
+    {
+        static_assert(std::is_base_of<IConditionalStep<TToken>, TStep>::value, "Step does not implement IConditionalStep for the token type!");
+        return { step, GetTypeId<TToken>(), typeid(TToken).name(), typeid(TStep).name(), [](void* instance, void* token, int condition) { static_cast<TStep*>(instance)->TStep::Step(static_cast<TToken*>(token), condition); } };
+    }
+
+    template<typename TStep>
+    StepPtr SimpleStep(TStep* step)
+    {
+        static_assert(std::is_base_of<ISimpleStep, TStep>::value, "Step does not implement ISimpleStep!");
+        return { step, GetTypeId<void>(), typeid(void).name(), typeid(TStep).name(), [](void* instance, void* token, int condition) { static_cast<TStep*>(instance)->TStep::Step(condition); } };
+    }
+
     typedef std::unordered_map<int, std::vector<StepPtr>> BranchSteps;
 
     class To
@@ -49,9 +90,9 @@ namespace PK::ECS
             To(std::initializer_list<BranchSteps::value_type> branchSteps, std::initializer_list<StepPtr> commonSteps);
             To(std::initializer_list<StepPtr> commonSteps, std::initializer_list<BranchSteps::value_type> steps);
 
-            inline const std::vector<StepPtr>* GetSteps(int condition);
-            inline const std::vector<StepPtr>* GetCommonSteps() const { return &m_commonSteps; }
- 
+            inline const BranchSteps& GetBranchSteps() const { return m_branchSteps; }
+            inline const std::vector<StepPtr>& GetCommonSteps() const { return m_commonSteps; }
+
         private:
             BranchSteps m_branchSteps;
             std::vector<StepPtr> m_commonSteps;
@@ -59,11 +100,79 @@ namespace PK::ECS
 
     typedef std::unordered_map<const void*, To> Steps;
 
+    // Resources are identified by address: a service instance or GetTypeId<T>() of a component type or of shared state such as the graphics context.
+    struct StepAccess
+    {
+        std::vector<const void*> reads;
+        std::vector<const void*> writes;
+        // Steps that use the graphics context or the window run on the thread executing the root sequence.
+        // Unlike steps without declared access they are only ordered against the steps they conflict with.
+        bool isMainThread = false;
+    };
+
+    enum class ExecutionMode
+    {
+        Serial,
+        // Root steps with declared access run on a thread pool unless they are declared as main thread steps.
+        // Root steps without declared access run on the calling thread & are ordered against every step.
+        Parallel,
+    };
+
     class Sequencer : public Core::IService
     {
+        private:
+            struct StepRange
+            {
+                uint32_t begin = 0;
+                uint32_t end = 0;
+            };
+
+            // A root step in the dependency graph. Successors index m_taskSuccessors.
+            struct Task
+            {
+                uint32_t step = 0;
+                int condition = 0;
+                bool isParallel = false;
+                uint32_t dependencyCount = 0;
+                uint32_t successorBegin = 0;
+                uint32_t successorEnd = 0;
+            };
+
+            // Steps of an engine that take one token type. Ranges index the shared step list.
+            struct Sequence
+            {
+                const void* tokenType = nullptr;
+                // Resolved when the steps are set so that dispatch traces need no rtti.
+                const char* tokenName = nullptr;
+                std::vector<std::pair<int, StepRange>> branches;
+                StepRange common;
+
+                inline const StepRange* GetBranch(int condition) const
+                {
+                    for (auto& branch : branches)
+                    {
+                        if (branch.first == condition)
+                        {
+                            return &branch.second;
+                        }
+                    }
+
+                    return nullptr;
+                }
+            };
+
         public:
             void SetSteps(std::initializer_list<Steps::value_type> steps);
             void SetRootSequence(std::initializer_list<int> sequence);
+            // Applies to every root step of the instance. Steps dispatched from a parallel step with Next run on the same thread.
+            void SetStepAccess(const void* step, const StepAccess& access);
+            inline void SetStepAccess(const void* step, std::initializer_list<const void*> reads, std::initializer_list<const void*> writes, bool isMainThread = false) { SetStepAccess(step, { reads, writes, isMainThread }); }
+            // Applies to the root step of the instance for a single condition. Takes precedence over access declared for every condition.
+            void SetStepAccess(const void* step, int condition, const StepAccess& access);
+            inline void SetStepAccess(const void* step, int condition, std::initializer_list<const void*> reads, std::initializer_list<const void*> writes, bool isMainThread = false) { SetStepAccess(step, condition, { reads, writes, isMainThread }); }
+            // Parallel tasks run on the shared thread pool so that steps which dispatch their own jobs don't oversubscribe the cores.
+            inline void SetExecutionMode(ExecutionMode mode) { m_executionMode = mode; }
+            inline ExecutionMode GetExecutionMode() const { return m_executionMode; }
             void ExecuteRootSequence();
 
             inline const void* GetRoot() { return this; }
@@ -71,45 +180,67 @@ namespace PK::ECS
             template<typename T>
             void Next(const void* engine, T* token, int condition)
             {
-                if (m_steps.count(engine) < 1)
+                auto* sequence = GetSequence(engine, GetTypeId<T>());
+
+                if (sequence == nullptr)
                 {
                     return;
                 }
 
-                auto& target = m_steps.at(engine);
-                const auto* branchSteps = target.GetSteps(condition);
+                PK_PROFILE_TRACE_SCOPE(sequence->tokenName, "sequencer", condition);
+                auto* branch = sequence->GetBranch(condition);
 
-                if (branchSteps != nullptr)
+                if (branch != nullptr)
                 {
-                    InvokeSteps(branchSteps, token, condition);
+                    InvokeSteps(*branch, token, condition);
                 }
 
-                InvokeSteps(target.GetCommonSteps(), token, condition);
+                InvokeSteps(sequence->common, token, condition);
             }
 
-            inline void Release() { m_steps.clear(); }
+            void Release();
 
         private:
-            template<typename T>
-            void InvokeSteps(const std::vector<StepPtr>* branchSteps, T* token, int condition)
+            inline void InvokeSteps(const StepRange& range, void* token, int condition)
             {
-                auto& steps = *branchSteps;
-
-                for (auto& i : steps)
+                for (auto i = range.begin; i < range.end; ++i)
                 {
-                    if (auto* conditionalStep = dynamic_cast<IConditionalStep<T>*>(i))
-                    {
-                        conditionalStep->Step(token, condition);
-                    }
-
-                    if (auto* step = dynamic_cast<IStep<T>*>(i))
-                    {
-                        step->Step(token);
-                    }
+                    const auto& step = m_stepList[i];
+                    PK_PROFILE_TRACE_SCOPE(step.name, "step", condition);
+                    step.invoke(step.instance, token, condition);
                 }
             }
 
-            Steps m_steps;
+            const Sequence* GetSequence(const void* engine, const void* tokenType) const;
+            void CompileRootSequence();
+            const StepAccess* GetStepAccess(const void* step, int condition) const;
+            bool HasConflict(const Task& a, const Task& b) const;
+            void BuildTaskGraph();
+            void ExecuteTaskGraph();
+            void DispatchTask(uint32_t index);
+            void ExecuteTask(uint32_t index);
+            static void ExecuteTaskJob(void* context, uint32_t index);
+
+            // Steps are stored contiguously, grouped by engine, token type & condition. Root steps follow the first m_sequenceStepCount steps.
+            std::vector<StepPtr> m_stepList;
+            uint32_t m_sequenceStepCount = 0;
+            std::unordered_map<const void*, std::vector<Sequence>> m_sequences;
             std::vector<int> m_rootSequence;
+            // Branch & common steps of each root condition are copied into one range.
+            std::vector<std::pair<int, StepRange>> m_rootSteps;
+
+            ExecutionMode m_executionMode = ExecutionMode::Serial;
+            std::unordered_map<const void*, StepAccess> m_stepAccess;
+            std::map<std::pair<const void*, int>, StepAccess> m_conditionStepAccess;
+            // Edges are added between root steps in sequence order, so the graph is acyclic & conflicting steps keep their serial order.
+            std::vector<Task> m_tasks;
+            std::vector<uint32_t> m_taskSuccessors;
+            std::vector<std::atomic<uint32_t>> m_pendingDependencies;
+            std::atomic<uint32_t> m_remainingTasks = 0;
+            // Ready tasks that are not parallel. Only the thread executing the root sequence takes from this.
+            std::vector<uint32_t> m_mainThreadTasks;
+            size_t m_mainThreadTaskHead = 0;
+            std::mutex m_mainThreadLock;
+            std::condition_variable m_mainThreadCondition;
     };
 }
\ No newline at end of file
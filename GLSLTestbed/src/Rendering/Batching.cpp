@@ -3,6 +3,7 @@
 #include "Utilities/HashCache.h"
 #include "Rendering/Batching.h"
 #include "Rendering/GraphicsAPI.h"
+#include <emmintrin.h>
 
 namespace PK::Rendering::Batching
 {
@@ -28,9 +29,468 @@ namespace PK::Rendering::Batching
         }
     }
 
+    static InstanceTransformFormat s_transformFormat = InstanceTransformFormat::Float4x4;
+
+    // float4s per instance in pk_InstancingMatrices.
+    static inline uint GetTransformStride()
+    {
+        switch (s_transformFormat)
+        {
+            case InstanceTransformFormat::Float3x4: return 3u;
+            case InstanceTransformFormat::Compact: return 2u;
+            default: return 4u;
+        }
+    }
+
+    static float* MapTransforms(Ref<ComputeBuffer>& buffer, uint count)
+    {
+        auto rowCount = count * GetTransformStride();
+
+        if (buffer == nullptr)
+        {
+            buffer = CreateRef<ComputeBuffer>(BufferLayout({ { PK_TYPE::FLOAT4, "Row"} }), rowCount, false, GL_STREAM_DRAW);
+        }
+        else
+        {
+            buffer->ValidateSize(rowCount);
+        }
+
+        auto* rows = buffer->BeginMapBufferRange<float4>(0, rowCount).data;
+        PK_CORE_ASSERT(((size_t)rows & 15ull) == 0, "Mapped transform buffer is not aligned for streaming stores!");
+        return reinterpret_cast<float*>(rows);
+    }
+
+    // Round to nearest even. Values below the half precision range are flushed to zero.
+    static inline __m128i FloatToHalf(__m128 value)
+    {
+        const auto signMask = _mm_set1_epi32(0x80000000);
+        const auto halfMax = _mm_set1_epi32((127 + 16) << 23);
+        const auto minNormal = _mm_set1_epi32((127 - 14) << 23);
+        const auto normalBias = _mm_set1_epi32(0xFFF - ((127 - 15) << 23));
+        const auto infinity = _mm_set1_epi32(0x7C00);
+
+        auto sign = _mm_and_ps(value, _mm_castsi128_ps(signMask));
+        auto absolute = _mm_castps_si128(_mm_xor_ps(value, sign));
+        auto isRegular = _mm_cmpgt_epi32(halfMax, absolute);
+        auto isNormal = _mm_cmpgt_epi32(absolute, _mm_sub_epi32(minNormal, _mm_set1_epi32(1)));
+
+        auto mantissaOdd = _mm_srai_epi32(_mm_slli_epi32(absolute, 31 - 13), 31);
+        auto normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absolute, normalBias), mantissaOdd), 13);
+        normal = _mm_and_si128(normal, isNormal);
+
+        auto result = _mm_or_si128(_mm_and_si128(normal, isRegular), _mm_andnot_si128(isRegular, infinity));
+        return _mm_or_si128(result, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+    }
+
+    static inline __m128 PackHalf2(__m128 low, __m128 high)
+    {
+        return _mm_castsi128_ps(_mm_or_si128(FloatToHalf(low), _mm_slli_epi32(FloatToHalf(high), 16)));
+    }
+
+    static inline __m128 Select(__m128 maskW, __m128 maskX, __m128 maskY, __m128 maskZ, __m128 w, __m128 x, __m128 y, __m128 z)
+    {
+        return _mm_or_ps(_mm_or_ps(_mm_and_ps(maskW, w), _mm_and_ps(maskX, x)), _mm_or_ps(_mm_and_ps(maskY, y), _mm_and_ps(maskZ, z)));
+    }
+
+    // Decomposes four affine matrices without shear into position, rotation & scale. Matrices are processed as structures of arrays.
+    // The quaternion is derived from its largest component (Shepperd's method) with selects instead of branches.
+    // Output per instance: float4(position, half2(scale.xy)) & float4(half2(rotation.xy), half2(rotation.zw), half2(scale.z, 0), 0).
+    static void EncodeCompactTransforms(const float* const* matrices, __m128* output)
+    {
+        __m128 columns[4][4];
+
+        for (auto i = 0; i < 4; ++i)
+        {
+            for (auto j = 0; j < 4; ++j)
+            {
+                columns[j][i] = _mm_loadu_ps(matrices[i] + j * 4);
+            }
+        }
+
+        for (auto j = 0; j < 4; ++j)
+        {
+            _MM_TRANSPOSE4_PS(columns[j][0], columns[j][1], columns[j][2], columns[j][3]);
+        }
+
+        const auto zero = _mm_setzero_ps();
+        const auto one = _mm_set1_ps(1.0f);
+        const auto signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+        const auto minScale = _mm_set1_ps(1e-12f);
+
+        auto r00 = columns[0][0], r10 = columns[0][1], r20 = columns[0][2];
+        auto r01 = columns[1][0], r11 = columns[1][1], r21 = columns[1][2];
+        auto r02 = columns[2][0], r12 = columns[2][1], r22 = columns[2][2];
+
+        auto sx = _mm_max_ps(_mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r00, r00), _mm_mul_ps(r10, r10)), _mm_mul_ps(r20, r20))), minScale);
+        auto sy = _mm_max_ps(_mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r01, r01), _mm_mul_ps(r11, r11)), _mm_mul_ps(r21, r21))), minScale);
+        auto sz = _mm_max_ps(_mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r02, r02), _mm_mul_ps(r12, r12)), _mm_mul_ps(r22, r22))), minScale);
+
+        // Mirrored matrices get a negative x scale so that the remaining rotation is proper.
+        auto determinant = _mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(r10, r21), _mm_mul_ps(r20, r11)), r02),
+            _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(r20, r01), _mm_mul_ps(r00, r21)), r12)),
+            _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(r00, r11), _mm_mul_ps(r10, r01)), r22));
+        sx = _mm_xor_ps(sx, _mm_and_ps(_mm_cmplt_ps(determinant, zero), signMask));
+
+        auto invX = _mm_div_ps(one, sx);
+        auto invY = _mm_div_ps(one, sy);
+        auto invZ = _mm_div_ps(one, sz);
+        r00 = _mm_mul_ps(r00, invX); r10 = _mm_mul_ps(r10, invX); r20 = _mm_mul_ps(r20, invX);
+        r01 = _mm_mul_ps(r01, invY); r11 = _mm_mul_ps(r11, invY); r21 = _mm_mul_ps(r21, invY);
+        r02 = _mm_mul_ps(r02, invZ); r12 = _mm_mul_ps(r12, invZ); r22 = _mm_mul_ps(r22, invZ);
+
+        auto t0 = _mm_add_ps(_mm_add_ps(one, r00), _mm_add_ps(r11, r22));
+        auto t1 = _mm_sub_ps(_mm_add_ps(one, r00), _mm_add_ps(r11, r22));
+        auto t2 = _mm_sub_ps(_mm_add_ps(one, r11), _mm_add_ps(r00, r22));
+        auto t3 = _mm_sub_ps(_mm_add_ps(one, r22), _mm_add_ps(r00, r11));
+        auto largest = _mm_max_ps(_mm_max_ps(t0, t1), _mm_max_ps(t2, t3));
+
+        auto isW = _mm_cmpeq_ps(t0, largest);
+        auto isX = _mm_andnot_ps(isW, _mm_cmpeq_ps(t1, largest));
+        auto isY = _mm_andnot_ps(_mm_or_ps(isW, isX), _mm_cmpeq_ps(t2, largest));
+        auto isZ = _mm_andnot_ps(_mm_or_ps(_mm_or_ps(isW, isX), isY), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+
+        auto d21 = _mm_sub_ps(r21, r12);
+        auto d02 = _mm_sub_ps(r02, r20);
+        auto d10 = _mm_sub_ps(r10, r01);
+        auto s10 = _mm_add_ps(r10, r01);
+        auto s02 = _mm_add_ps(r02, r20);
+        auto s21 = _mm_add_ps(r21, r12);
+
+        auto normalization = _mm_div_ps(_mm_set1_ps(0.5f), _mm_sqrt_ps(largest));
+        auto qx = _mm_mul_ps(Select(isW, isX, isY, isZ, d21, t1, s10, s02), normalization);
+        auto qy = _mm_mul_ps(Select(isW, isX, isY, isZ, d02, s10, t2, s21), normalization);
+        auto qz = _mm_mul_ps(Select(isW, isX, isY, isZ, d10, s02, s21, t3), normalization);
+        auto qw = _mm_mul_ps(Select(isW, isX, isY, isZ, t0, d21, d02, d10), normalization);
+
+        auto v0x = columns[3][0];
+        auto v0y = columns[3][1];
+        auto v0z = columns[3][2];
+        auto v0w = PackHalf2(sx, sy);
+        auto v1x = PackHalf2(qx, qy);
+        auto v1y = PackHalf2(qz, qw);
+        auto v1z = PackHalf2(sz, zero);
+        auto v1w = zero;
+        _MM_TRANSPOSE4_PS(v0x, v0y, v0z, v0w);
+        _MM_TRANSPOSE4_PS(v1x, v1y, v1z, v1w);
+
+        output[0] = v0x; output[1] = v1x;
+        output[2] = v0y; output[3] = v1y;
+        output[4] = v0z; output[5] = v1z;
+        output[6] = v0w; output[7] = v1w;
+    }
+
+    // Mapped buffers are usually write combined. Non temporal stores write them without reading the destination into the cache.
+    // Matrices are fetched a few draws ahead as they are scattered across the implementer buckets.
+    // Callers fence with _mm_sfence before unmapping.
+    template<typename TDrawcall>
+    static void StreamTransforms(float* destination, const TDrawcall* drawcalls, uint count)
+    {
+        const uint prefetchDistance = 4u;
+
+        if (s_transformFormat == InstanceTransformFormat::Compact)
+        {
+            for (uint i = 0; i < count; i += 4u)
+            {
+                auto groupCount = count - i < 4u ? count - i : 4u;
+                const float* matrices[4];
+                __m128 encoded[8];
+
+                // Partial groups repeat their last matrix. Only groupCount instances are written.
+                for (uint j = 0; j < 4u; ++j)
+                {
+                    matrices[j] = glm::value_ptr(*drawcalls[i + (j < groupCount ? j : groupCount - 1)].localToWorld);
+
+                    if (i + j + prefetchDistance < count)
+                    {
+                        _mm_prefetch(reinterpret_cast<const char*>(drawcalls[i + j + prefetchDistance].localToWorld), _MM_HINT_T0);
+                    }
+                }
+
+                EncodeCompactTransforms(matrices, encoded);
+
+                for (uint j = 0; j < groupCount * 2u; ++j, destination += 4)
+                {
+                    _mm_stream_ps(destination, encoded[j]);
+                }
+            }
+
+            return;
+        }
+
+        for (uint i = 0; i < count; ++i)
+        {
+            if (i + prefetchDistance < count)
+            {
+                _mm_prefetch(reinterpret_cast<const char*>(drawcalls[i + prefetchDistance].localToWorld), _MM_HINT_T0);
+            }
+
+            auto* matrix = glm::value_ptr(*drawcalls[i].localToWorld);
+            auto c0 = _mm_loadu_ps(matrix + 0);
+            auto c1 = _mm_loadu_ps(matrix + 4);
+            auto c2 = _mm_loadu_ps(matrix + 8);
+            auto c3 = _mm_loadu_ps(matrix + 12);
+
+            if (s_transformFormat == InstanceTransformFormat::Float3x4)
+            {
+                // Columns to rows. The last row of an affine matrix is constant & dropped.
+                _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+                _mm_stream_ps(destination + 0, c0);
+                _mm_stream_ps(destination + 4, c1);
+                _mm_stream_ps(destination + 8, c2);
+                destination += 12;
+            }
+            else
+            {
+                _mm_stream_ps(destination + 0, c0);
+                _mm_stream_ps(destination + 4, c1);
+                _mm_stream_ps(destination + 8, c2);
+                _mm_stream_ps(destination + 12, c3);
+                destination += 16;
+            }
+        }
+    }
+
+    static void SetInstancingMatrices(const HashCache* hashes, const ComputeBuffer* matrices)
+    {
+        GraphicsAPI::SetGlobalComputeBuffer(hashes->pk_InstancingMatrices, matrices->GetGraphicsID());
+        GraphicsAPI::SetGlobalUInt(hashes->pk_InstancingTransformStride, GetTransformStride());
+    }
+
+    struct DepthSortKey
+    {
+        uint key = 0;
+        uint index = 0;
+    };
+
+    // Depths are quantized to 16 bits over the depth range of the items being sorted.
+    static uint QuantizeDepth(float depth, float minDepth, float scale)
+    {
+        auto value = (depth - minDepth) * scale;
+        return value <= 0.0f ? 0u : value >= 65535.0f ? 65535u : (uint)value;
+    }
+
+    // Stable two pass radix sort on 16 bit keys. Scratch must fit count keys. Sorted keys are written back to keys.
+    static void RadixSort16(DepthSortKey* keys, DepthSortKey* scratch, uint count)
+    {
+        uint histograms[2][256] = {};
+
+        for (uint i = 0; i < count; ++i)
+        {
+            ++histograms[0][keys[i].key & 0xFFu];
+            ++histograms[1][(keys[i].key >> 8u) & 0xFFu];
+        }
+
+        auto* source = keys;
+        auto* destination = scratch;
+
+        for (uint pass = 0; pass < 2; ++pass)
+        {
+            auto* histogram = histograms[pass];
+            auto shift = pass * 8u;
+            uint offset = 0;
+
+            for (uint i = 0; i < 256; ++i)
+            {
+                auto bucketCount = histogram[i];
+                histogram[i] = offset;
+                offset += bucketCount;
+            }
+
+            for (uint i = 0; i < count; ++i)
+            {
+                destination[histogram[(source[i].key >> shift) & 0xFFu]++] = source[i];
+            }
+
+            std::swap(source, destination);
+        }
+    }
+
+    // Front to back by the nearest draw of each batch to get the most out of early z rejection.
+    static void SortOpaqueBatches(DynamicBatchCollection* collection)
+    {
+        auto batchCount = (uint)collection->MeshBatches.size();
+        auto* keys = FrameAllocator::Allocate<DepthSortKey>(batchCount * 2ull);
+        auto minDepth = std::numeric_limits<float>().max();
+        auto maxDepth = -std::numeric_limits<float>().max();
+        uint count = 0;
+
+        for (uint i = 0; i < batchCount; ++i)
+        {
+            auto& batch = collection->MeshBatches[i];
+
+            if (batch.drawCallCount < 1)
+            {
+                continue;
+            }
+
+            minDepth = batch.minDepth < minDepth ? batch.minDepth : minDepth;
+            maxDepth = batch.minDepth > maxDepth ? batch.minDepth : maxDepth;
+            keys[count++].index = i;
+        }
+
+        auto scale = maxDepth > minDepth ? 65535.0f / (maxDepth - minDepth) : 0.0f;
+
+        for (uint i = 0; i < count; ++i)
+        {
+            keys[i].key = QuantizeDepth(collection->MeshBatches[keys[i].index].minDepth, minDepth, scale);
+        }
+
+        RadixSort16(keys, keys + count, count);
+
+        collection->OpaqueOrder.ValidateSize(count, 0);
+        collection->OpaqueBatchCount = count;
+
+        for (uint i = 0; i < count; ++i)
+        {
+            collection->OpaqueOrder[i] = keys[i].index;
+        }
+    }
+
+    static void SortTransparentDrawcalls(DynamicBatchCollection* collection)
+    {
+        auto count = collection->TransparentDrawCallCount;
+
+        if (count < 2)
+        {
+            return;
+        }
+
+        auto* drawcalls = collection->TransparentDrawcalls.data();
+        auto* keys = FrameAllocator::Allocate<DepthSortKey>(count * 2ull);
+        auto minDepth = drawcalls[0].depth;
+        auto maxDepth = drawcalls[0].depth;
+
+        for (uint i = 1; i < count; ++i)
+        {
+            minDepth = drawcalls[i].depth < minDepth ? drawcalls[i].depth : minDepth;
+            maxDepth = drawcalls[i].depth > maxDepth ? drawcalls[i].depth : maxDepth;
+        }
+
+        auto scale = maxDepth > minDepth ? 65535.0f / (maxDepth - minDepth) : 0.0f;
+
+        // Inverted keys for back to front order.
+        for (uint i = 0; i < count; ++i)
+        {
+            keys[i] = { 65535u - QuantizeDepth(drawcalls[i].depth, minDepth, scale), i };
+        }
+
+        RadixSort16(keys, keys + count, count);
+
+        auto* sorted = FrameAllocator::Allocate<TransparentDrawcall>(count);
+
+        for (uint i = 0; i < count; ++i)
+        {
+            sorted[i] = drawcalls[keys[i].index];
+        }
+
+        memcpy(drawcalls, sorted, sizeof(TransparentDrawcall) * count);
+    }
+
+    // Orders the batches of a mesh batch by the state they bind so that consecutive draws share programs & uniform values.
+    // Batch counts per mesh are small. Insertion sort keeps equal keys in queue order.
+    template<typename TGetKey>
+    static void SortByStateKey(uint* indices, uint count, TGetKey getKey)
+    {
+        for (uint i = 1; i < count; ++i)
+        {
+            auto index = indices[i];
+            auto key = getKey(index);
+            auto j = i;
+
+            for (; j > 0 && getKey(indices[j - 1]) > key; --j)
+            {
+                indices[j] = indices[j - 1];
+            }
+
+            indices[j] = index;
+        }
+    }
+
+    void SetInstanceTransformFormat(InstanceTransformFormat format) { s_transformFormat = format; }
+
+    InstanceTransformFormat GetInstanceTransformFormat() { return s_transformFormat; }
+
+    void WriteInstanceTransforms(float* destination, const Drawcall* drawcalls, uint count)
+    {
+        StreamTransforms(destination, drawcalls, count);
+        _mm_sfence();
+    }
+
+    float4x4 ReadInstanceTransform(const float* source)
+    {
+        switch (s_transformFormat)
+        {
+            case InstanceTransformFormat::Float3x4:
+            {
+                auto matrix = PK_FLOAT4X4_IDENTITY;
+
+                for (auto row = 0; row < 3; ++row)
+                {
+                    for (auto column = 0; column < 4; ++column)
+                    {
+                        matrix[column][row] = source[row * 4 + column];
+                    }
+                }
+
+                return matrix;
+            }
+            case InstanceTransformFormat::Compact:
+            {
+                uint packed[4];
+                memcpy(packed, source + 3, sizeof(uint));
+                memcpy(packed + 1, source + 4, sizeof(uint) * 3);
+                auto scaleXY = glm::unpackHalf2x16(packed[0]);
+                auto rotationXY = glm::unpackHalf2x16(packed[1]);
+                auto rotationZW = glm::unpackHalf2x16(packed[2]);
+                auto scaleZ = glm::unpackHalf2x16(packed[3]).x;
+                auto rotation = glm::normalize(quaternion(rotationZW.y, rotationXY.x, rotationXY.y, rotationZW.x));
+                auto matrix = float4x4(glm::mat3_cast(rotation));
+                matrix[0] *= scaleXY.x;
+                matrix[1] *= scaleXY.y;
+                matrix[2] *= scaleZ;
+                matrix[3] = float4(source[0], source[1], source[2], 1.0f);
+                return matrix;
+            }
+            default: return glm::make_mat4(source);
+        }
+    }
+
+    InstanceTransformFormat GetInstanceTransformFormatFromString(const std::string& name, InstanceTransformFormat fallback)
+    {
+        if (name == "Float4x4")
+        {
+            return InstanceTransformFormat::Float4x4;
+        }
+
+        if (name == "Float3x4")
+        {
+            return InstanceTransformFormat::Float3x4;
+        }
+
+        if (name == "Compact")
+        {
+            return InstanceTransformFormat::Compact;
+        }
+
+        return fallback;
+    }
+
+    const char* GetInstanceTransformFormatName(InstanceTransformFormat format)
+    {
+        switch (format)
+        {
+            case InstanceTransformFormat::Float3x4: return "Float3x4";
+            case InstanceTransformFormat::Compact: return "Compact";
+            default: return "Float4x4";
+        }
+    }
+
     void ResetCollection(DynamicBatchCollection* collection)
     {
         collection->TotalDrawCallCount = 0;
+        collection->OpaqueBatchCount = 0;
+        collection->TransparentDrawCallCount = 0;
 
         for (auto& batch : collection->MeshBatches)
         {
@@ -78,6 +538,12 @@ namespace PK::Rendering::Batching
   
     void QueueDraw(DynamicBatchCollection* collection, const Mesh* mesh, int submesh, const Material* material, const Drawcall& drawcall)
     {
+        if (material->GetRenderQueue() == RenderQueue::Transparent)
+        {
+            collection->TransparentDrawcalls.Push({ mesh, material, drawcall.localToWorld, drawcall.depth, submesh }, &collection->TransparentDrawCallCount);
+            return;
+        }
+
         auto meshId = (ulong)mesh->GetGraphicsID();
         auto materialId = (ulong)material->GetAssetID();
         auto shaderId = (ulong)material->GetShaderAssetID();
@@ -96,6 +562,7 @@ namespace PK::Rendering::Batching
 
         GetBatch(collection->BatchMap, collection->MeshBatches, meshKey, &meshBatch, &meshBatchIndex);
         meshBatch->mesh = mesh;
+        meshBatch->minDepth = meshBatch->drawCallCount == 0 || drawcall.depth < meshBatch->minDepth ? drawcall.depth : meshBatch->minDepth;
 
         if (GetBatch(collection->BatchMap, collection->ShaderBatches, shaderKey, &shaderBatch, &shaderBatchIndex))
         {
@@ -113,16 +580,15 @@ namespace PK::Rendering::Batching
 
         if (shaderBatch->drawCallCount == 0)
         {
-            Utilities::PushVectorElementRef(meshBatch->shaderBatches, &meshBatch->shaderBatchCount, shaderBatchIndex);
+            meshBatch->shaderBatches.Push(shaderBatchIndex, &meshBatch->shaderBatchCount);
         }
 
         if (materialBatch->drawCallCount == 0)
         {
-            Utilities::PushVectorElementRef(shaderBatch->materialBatches, &shaderBatch->materialBatchCount, materialBatchIndex);
+            shaderBatch->materialBatches.Push(materialBatchIndex, &shaderBatch->materialBatchCount);
         }
 
-        Utilities::ValidateVectorSize(materialBatch->drawcalls, materialBatch->drawCallCount + 1);
-        materialBatch->drawcalls[materialBatch->drawCallCount++] = drawcall;
+        materialBatch->drawcalls.Push(drawcall, &materialBatch->drawCallCount);
         ++shaderBatch->drawCallCount;
         ++meshBatch->drawCallCount;
         ++collection->TotalDrawCallCount;
@@ -138,8 +604,7 @@ namespace PK::Rendering::Batching
         GetBatch(collection->BatchMap, collection->MeshBatches, meshId, &meshBatch, &meshBatchIndex);
         meshBatch->mesh = mesh;
 
-        Utilities::ValidateVectorSize(meshBatch->drawcalls, meshBatch->drawCallCount + 1);
-        meshBatch->drawcalls[meshBatch->drawCallCount++] = drawcall;
+        meshBatch->drawcalls.Push(drawcall, &meshBatch->drawCallCount);
         ++collection->TotalDrawCallCount;
     }
 
@@ -153,14 +618,50 @@ namespace PK::Rendering::Batching
         GetBatch(collection->BatchMap, collection->MeshBatches, meshId, &meshBatch, &meshBatchIndex);
         meshBatch->mesh = mesh;
 
-        Utilities::ValidateVectorSize(meshBatch->drawcalls, meshBatch->drawCallCount + 1);
-        meshBatch->drawcalls[meshBatch->drawCallCount++] = drawcall;
+        meshBatch->drawcalls.Push(drawcall, &meshBatch->drawCallCount);
         ++collection->TotalDrawCallCount;
     }
 
+    void MergeCollection(IndexedMeshBatchCollection* collection, const IndexedMeshBatchCollection* source, uint indexMask, uint clipMask)
+    {
+        for (auto& sourceBatch : source->MeshBatches)
+        {
+            if (sourceBatch.drawCallCount < 1)
+            {
+                continue;
+            }
+
+            uint meshBatchIndex = 0;
+            IndexedMeshBatch* meshBatch = nullptr;
+
+            GetBatch(collection->BatchMap, collection->MeshBatches, (ulong)sourceBatch.mesh->GetGraphicsID(), &meshBatch, &meshBatchIndex);
+            meshBatch->mesh = sourceBatch.mesh;
+
+            meshBatch->drawcalls.ValidateSize(meshBatch->drawCallCount + sourceBatch.drawCallCount, meshBatch->drawCallCount);
+
+            for (uint i = 0; i < sourceBatch.drawCallCount; ++i)
+            {
+                auto drawcall = sourceBatch.drawcalls[i];
+
+                // Clip index is stored in the high byte of the draw index.
+                if ((clipMask & (1u << (drawcall.index >> 24u))) == 0)
+                {
+                    continue;
+                }
+
+                drawcall.index |= indexMask;
+                meshBatch->drawcalls[meshBatch->drawCallCount++] = drawcall;
+                ++collection->TotalDrawCallCount;
+            }
+        }
+    }
+
    
     void UpdateBuffers(DynamicBatchCollection* collection)
     {
+        SortOpaqueBatches(collection);
+        SortTransparentDrawcalls(collection);
+
         if (collection->TotalDrawCallCount < 1)
         {
             return;
@@ -175,21 +676,12 @@ namespace PK::Rendering::Batching
             collection->PropertyIndices->ValidateSize((uint)collection->TotalDrawCallCount);
         }
 
-        if (collection->MatrixBuffer == nullptr)
-        {
-            collection->MatrixBuffer = CreateRef<ComputeBuffer>(BufferLayout({ { PK_TYPE::FLOAT4X4, "Matrix"} }), (uint)collection->TotalDrawCallCount, false, GL_STREAM_DRAW);
-        }
-        else
-        {
-            collection->MatrixBuffer->ValidateSize((uint)collection->TotalDrawCallCount);
-        }
-
         auto indexBuffer = collection->PropertyIndices->BeginMapBufferRange<uint>(0, collection->TotalDrawCallCount);
-        auto matrixBuffer = collection->MatrixBuffer->BeginMapBufferRange<float4x4>(0, collection->TotalDrawCallCount);
+        auto matrixBuffer = MapTransforms(collection->MatrixBuffer, collection->TotalDrawCallCount);
+        auto transformStride = GetTransformStride() * 4ull;
         auto shaderBatches = collection->ShaderBatches.data();
         auto materialBatches = collection->MaterialBatches.data();
         char* instancedDataBuffer = nullptr;
-        const BufferLayout* instancingLayout = nullptr;
         size_t stride = 0;
         size_t offset = 0;
 
@@ -203,6 +695,9 @@ namespace PK::Rendering::Batching
             meshBatch.instancingOffset = (uint)offset;
             auto shaderBatchIndices = meshBatch.shaderBatches.data();
 
+            // Sorted before the layout is written as instanced property indices are material batch positions.
+            SortByStateKey(shaderBatchIndices, meshBatch.shaderBatchCount, [&](uint index) { return materialBatches[shaderBatches[index].materialBatches[0]].material->GetShaderAssetID(); });
+
             for (uint i = 0; i < meshBatch.shaderBatchCount; ++i)
             {
                 auto* shaderBatch = &shaderBatches[shaderBatchIndices[i]];
@@ -210,13 +705,13 @@ namespace PK::Rendering::Batching
                 if (shaderBatch->instancedData != nullptr)
                 {
                     stride = shaderBatch->instancedData->GetStride();
-                    instancingLayout = &shaderBatch->instancedData->GetLayout();
                     shaderBatch->instancingOffset = (uint)offset;
                     shaderBatch->instancedData->ValidateSize(shaderBatch->drawCallCount);
                     instancedDataBuffer = shaderBatch->instancedData->BeginMapBufferRange<char>(0, shaderBatch->drawCallCount * stride).data;
                 }
 
                 auto materialBatchIndices = shaderBatch->materialBatches.data();
+                SortByStateKey(materialBatchIndices, shaderBatch->materialBatchCount, [&](uint index) { return materialBatches[index].material->GetAssetID(); });
 
                 for (uint j = 0; j < shaderBatch->materialBatchCount; ++j)
                 {
@@ -225,17 +720,15 @@ namespace PK::Rendering::Batching
 
                     if (shaderBatch->instancedData != nullptr)
                     {
-                        materialBatch->material->CopyBufferLayout(*instancingLayout, instancedDataBuffer + j * stride);
+                        memcpy(instancedDataBuffer + j * stride, materialBatch->material->GetInstancedProperties(), stride);
                     }
 
-                    Drawcall* drawcalls = materialBatch->drawcalls.data();
-
                     for (uint k = 0; k < materialBatch->drawCallCount; ++k)
                     {
                         indexBuffer[offset + k] = j;
-                        matrixBuffer[offset + k] = *drawcalls[k].localToWorld;
                     }
 
+                    StreamTransforms(matrixBuffer + offset * transformStride, materialBatch->drawcalls.data(), materialBatch->drawCallCount);
                     offset += materialBatch->drawCallCount;
                 }
 
@@ -246,6 +739,7 @@ namespace PK::Rendering::Batching
             }
         }
 
+        _mm_sfence();
         collection->PropertyIndices->EndMapBuffer();
         collection->MatrixBuffer->EndMapBuffer();
     }
@@ -257,16 +751,8 @@ namespace PK::Rendering::Batching
             return;
         }
 
-        if (collection->MatrixBuffer == nullptr)
-        {
-            collection->MatrixBuffer = CreateRef<ComputeBuffer>(BufferLayout({ { PK_TYPE::FLOAT4X4, "Matrix"} }), (uint)collection->TotalDrawCallCount, false, GL_STREAM_DRAW);
-        }
-        else
-        {
-            collection->MatrixBuffer->ValidateSize((uint)collection->TotalDrawCallCount);
-        }
-
-        auto matrixBuffer = collection->MatrixBuffer->BeginMapBufferRange<float4x4>(0, collection->TotalDrawCallCount);
+        auto matrixBuffer = MapTransforms(collection->MatrixBuffer, collection->TotalDrawCallCount);
+        auto transformStride = GetTransformStride() * 4ull;
         size_t offset = 0;
 
         for (auto& meshBatch : collection->MeshBatches)
@@ -277,16 +763,11 @@ namespace PK::Rendering::Batching
             }
 
             meshBatch.instancingOffset = (uint)offset;
-            Drawcall* drawcalls = meshBatch.drawcalls.data();
-
-            for (uint i = 0; i < meshBatch.drawCallCount; ++i)
-            {
-                matrixBuffer[offset + i] = *drawcalls[i].localToWorld;
-            }
-
+            StreamTransforms(matrixBuffer + offset * transformStride, meshBatch.drawcalls.data(), meshBatch.drawCallCount);
             offset += meshBatch.drawCallCount;
         }
 
+        _mm_sfence();
         collection->MatrixBuffer->EndMapBuffer();
     }
 
@@ -297,15 +778,6 @@ namespace PK::Rendering::Batching
             return;
         }
 
-        if (collection->MatrixBuffer == nullptr)
-        {
-            collection->MatrixBuffer = CreateRef<ComputeBuffer>(BufferLayout({ { PK_TYPE::FLOAT4X4, "Matrix"} }), (uint)collection->TotalDrawCallCount, false, GL_STREAM_DRAW);
-        }
-        else
-        {
-            collection->MatrixBuffer->ValidateSize((uint)collection->TotalDrawCallCount);
-        }
-
         if (collection->IndexBuffer == nullptr)
         {
             collection->IndexBuffer = CreateRef<ComputeBuffer>(BufferLayout({ { PK_TYPE::UINT, "Index"} }), (uint)collection->TotalDrawCallCount, false, GL_STREAM_DRAW);
@@ -316,7 +788,8 @@ namespace PK::Rendering::Batching
         }
 
 
-        auto matrixBuffer = collection->MatrixBuffer->BeginMapBufferRange<float4x4>(0, collection->TotalDrawCallCount);
+        auto matrixBuffer = MapTransforms(collection->MatrixBuffer, collection->TotalDrawCallCount);
+        auto transformStride = GetTransformStride() * 4ull;
         auto indexBuffer = collection->IndexBuffer->BeginMapBufferRange<uint>(0, collection->TotalDrawCallCount);
         size_t offset = 0;
 
@@ -333,12 +806,13 @@ namespace PK::Rendering::Batching
             for (uint i = 0; i < meshBatch.drawCallCount; ++i)
             {
                 indexBuffer[offset + i] = drawcalls[i].index;
-                matrixBuffer[offset + i] = *drawcalls[i].localToWorld;
             }
 
+            StreamTransforms(matrixBuffer + offset * transformStride, drawcalls, meshBatch.drawCallCount);
             offset += meshBatch.drawCallCount;
         }
 
+        _mm_sfence();
         collection->MatrixBuffer->EndMapBuffer();
         collection->IndexBuffer->EndMapBuffer();
     }
@@ -352,17 +826,15 @@ namespace PK::Rendering::Batching
         }
 
         auto hashes = HashCache::Get();
-        GraphicsAPI::SetGlobalComputeBuffer(hashes->pk_InstancingMatrices, collection->MatrixBuffer->GetGraphicsID());
+        SetInstancingMatrices(hashes, collection->MatrixBuffer.get());
         GraphicsAPI::SetGlobalComputeBuffer(hashes->pk_InstancingPropertyIndices, collection->PropertyIndices->GetGraphicsID());
         GraphicsAPI::SetGlobalKeyword(hashes->PK_ENABLE_INSTANCING, true);
 
-        for (auto& meshBatch : collection->MeshBatches)
-        {
-            if (meshBatch.drawCallCount < 1)
-            {
-                continue;
-            }
+        auto* order = collection->OpaqueOrder.data();
 
+        for (uint n = 0; n < collection->OpaqueBatchCount; ++n)
+        {
+            auto& meshBatch = collection->MeshBatches.at(order[n]);
             auto shaderBatches = meshBatch.shaderBatches.data();
 
             for (uint i = 0; i < meshBatch.shaderBatchCount; ++i)
@@ -392,6 +864,15 @@ namespace PK::Rendering::Batching
         GraphicsAPI::SetGlobalKeyword(hashes->PK_ENABLE_INSTANCING, false);
     }
 
+    void DrawTransparent(DynamicBatchCollection* collection)
+    {
+        for (uint i = 0; i < collection->TransparentDrawCallCount; ++i)
+        {
+            auto& drawcall = collection->TransparentDrawcalls[i];
+            GraphicsAPI::DrawMesh(drawcall.mesh, drawcall.submesh, drawcall.material, *drawcall.localToWorld);
+        }
+    }
+
     void DrawBatches(DynamicBatchCollection* collection, const Material* overrideMaterial)
     {
         if (collection->TotalDrawCallCount < 1)
@@ -400,16 +881,14 @@ namespace PK::Rendering::Batching
         }
 
         auto hashes = HashCache::Get();
-        GraphicsAPI::SetGlobalComputeBuffer(hashes->pk_InstancingMatrices, collection->MatrixBuffer->GetGraphicsID());
+        SetInstancingMatrices(hashes, collection->MatrixBuffer.get());
         GraphicsAPI::SetGlobalKeyword(hashes->PK_ENABLE_INSTANCING, true);
 
-        for (auto& meshBatch : collection->MeshBatches)
-        {
-            if (meshBatch.drawCallCount < 1)
-            {
-                continue;
-            }
+        auto* order = collection->OpaqueOrder.data();
 
+        for (uint n = 0; n < collection->OpaqueBatchCount; ++n)
+        {
+            auto& meshBatch = collection->MeshBatches.at(order[n]);
             GraphicsAPI::DrawMeshInstanced(meshBatch.mesh, -1, meshBatch.instancingOffset, (uint)meshBatch.drawCallCount, overrideMaterial);
         }
 
@@ -424,16 +903,14 @@ namespace PK::Rendering::Batching
         }
 
         auto hashes = HashCache::Get();
-        GraphicsAPI::SetGlobalComputeBuffer(hashes->pk_InstancingMatrices, collection->MatrixBuffer->GetGraphicsID());
+        SetInstancingMatrices(hashes, collection->MatrixBuffer.get());
         GraphicsAPI::SetGlobalKeyword(hashes->PK_ENABLE_INSTANCING, true);
 
-        for (auto& meshBatch : collection->MeshBatches)
-        {
-            if (meshBatch.drawCallCount < 1)
-            {
-                continue;
-            }
+        auto* order = collection->OpaqueOrder.data();
 
+        for (uint n = 0; n < collection->OpaqueBatchCount; ++n)
+        {
+            auto& meshBatch = collection->MeshBatches.at(order[n]);
             GraphicsAPI::DrawMeshInstanced(meshBatch.mesh, -1, meshBatch.instancingOffset, (uint)meshBatch.drawCallCount, overrideShader, propertyBlock);
         }
 
@@ -448,16 +925,14 @@ namespace PK::Rendering::Batching
         }
 
         auto hashes = HashCache::Get();
-        GraphicsAPI::SetGlobalComputeBuffer(hashes->pk_InstancingMatrices, collection->MatrixBuffer->GetGraphicsID());
+        SetInstancingMatrices(hashes, collection->MatrixBuffer.get());
         GraphicsAPI::SetGlobalKeyword(hashes->PK_ENABLE_INSTANCING, true);
 
-        for (auto& meshBatch : collection->MeshBatches)
-        {
-            if (meshBatch.drawCallCount < 1)
-            {
-                continue;
-            }
+        auto* order = collection->OpaqueOrder.data();
 
+        for (uint n = 0; n < collection->OpaqueBatchCount; ++n)
+        {
+            auto& meshBatch = collection->MeshBatches.at(order[n]);
             GraphicsAPI::DrawMeshInstanced(meshBatch.mesh, -1, meshBatch.instancingOffset, (uint)meshBatch.drawCallCount, overrideShader);
         }
 
@@ -472,18 +947,16 @@ namespace PK::Rendering::Batching
         }
 
         auto hashes = HashCache::Get();
-        GraphicsAPI::SetGlobalComputeBuffer(hashes->pk_InstancingMatrices, collection->MatrixBuffer->GetGraphicsID());
+        SetInstancingMatrices(hashes, collection->MatrixBuffer.get());
         GraphicsAPI::SetGlobalComputeBuffer(hashes->pk_InstancingPropertyIndices, collection->PropertyIndices->GetGraphicsID());
         GraphicsAPI::SetGlobalKeyword(hashes->PK_ENABLE_INSTANCING, true);
         GraphicsAPI::SetGlobalKeyword(keyword, true);
 
-        for (auto& meshBatch : collection->MeshBatches)
-        {
-            if (meshBatch.drawCallCount < 1)
-            {
-                continue;
-            }
+        auto* order = collection->OpaqueOrder.data();
 
+        for (uint n = 0; n < collection->OpaqueBatchCount; ++n)
+        {
+            auto& meshBatch = collection->MeshBatches.at(order[n]);
             auto shaderBatches = meshBatch.shaderBatches.data();
 
             for (uint i = 0; i < meshBatch.shaderBatchCount; ++i)
@@ -528,18 +1001,16 @@ namespace PK::Rendering::Batching
         }
 
         auto hashes = HashCache::Get();
-        GraphicsAPI::SetGlobalComputeBuffer(hashes->pk_InstancingMatrices, collection->MatrixBuffer->GetGraphicsID());
+        SetInstancingMatrices(hashes, collection->MatrixBuffer.get());
         GraphicsAPI::SetGlobalComputeBuffer(hashes->pk_InstancingPropertyIndices, collection->PropertyIndices->GetGraphicsID());
         GraphicsAPI::SetGlobalKeyword(hashes->PK_ENABLE_INSTANCING, true);
         GraphicsAPI::SetGlobalKeyword(keyword, true);
 
-        for (auto& meshBatch : collection->MeshBatches)
-        {
-            if (meshBatch.drawCallCount < 1)
-            {
-                continue;
-            }
+        auto* order = collection->OpaqueOrder.data();
 
+        for (uint n = 0; n < collection->OpaqueBatchCount; ++n)
+        {
+            auto& meshBatch = collection->MeshBatches.at(order[n]);
             auto shaderBatches = meshBatch.shaderBatches.data();
 
             for (uint i = 0; i < meshBatch.shaderBatchCount; ++i)
@@ -585,7 +1056,7 @@ namespace PK::Rendering::Batching
         }
 
         auto hashes = HashCache::Get();
-        GraphicsAPI::SetGlobalComputeBuffer(hashes->pk_InstancingMatrices, collection->MatrixBuffer->GetGraphicsID());
+        SetInstancingMatrices(hashes, collection->MatrixBuffer.get());
         GraphicsAPI::SetGlobalKeyword(hashes->PK_ENABLE_INSTANCING, true);
 
         for (auto& meshBatch : collection->MeshBatches)
@@ -609,7 +1080,7 @@ namespace PK::Rendering::Batching
         }
 
         auto hashes = HashCache::Get();
-        GraphicsAPI::SetGlobalComputeBuffer(hashes->pk_InstancingMatrices, collection->MatrixBuffer->GetGraphicsID());
+        SetInstancingMatrices(hashes, collection->MatrixBuffer.get());
         GraphicsAPI::SetGlobalKeyword(hashes->PK_ENABLE_INSTANCING, true);
 
         for (auto& meshBatch : collection->MeshBatches)
@@ -633,7 +1104,7 @@ namespace PK::Rendering::Batching
         }
 
         auto hashes = HashCache::Get();
-        GraphicsAPI::SetGlobalComputeBuffer(hashes->pk_InstancingMatrices, collection->MatrixBuffer->GetGraphicsID());
+        SetInstancingMatrices(hashes, collection->MatrixBuffer.get());
         GraphicsAPI::SetGlobalKeyword(hashes->PK_ENABLE_INSTANCING, true);
 
         for (auto& meshBatch : collection->MeshBatches)
@@ -657,7 +1128,7 @@ namespace PK::Rendering::Batching
         }
 
         auto hashes = HashCache::Get();
-        GraphicsAPI::SetGlobalComputeBuffer(hashes->pk_InstancingMatrices, collection->MatrixBuffer->GetGraphicsID());
+        SetInstancingMatrices(hashes, collection->MatrixBuffer.get());
         GraphicsAPI::SetGlobalComputeBuffer(hashes->pk_InstancingPropertyIndices, collection->IndexBuffer->GetGraphicsID());
         GraphicsAPI::SetGlobalKeyword(hashes->PK_ENABLE_INSTANCING, true);
 
@@ -682,7 +1153,7 @@ namespace PK::Rendering::Batching
         }
 
         auto hashes = HashCache::Get();
-        GraphicsAPI::SetGlobalComputeBuffer(hashes->pk_InstancingMatrices, collection->MatrixBuffer->GetGraphicsID());
+        SetInstancingMatrices(hashes, collection->MatrixBuffer.get());
         GraphicsAPI::SetGlobalComputeBuffer(hashes->pk_InstancingPropertyIndices, collection->IndexBuffer->GetGraphicsID());
         GraphicsAPI::SetGlobalKeyword(hashes->PK_ENABLE_INSTANCING, true);
 
@@ -707,7 +1178,7 @@ namespace PK::Rendering::Batching
         }
 
         auto hashes = HashCache::Get();
-        GraphicsAPI::SetGlobalComputeBuffer(hashes->pk_InstancingMatrices, collection->MatrixBuffer->GetGraphicsID());
+        SetInstancingMatrices(hashes, collection->MatrixBuffer.get());
         GraphicsAPI::SetGlobalComputeBuffer(hashes->pk_InstancingPropertyIndices, collection->IndexBuffer->GetGraphicsID());
         GraphicsAPI::SetGlobalKeyword(hashes->PK_ENABLE_INSTANCING, true);
 
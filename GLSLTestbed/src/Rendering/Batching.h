@@ -2,6 +2,7 @@
 #include "Rendering/Objects/Material.h"
 #include "Rendering/Objects/Mesh.h"
 #include "Rendering/Objects/Mesh.h"
+#include "Utilities/FrameAllocator.h"
 
 namespace PK::Rendering::Batching
 {
@@ -9,6 +10,15 @@ namespace PK::Rendering::Batching
     using namespace PK::Rendering::Objects;
     using namespace PK::Math;
     
+    // Layout of the transforms in pk_InstancingMatrices. Float3x4 stores the first three rows of affine matrices & uploads 25% less data.
+    // Compact stores position, a half precision quaternion & half precision scale in 32 bytes. Matrices with shear are not representable.
+    enum class InstanceTransformFormat
+    {
+        Float4x4,
+        Float3x4,
+        Compact
+    };
+
     struct Drawcall
     {
         float4x4* localToWorld = nullptr;
@@ -22,6 +32,15 @@ namespace PK::Rendering::Batching
         uint index = 0;
     };
 
+    struct TransparentDrawcall
+    {
+        const Mesh* mesh = nullptr;
+        const Material* material = nullptr;
+        float4x4* localToWorld = nullptr;
+        float depth = 0.0f;
+        int submesh = 0;
+    };
+
     struct BatchBase
     {
         uint instancingOffset = 0;
@@ -31,13 +50,13 @@ namespace PK::Rendering::Batching
     struct MaterialBatch : BatchBase
     {
         const Material* material = nullptr;
-        std::vector<Drawcall> drawcalls;
+        FrameArray<Drawcall> drawcalls;
     };
 
     struct ShaderBatch : BatchBase
     {
         Ref<ComputeBuffer> instancedData;
-        std::vector<uint> materialBatches;
+        FrameArray<uint> materialBatches;
         uint materialBatchCount = 0;
         int submesh = 0;
     };
@@ -45,20 +64,21 @@ namespace PK::Rendering::Batching
     struct MeshBatch : BatchBase
     {
         const Mesh* mesh = nullptr;
-        std::vector<uint> shaderBatches;
+        FrameArray<uint> shaderBatches;
         uint shaderBatchCount = 0;
+        float minDepth = 0.0f;
     };
 
     struct MeshOnlyBatch : BatchBase
     {
         const Mesh* mesh = nullptr;
-        std::vector<Drawcall> drawcalls;
+        FrameArray<Drawcall> drawcalls;
     };
 
     struct IndexedMeshBatch : BatchBase
     {
         const Mesh* mesh = nullptr;
-        std::vector<DrawcallIndexed> drawcalls;
+        FrameArray<DrawcallIndexed> drawcalls;
     };
 
     struct DynamicBatchCollection
@@ -68,9 +88,18 @@ namespace PK::Rendering::Batching
         std::vector<MeshBatch> MeshBatches;
         std::unordered_map<ulong, uint> BatchMap;
 
+        // Mesh batch indices ordered front to back by their nearest draw. Built by UpdateBuffers.
+        FrameArray<uint> OpaqueOrder;
+        uint OpaqueBatchCount = 0;
+
+        // Not instanced so that blending order is kept. Sorted back to front by UpdateBuffers.
+        FrameArray<TransparentDrawcall> TransparentDrawcalls;
+        uint TransparentDrawCallCount = 0;
+
         // @TODO Consider using persistently mapped triple buffering instead
         Ref<ComputeBuffer> MatrixBuffer;
         Ref<ComputeBuffer> PropertyIndices;
+        // Instanced opaque draws only.
         uint TotalDrawCallCount = 0;
     };
 
@@ -91,19 +120,37 @@ namespace PK::Rendering::Batching
         uint TotalDrawCallCount = 0;
     };
 
+    // Applies to buffers updated after the call. Set once at startup rather than between updating & drawing a collection.
+    void SetInstanceTransformFormat(InstanceTransformFormat format);
+    InstanceTransformFormat GetInstanceTransformFormat();
+    // Unknown names keep the fallback format.
+    InstanceTransformFormat GetInstanceTransformFormatFromString(const std::string& name, InstanceTransformFormat fallback);
+    const char* GetInstanceTransformFormatName(InstanceTransformFormat format);
+
+    // Encodes the transforms of the draws in the active format. Destination must be 16 byte aligned.
+    void WriteInstanceTransforms(float* destination, const Drawcall* drawcalls, uint count);
+    // Cpu reference of the decoding in Instancing.glsl.
+    float4x4 ReadInstanceTransform(const float* source);
+
     void ResetCollection(DynamicBatchCollection* collection);
     void ResetCollection(MeshBatchCollection* collection);
     void ResetCollection(IndexedMeshBatchCollection* collection);
     
+    // Drawcall depth orders the draw within the queue of the material.
     void QueueDraw(DynamicBatchCollection* collection, const Mesh* mesh, int submesh, const Material* material, const Drawcall& drawcall);
     void QueueDraw(MeshBatchCollection* collection, const Mesh* mesh, const Drawcall& drawcall);
     void QueueDraw(IndexedMeshBatchCollection* collection, const Mesh* mesh, const DrawcallIndexed& drawcall);
 
+    // Appends the draws of a collection built elsewhere (e.g. on a worker thread). indexMask is or'ed into the draw indices.
+    // Only draws whose clip index has its bit set in clipMask are appended.
+    void MergeCollection(IndexedMeshBatchCollection* collection, const IndexedMeshBatchCollection* source, uint indexMask, uint clipMask);
+
     void UpdateBuffers(DynamicBatchCollection* collection);
     void UpdateBuffers(MeshBatchCollection* collection);
     void UpdateBuffers(IndexedMeshBatchCollection* collection);
 
     void DrawBatches(DynamicBatchCollection* collection);
+    void DrawTransparent(DynamicBatchCollection* collection);
     void DrawBatches(DynamicBatchCollection* collection, const Material* overrideMaterial);
     void DrawBatches(DynamicBatchCollection* collection, Shader* overrideShader, const ShaderPropertyBlock& propertyBlock);
     void DrawBatches(DynamicBatchCollection* collection, Shader* overrideShader);
@@ -0,0 +1,237 @@
+#include "PrecompiledHeader.h"
+#include "ClusterLightAssignment.h"
+#include "Utilities/ThreadPool.h"
+#include <emmintrin.h>
+
+namespace PK::Rendering
+{
+	ClusterLightAssignment::ClusterLightAssignment(uint gridSizeX, uint gridSizeY, uint gridSizeZ, uint maxLightsPerCluster) :
+		m_gridSizeX(gridSizeX),
+		m_gridSizeY(gridSizeY),
+		m_gridSizeZ(gridSizeZ),
+		m_maxLightsPerCluster(maxLightsPerCluster)
+	{
+		m_sliceIndices.resize(gridSizeZ);
+		m_lightTiles.resize((size_t)gridSizeX * gridSizeY * gridSizeZ);
+	}
+
+	void ClusterLightAssignment::Execute(const ClusterLight* lights,
+										 uint lightCount,
+										 const float4x4& worldToView,
+										 const float4x4& inverseProjection,
+										 float zNear,
+										 float zFar,
+										 const float* cascadeSplits,
+										 const float* tileMaxDepths,
+										 uint threadCount)
+	{
+		m_paddedLightCount = (lightCount + 3u) & ~3u;
+		m_positionX.resize(m_paddedLightCount);
+		m_positionY.resize(m_paddedLightCount);
+		m_positionZ.resize(m_paddedLightCount);
+		m_radius.resize(m_paddedLightCount);
+		m_directionX.resize(m_paddedLightCount);
+		m_directionY.resize(m_paddedLightCount);
+		m_directionZ.resize(m_paddedLightCount);
+		m_cosHalfAngle.resize(m_paddedLightCount);
+		m_sinHalfAngle.resize(m_paddedLightCount);
+		m_type.resize(m_paddedLightCount);
+
+		for (auto i = 0u; i < m_paddedLightCount; ++i)
+		{
+			if (i >= lightCount)
+			{
+				m_positionX[i] = m_positionY[i] = m_positionZ[i] = m_radius[i] = 0.0f;
+				m_directionX[i] = m_directionY[i] = m_directionZ[i] = 0.0f;
+				m_cosHalfAngle[i] = m_sinHalfAngle[i] = 0.0f;
+				m_type[i] = 0xFFFFFFFF;
+				continue;
+			}
+
+			auto& light = lights[i];
+			auto position = worldToView * float4(light.position, 1.0f);
+			auto direction = worldToView * float4(light.direction, 0.0f);
+			m_positionX[i] = position.x;
+			m_positionY[i] = position.y;
+			m_positionZ[i] = position.z;
+			m_radius[i] = light.radius;
+			m_directionX[i] = direction.x;
+			m_directionY[i] = direction.y;
+			m_directionZ[i] = direction.z;
+			m_cosHalfAngle[i] = glm::cos(light.angle * 0.5f);
+			m_sinHalfAngle[i] = glm::sin(light.angle * 0.5f);
+			m_type[i] = light.type;
+		}
+
+		SliceParams params;
+		params.inverseProjectionScale = { inverseProjection[0][0], inverseProjection[1][1] };
+		params.zNear = zNear;
+		params.zFar = zFar;
+		params.cascadeSplits[0] = cascadeSplits[1];
+		params.cascadeSplits[1] = cascadeSplits[2];
+		params.cascadeSplits[2] = cascadeSplits[3];
+		params.tileMaxDepths = tileMaxDepths;
+
+		threadCount = glm::clamp(threadCount, 1u, m_gridSizeZ);
+
+		if (threadCount == 1)
+		{
+			for (auto z = 0u; z < m_gridSizeZ; ++z)
+			{
+				ExecuteSlice(z, params);
+			}
+		}
+		else
+		{
+			SliceJobs jobs = { this, &params, threadCount };
+			auto* threadPool = Utilities::ThreadPool::GetShared();
+			Utilities::ThreadPool::Batch batch;
+			threadPool->Dispatch(ExecuteSliceJob, &jobs, threadCount, &batch);
+			threadPool->Wait(&batch);
+		}
+
+		// Offsets are assigned in slice order. The shader uses an atomic counter so its offsets are arbitrarily ordered. Tile contents are identical.
+		auto sliceSize = m_gridSizeX * m_gridSizeY;
+		auto offset = 0u;
+
+		for (auto z = 0u; z < m_gridSizeZ; ++z)
+		{
+			auto* tiles = m_lightTiles.data() + z * sliceSize;
+
+			for (auto i = 0u; i < sliceSize; ++i)
+			{
+				auto count = (tiles[i] >> 20u) & 0xFFu;
+				tiles[i] |= offset & 0xFFFFFu;
+				offset += count;
+			}
+		}
+
+		m_lightIndexCount = offset;
+		m_lightIndices.resize(offset);
+		offset = 0u;
+
+		for (auto z = 0u; z < m_gridSizeZ; ++z)
+		{
+			auto& indices = m_sliceIndices[z];
+			std::copy(indices.begin(), indices.end(), m_lightIndices.begin() + offset);
+			offset += (uint)indices.size();
+		}
+	}
+
+	void ClusterLightAssignment::ExecuteSliceJob(void* context, uint32_t index)
+	{
+		auto* jobs = reinterpret_cast<SliceJobs*>(context);
+
+		for (auto z = index; z < jobs->assignment->m_gridSizeZ; z += jobs->jobCount)
+		{
+			jobs->assignment->ExecuteSlice(z, *jobs->params);
+		}
+	}
+
+	void ClusterLightAssignment::ExecuteSlice(uint z, const SliceParams& params)
+	{
+		auto& indices = m_sliceIndices[z];
+		indices.clear();
+
+		auto cellNear = params.zNear * glm::pow(params.zFar / params.zNear, (float)z / m_gridSizeZ);
+		auto cellFarSlice = params.zNear * glm::pow(params.zFar / params.zNear, (z + 1.0f) / m_gridSizeZ);
+		auto invstep = float2(1.0f / m_gridSizeX, 1.0f / m_gridSizeY);
+
+		const auto zero = _mm_setzero_ps();
+		const auto signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		const auto allOnes = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		const auto typePoint = _mm_set1_epi32(0);
+		const auto typeSpot = _mm_set1_epi32(1);
+		const auto typeDirectional = _mm_set1_epi32(2);
+
+		for (auto y = 0u; y < m_gridSizeY; ++y)
+		{
+			for (auto x = 0u; x < m_gridSizeX; ++x)
+			{
+				auto tileIndex = x + y * m_gridSizeX;
+				auto maxFar = params.tileMaxDepths != nullptr ? params.tileMaxDepths[tileIndex] : params.zFar + 1.0f;
+				auto cellFar = glm::min(cellFarSlice, maxFar);
+				auto discardTile = cellNear > maxFar;
+
+				auto screenmin = float2(x, y) * invstep;
+				auto screenmax = float2(x + 1.0f, y + 1.0f) * invstep;
+				auto min00 = float3((screenmin * 2.0f - 1.0f) * params.inverseProjectionScale, 1.0f) * cellNear;
+				auto max00 = float3((screenmin * 2.0f - 1.0f) * params.inverseProjectionScale, 1.0f) * cellFar;
+				auto min11 = float3((screenmax * 2.0f - 1.0f) * params.inverseProjectionScale, 1.0f) * cellNear;
+				auto max11 = float3((screenmax * 2.0f - 1.0f) * params.inverseProjectionScale, 1.0f) * cellFar;
+
+				auto aabbmin = glm::min(glm::min(min00, max00), glm::min(min11, max11));
+				auto aabbmax = glm::max(glm::max(min00, max00), glm::max(min11, max11));
+				auto extents = (aabbmax - aabbmin) * 0.5f;
+				auto center = aabbmin + extents;
+				auto cellRadius = glm::length(extents);
+
+				auto cx = _mm_set1_ps(center.x);
+				auto cy = _mm_set1_ps(center.y);
+				auto cz = _mm_set1_ps(center.z);
+				auto ex = _mm_set1_ps(extents.x);
+				auto ey = _mm_set1_ps(extents.y);
+				auto ez = _mm_set1_ps(extents.z);
+				auto cr = _mm_set1_ps(cellRadius);
+				auto ncr = _mm_set1_ps(-cellRadius);
+
+				auto count = 0u;
+
+				for (auto i = 0u; i < m_paddedLightCount && !discardTile && count < m_maxLightsPerCluster; i += 4)
+				{
+					auto px = _mm_loadu_ps(m_positionX.data() + i);
+					auto py = _mm_loadu_ps(m_positionY.data() + i);
+					auto pz = _mm_loadu_ps(m_positionZ.data() + i);
+					auto pr = _mm_loadu_ps(m_radius.data() + i);
+					auto type = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_type.data() + i));
+
+					// Sphere vs aabb
+					auto dx = _mm_sub_ps(_mm_and_ps(_mm_sub_ps(px, cx), signMask), ex);
+					auto dy = _mm_sub_ps(_mm_and_ps(_mm_sub_ps(py, cy), signMask), ey);
+					auto dz = _mm_sub_ps(_mm_and_ps(_mm_sub_ps(pz, cz), signMask), ez);
+					auto inner = _mm_max_ps(_mm_min_ps(dx, zero), _mm_max_ps(_mm_min_ps(dy, zero), _mm_min_ps(dz, zero)));
+					auto r = _mm_sub_ps(pr, inner);
+					dx = _mm_max_ps(dx, zero);
+					dy = _mm_max_ps(dy, zero);
+					dz = _mm_max_ps(dz, zero);
+					auto distanceSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+					auto pointPass = _mm_and_ps(_mm_cmpgt_ps(pr, zero), _mm_cmple_ps(distanceSq, _mm_mul_ps(r, r)));
+
+					// Cone vs bounding sphere. Source: https://bartwronski.com/2017/04/13/cull-that-cone/
+					auto vx = _mm_sub_ps(cx, px);
+					auto vy = _mm_sub_ps(cy, py);
+					auto vz = _mm_sub_ps(cz, pz);
+					auto vlenSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+					auto v1len = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_loadu_ps(m_directionX.data() + i)),
+													   _mm_mul_ps(vy, _mm_loadu_ps(m_directionY.data() + i))),
+													   _mm_mul_ps(vz, _mm_loadu_ps(m_directionZ.data() + i)));
+					auto lateral = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(vlenSq, _mm_mul_ps(v1len, v1len)), zero));
+					auto distanceClosestPoint = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(m_cosHalfAngle.data() + i), lateral), _mm_mul_ps(v1len, _mm_loadu_ps(m_sinHalfAngle.data() + i)));
+					auto angleCull = _mm_cmpgt_ps(distanceClosestPoint, cr);
+					auto frontCull = _mm_cmpgt_ps(v1len, _mm_add_ps(cr, pr));
+					auto backCull = _mm_cmplt_ps(v1len, ncr);
+					auto spotPass = _mm_andnot_ps(_mm_or_ps(angleCull, _mm_or_ps(frontCull, backCull)), allOnes);
+
+					auto isPoint = _mm_castsi128_ps(_mm_cmpeq_epi32(type, typePoint));
+					auto isSpot = _mm_castsi128_ps(_mm_cmpeq_epi32(type, typeSpot));
+					auto isDirectional = _mm_castsi128_ps(_mm_cmpeq_epi32(type, typeDirectional));
+					auto pass = _mm_or_ps(_mm_and_ps(isPoint, pointPass), _mm_or_ps(_mm_and_ps(isSpot, _mm_and_ps(pointPass, spotPass)), isDirectional));
+					auto mask = (uint)_mm_movemask_ps(pass);
+
+					for (auto j = 0u; j < 4u && mask != 0u && count < m_maxLightsPerCluster; ++j)
+					{
+						if (mask & (1u << j))
+						{
+							indices.push_back(i + j);
+							++count;
+						}
+					}
+				}
+
+				auto depth = cellNear + (cellFar - cellNear) * 0.5f;
+				auto cascade = depth > params.cascadeSplits[0] ? depth > params.cascadeSplits[1] ? depth > params.cascadeSplits[2] ? 3u : 2u : 1u : 0u;
+				m_lightTiles[tileIndex + z * m_gridSizeX * m_gridSizeY] = ((count & 0xFFu) << 20u) | (cascade << 28u);
+			}
+		}
+	}
+}
\ No newline at end of file
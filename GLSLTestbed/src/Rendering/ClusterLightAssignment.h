@@ -0,0 +1,85 @@
+#pragma once
+#include "Core/NoCopy.h"
+#include <vector>
+#include <hlslmath.h>
+
+namespace PK::Rendering
+{
+    using namespace PK::Math;
+
+    // Cpu implementation of CS_ClusteredLightAssignment. Produces the same pk_GlobalLightsList & pk_LightTiles layout.
+    // Z slices are processed in parallel on the shared thread pool & lights are tested against clusters four at a time with sse.
+    class ClusterLightAssignment : public PK::Core::NoCopy
+    {
+        public:
+            struct ClusterLight
+            {
+                float3 position;
+                float radius;
+                float3 direction;
+                float angle;
+                uint type;
+            };
+
+            ClusterLightAssignment(uint gridSizeX, uint gridSizeY, uint gridSizeZ, uint maxLightsPerCluster);
+
+            void Execute(const ClusterLight* lights,
+                         uint lightCount,
+                         const float4x4& worldToView,
+                         const float4x4& inverseProjection,
+                         float zNear,
+                         float zFar,
+                         const float* cascadeSplits,
+                         const float* tileMaxDepths,
+                         uint threadCount);
+
+            inline const uint* GetLightIndices() const { return m_lightIndices.data(); }
+            inline uint GetLightIndexCount() const { return m_lightIndexCount; }
+            inline const uint* GetLightTiles() const { return m_lightTiles.data(); }
+            inline uint GetClusterCount() const { return m_gridSizeX * m_gridSizeY * m_gridSizeZ; }
+
+        private:
+            struct SliceParams
+            {
+                float2 inverseProjectionScale;
+                float zNear;
+                float zFar;
+                float cascadeSplits[3];
+                const float* tileMaxDepths;
+            };
+
+            // Each job processes every jobCount:th slice starting from its index.
+            struct SliceJobs
+            {
+                ClusterLightAssignment* assignment;
+                const SliceParams* params;
+                uint jobCount;
+            };
+
+            static void ExecuteSliceJob(void* context, uint32_t index);
+            void ExecuteSlice(uint z, const SliceParams& params);
+
+            const uint m_gridSizeX;
+            const uint m_gridSizeY;
+            const uint m_gridSizeZ;
+            const uint m_maxLightsPerCluster;
+
+            // View space lights as structure of arrays. Padded to a multiple of 4 with invalid lights.
+            uint m_paddedLightCount = 0;
+            std::vector<float> m_positionX;
+            std::vector<float> m_positionY;
+            std::vector<float> m_positionZ;
+            std::vector<float> m_radius;
+            std::vector<float> m_directionX;
+            std::vector<float> m_directionY;
+            std::vector<float> m_directionZ;
+            std::vector<float> m_cosHalfAngle;
+            std::vector<float> m_sinHalfAngle;
+            std::vector<uint> m_type;
+
+            std::vector<std::vector<uint>> m_sliceIndices;
+            std::vector<uint> m_lightTiles;
+            std::vector<uint> m_lightIndices;
+            uint m_lightIndexCount = 0;
+    };
+}
\ No newline at end of file
@@ -2,29 +2,98 @@
 #include "Culling.h"
 #include "ECS/Contextual/EntityViews/EntityViews.h"
 #include "Utilities/Utilities.h"
+#include "Core/Profiler.h"
+#include "Utilities/ThreadPool.h"
 
 namespace PK::Rendering::Culling
 {
-	void VisibilityCache::AddItem(CullingGroup group, ushort type, uint item)
+	// Below this many items per thread the cost of dispatching a job outweighs the culling work.
+	constexpr size_t MinParallelCullingItemCount = 4096;
+
+	void VisibilityCache::ThreadBuffer::Reserve(ushort flags, size_t count)
 	{
-		auto key = ((uint)type << 16) | ((uint)group & 0xFFFF);
-		auto& vis = m_visibilityLists[key];
-		Utilities::PushVectorElementRef(vis.list, &vis.count, item);
+		for (uint bits = flags; bits != 0; bits &= bits - 1)
+		{
+			auto index = glm::findLSB(bits);
+			lists[index].ValidateSize(count, 0);
+		}
 	}
 
-	void VisibilityCache::Reset()
+	void VisibilityCache::ThreadBuffer::AddItem(ushort flags, ECS::EGID item)
 	{
-		for (auto& kv : m_visibilityLists)
+		for (uint bits = flags; bits != 0; bits &= bits - 1)
 		{
-			kv.second.count = 0;
+			auto index = glm::findLSB(bits);
+			lists[index].Push(item, counts + index);
 		}
 	}
 
-	void Culling::ExecuteOnVisibleItemsCubeFaces(PK::ECS::EntityDatabase* entityDb, const BoundingBox& aabb, ushort typeMask, OnVisibleItemMulti onvisible, void* context)
+	void VisibilityCache::AddItem(CullingGroup group, ushort flags, ECS::EGID item)
+	{
+		auto* lists = m_lists[(uint)group];
+		auto* counts = m_counts[(uint)group];
+
+		for (uint bits = flags; bits != 0; bits &= bits - 1)
+		{
+			auto index = glm::findLSB(bits);
+			lists[index].Push(item, counts + index);
+		}
+	}
+
+	void VisibilityCache::Merge(CullingGroup group, const ThreadBuffer& buffer)
+	{
+		for (auto i = 0u; i < FlagCount; ++i)
+		{
+			if (buffer.counts[i] == 0)
+			{
+				continue;
+			}
+
+			auto& list = m_lists[(uint)group][i];
+			auto& count = m_counts[(uint)group][i];
+			list.ValidateSize((size_t)count + buffer.counts[i], count);
+			memcpy(list.data() + count, buffer.lists[i].data(), sizeof(ECS::EGID) * buffer.counts[i]);
+			count += buffer.counts[i];
+		}
+	}
+
+	void VisibilityCache::Reset()
+	{
+		memset(m_counts, 0, sizeof(m_counts));
+	}
+
+	static void GetCubeFaceVisibility(const float3& aabbcenter, const BoundingBox& bounds, bool* vis)
 	{
 		const float3 planeNormals[] = { {-1,1,0}, {1,1,0}, {1,0,1}, {1,0,-1}, {0,1,1}, {0,-1,1} };
 		const float3 absPlaneNormals[] = { {1,1,0}, {1,1,0}, {1,0,1}, {1,0,1}, {0,1,1}, {0,1,1} };
 
+		auto center = bounds.GetCenter() - aabbcenter;
+		auto extents = bounds.GetExtents();
+
+		bool rp[6];
+		bool rn[6];
+
+		// Source: https://newq.net/dl/pub/s2015_shadows.pdf
+		for (uint j = 0; j < 6; ++j)
+		{
+			auto dist = glm::dot(center, planeNormals[j]);
+			auto radius = glm::dot(extents, absPlaneNormals[j]);
+			rp[j] = dist > -radius;
+			rn[j] = dist < radius;
+		}
+
+		vis[0] = rn[0] && rp[1] && rp[2] && rp[3] && bounds.max.x > aabbcenter.x;
+		vis[1] = rp[0] && rn[1] && rn[2] && rn[3] && bounds.min.x < aabbcenter.x;
+
+		vis[2] = rp[0] && rp[1] && rp[4] && rn[5] && bounds.max.y > aabbcenter.y;
+		vis[3] = rn[0] && rn[1] && rn[4] && rp[5] && bounds.min.y < aabbcenter.y;
+
+		vis[4] = rp[2] && rn[3] && rp[4] && rp[5] && bounds.max.z > aabbcenter.z;
+		vis[5] = rn[2] && rp[3] && rn[4] && rn[5] && bounds.min.z < aabbcenter.z;
+	}
+
+	void Culling::ExecuteOnVisibleItemsCubeFaces(PK::ECS::EntityDatabase* entityDb, const BoundingBox& aabb, ushort typeMask, OnVisibleItemMulti onvisible, void* context)
+	{
 		auto aabbcenter = aabb.GetCenter();
 
 		auto cullables = entityDb->Query<ECS::EntityViews::BaseRenderable>((int)ECS::ENTITY_GROUPS::ACTIVE);
@@ -38,30 +107,8 @@ namespace PK::Rendering::Culling
 				continue;
 			}
 
-			auto center = cullable->bounds->worldAABB.GetCenter() - aabbcenter;
-			auto extents = cullable->bounds->worldAABB.GetExtents();
-
-			bool rp[6];
-			bool rn[6];
 			bool vis[6];
-
-			// Source: https://newq.net/dl/pub/s2015_shadows.pdf
-			for (uint j = 0; j < 6; ++j)
-			{
-				auto dist = glm::dot(center, planeNormals[j]);
-				auto radius = glm::dot(extents, absPlaneNormals[j]);
-				rp[j] = dist > -radius;
-				rn[j] = dist < radius;
-			}
-
-			vis[0] = rn[0] && rp[1] && rp[2] && rp[3] && cullable->bounds->worldAABB.max.x > aabbcenter.x;
-			vis[1] = rp[0] && rn[1] && rn[2] && rn[3] && cullable->bounds->worldAABB.min.x < aabbcenter.x;
-
-			vis[2] = rp[0] && rp[1] && rp[4] && rn[5] && cullable->bounds->worldAABB.max.y > aabbcenter.y;
-			vis[3] = rn[0] && rn[1] && rn[4] && rp[5] && cullable->bounds->worldAABB.min.y < aabbcenter.y;
-
-			vis[4] = rp[2] && rn[3] && rp[4] && rp[5] && cullable->bounds->worldAABB.max.z > aabbcenter.z;
-			vis[5] = rn[2] && rp[3] && rn[4] && rn[5] && cullable->bounds->worldAABB.min.z < aabbcenter.z;
+			GetCubeFaceVisibility(aabbcenter, cullable->bounds->worldAABB, vis);
 
 			for (uint j = 0; j < 6; ++j)
 			{
@@ -104,7 +151,7 @@ namespace PK::Rendering::Culling
 
 	void Culling::ExecuteOnVisibleItemsCascades(PK::ECS::EntityDatabase* entityDb, const float4x4* cascades, uint count, ushort typeMask, OnVisibleItemMulti onvisible, void* context)
 	{
-		FrustumPlanes* frustums = PK_STACK_ALLOC(FrustumPlanes, count);
+		auto* frustums = Utilities::FrameAllocator::Allocate<FrustumPlanes>(count);
 
 		for (auto i = 0u; i < count; ++i)
 		{
@@ -135,6 +182,87 @@ namespace PK::Rendering::Culling
 		}
 	}
 
+	void Culling::ExecuteOnVisibleItemsVolumes(PK::ECS::EntityDatabase* entityDb, const CullingVolume* volumes, uint count, ushort typeMask, OnVisibleItemVolume onvisible, void* context, uint* rejectedCounts)
+	{
+		auto cullables = entityDb->Query<ECS::EntityViews::BaseRenderable>((int)ECS::ENTITY_GROUPS::ACTIVE);
+
+		for (auto i = 0; i < cullables.count; ++i)
+		{
+			auto cullable = &cullables[i];
+
+			if (((ushort)cullable->handle->flags & typeMask) != typeMask)
+			{
+				continue;
+			}
+
+			auto& bounds = cullable->bounds->worldAABB;
+
+			for (auto j = 0u; j < count; ++j)
+			{
+				auto& volume = volumes[j];
+
+				// The caster hull is only tested for items inside of the light volume so that rejections are not overcounted.
+				auto hullTested = volume.casterPlaneCount == 0 || !cullable->handle->isCullable;
+
+				switch (volume.type)
+				{
+					case CullingVolumeType::CubeFaces:
+					{
+						if (!Functions::IntersectAABB(volume.aabb, bounds))
+						{
+							break;
+						}
+
+						if (!hullTested && !Functions::IntersectPlanesAABB(volume.casterPlanes, volume.casterPlaneCount, bounds))
+						{
+							++rejectedCounts[j];
+							break;
+						}
+
+						bool vis[6];
+						GetCubeFaceVisibility(volume.aabb.GetCenter(), bounds, vis);
+
+						for (uint k = 0; k < 6; ++k)
+						{
+							auto isVisible = !cullable->handle->isCullable || vis[k];
+
+							if (isVisible)
+							{
+								onvisible(entityDb, cullable->GID, j, k, 0.0f, context);
+							}
+						}
+						break;
+					}
+					case CullingVolumeType::Frustum:
+					case CullingVolumeType::Cascades:
+					{
+						for (auto k = 0u; k < volume.frustumCount; ++k)
+						{
+							auto isVisible = !cullable->handle->isCullable || Functions::IntersectPlanesAABB(volume.frustums[k].planes, 6, bounds);
+
+							if (isVisible && !hullTested)
+							{
+								hullTested = true;
+
+								if (!Functions::IntersectPlanesAABB(volume.casterPlanes, volume.casterPlaneCount, bounds))
+								{
+									++rejectedCounts[j];
+									break;
+								}
+							}
+
+							if (isVisible)
+							{
+								onvisible(entityDb, cullable->GID, j, k, Functions::PlaneDistanceToAABB(volume.frustums[k].planes[4], bounds), context);
+							}
+						}
+						break;
+					}
+				}
+			}
+		}
+	}
+
 	void Culling::ExecuteOnVisibleItemsAABB(PK::ECS::EntityDatabase* entityDb, const BoundingBox& aabb, ushort typeMask, OnVisibleItem onvisible, void* context)
 	{
 		auto cullables = entityDb->Query<ECS::EntityViews::BaseRenderable>((int)ECS::ENTITY_GROUPS::ACTIVE);
@@ -181,33 +309,77 @@ namespace PK::Rendering::Culling
 		}
 	}
 
-	void Culling::BuildVisibilityCacheFrustum(PK::ECS::EntityDatabase* entityDb, VisibilityCache* cache, const float4x4& matrix, CullingGroup group, ushort typeMask)
+	template<typename TOnVisible>
+	static void CullFrustumRange(Core::BufferView<ECS::EntityViews::BaseRenderable> cullables, size_t begin, size_t end, const FrustumPlanes& frustum, ushort typeMask, TOnVisible onVisible)
 	{
-		FrustumPlanes frustrum;
-		Functions::ExtractFrustrumPlanes(matrix, &frustrum, true);
-
-		auto cullables = entityDb->Query<ECS::EntityViews::BaseRenderable>((int)ECS::ENTITY_GROUPS::ACTIVE);
-
-		for (auto i = 0; i < cullables.count; ++i)
+		for (auto i = begin; i < end; ++i)
 		{
 			auto cullable = &cullables[i];
-			auto maskedFlags = (ushort)cullable->handle->flags & typeMask;
+			auto maskedFlags = (ushort)((ushort)cullable->handle->flags & typeMask);
 
 			if (!maskedFlags)
 			{
 				continue;
 			}
 
-			auto isVisible = !cullable->handle->isCullable || Functions::IntersectPlanesAABB(frustrum.planes, 6, cullable->bounds->worldAABB);
+			auto isVisible = !cullable->handle->isCullable || Functions::IntersectPlanesAABB(frustum.planes, 6, cullable->bounds->worldAABB);
 			cullable->handle->isVisible |= isVisible;
 
 			if (isVisible)
 			{
-				cache->AddItem(group, maskedFlags, cullable->GID.entityID());
+				onVisible(maskedFlags, cullable->GID);
 			}
 		}
 	}
 
+	struct FrustumCullingJobs
+	{
+		Core::BufferView<ECS::EntityViews::BaseRenderable> cullables;
+		const FrustumPlanes* frustum;
+		VisibilityCache::ThreadBuffer* buffers;
+		size_t rangeSize;
+		ushort typeMask;
+	};
+
+	static void ExecuteFrustumCullingJob(void* context, uint32_t index)
+	{
+		PK_PROFILE_SCOPE("FrustumCullingWorker");
+		auto* jobs = reinterpret_cast<FrustumCullingJobs*>(context);
+		auto begin = jobs->rangeSize * index;
+		auto end = begin + jobs->rangeSize < jobs->cullables.count ? begin + jobs->rangeSize : jobs->cullables.count;
+		auto* buffer = jobs->buffers + index;
+		buffer->Reserve(jobs->typeMask, end - begin);
+		CullFrustumRange(jobs->cullables, begin, end, *jobs->frustum, jobs->typeMask, [buffer](ushort flags, ECS::EGID egid) { buffer->AddItem(flags, egid); });
+	}
+
+	void Culling::BuildVisibilityCacheFrustum(PK::ECS::EntityDatabase* entityDb, VisibilityCache* cache, const float4x4& matrix, CullingGroup group, ushort typeMask)
+	{
+		FrustumPlanes frustrum;
+		Functions::ExtractFrustrumPlanes(matrix, &frustrum, true);
+
+		auto cullables = entityDb->Query<ECS::EntityViews::BaseRenderable>((int)ECS::ENTITY_GROUPS::ACTIVE);
+		auto* threadPool = Utilities::ThreadPool::GetShared();
+		auto jobCount = (uint)glm::clamp(cullables.count / MinParallelCullingItemCount, (size_t)1u, (size_t)threadPool->GetThreadCount() + 1u);
+
+		if (jobCount <= 1)
+		{
+			CullFrustumRange(cullables, 0, cullables.count, frustrum, typeMask, [cache, group](ushort flags, ECS::EGID egid) { cache->AddItem(group, flags, egid); });
+			return;
+		}
+
+		// Each job culls a contiguous range into its own buffer. Merging the buffers in range order keeps the lists in entity order.
+		Utilities::FrameVector<VisibilityCache::ThreadBuffer> buffers(jobCount);
+		FrustumCullingJobs jobs = { cullables, &frustrum, buffers.data(), (cullables.count + jobCount - 1) / jobCount, typeMask };
+		Utilities::ThreadPool::Batch batch;
+		threadPool->Dispatch(ExecuteFrustumCullingJob, &jobs, jobCount, &batch);
+		threadPool->Wait(&batch);
+
+		for (auto& buffer : buffers)
+		{
+			cache->Merge(group, buffer);
+		}
+	}
+
 	void Culling::BuildVisibilityCacheAABB(PK::ECS::EntityDatabase* entityDb, VisibilityCache* cache, const BoundingBox& aabb, CullingGroup group, ushort typeMask)
 	{
 		auto cullables = entityDb->Query<ECS::EntityViews::BaseRenderable>((int)ECS::ENTITY_GROUPS::ACTIVE);
@@ -215,8 +387,9 @@ namespace PK::Rendering::Culling
 		for (auto i = 0; i < cullables.count; ++i)
 		{
 			auto cullable = &cullables[i];
+			auto maskedFlags = (ushort)((ushort)cullable->handle->flags & typeMask);
 
-			if (!((ushort)cullable->handle->flags & typeMask))
+			if (!maskedFlags)
 			{
 				continue;
 			}
@@ -226,7 +399,7 @@ namespace PK::Rendering::Culling
 
 			if (isVisible)
 			{
-				cache->AddItem(group, (ushort)cullable->handle->flags, cullable->GID.entityID());
+				cache->AddItem(group, maskedFlags, cullable->GID);
 			}
 		}
 	}
@@ -1,6 +1,7 @@
 #pragma once
 #include "Core/BufferView.h"
 #include "ECS/EntityDatabase.h"
+#include "Utilities/FrameAllocator.h"
 #include <vector>
 #include <hlslmath.h>
 
@@ -12,41 +13,70 @@ namespace PK::Rendering::Culling
     {
         CameraFrustum,
         ShadowFrustum,
+        Count
     };
 
     typedef void (*OnVisibleItem)(ECS::EntityDatabase*, ECS::EGID, float depth, void*);
 
     typedef void (*OnVisibleItemMulti)(ECS::EntityDatabase*, ECS::EGID, uint clipIndex, float depth, void*);
 
+    typedef void (*OnVisibleItemVolume)(ECS::EntityDatabase*, ECS::EGID, uint volumeIndex, uint clipIndex, float depth, void*);
+
+    enum class CullingVolumeType : ushort
+    {
+        CubeFaces,
+        Frustum,
+        Cascades,
+    };
+
+    // Matches the per light tests of ExecuteOnVisibleItemsCubeFaces, Frustum & Cascades.
+    struct CullingVolume
+    {
+        static constexpr uint MaxFrustumCount = 4;
+        CullingVolumeType type = CullingVolumeType::Frustum;
+        BoundingBox aabb;
+        FrustumPlanes frustums[MaxFrustumCount];
+        uint frustumCount = 0;
+        // Optional convex hull that casters must also intersect. See Functions::GetShadowCasterCullingPlanes.
+        float4 casterPlanes[PK_MAX_SHADOW_CASTER_PLANES];
+        uint casterPlaneCount = 0;
+    };
+
+    // Visible items are listed once per set flag bit so that an item can be a member of several lists.
+    // Lists are contiguous spans of entity ids indexed by (group, flag bit).
     class VisibilityCache
     {
-        private:
-            struct VisibilityList
+        public:
+            static constexpr uint GroupCount = (uint)CullingGroup::Count;
+            static constexpr uint FlagCount = sizeof(ushort) * 8;
+
+            // Append buffer of a single culling thread. Merged in submission order so that the lists do not depend on thread timing.
+            struct ThreadBuffer
             {
-                std::vector<uint> list;
-                size_t count = 0;
+                Utilities::FrameArray<ECS::EGID> lists[FlagCount];
+                uint counts[FlagCount] = {};
+
+                void Reserve(ushort flags, size_t count);
+                void AddItem(ushort flags, ECS::EGID item);
             };
 
-        public:
-            void AddItem(CullingGroup group, ushort type, uint item);
+            void AddItem(CullingGroup group, ushort flags, ECS::EGID item);
+
+            void Merge(CullingGroup group, const ThreadBuffer& buffer);
             
             void Reset();
 
-            Core::BufferView<uint> GetList(CullingGroup group, ushort type)
+            // Flag is expected to be a single bit.
+            inline Core::BufferView<ECS::EGID> GetList(CullingGroup group, ushort flag)
             {
-                auto key = (uint)type << 16 | (uint)group & 0xFFFF;
-
-                if (m_visibilityLists.count(key))
-                {
-                    auto& element = m_visibilityLists.at(key);
-                    return { element.list.data(), element.count };
-                }
-
-                return { nullptr, 0 };
+                PK_CORE_ASSERT(flag != 0 && (flag & (flag - 1)) == 0, "Visibility lists are indexed by a single flag bit!");
+                auto index = glm::findLSB((uint)flag);
+                return { m_lists[(uint)group][index].data(), m_counts[(uint)group][index] };
             }
 
-        private:            
-            std::map<uint, VisibilityList> m_visibilityLists;
+        private:
+            Utilities::FrameArray<ECS::EGID> m_lists[GroupCount][FlagCount];
+            uint m_counts[GroupCount][FlagCount] = {};
     };
 
     void ExecuteOnVisibleItemsCubeFaces(PK::ECS::EntityDatabase* entityDb, const BoundingBox& aabb, ushort typeMask, OnVisibleItemMulti onvisible, void* context);
@@ -55,6 +85,10 @@ namespace PK::Rendering::Culling
     
     void ExecuteOnVisibleItemsCascades(PK::ECS::EntityDatabase* entityDb, const float4x4* cascades, uint count, ushort typeMask, OnVisibleItemMulti onvisible, void* context);
 
+    // Tests every entity against all volumes in a single pass over the entities. Items inside of a volume that were rejected by its caster planes are added to the rejected count of the volume.
+    // Does not write render handle visibility so that several calls can run in parallel. Callers mark the visible items once they have finished.
+    void ExecuteOnVisibleItemsVolumes(PK::ECS::EntityDatabase* entityDb, const CullingVolume* volumes, uint count, ushort typeMask, OnVisibleItemVolume onvisible, void* context, uint* rejectedCounts);
+
     void ExecuteOnVisibleItemsAABB(PK::ECS::EntityDatabase* entityDb, const BoundingBox& aabb, ushort typeMask, OnVisibleItem onvisible, void* context);
 
     void ExecuteOnVisibleItemsSphere(PK::ECS::EntityDatabase* entityDb, const float3& center, float radius, ushort typeMask, OnVisibleItem onvisible, void* context);
@@ -0,0 +1,30 @@
+#include "PrecompiledHeader.h"
+#include "Rendering/CullingStep.h"
+#include "Rendering/FrameSetup.h"
+#include "ECS/Contextual/EntityViews/EntityViews.h"
+
+namespace PK::Rendering
+{
+	CullingStep::CullingStep(ECS::EntityDatabase* entityDb, uint occluderBufferWidth, uint occluderBufferHeight, uint occluderTriangleBudget) :
+		m_entityDb(entityDb),
+		m_occluderTriangleBudget(occluderTriangleBudget)
+	{
+		m_occluderBuffer.Resize(occluderBufferWidth, occluderBufferHeight);
+	}
+
+	void CullingStep::Step(int condition)
+	{
+		FrameSetup::CullCameraFrustum(m_entityDb, 
+			&m_visibilityCache, 
+			m_viewProjection, 
+			(ushort)(ECS::Components::RenderHandleFlags::Renderer | ECS::Components::RenderHandleFlags::Light | ECS::Components::RenderHandleFlags::Occluder));
+	
+		m_occluderBuffer.SetViewProjection(m_viewProjection);
+		m_occluderBuffer.Clear();
+
+		if (m_enableOccluderRasterization)
+		{
+			FrameSetup::RenderOccluders(m_entityDb, &m_visibilityCache, m_viewProjection, m_occluderTriangleBudget, &m_occluderQueue, &m_occluderBuffer);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+#include "ECS/Sequencer.h"
+#include "ECS/EntityDatabase.h"
+#include "Rendering/Culling.h"
+#include "Rendering/MaskedOcclusionBuffer.h"
+#include <vector>
+
+namespace PK::Rendering
+{
+    using namespace PK::Math;
+
+    // Camera frustum culling & occluder rasterization. A step of its own so that it can run on a worker while the pipeline prepares the frame.
+    // Owns every result it writes. Steps that read the results declare read access to this step. Entity visibilities are covered by the render handle components.
+    // Uses no graphics api. The view projection is set from the main thread before the step runs.
+    class CullingStep : public PK::ECS::ISimpleStep
+    {
+        public:
+            CullingStep(PK::ECS::EntityDatabase* entityDb, uint occluderBufferWidth, uint occluderBufferHeight, uint occluderTriangleBudget);
+
+            void Step(int condition) override;
+
+            inline void SetViewProjection(const float4x4& viewProjection) { m_viewProjection = viewProjection; }
+            inline void SetOccluderRasterization(bool value) { m_enableOccluderRasterization = value; }
+
+            inline Culling::VisibilityCache* GetVisibilityCache() { return &m_visibilityCache; }
+            // Null when no occluders were rasterized this frame.
+            inline const Culling::MaskedOcclusionBuffer* GetOccluders() const { return m_occluderBuffer.GetTriangleCount() > 0 ? &m_occluderBuffer : nullptr; }
+
+        private:
+            PK::ECS::EntityDatabase* m_entityDb;
+            uint m_occluderTriangleBudget;
+            bool m_enableOccluderRasterization = true;
+            float4x4 m_viewProjection = PK_FLOAT4X4_IDENTITY;
+            Culling::VisibilityCache m_visibilityCache;
+            Culling::MaskedOcclusionBuffer m_occluderBuffer;
+            std::vector<std::pair<float, uint>> m_occluderQueue;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include "PrecompiledHeader.h"
+#include "Rendering/FrameSetup.h"
+#include "Utilities/HashCache.h"
+#include "Core/Profiler.h"
+#include "ECS/Contextual/EntityViews/EntityViews.h"
+#include <algorithm>
+
+namespace PK::Rendering::FrameSetup
+{
+	using namespace PK::Utilities;
+
+	void CullCameraFrustum(ECS::EntityDatabase* entityDb, Culling::VisibilityCache* visibilityCache, const float4x4& viewProjection, ushort typeMask)
+	{
+		PK_PROFILE_SCOPE("FrustumCulling");
+		Culling::ResetEntityVisibilities(entityDb);
+		visibilityCache->Reset();
+		Culling::BuildVisibilityCacheFrustum(entityDb, visibilityCache, viewProjection, Culling::CullingGroup::CameraFrustum, typeMask);
+	}
+
+	void RenderOccluders(ECS::EntityDatabase* entityDb, 
+		Culling::VisibilityCache* visibilityCache, 
+		const float4x4& viewProjection, 
+		uint triangleBudget, 
+		std::vector<std::pair<float, uint>>* queue, 
+		Culling::MaskedOcclusionBuffer* buffer)
+	{
+		PK_PROFILE_SCOPE("OccluderRasterization");
+		auto occluders = visibilityCache->GetList(Culling::CullingGroup::CameraFrustum, (ushort)ECS::Components::RenderHandleFlags::Occluder);
+
+		queue->clear();
+
+		for (uint i = 0; i < occluders.count; ++i)
+		{
+			auto* renderable = entityDb->Query<ECS::EntityViews::BaseRenderable>(occluders[i]);
+			auto clip = viewProjection * float4(renderable->bounds->worldAABB.GetCenter(), 1.0f);
+			queue->push_back({ clip.w, i });
+		}
+
+		// Front to back so that near occluders fill the buffer before the budget runs out.
+		std::sort(queue->begin(), queue->end());
+
+		for (auto& item : *queue)
+		{
+			if (buffer->GetTriangleCount() >= triangleBudget)
+			{
+				break;
+			}
+
+			auto* view = entityDb->Query<ECS::EntityViews::MeshRenderable>(occluders[item.second]);
+			auto* mesh = view->mesh->sharedMesh;
+			auto& vertices = mesh->GetOccluderVertices();
+			auto& indices = mesh->GetOccluderIndices();
+			buffer->RenderOccluder(view->transform->localToWorld, vertices.data(), indices.data(), (uint)indices.size());
+		}
+	}
+
+	void BuildDynamicBatches(ECS::EntityDatabase* entityDb, 
+		Culling::VisibilityCache* visibilityCache, 
+		const Culling::DepthPyramid* occlusion, 
+		const Culling::MaskedOcclusionBuffer* occluders, 
+		const float4x4& viewProjection,
+		float pixelsPerUnit,
+		TextureStreamer* textureStreamer,
+		Batching::DynamicBatchCollection* batches,
+		ShadowCascadeReceivers* receivers)
+	{
+		PK_PROFILE_SCOPE("DynamicBatches");
+		Batching::ResetCollection(batches);
+
+		// Draw depth is the view depth of the bounds center. Used to order the render queues.
+		FrustumPlanes frustum;
+		Functions::ExtractFrustrumPlanes(viewProjection, &frustum, true);
+	
+		auto cullingResults = visibilityCache->GetList(Culling::CullingGroup::CameraFrustum, (ushort)ECS::Components::RenderHandleFlags::Renderer);
+	
+		for (uint i = 0; i < cullingResults.count; ++i)
+		{
+			auto& egid = cullingResults[i];
+			auto* renderable = entityDb->Query<ECS::EntityViews::BaseRenderable>(egid);
+			auto& aabb = renderable->bounds->worldAABB;
+
+			if (renderable->handle->isCullable && ((occlusion != nullptr && occlusion->IsOccluded(aabb)) || (occluders != nullptr && occluders->IsOccluded(aabb))))
+			{
+				continue;
+			}
+
+			auto* view = entityDb->Query<ECS::EntityViews::MeshRenderable>(egid);
+			auto* materials = &view->materials->sharedMaterials;
+			auto mesh = view->mesh->sharedMesh;
+			auto depth = Functions::PlaneDistanceToPoint(frustum.planes[4], aabb.GetCenter());
+			receivers->Add(aabb, depth);
+			// Texture streaming assumes that the uv range of a mesh spans its bounds.
+			auto screenSize = 2.0f * glm::length(aabb.GetExtents()) * pixelsPerUnit / (depth > 1e-4f ? depth : 1e-4f);
+	
+			for (auto submesh = 0u; submesh < (uint)materials->size(); ++submesh)
+			{
+				Batching::QueueDraw(batches, mesh, submesh, materials->at(submesh), { &view->transform->localToWorld, depth });
+
+				if (textureStreamer != nullptr)
+				{
+					textureStreamer->ReportMaterialUsage(materials->at(submesh), screenSize);
+				}
+			}
+		}
+	
+		Batching::UpdateBuffers(batches);
+	}
+
+	void PreprocessLights(LightsManager* lightsManager, 
+		ECS::EntityDatabase* entityDb, 
+		Culling::VisibilityCache* visibilityCache, 
+		const Structs::ShaderPropertyBlock& frameProperties, 
+		const uint2& resolution, 
+		ShadowCascadeReceivers* receivers)
+	{
+		auto* hashCache = HashCache::Get();
+		const float4x4& inverseViewProjection = *frameProperties.GetPropertyPtr<float4x4>(hashCache->pk_MATRIX_I_VP);
+		const float4x4& inverseProjection = *frameProperties.GetPropertyPtr<float4x4>(hashCache->pk_MATRIX_I_P);
+		const float4x4& worldToView = *frameProperties.GetPropertyPtr<float4x4>(hashCache->pk_MATRIX_V);
+		const float4 projParams = *frameProperties.GetPropertyPtr<float4>(hashCache->pk_ProjectionParams);
+
+		lightsManager->Preprocess(
+			entityDb, 
+			visibilityCache->GetList(Culling::CullingGroup::CameraFrustum, (ushort)ECS::Components::RenderHandleFlags::Light), 
+			resolution, 
+			worldToView, 
+			inverseProjection, 
+			inverseViewProjection, 
+			projParams.x, 
+			projParams.y,
+			receivers);
+	}
+}
\ No newline at end of file
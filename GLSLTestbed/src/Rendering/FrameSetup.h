@@ -0,0 +1,47 @@
+#pragma once
+#include "ECS/EntityDatabase.h"
+#include "Rendering/Structs/ShaderPropertyBlock.h"
+#include "Rendering/Batching.h"
+#include "Rendering/Culling.h"
+#include "Rendering/OcclusionCulling.h"
+#include "Rendering/MaskedOcclusionBuffer.h"
+#include "Rendering/LightsManager.h"
+#include "Rendering/TextureStreamer.h"
+#include <vector>
+
+// Cpu side of a frame between culling & drawing. Shared by RenderPipeline & the benchmark so that both measure & run the same code.
+// Uses no graphics api.
+namespace PK::Rendering::FrameSetup
+{
+    using namespace PK::Math;
+
+    void CullCameraFrustum(ECS::EntityDatabase* entityDb, Culling::VisibilityCache* visibilityCache, const float4x4& viewProjection, ushort typeMask);
+
+    // Rasterizes the visible occluders front to back until the triangle budget runs out.
+    void RenderOccluders(ECS::EntityDatabase* entityDb, 
+        Culling::VisibilityCache* visibilityCache, 
+        const float4x4& viewProjection, 
+        uint triangleBudget, 
+        std::vector<std::pair<float, uint>>* queue, 
+        Culling::MaskedOcclusionBuffer* buffer);
+
+    // Queues the visible renderers that pass the optional occlusion tests & adds them to the cascade receivers.
+    // Material usage is reported to the texture streamer when one is given.
+    void BuildDynamicBatches(ECS::EntityDatabase* entityDb, 
+        Culling::VisibilityCache* visibilityCache, 
+        const Culling::DepthPyramid* occlusion, 
+        const Culling::MaskedOcclusionBuffer* occluders, 
+        const float4x4& viewProjection,
+        float pixelsPerUnit,
+        TextureStreamer* textureStreamer,
+        Batching::DynamicBatchCollection* batches,
+        ShadowCascadeReceivers* receivers);
+
+    // Camera matrices & clip planes are read from the per frame properties of the graphics context.
+    void PreprocessLights(LightsManager* lightsManager, 
+        ECS::EntityDatabase* entityDb, 
+        Culling::VisibilityCache* visibilityCache, 
+        const Structs::ShaderPropertyBlock& frameProperties, 
+        const uint2& resolution, 
+        ShadowCascadeReceivers* receivers);
+}
\ No newline at end of file
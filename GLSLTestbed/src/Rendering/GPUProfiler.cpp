@@ -0,0 +1,129 @@
+#include "PrecompiledHeader.h"
+#include "Rendering/GPUProfiler.h"
+
+namespace PK::Rendering::GPUProfiler
+{
+	constexpr uint32_t MaxScopeDepth = 16;
+
+	struct QueryFrame
+	{
+		GLuint queries[MaxScopesPerFrame * 2];
+		const char* names[MaxScopesPerFrame];
+		uint32_t depths[MaxScopesPerFrame];
+		uint32_t count = 0;
+	};
+
+	static QueryFrame s_frames[FrameLatency];
+	static uint32_t s_openScopes[MaxScopeDepth];
+	static uint32_t s_depth = 0;
+	static uint64_t s_frameIndex = 0;
+	static bool s_initialized = false;
+
+	static void ResolveFrame(QueryFrame& frame)
+	{
+		if (frame.count == 0)
+		{
+			return;
+		}
+
+		// Queries complete in submission order. If the last one is not available neither are the rest.
+		GLint isAvailable = GL_FALSE;
+		glGetQueryObjectiv(frame.queries[frame.count * 2 - 1], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+
+		if (isAvailable == GL_FALSE)
+		{
+			frame.count = 0;
+			return;
+		}
+
+		// Move the gpu timestamps to the cpu clock so that both timelines line up in captures.
+		GLint64 gpuTimestamp = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuTimestamp);
+		auto clockOffset = (int64_t)Core::Profiler::GetTimestamp() - (int64_t)gpuTimestamp;
+
+		for (auto i = 0u; i < frame.count; ++i)
+		{
+			GLuint64 begin = 0ull;
+			GLuint64 end = 0ull;
+			glGetQueryObjectui64v(frame.queries[i * 2 + 0], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(frame.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+
+			Core::Profiler::Sample sample;
+			sample.name = frame.names[i];
+			sample.depth = frame.depths[i];
+			sample.begin = (uint64_t)((int64_t)begin + clockOffset);
+			sample.end = (uint64_t)((int64_t)end + clockOffset);
+			sample.timeline = Core::Profiler::Timeline::GPU;
+			Core::Profiler::RecordSample(sample);
+		}
+
+		frame.count = 0;
+	}
+
+	void BeginFrame()
+	{
+		if (!s_initialized)
+		{
+			for (auto& frame : s_frames)
+			{
+				glGenQueries(MaxScopesPerFrame * 2, frame.queries);
+			}
+
+			s_initialized = true;
+		}
+
+		s_depth = 0;
+		ResolveFrame(s_frames[++s_frameIndex % FrameLatency]);
+	}
+
+	void BeginScope(const char* name)
+	{
+		auto& frame = s_frames[s_frameIndex % FrameLatency];
+
+		if (s_initialized && s_depth < MaxScopeDepth && frame.count < MaxScopesPerFrame)
+		{
+			auto index = frame.count++;
+			frame.names[index] = name;
+			frame.depths[index] = s_depth;
+			s_openScopes[s_depth] = index;
+			glQueryCounter(frame.queries[index * 2], GL_TIMESTAMP);
+		}
+		else if (s_depth < MaxScopeDepth)
+		{
+			s_openScopes[s_depth] = MaxScopesPerFrame;
+		}
+
+		s_depth++;
+	}
+
+	void EndScope()
+	{
+		if (s_depth == 0 || --s_depth >= MaxScopeDepth)
+		{
+			return;
+		}
+
+		auto index = s_openScopes[s_depth];
+
+		if (index < MaxScopesPerFrame)
+		{
+			glQueryCounter(s_frames[s_frameIndex % FrameLatency].queries[index * 2 + 1], GL_TIMESTAMP);
+		}
+	}
+
+	void Release()
+	{
+		if (!s_initialized)
+		{
+			return;
+		}
+
+		for (auto& frame : s_frames)
+		{
+			glDeleteQueries(MaxScopesPerFrame * 2, frame.queries);
+			frame.count = 0;
+		}
+
+		s_initialized = false;
+	}
+}
\ No newline at end of file
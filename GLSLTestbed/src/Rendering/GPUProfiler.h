@@ -0,0 +1,26 @@
+#pragma once
+#include "Core/Profiler.h"
+#include <glad/glad.h>
+
+// Gpu timestamp queries around render stages. Queries are resolved FrameLatency frames later & forwarded to the cpu profiler as gpu samples.
+// Results that are still unavailable at that point are dropped instead of stalling the pipeline.
+namespace PK::Rendering::GPUProfiler
+{
+    constexpr uint32_t FrameLatency = 4;
+    constexpr uint32_t MaxScopesPerFrame = 64;
+
+    void BeginFrame();
+    void BeginScope(const char* name);
+    void EndScope();
+    void Release();
+
+    class Scope : public PK::Core::NoCopy
+    {
+        public:
+            inline Scope(const char* name) { BeginScope(name); }
+            inline ~Scope() { EndScope(); }
+    };
+}
+
+#define PK_PROFILE_GPU_SCOPE(name) PK::Rendering::GPUProfiler::Scope PK_PROFILE_CONCAT(pk_profile_gpu_scope_, __LINE__)(name)
+#define PK_PROFILE_RENDER_SCOPE(name) PK_PROFILE_SCOPE(name); PK_PROFILE_GPU_SCOPE(name)
\ No newline at end of file
@@ -6,6 +6,9 @@
 namespace PK::Rendering::GraphicsAPI
 {
 	static GraphicsContext* m_currentContext;
+	static StateCacheCounters m_stateCacheCounters;
+	static bool m_stateCachingEnabled = true;
+	static bool m_stateValidationEnabled = false;
 	
 	static inline GraphicsContext* GetCurrentContext()
 	{
@@ -129,6 +132,20 @@ namespace PK::Rendering::GraphicsAPI
 		return currentProgram;
     }
 
+	void GraphicsAPI::SetStateCaching(bool enabled, bool validate)
+	{
+		m_stateCachingEnabled = enabled;
+		m_stateValidationEnabled = enabled && validate;
+	}
+
+	bool GraphicsAPI::IsStateCachingEnabled() { return m_stateCachingEnabled; }
+
+	bool GraphicsAPI::IsStateValidationEnabled() { return m_stateValidationEnabled; }
+
+	StateCacheCounters& GraphicsAPI::GetStateCacheCounters() { return m_stateCacheCounters; }
+
+	void GraphicsAPI::ResetStateCacheCounters() { m_stateCacheCounters = StateCacheCounters(); }
+
 	int GraphicsAPI::GetMemoryUsageKB()
 	{
 		#define GL_GPU_MEM_INFO_TOTAL_AVAILABLE_MEM_NVX 0x9048
@@ -349,13 +366,24 @@ namespace PK::Rendering::GraphicsAPI
 		{
 			auto& variant = shader->GetActiveVariant();
 
-			if (context->ActiveShader == variant)
+			if (context->ActiveShader != variant || !m_stateCachingEnabled)
+			{
+				context->ActiveShader = variant;
+				glUseProgram(variant->GetGraphicsID());
+				++m_stateCacheCounters.programBinds;
+			}
+			else
 			{
-				return;
+				++m_stateCacheCounters.programBindsElided;
+
+				if (m_stateValidationEnabled && GetActiveShaderProgramId() != (int)variant->GetGraphicsID())
+				{
+					++m_stateCacheCounters.validationFailures;
+					PK_CORE_LOG_WARNING("Skipped program bind does not match program state. expected: %u, bound: %i", variant->GetGraphicsID(), GetActiveShaderProgramId());
+				}
 			}
 
-			context->ActiveShader = variant;
-			glUseProgram(variant->GetGraphicsID());
+			// Fixed state is delta checked separately as the same program can be used with different attributes.
 			SetFixedStateAttributes(attributes);
 			return;
 		}
@@ -424,19 +452,9 @@ namespace PK::Rendering::GraphicsAPI
 
 		if (descriptor.shader != nullptr)
 		{
-			descriptor.shader->ResetKeywords();
-
-			if (descriptor.propertyBlock0 != nullptr)
-			{
-				descriptor.shader->SetKeywords(descriptor.propertyBlock0->GetKeywords());
-			}
-
-			descriptor.shader->SetKeywords(GLOBAL_KEYWORDS);
-
-			if (descriptor.propertyBlock1 != nullptr)
-			{
-				descriptor.shader->SetKeywords(descriptor.propertyBlock1->GetKeywords());
-			}
+			descriptor.shader->SetKeywords(descriptor.propertyBlock0 != nullptr ? descriptor.propertyBlock0->GetKeywords() : KeywordSet(),
+				GLOBAL_KEYWORDS,
+				descriptor.propertyBlock1 != nullptr ? descriptor.propertyBlock1->GetKeywords() : KeywordSet());
 
 			if (descriptor.attributes != nullptr)
 			{
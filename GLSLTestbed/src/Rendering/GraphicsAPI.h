@@ -14,6 +14,15 @@ namespace PK::Rendering::GraphicsAPI
 	using namespace Objects;
 	using namespace Structs;
 
+	struct StateCacheCounters
+	{
+		uint64_t programBinds = 0;
+		uint64_t programBindsElided = 0;
+		uint64_t uniformWrites = 0;
+		uint64_t uniformWritesElided = 0;
+		uint64_t validationFailures = 0;
+	};
+
 	void Initialize();
 	void Terminate();
 
@@ -31,6 +40,14 @@ namespace PK::Rendering::GraphicsAPI
 	int GetActiveShaderProgramId();
 	int GetMemoryUsageKB();
 
+	// Redundant program binds & uniform writes are skipped while caching is enabled.
+	// Validation reads skipped state back from the driver & counts mismatches. It stalls the pipeline so it is for debugging only.
+	void SetStateCaching(bool enabled, bool validate = false);
+	bool IsStateCachingEnabled();
+	bool IsStateValidationEnabled();
+	StateCacheCounters& GetStateCacheCounters();
+	void ResetStateCacheCounters();
+
 	void ResetResourceBindings();
 	void ClearGlobalProperties();
 	void SetGlobalFloat(uint32_t hashId, const float* values, uint32_t count = 1);
@@ -1,16 +1,13 @@
 #include "PrecompiledHeader.h"
 #include "Utilities/Utilities.h"
 #include "Utilities/HashCache.h"
+#include "Utilities/Log.h"
+#include "Rendering/GPUProfiler.h"
+#include "Utilities/ThreadPool.h"
 #include "LightsManager.h"
 
 namespace PK::Rendering
 {
-	struct ShadowmapContext
-	{
-		ShadowmapData* data;
-		uint index;
-	};
-
 	static int LightViewCompare(PK::ECS::EntityViews::LightRenderable* a, PK::ECS::EntityViews::LightRenderable* b)
 	{
 		if (a->light->castShadows < b->light->castShadows)
@@ -75,15 +72,75 @@ namespace PK::Rendering
 		}
 	}
 
-	static void OnCullVisibleShadowmap(ECS::EntityDatabase* entityDb, ECS::EGID egid, uint clipIndex, float depth, void* context)
+	static void OnCullVisibleShadowmap(ECS::EntityDatabase* entityDb, ECS::EGID egid, uint volumeIndex, uint clipIndex, float depth, void* context)
 	{
-		auto ctx = reinterpret_cast<ShadowmapContext*>(context);
+		auto job = reinterpret_cast<ShadowmapCullJob*>(context) + volumeIndex;
 		auto renderable = entityDb->Query<ECS::EntityViews::MeshRenderable>(egid);
-		auto index = (clipIndex << 24u) | ctx->index;
-		Batching::QueueDraw(&ctx->data->Batches, renderable->mesh->sharedMesh, { &renderable->transform->localToWorld, depth, index });
+		auto& hash = job->hashes[job->hashCount > 1 ? clipIndex : 0u];
+		hash = ShadowmapCache::Hash(hash, egid);
+		hash = ShadowmapCache::Hash(hash, clipIndex);
+		hash = ShadowmapCache::Hash(hash, renderable->mesh->sharedMesh);
+		hash = ShadowmapCache::Hash(hash, renderable->transform->localToWorld);
+		++job->drawCount;
+
+		// Clips of the same caster are reported consecutively.
+		if (job->visibleCasterCount == 0 || !(job->visibleCasters[job->visibleCasterCount - 1] == egid))
+		{
+			job->visibleCasters.Push(egid, &job->visibleCasterCount);
+		}
+
+		Batching::QueueDraw(&job->batches, renderable->mesh->sharedMesh, { &renderable->transform->localToWorld, depth, (clipIndex << 24u) | job->lightIndex });
+	}
+
+	struct ShadowCasterCullingJobs
+	{
+		ECS::EntityDatabase* entityDb;
+		ShadowmapCullJob* jobs;
+		const Culling::CullingVolume* volumes;
+		ushort cullingMask;
+	};
+
+	static void ExecuteShadowCasterCullingJob(void* context, uint32_t index)
+	{
+		PK_PROFILE_SCOPE("ShadowCasterCullingWorker");
+		auto* jobs = reinterpret_cast<ShadowCasterCullingJobs*>(context);
+		Culling::ExecuteOnVisibleItemsVolumes(jobs->entityDb, jobs->volumes + index, 1, jobs->cullingMask, OnCullVisibleShadowmap, jobs->jobs + index, &jobs->jobs[index].rejectedCount);
+	}
+
+	ShadowCascadeReceivers::ShadowCascadeReceivers(const ShadowCascades& cascadeSplits) : cascades(cascadeSplits)
+	{
+		for (auto& aabb : bounds)
+		{
+			aabb = BoundingBox(PK_FLOAT3_ONE * std::numeric_limits<float>().max(), -PK_FLOAT3_ONE * std::numeric_limits<float>().max());
+		}
+	}
+
+	void ShadowCascadeReceivers::Add(const BoundingBox& aabb, float depth)
+	{
+		// Matches the slices of Functions::GetShadowCascadeMatrices, which offsets the cascade planes from the near plane.
+		auto radius = glm::length(aabb.GetExtents());
+		auto minDepth = depth - radius;
+		auto maxDepth = depth + radius;
+
+		for (auto i = 0u; i < ShadowCascadeCache::MaxCascadeCount; ++i)
+		{
+			if (minDepth <= cascades.planes[i + 1] && maxDepth >= cascades.planes[i])
+			{
+				Functions::BoundsEncapsulate(bounds + i, aabb);
+			}
+		}
 	}
 
-	LightsManager::LightsManager(AssetDatabase* assetDatabase, const ApplicationConfig* config) : m_cascadeLinearity(config->CascadeLinearity), m_zcullLights(config->ZCullLights)
+	LightsManager::LightsManager(AssetDatabase* assetDatabase, const ApplicationConfig* config) : 
+		m_cascadeLinearity(config->CascadeLinearity), 
+		m_zcullLights(config->ZCullLights), 
+		m_cpuLightAssignment(config->EnableCPULightAssignment),
+		m_cacheShadowmaps(config->EnableShadowmapCaching),
+		m_singlePassShadowCulling(config->EnableSinglePassShadowCulling),
+		m_cullShadowCastersByCamera(config->EnableShadowCasterCameraCulling),
+		m_clusterAssignment(GridSizeX, GridSizeY, GridSizeZ, MaxLightsPerTile),
+		m_shadowmapCache(config->ShadowmapTileCount),
+		m_cascadeCache(ShadowmapData::BatchSize, config->ShadowmapTileSize, config->ShadowCascadeUpdateInterval, config->EnableStableShadowCascades)
 	{
 		m_computeLightAssignment = assetDatabase->Find<Shader>("CS_ClusteredLightAssignment");
 		m_computeDepthTiles = assetDatabase->Find<Shader>("CS_ClusteredDepthMax");
@@ -105,20 +162,24 @@ namespace PK::Rendering
 		m_shadowmapData.LightIndices[(int)LightType::Directional].maxBatchSize = 1;
 
 		auto descriptor = RenderTextureDescriptor();
-		descriptor.dimension = GL_TEXTURE_CUBE_MAP_ARRAY;
-		descriptor.resolution = { m_shadowmapCubeFaceSize, m_shadowmapCubeFaceSize, ShadowmapData::BatchSize };
-		descriptor.colorFormats = { GL_RG32F };
-		descriptor.depthFormat = GL_DEPTH_COMPONENT16;
 		descriptor.wrapmodex = GL_CLAMP_TO_EDGE;
 		descriptor.wrapmodey = GL_CLAMP_TO_EDGE;
 		descriptor.wrapmodez = GL_CLAMP_TO_EDGE;
-		m_shadowmapData.LightIndices[(int)LightType::Point].SceneRenderTarget = CreateRef<RenderTexture>(descriptor);
 
-		descriptor.dimension = GL_TEXTURE_2D_ARRAY;
-		descriptor.resolution = { m_shadowmapTileSize, m_shadowmapTileSize, ShadowmapData::BatchSize };
-		descriptor.colorFormats = { GL_RG32F };
-		descriptor.depthFormat = GL_DEPTH_COMPONENT16;
-		m_shadowmapData.LightIndices[(int)LightType::Directional].SceneRenderTarget = m_shadowmapData.LightIndices[(int)LightType::Spot].SceneRenderTarget = CreateRef<RenderTexture>(descriptor);
+		for (auto level = 0u; level < ShadowmapCache::LevelCount; ++level)
+		{
+			descriptor.dimension = GL_TEXTURE_CUBE_MAP_ARRAY;
+			descriptor.resolution = { m_shadowmapCubeFaceSize >> level, m_shadowmapCubeFaceSize >> level, ShadowmapData::BatchSize };
+			descriptor.colorFormats = { GL_RG32F };
+			descriptor.depthFormat = GL_DEPTH_COMPONENT16;
+			m_shadowmapData.LightIndices[(int)LightType::Point].SceneRenderTargets[level] = CreateRef<RenderTexture>(descriptor);
+
+			descriptor.dimension = GL_TEXTURE_2D_ARRAY;
+			descriptor.resolution = { m_shadowmapTileSize >> level, m_shadowmapTileSize >> level, ShadowmapData::BatchSize };
+			descriptor.colorFormats = { GL_RG32F };
+			descriptor.depthFormat = GL_DEPTH_COMPONENT16;
+			m_shadowmapData.LightIndices[(int)LightType::Directional].SceneRenderTargets[level] = m_shadowmapData.LightIndices[(int)LightType::Spot].SceneRenderTargets[level] = CreateRef<RenderTexture>(descriptor);
+		}
 
 		descriptor.dimension = GL_TEXTURE_2D_ARRAY;
 		descriptor.colorFormats = { GL_RG32F };
@@ -176,103 +237,304 @@ namespace PK::Rendering
 		return cascadeSplits;
 	}
 
-	void LightsManager::UpdateShadowmaps(ECS::EntityDatabase* entityDb, const float4x4& inverseViewProjection, float zNear, float zFar)
+	void LightsManager::CullShadowCasters(ECS::EntityDatabase* entityDb)
+	{
+		PK_PROFILE_SCOPE("ShadowCasterCulling");
+		const auto cullingMask = (ushort)(ECS::Components::RenderHandleFlags::Renderer | ECS::Components::RenderHandleFlags::ShadowCaster);
+		auto jobCount = m_shadowmapData.CullJobCount;
+		auto* jobs = m_shadowmapData.CullJobs.data();
+		auto* volumes = m_shadowmapData.CullVolumes.data();
+
+		if (jobCount == 0)
+		{
+			return;
+		}
+
+		if (m_singlePassShadowCulling)
+		{
+			auto* rejectedCounts = Utilities::FrameAllocator::Allocate<uint>(jobCount);
+			memset(rejectedCounts, 0, sizeof(uint) * jobCount);
+			Culling::ExecuteOnVisibleItemsVolumes(entityDb, volumes, jobCount, cullingMask, OnCullVisibleShadowmap, jobs, rejectedCounts);
+
+			for (auto i = 0u; i < jobCount; ++i)
+			{
+				jobs[i].rejectedCount = rejectedCounts[i];
+			}
+		}
+		else
+		{
+			// Jobs only read the view collection. Make sure it exists before they query it.
+			entityDb->Query<ECS::EntityViews::BaseRenderable>((int)ECS::ENTITY_GROUPS::ACTIVE);
+
+			// One job per light. Each writes only to its own cull job.
+			auto* threadPool = Utilities::ThreadPool::GetShared();
+			ShadowCasterCullingJobs cullingJobs = { entityDb, jobs, volumes, cullingMask };
+			Utilities::ThreadPool::Batch batch;
+			threadPool->Dispatch(ExecuteShadowCasterCullingJob, &cullingJobs, jobCount, &batch);
+			threadPool->Wait(&batch);
+		}
+
+		for (auto i = 0u; i < jobCount; ++i)
+		{
+			for (auto j = 0u; j < jobs[i].visibleCasterCount; ++j)
+			{
+				entityDb->Query<ECS::EntityViews::BaseRenderable>(jobs[i].visibleCasters[j])->handle->isVisible = true;
+			}
+		}
+	}
+
+	void LightsManager::LogShadowCasterCulling() const
+	{
+		auto drawCount = 0u;
+		auto rejectedCount = 0u;
+
+		for (auto i = 0u; i < m_shadowmapData.CullJobCount; ++i)
+		{
+			drawCount += m_shadowmapData.CullJobs[i].drawCount;
+			rejectedCount += m_shadowmapData.CullJobs[i].rejectedCount;
+		}
+
+		PK_CORE_LOG_HEADER("Shadow caster culling: %u lights, %u caster draws, %u casters rejected by the camera frustum (%s)", 
+			m_shadowmapData.CullJobCount, 
+			drawCount, 
+			rejectedCount, 
+			m_cullShadowCastersByCamera ? "enabled" : "disabled");
+	}
+
+	void LightsManager::UpdateShadowmaps(ECS::EntityDatabase* entityDb, const float4x4& inverseViewProjection)
 	{
-		m_properties.SetTexture(HashCache::Get()->_ShadowmapBatchCube, m_shadowmapData.LightIndices[(int)LightType::Point].SceneRenderTarget->GetColorBuffer(0)->GetGraphicsID());
-		m_properties.SetTexture(HashCache::Get()->_ShadowmapBatch0, m_shadowmapData.LightIndices[(int)LightType::Spot].SceneRenderTarget->GetColorBuffer(0)->GetGraphicsID());
+		PK_PROFILE_RENDER_SCOPE("Shadows");
 		m_properties.SetTexture(HashCache::Get()->_ShadowmapBatch1, m_shadowmapData.ShadowmapAtlas->GetColorBuffer(0)->GetGraphicsID());
+		m_shadowmapData.CullJobCount = 0;
 
-		float4 viewports[2] = 
+		// One culling job per shadowed light. All lights of the frame are culled at once before any of them are rendered.
+		for (auto typeIdx = 0; typeIdx < (int)LightType::TypeCount; ++typeIdx)
 		{
-			{0, 0, m_shadowmapCubeFaceSize, m_shadowmapCubeFaceSize},
-			{0, 0, m_shadowmapTileSize, m_shadowmapTileSize},
-		};
+			auto& typedata = m_shadowmapData.LightIndices[typeIdx];
 
-		auto cascadeSplits = GetCascadeZSplits(zNear, zFar);
-		const auto cullingMask = (ushort)(ECS::Components::RenderHandleFlags::Renderer | ECS::Components::RenderHandleFlags::ShadowCaster);
+			for (auto i = 0u; i < typedata.lightCount; ++i)
+			{
+				auto* lightview = typedata.lights[i].lightview;
+				auto jobIndex = m_shadowmapData.CullJobCount++;
+				Utilities::ValidateVectorSize(m_shadowmapData.CullJobs, m_shadowmapData.CullJobCount);
+				Utilities::ValidateVectorSize(m_shadowmapData.CullVolumes, m_shadowmapData.CullJobCount);
+
+				auto& job = m_shadowmapData.CullJobs[jobIndex];
+				auto& volume = m_shadowmapData.CullVolumes[jobIndex];
+				Batching::ResetCollection(&job.batches);
+				job.lightIndex = lightview->light->linearIndex & 0xFFFF;
+				job.drawCount = 0;
+				job.rejectedCount = 0;
+				job.visibleCasterCount = 0;
+				job.maxDistance = lightview->light->radius;
+				job.hashCount = 1u;
+				job.hashes[0] = ShadowmapCache::HashSeed;
+				job.hashes[0] = ShadowmapCache::Hash(job.hashes[0], lightview->transform->localToWorld);
+				job.hashes[0] = ShadowmapCache::Hash(job.hashes[0], lightview->light->radius);
+				job.hashes[0] = ShadowmapCache::Hash(job.hashes[0], lightview->light->angle);
+
+				switch ((LightType)typeIdx)
+				{
+					case LightType::Point:
+					{
+						volume.type = Culling::CullingVolumeType::CubeFaces;
+						volume.aabb = entityDb->Query<ECS::EntityViews::BaseRenderable>(lightview->GID)->bounds->worldAABB;
+						volume.frustumCount = 0;
+						break;
+					}
+					case LightType::Spot:
+					{
+						auto projection = Functions::GetPerspective(lightview->light->angle, 1.0f, 0.1f, lightview->light->radius) * lightview->transform->worldToLocal;
+						volume.type = Culling::CullingVolumeType::Frustum;
+						volume.frustumCount = 1;
+						Functions::ExtractFrustrumPlanes(projection, volume.frustums, true);
+						break;
+					}
+					case LightType::Directional:
+					{
+						// Solved when the light buffers were updated. Cascades that were not updated this frame keep their hash.
+						auto* cascades = m_cascadeCache.Find(lightview->GID.entityID());
+						auto baseHash = ShadowmapCache::Hash(job.hashes[0], cascades->depthRange);
+						job.maxDistance = cascades->depthRange;
+						job.hashCount = ShadowmapData::BatchSize;
+						volume.type = Culling::CullingVolumeType::Cascades;
+						volume.frustumCount = ShadowmapData::BatchSize;
+
+						for (auto j = 0u; j < ShadowmapData::BatchSize; ++j)
+						{
+							job.hashes[j] = ShadowmapCache::Hash(baseHash, cascades->matrices[j]);
+							Functions::ExtractFrustrumPlanes(cascades->matrices[j], volume.frustums + j, true);
+						}
+						break;
+					}
+				}
+
+				volume.casterPlaneCount = 0;
+
+				// Casters outside of the camera frustum extruded towards the light cannot shadow anything visible.
+				if (m_cullShadowCastersByCamera)
+				{
+					auto light = (LightType)typeIdx == LightType::Directional ?
+						float4(lightview->transform->rotation * -PK_FLOAT3_FORWARD, 0.0f) :
+						float4(lightview->transform->position, 1.0f);
 
-		GraphicsAPI::SetViewPorts(0, viewports, 2);
+					volume.casterPlaneCount = Functions::GetShadowCasterCullingPlanes(inverseViewProjection, light, volume.casterPlanes);
+				}
+			}
+		}
+
+		CullShadowCasters(entityDb);
+
+		auto jobIndex = 0u;
 
 		for (auto typeIdx = 0; typeIdx < (int)LightType::TypeCount; ++typeIdx)
 		{
 			auto& typedata = m_shadowmapData.LightIndices[typeIdx];
-			auto batchCount = (uint)std::ceil(typedata.viewCount / (float)typedata.maxBatchSize);
+			m_shadowmapData.DirtyLightCount = 0;
 
-			for (auto batch = 0u; batch < batchCount; ++batch)
+			// Lights whose tiles are up to date with the hash of their inputs are skipped.
+			for (auto i = 0u; i < typedata.lightCount; ++i, ++jobIndex)
 			{
-				auto batchSize = std::min(typedata.viewCount - batch * typedata.maxBatchSize, typedata.maxBatchSize);
-				auto tileCount = (batchSize * ShadowmapData::BatchSize) / typedata.maxBatchSize;
-				auto baseLightIndex = typedata.viewFirst + batch * typedata.maxBatchSize;
-				auto atlasIndex = m_visibleLights[baseLightIndex]->light->shadowmapIndex;
+				auto* lightview = typedata.lights[i].lightview;
+				auto& job = m_shadowmapData.CullJobs[jobIndex];
+				auto layerMask = (1u << job.hashCount) - 1u;
+
+				if (m_cacheShadowmaps)
+				{
+					layerMask = m_shadowmapCache.ValidateLayers(lightview->GID.entityID(), job.hashes, job.hashCount);
+				}
+				else if ((LightType)typeIdx == LightType::Directional)
+				{
+					// Cascades that were not due for an update keep their previous contents.
+					layerMask = m_cascadeCache.Find(lightview->GID.entityID())->dirtyMask;
+				}
+
+				if (layerMask == 0u)
+				{
+					continue;
+				}
+
+				m_shadowmapData.DirtyLights.Push(ShadowmapDirtyLight { lightview, typedata.lights[i].tile, jobIndex, layerMask }, &m_shadowmapData.DirtyLightCount);
+			}
+
+			// Lights in a batch share a scene target. Group them by atlas level.
+			std::stable_sort(m_shadowmapData.DirtyLights.begin(), m_shadowmapData.DirtyLights.begin() + m_shadowmapData.DirtyLightCount, [](const ShadowmapDirtyLight& a, const ShadowmapDirtyLight& b)
+			{
+				return a.tile.level < b.tile.level;
+			});
+
+			auto tilesPerLight = ShadowmapData::BatchSize / typedata.maxBatchSize;
+			auto batchSize = 0u;
+
+			for (auto baseLightIndex = 0u; baseLightIndex < m_shadowmapData.DirtyLightCount; baseLightIndex += batchSize)
+			{
+				auto level = m_shadowmapData.DirtyLights[baseLightIndex].tile.level;
+				auto tileSize = m_shadowmapTileSize >> level;
 				auto maxDistance = 0.0f;
+				batchSize = 1u;
 
-				Batching::ResetCollection(&m_shadowmapData.Batches);
+				while (batchSize < typedata.maxBatchSize && 
+					   baseLightIndex + batchSize < m_shadowmapData.DirtyLightCount && 
+					   m_shadowmapData.DirtyLights[baseLightIndex + batchSize].tile.level == level)
+				{
+					++batchSize;
+				}
 
-				for (uint i = 0; i < batchSize; ++i)
+				m_properties.SetTexture(HashCache::Get()->_ShadowmapBatchCube, m_shadowmapData.LightIndices[(int)LightType::Point].SceneRenderTargets[level]->GetColorBuffer(0)->GetGraphicsID());
+				m_properties.SetTexture(HashCache::Get()->_ShadowmapBatch0, m_shadowmapData.LightIndices[(int)LightType::Spot].SceneRenderTargets[level]->GetColorBuffer(0)->GetGraphicsID());
+
+				float4 viewports[2] = 
 				{
-					auto* lightview = m_visibleLights[baseLightIndex + i];
-					auto radius = lightview->light->radius;
-					auto baseKey = ((uint)i << 16u) | (lightview->light->linearIndex & 0xFFFF);
+					{0, 0, m_shadowmapCubeFaceSize >> level, m_shadowmapCubeFaceSize >> level},
+					{0, 0, tileSize, tileSize},
+				};
 
-					ShadowmapContext ctx = { &m_shadowmapData, baseKey };
+				GraphicsAPI::SetViewPorts(0, viewports, 2);
 
-					switch ((LightType)typeIdx)
-					{
-						case LightType::Point:
-						{
-							maxDistance = glm::max(maxDistance, radius);
-							auto bounds = entityDb->Query<ECS::EntityViews::BaseRenderable>(lightview->GID)->bounds->worldAABB;
-							Culling::ExecuteOnVisibleItemsCubeFaces(entityDb, bounds, cullingMask, OnCullVisibleShadowmap, &ctx);
-							break;
-						}
-						case LightType::Spot:
-						{
-							maxDistance = glm::max(maxDistance, radius);
-							auto projection = Functions::GetPerspective(lightview->light->angle, 1.0f, 0.1f, lightview->light->radius) * lightview->transform->worldToLocal;
-							Culling::ExecuteOnVisibleItemsFrustum(entityDb, projection, cullingMask, OnCullVisibleShadowmap, &ctx);
-							break;
-						}
-						case LightType::Directional:
-						{
-							float4x4 cascades[ShadowmapData::BatchSize];
-							auto lightRange = Functions::GetShadowCascadeMatrices(
-								lightview->transform->worldToLocal, 
-								inverseViewProjection, 
-								cascadeSplits.planes,
-								-lightview->light->radius, 
-								ShadowmapData::BatchSize, 
-								cascades);
-
-							Culling::ExecuteOnVisibleItemsCascades(entityDb, cascades, ShadowmapData::BatchSize, cullingMask, OnCullVisibleShadowmap, &ctx);
-							maxDistance = glm::max(maxDistance, lightRange);
-							break;
-						}
-					}
+				Batching::ResetCollection(&m_shadowmapData.Batches);
+
+				for (uint i = 0; i < batchSize; ++i)
+				{
+					auto& dirty = m_shadowmapData.DirtyLights[baseLightIndex + i];
+					auto& job = m_shadowmapData.CullJobs[dirty.jobIndex];
+					// Clip indices of multi layer lights map to layers. Single layer lights render all of their clips.
+					auto clipMask = job.hashCount > 1 ? dirty.layerMask : 0xFFFFFFFFu;
+					maxDistance = glm::max(maxDistance, job.maxDistance);
+					Batching::MergeCollection(&m_shadowmapData.Batches, &job.batches, (uint)i << 16u, clipMask);
 				}
 
 				Batching::UpdateBuffers(&m_shadowmapData.Batches);
 
-				GraphicsAPI::SetRenderTarget(typedata.SceneRenderTarget.get(), false);
+				GraphicsAPI::SetRenderTarget(typedata.SceneRenderTargets[level].get(), false);
 				GraphicsAPI::Clear(float4(maxDistance, maxDistance * maxDistance, 0, 0), 1.0f, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 				Batching::DrawBatches(&m_shadowmapData.Batches, typedata.ShaderRenderShadows, m_properties);
 
 				m_properties.SetKeywords({ StringHashID::StringToID("SHADOW_BLUR_PASS0") });
 				GraphicsAPI::SetRenderTarget(m_shadowmapData.ShadowmapAtlas.get(), false);
-				GraphicsAPI::BlitInstanced(atlasIndex + ShadowmapData::BatchSize, tileCount, typedata.ShaderBlur, m_properties, GL_TEXTURE_FETCH_BARRIER_BIT);
+				GraphicsAPI::BlitInstanced(0, batchSize * tilesPerLight, typedata.ShaderBlur, m_properties, GL_TEXTURE_FETCH_BARRIER_BIT);
 
+				// Cached tiles are not contiguous. Resolve each light from the scratch layers into its quadtree tile separately.
 				m_properties.SetKeywords({ StringHashID::StringToID("SHADOW_BLUR_PASS1") });
-				GraphicsAPI::BlitInstanced(atlasIndex, tileCount, typedata.ShaderBlur, m_properties);
+				m_properties.SetFloat(HashCache::Get()->pk_ShadowmapSourceScale, 1.0f / (1u << level));
+
+				for (uint i = 0; i < batchSize; ++i)
+				{
+					auto& dirty = m_shadowmapData.DirtyLights[baseLightIndex + i];
+					viewports[1] = { dirty.tile.x * tileSize, dirty.tile.y * tileSize, tileSize, tileSize };
+					GraphicsAPI::SetViewPorts(1, viewports + 1, 1);
+
+					// Layers that are up to date are not resolved. Their scratch layers only contain the cleared background.
+					for (auto j = 0u; j < tilesPerLight; ++j)
+					{
+						if (dirty.layerMask & (1u << j))
+						{
+							m_properties.SetUInt(HashCache::Get()->pk_ShadowmapScratchLayer, i * tilesPerLight + j);
+							GraphicsAPI::BlitInstanced(dirty.tile.layer + ShadowmapData::BatchSize + j, 1, typedata.ShaderBlur, m_properties);
+						}
+					}
+				}
 			}
 		}
 	}
 
-	void LightsManager::UpdateLightBuffers(PK::ECS::EntityDatabase* entityDb, Core::BufferView<uint> visibleLights, const float4x4& inverseViewProjection, float zNear, float zFar)
+	uint LightsManager::GetShadowmapLevel(const PK::ECS::EntityViews::LightRenderable* view, const float4x4& worldToView, float tanHalfFov) const
+	{
+		if (view->light->lightType == LightType::Directional)
+		{
+			return 0u;
+		}
+
+		auto distance = glm::length(float3(worldToView * float4(view->transform->position, 1.0f)));
+
+		if (distance <= view->light->radius)
+		{
+			return 0u;
+		}
+
+		// Continuous level from the projected radius. Level n covers the range [n, n + 1).
+		auto coverage = view->light->radius / (distance * tanHalfFov);
+		auto continuousLevel = glm::max(0.0f, -glm::log2(coverage / ShadowmapFullResolutionCoverage));
+		auto level = glm::min((uint)continuousLevel, ShadowmapCache::MaxLevel);
+		auto previousLevel = 0u;
+
+		// Keep the previous level unless the coverage has moved clearly outside of its range to avoid reallocating tiles every frame.
+		if (m_shadowmapCache.TryGetLevel(view->GID.entityID(), &previousLevel) && 
+			continuousLevel >= previousLevel - ShadowmapLevelHysteresis && 
+			(continuousLevel < previousLevel + 1.0f + ShadowmapLevelHysteresis || previousLevel == ShadowmapCache::MaxLevel))
+		{
+			return previousLevel;
+		}
+
+		return level;
+	}
+
+	void LightsManager::UpdateLightBuffers(PK::ECS::EntityDatabase* entityDb, Core::BufferView<ECS::EGID> visibleLights, const float4x4& worldToView, const float4x4& inverseProjection, const float4x4& inverseViewProjection, float zNear, float zFar, const ShadowCascadeReceivers* receivers)
 	{
 		m_visibleLightCount = 0;
 
 		for (size_t i = 0; i < visibleLights.count; ++i)
 		{
-			Utilities::PushVectorElement(m_visibleLights, &m_visibleLightCount, entityDb->Query<ECS::EntityViews::LightRenderable>(ECS::EGID(visibleLights[i], (uint)ECS::ENTITY_GROUPS::ACTIVE)));
+			m_visibleLights.Push(entityDb->Query<ECS::EntityViews::LightRenderable>(visibleLights[i]), &m_visibleLightCount);
 		}
 
 		if (m_visibleLightCount > 1)
@@ -282,15 +544,18 @@ namespace PK::Rendering
 
 		for (auto i = 0; i < (int)LightType::TypeCount; ++i)
 		{
-			m_shadowmapData.LightIndices[i].viewCount = 0;
-			m_shadowmapData.LightIndices[i].viewFirst = 0xFFFFFFFF;
+			m_shadowmapData.LightIndices[i].lightCount = 0;
 		}
 
+		// Allocations are kept even without caching so that tile levels stay stable. Tiles are then just rendered every frame.
+		m_shadowmapCache.BeginFrame();
+		m_cascadeCache.BeginFrame();
+
+		auto tanHalfFov = inverseProjection[1][1];
 		auto cascades = GetCascadeZSplits(zNear, zFar);
 		auto lightProjectionCount = 0;
-		auto shadowMapCount = 0u;
 
-		// Get visible shadowmap tiles per light type so that tile indexing can be ordered by light type
+		// Lights keep their atlas tiles across frames. Atlas layers are offset by the blur scratch layers.
 		for (size_t i = 0; i < m_visibleLightCount; ++i)
 		{
 			auto* view = m_visibleLights.at(i);
@@ -312,32 +577,24 @@ namespace PK::Rendering
 
 			view->light->shadowmapIndex = 0xFFFFFFFF;
 
-			if (!view->light->castShadows || shadowMapCount >= m_shadowmapTileCount)
+			if (!view->light->castShadows)
 			{
 				continue;
 			}
 
-			switch (view->light->lightType)
+			auto layerCount = view->light->lightType == LightType::Directional ? ShadowmapData::BatchSize : 1u;
+			auto level = GetShadowmapLevel(view, worldToView, tanHalfFov);
+			ShadowmapCache::Tile tile;
+
+			// Not enough atlas space even after evicting tiles of lights that are not visible.
+			if (!m_shadowmapCache.Allocate(view->GID.entityID(), layerCount, level, &tile))
 			{
-				case LightType::Point:
-				case LightType::Spot:
-					view->light->shadowmapIndex = shadowMapCount++;
-					break;
-				case LightType::Directional:
-					if (m_shadowmapTileCount - shadowMapCount >= ShadowmapData::BatchSize)
-					{
-						view->light->shadowmapIndex = shadowMapCount;
-						shadowMapCount += ShadowmapData::BatchSize;
-						break;
-					}
-					
-					// Not enough atlas space for 4 cascades
-					continue;
+				continue;
 			}
-			
-			auto& indicesView = m_shadowmapData.LightIndices[(uint)view->light->lightType];
-			indicesView.viewFirst = std::min(indicesView.viewFirst, (uint)i);
-			++indicesView.viewCount;
+
+			view->light->shadowmapIndex = ShadowmapCache::EncodeTile(tile, ShadowmapData::BatchSize);
+			auto& typedata = m_shadowmapData.LightIndices[(uint)view->light->lightType];
+			typedata.lights.Push(ShadowmapLight { view, tile }, &typedata.lightCount);
 		}
 
 		m_lightMatricesBuffer->ValidateSize((uint)lightProjectionCount);
@@ -348,6 +605,11 @@ namespace PK::Rendering
 		auto bufferMatrices = lightProjectionCount > 0 ? m_lightMatricesBuffer->BeginMapBufferRange<float4x4>(0, lightProjectionCount) : BufferView<float4x4>();
 		auto bufferDirections = lightProjectionCount > 0 ? m_lightDirectionsBuffer->BeginMapBufferRange<float4>(0, lightProjectionCount) : BufferView<float4>();
 
+		if (m_cpuLightAssignment)
+		{
+			m_clusterLights.resize(m_visibleLightCount);
+		}
+
 		for (size_t i = 0; i < m_visibleLightCount; ++i)
 		{
 			auto* view = m_visibleLights.at(i);
@@ -356,15 +618,19 @@ namespace PK::Rendering
 			switch (view->light->lightType)
 			{
 				case LightType::Directional:
-					position = float4(view->transform->rotation * PK_FLOAT3_FORWARD, 0.0f);
-					position.w = Functions::GetShadowCascadeMatrices(
+				{
+					auto& lightCascades = m_cascadeCache.Update(
+						view->GID.entityID(),
 						view->transform->worldToLocal, 
 						inverseViewProjection, 
 						cascades.planes, 
 						-view->light->radius, 
-						ShadowmapData::BatchSize, 
-						bufferMatrices.data + view->light->projectionIndex);
+						receivers != nullptr ? receivers->bounds : nullptr);
+
+					position = float4(view->transform->rotation * PK_FLOAT3_FORWARD, lightCascades.depthRange);
+					memcpy(bufferMatrices.data + view->light->projectionIndex, lightCascades.matrices, sizeof(float4x4) * ShadowmapData::BatchSize);
 					break;
+				}
 
 				case LightType::Point:
 					position = float4(view->transform->position, view->light->radius);
@@ -386,6 +652,18 @@ namespace PK::Rendering
 				(uint)view->light->cookie, 
 				(uint)view->light->lightType 
 			};
+
+			if (m_cpuLightAssignment)
+			{
+				m_clusterLights[i] = 
+				{ 
+					float3(position), 
+					position.w, 
+					view->transform->rotation * PK_FLOAT3_FORWARD, 
+					view->light->angle * PK_FLOAT_DEG2RAD, 
+					(uint)view->light->lightType 
+				};
+			}
 		}
 
 		bufferLights[m_visibleLightCount] = { PK_COLOR_CLEAR, PK_FLOAT4_ZERO, 0xFFFFFFFF, 0u, 0xFFFFFFFF, 0xFFFFFFFF };
@@ -398,9 +676,38 @@ namespace PK::Rendering
 		}
 	}
 	
-	void LightsManager::Preprocess(PK::ECS::EntityDatabase* entityDb, Core::BufferView<uint> visibleLights, const uint2& resolution, const float4x4& inverseViewProjection, float zNear, float zFar)
+	void LightsManager::AssignClusterLights(const float4x4& worldToView, const float4x4& inverseProjection, float zNear, float zFar)
 	{
-		UpdateLightBuffers(entityDb, visibleLights, inverseViewProjection, zNear, zFar);
+		// Depth tiles are produced on the gpu later in the frame. Clusters are not z culled on this path.
+		auto cascades = GetCascadeZSplits(zNear, zFar);
+		auto threadCount = Utilities::ThreadPool::GetShared()->GetThreadCount() + 1u;
+		m_clusterAssignment.Execute(m_clusterLights.data(), m_visibleLightCount, worldToView, inverseProjection, zNear, zFar, cascades.planes, nullptr, threadCount);
+
+		if (m_clusterAssignment.GetLightIndexCount() > 0)
+		{
+			m_globalLightsList->SubmitData(m_clusterAssignment.GetLightIndices(), 0, sizeof(uint) * m_clusterAssignment.GetLightIndexCount());
+		}
+
+		m_lightTiles->SetData(const_cast<uint*>(m_clusterAssignment.GetLightTiles()), sizeof(uint) * m_clusterAssignment.GetClusterCount(), 0);
+	}
+	
+	void LightsManager::Preprocess(PK::ECS::EntityDatabase* entityDb, 
+		Core::BufferView<ECS::EGID> visibleLights, 
+		const uint2& resolution, 
+		const float4x4& worldToView, 
+		const float4x4& inverseProjection, 
+		const float4x4& inverseViewProjection, 
+		float zNear, 
+		float zFar,
+		const ShadowCascadeReceivers* receivers)
+	{
+		PK_PROFILE_SCOPE("LightsPreprocess");
+		UpdateLightBuffers(entityDb, visibleLights, worldToView, inverseProjection, inverseViewProjection, zNear, zFar, receivers);
+
+		if (m_cpuLightAssignment)
+		{
+			AssignClusterLights(worldToView, inverseProjection, zNear, zFar);
+		}
 
 		auto hashCache = HashCache::Get();
 		m_globalLightIndex->Clear();
@@ -410,11 +717,18 @@ namespace PK::Rendering
 		GraphicsAPI::SetGlobalComputeBuffer(hashCache->pk_LightMatrices, m_lightMatricesBuffer->GetGraphicsID());
 		GraphicsAPI::SetGlobalComputeBuffer(hashCache->pk_GlobalLightsList, m_globalLightsList->GetGraphicsID());
 		GraphicsAPI::SetGlobalImage(hashCache->pk_LightTiles, m_lightTiles->GetImageBindDescriptor(GL_READ_WRITE, 0, 0, true));
-		UpdateShadowmaps(entityDb, inverseViewProjection, zNear, zFar);
+		UpdateShadowmaps(entityDb, inverseViewProjection);
 	}
 	
 	void LightsManager::UpdateLightTiles(const uint2& resolution)
 	{	
+		PK_PROFILE_RENDER_SCOPE("LightTiles");
+
+		if (m_cpuLightAssignment)
+		{
+			return;
+		}
+
 		if (m_zcullLights)
 		{
 			auto depthCountX = (uint)std::ceilf(resolution.x / DepthGroupSize);
@@ -1,5 +1,6 @@
 #pragma once
 #include "Utilities/Ref.h"
+#include "Utilities/FrameAllocator.h"
 #include "Core/NoCopy.h"
 #include "Core/ApplicationConfig.h"
 #include "ECS/EntityDatabase.h"
@@ -10,6 +11,9 @@
 #include "Rendering/Objects/RenderTexture.h"
 #include "Rendering/Objects/TextureXD.h"
 #include "Rendering/GraphicsAPI.h"
+#include "Rendering/ClusterLightAssignment.h"
+#include "Rendering/ShadowmapCache.h"
+#include "Rendering/ShadowCascadeCache.h"
 #include <hlslmath.h>
 
 namespace PK::Rendering
@@ -17,33 +21,82 @@ namespace PK::Rendering
     using namespace PK::Math;
     using namespace PK::Rendering::Objects;
 
+    struct ShadowmapLight
+    {
+        PK::ECS::EntityViews::LightRenderable* lightview = nullptr;
+        ShadowmapCache::Tile tile;
+    };
+
     struct ShadowmapLightTypeData
     {
-        Utilities::Ref<RenderTexture> SceneRenderTarget;
+        // One scene target per atlas level so that smaller tiles are also rendered at a lower resolution.
+        Utilities::Ref<RenderTexture> SceneRenderTargets[ShadowmapCache::LevelCount];
         Shader* ShaderRenderShadows = nullptr;
         Shader* ShaderBlur = nullptr;
-        uint viewFirst = 0;
-        uint viewCount = 0;
+        Utilities::FrameArray<ShadowmapLight> lights;
+        uint lightCount = 0;
         uint atlasBaseIndex = 0;
         uint maxBatchSize = 0;
     };
+
+    // Casters of a single light. Culled & batched independently so that jobs can run in parallel.
+    struct ShadowmapCullJob
+    {
+        Batching::IndexedMeshBatchCollection batches;
+        // One hash per atlas layer of the light. Casters are hashed into the layer of their clip index.
+        ulong hashes[ShadowmapCache::MaxLayerCount] = {};
+        uint hashCount = 1;
+        uint lightIndex = 0;
+        uint drawCount = 0;
+        uint rejectedCount = 0;
+        float maxDistance = 0.0f;
+        // Render handles of visible casters are marked on the main thread after all jobs have finished.
+        Utilities::FrameArray<ECS::EGID> visibleCasters;
+        uint visibleCasterCount = 0;
+    };
+
+    struct ShadowmapDirtyLight
+    {
+        PK::ECS::EntityViews::LightRenderable* lightview = nullptr;
+        ShadowmapCache::Tile tile;
+        uint jobIndex = 0;
+        uint layerMask = 0;
+    };
     
     struct ShadowmapData
     {
         ShadowmapLightTypeData LightIndices[(int)LightType::TypeCount];
         Batching::IndexedMeshBatchCollection Batches;
         Utilities::Ref<RenderTexture> ShadowmapAtlas;
+        std::vector<ShadowmapCullJob> CullJobs;
+        std::vector<Culling::CullingVolume> CullVolumes;
+        Utilities::FrameArray<ShadowmapDirtyLight> DirtyLights;
+        uint CullJobCount = 0;
+        uint DirtyLightCount = 0;
+        // The first BatchSize atlas layers are used as blur scratch space. Tiles start after them.
         static constexpr uint BatchSize = 4;
     };
 
     typedef struct ShadowCascades { float planes[5]; } ShadowCascades;
 
+    // World space bounds of the visible shadow receivers in the depth range of each cascade. Cascades without receivers keep inverted bounds.
+    struct ShadowCascadeReceivers
+    {
+        BoundingBox bounds[ShadowCascadeCache::MaxCascadeCount];
+        ShadowCascades cascades;
+
+        ShadowCascadeReceivers(const ShadowCascades& cascadeSplits);
+
+        // Depth is the distance of the bounds center to the camera near plane.
+        void Add(const BoundingBox& aabb, float depth);
+    };
+
     class LightsManager : public PK::Core::NoCopy
     {
         public:
             LightsManager(AssetDatabase* assetDatabase, const ApplicationConfig* config);
 
-            void Preprocess(PK::ECS::EntityDatabase* entityDb, Core::BufferView<uint> visibleLights, const uint2& resolution, const float4x4& inverseViewProjection, float zNear, float zFar);
+            void Preprocess(PK::ECS::EntityDatabase* entityDb, Core::BufferView<ECS::EGID> visibleLights, const uint2& resolution, const float4x4& worldToView, const float4x4& inverseProjection, const float4x4& inverseViewProjection, float zNear, float zFar, const ShadowCascadeReceivers* receivers);
 
             void UpdateLightTiles(const uint2& resolution);
 
@@ -51,29 +104,47 @@ namespace PK::Rendering
 
             inline const Ref<RenderTexture>& GetShadowmapAtlas() const { return m_shadowmapData.ShadowmapAtlas; }
 
+            inline void LogShadowmapAtlas() const { m_shadowmapCache.LogLayout(); }
+
+            void LogShadowCasterCulling() const;
+
             ShadowCascades GetCascadeZSplits(float znear, float zfar) const;
 
         private:
-            void UpdateShadowmaps(PK::ECS::EntityDatabase* entityDb, const float4x4& inverseViewProjection, float znear, float zfar);
-            void UpdateLightBuffers(PK::ECS::EntityDatabase* entityDb, Core::BufferView<uint> visibleLights, const float4x4& inverseViewProjection, float znear, float zfar);
+            void UpdateShadowmaps(PK::ECS::EntityDatabase* entityDb, const float4x4& inverseViewProjection);
+            void CullShadowCasters(PK::ECS::EntityDatabase* entityDb);
+            void UpdateLightBuffers(PK::ECS::EntityDatabase* entityDb, Core::BufferView<ECS::EGID> visibleLights, const float4x4& worldToView, const float4x4& inverseProjection, const float4x4& inverseViewProjection, float znear, float zfar, const ShadowCascadeReceivers* receivers);
+            uint GetShadowmapLevel(const PK::ECS::EntityViews::LightRenderable* view, const float4x4& worldToView, float tanHalfFov) const;
+            void AssignClusterLights(const float4x4& worldToView, const float4x4& inverseProjection, float znear, float zfar);
 
-            const uint MaxLightsPerTile = 64;
+            const uint MaxLightsPerTile = 128;
             const uint GridSizeX = 16;
             const uint GridSizeY = 9;
             const uint GridSizeZ = 24;
             const uint ClusterCount = GridSizeX * GridSizeY * GridSizeZ;
             const float DepthGroupSize = 32.0f;
+            // Projected light radius relative to half of the screen height at which a light uses a full resolution tile. Each level halves it.
+            const float ShadowmapFullResolutionCoverage = 0.5f;
+            const float ShadowmapLevelHysteresis = 0.25f;
 
             const bool m_zcullLights;
+            const bool m_cpuLightAssignment;
+            const bool m_cacheShadowmaps;
+            const bool m_singlePassShadowCulling;
+            const bool m_cullShadowCastersByCamera;
             const float m_cascadeLinearity;
-            std::vector<PK::ECS::EntityViews::LightRenderable*> m_visibleLights;
+            Utilities::FrameArray<PK::ECS::EntityViews::LightRenderable*> m_visibleLights;
             uint m_visibleLightCount;
+            std::vector<ClusterLightAssignment::ClusterLight> m_clusterLights;
+            ClusterLightAssignment m_clusterAssignment;
             uint m_shadowmapCubeFaceSize;
             uint m_shadowmapTileSize;
             uint m_shadowmapTileCount;
 
             ShaderPropertyBlock m_properties;
             ShadowmapData m_shadowmapData;
+            ShadowmapCache m_shadowmapCache;
+            ShadowCascadeCache m_cascadeCache;
 
             Shader* m_computeLightAssignment;
             Shader* m_computeDepthTiles;
@@ -0,0 +1,292 @@
+#include "PrecompiledHeader.h"
+#include "MaskedOcclusionBuffer.h"
+#include <emmintrin.h>
+
+namespace PK::Rendering::Culling
+{
+	void MaskedOcclusionBuffer::Resize(uint width, uint height)
+	{
+		auto countX = (width + SubtileWidth - 1) / SubtileWidth;
+		auto countY = (height + SubtileHeight - 1) / SubtileHeight;
+
+		if (m_subtileCountX == countX && m_subtileCountY == countY)
+		{
+			return;
+		}
+
+		m_subtileCountX = countX;
+		m_subtileCountY = countY;
+		m_width = countX * SubtileWidth;
+		m_height = countY * SubtileHeight;
+		m_masks.resize((size_t)countX * countY);
+		m_zMax0.resize((size_t)countX * countY);
+		m_zMax1.resize((size_t)countX * countY);
+		Clear();
+	}
+
+	void MaskedOcclusionBuffer::Clear()
+	{
+		std::fill(m_masks.begin(), m_masks.end(), 0u);
+		std::fill(m_zMax0.begin(), m_zMax0.end(), 1.0f);
+		std::fill(m_zMax1.begin(), m_zMax1.end(), 0.0f);
+		m_triangleCount = 0;
+	}
+
+	void MaskedOcclusionBuffer::RenderOccluder(const float4x4& localToWorld, const float3* vertices, const uint* indices, uint indexCount)
+	{
+		auto matrix = m_viewProjection * localToWorld;
+
+		for (auto i = 0u; i + 2 < indexCount; i += 3)
+		{
+			float4 clip[3];
+			float4 polygon[4];
+			auto vertexCount = 0u;
+
+			for (auto j = 0u; j < 3u; ++j)
+			{
+				clip[j] = matrix * float4(vertices[indices[i + j]], 1.0f);
+			}
+
+			// Clip against the near plane (z = -w). Produces at most a quad.
+			for (auto j = 0u; j < 3u; ++j)
+			{
+				auto& a = clip[j];
+				auto& b = clip[(j + 1) % 3];
+				auto da = a.z + a.w;
+				auto db = b.z + b.w;
+
+				if (da >= 0.0f)
+				{
+					polygon[vertexCount++] = a;
+				}
+
+				if ((da >= 0.0f) != (db >= 0.0f))
+				{
+					polygon[vertexCount++] = a + (b - a) * (da / (da - db));
+				}
+			}
+
+			if (vertexCount < 3)
+			{
+				continue;
+			}
+
+			float3 screen[4];
+
+			for (auto j = 0u; j < vertexCount; ++j)
+			{
+				auto ndc = float3(polygon[j].xyz) / glm::max(polygon[j].w, 1e-5f);
+				screen[j] = { (ndc.x * 0.5f + 0.5f) * m_width, (ndc.y * 0.5f + 0.5f) * m_height, glm::clamp(ndc.z * 0.5f + 0.5f, 0.0f, 1.0f) };
+			}
+
+			for (auto j = 2u; j < vertexCount; ++j)
+			{
+				float3 triangle[3] = { screen[0], screen[j - 1], screen[j] };
+				RasterizeTriangle(triangle);
+			}
+		}
+	}
+
+	void MaskedOcclusionBuffer::RasterizeTriangle(const float3* p)
+	{
+		auto area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[1].y - p[0].y) * (p[2].x - p[0].x);
+
+		if (glm::abs(area) < 1e-8f)
+		{
+			return;
+		}
+
+		// Occluders are rasterized double sided. Flip clockwise triangles so that the inside of every edge is positive.
+		float3 v[3] = { p[0], area > 0.0f ? p[1] : p[2], area > 0.0f ? p[2] : p[1] };
+		area = glm::abs(area);
+
+		auto xmin = glm::max(0.0f, glm::min(v[0].x, glm::min(v[1].x, v[2].x)));
+		auto ymin = glm::max(0.0f, glm::min(v[0].y, glm::min(v[1].y, v[2].y)));
+		auto xmax = glm::min(m_width - 1.0f, glm::max(v[0].x, glm::max(v[1].x, v[2].x)));
+		auto ymax = glm::min(m_height - 1.0f, glm::max(v[0].y, glm::max(v[1].y, v[2].y)));
+
+		if (xmin > xmax || ymin > ymax)
+		{
+			return;
+		}
+
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+
+		for (auto i = 0u; i < 3u; ++i)
+		{
+			auto& a = v[i];
+			auto& b = v[(i + 1) % 3];
+			edgeA[i] = a.y - b.y;
+			edgeB[i] = b.x - a.x;
+			edgeC[i] = -(edgeA[i] * a.x + edgeB[i] * a.y);
+		}
+
+		// Depth plane z = zdx * x + zdy * y + z0.
+		auto zdx = ((v[1].z - v[0].z) * (v[2].y - v[0].y) - (v[2].z - v[0].z) * (v[1].y - v[0].y)) / area;
+		auto zdy = ((v[2].z - v[0].z) * (v[1].x - v[0].x) - (v[1].z - v[0].z) * (v[2].x - v[0].x)) / area;
+		auto z0 = v[0].z - zdx * v[0].x - zdy * v[0].y;
+		auto zVertexMax = glm::max(v[0].z, glm::max(v[1].z, v[2].z));
+
+		auto stx0 = (uint)xmin / SubtileWidth;
+		auto sty0 = (uint)ymin / SubtileHeight;
+		auto stx1 = (uint)xmax / SubtileWidth;
+		auto sty1 = (uint)ymax / SubtileHeight;
+
+		const auto columnOffsets0 = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		const auto columnOffsets1 = _mm_setr_ps(4.5f, 5.5f, 6.5f, 7.5f);
+		const auto zero = _mm_setzero_ps();
+
+		__m128 stepX[3];
+
+		for (auto i = 0u; i < 3u; ++i)
+		{
+			stepX[i] = _mm_set1_ps(edgeA[i]);
+		}
+
+		for (auto sty = sty0; sty <= sty1; ++sty)
+		{
+			for (auto stx = stx0; stx <= stx1; ++stx)
+			{
+				auto px = (float)(stx * SubtileWidth);
+				auto py = (float)(sty * SubtileHeight);
+				auto coverage = 0u;
+
+				for (auto row = 0u; row < SubtileHeight; ++row)
+				{
+					auto y = py + row + 0.5f;
+					auto inside0 = _mm_castsi128_ps(_mm_set1_epi32(-1));
+					auto inside1 = inside0;
+
+					for (auto i = 0u; i < 3u; ++i)
+					{
+						auto rowBase = _mm_set1_ps(edgeA[i] * px + edgeB[i] * y + edgeC[i]);
+						auto e0 = _mm_add_ps(rowBase, _mm_mul_ps(stepX[i], columnOffsets0));
+						auto e1 = _mm_add_ps(rowBase, _mm_mul_ps(stepX[i], columnOffsets1));
+						inside0 = _mm_and_ps(inside0, _mm_cmpge_ps(e0, zero));
+						inside1 = _mm_and_ps(inside1, _mm_cmpge_ps(e1, zero));
+					}
+
+					auto rowMask = (uint)_mm_movemask_ps(inside0) | ((uint)_mm_movemask_ps(inside1) << 4u);
+					coverage |= rowMask << (row * SubtileWidth);
+				}
+
+				if (coverage == 0u)
+				{
+					continue;
+				}
+
+				// Conservative triangle depth inside the subtile: the farthest plane value at the subtile corners.
+				auto zc0 = z0 + zdx * px + zdy * py;
+				auto zc1 = zc0 + zdx * SubtileWidth;
+				auto zc2 = zc0 + zdy * SubtileHeight;
+				auto zc3 = zc1 + zdy * SubtileHeight;
+				auto zTri = glm::min(zVertexMax, glm::max(glm::max(zc0, zc1), glm::max(zc2, zc3)));
+
+				auto index = stx + sty * m_subtileCountX;
+				auto& mask = m_masks[index];
+				auto& zMax0 = m_zMax0[index];
+				auto& zMax1 = m_zMax1[index];
+
+				if (zTri >= zMax0)
+				{
+					continue;
+				}
+
+				// Discard the working layer when the new triangle is considerably closer than it. Reverts those pixels to the reference layer.
+				if (zMax1 - zTri > zMax0 - zMax1)
+				{
+					zMax1 = 0.0f;
+					mask = 0u;
+				}
+
+				zMax1 = glm::max(zMax1, zTri);
+				mask |= coverage;
+
+				if (mask == 0xFFFFFFFFu)
+				{
+					zMax0 = zMax1;
+					zMax1 = 0.0f;
+					mask = 0u;
+				}
+			}
+		}
+
+		++m_triangleCount;
+	}
+
+	bool MaskedOcclusionBuffer::IsOccluded(const BoundingBox& aabb) const
+	{
+		if (m_masks.empty())
+		{
+			return false;
+		}
+
+		auto smin = float2(std::numeric_limits<float>().max());
+		auto smax = float2(-std::numeric_limits<float>().max());
+		auto zmin = 1.0f;
+
+		for (auto i = 0u; i < 8u; ++i)
+		{
+			auto corner = float3(i & 1 ? aabb.max.x : aabb.min.x, i & 2 ? aabb.max.y : aabb.min.y, i & 4 ? aabb.max.z : aabb.min.z);
+			auto clip = m_viewProjection * float4(corner, 1.0f);
+
+			if (clip.w <= 1e-5f)
+			{
+				return false;
+			}
+
+			auto ndc = float3(clip.xyz) / clip.w;
+			smin = glm::min(smin, float2(ndc.xy) * 0.5f + 0.5f);
+			smax = glm::max(smax, float2(ndc.xy) * 0.5f + 0.5f);
+			zmin = glm::min(zmin, ndc.z * 0.5f + 0.5f);
+		}
+
+		if (zmin <= 0.0f || smax.x < 0.0f || smax.y < 0.0f || smin.x > 1.0f || smin.y > 1.0f)
+		{
+			return false;
+		}
+
+		auto x0 = glm::min((uint)(glm::clamp(smin.x, 0.0f, 1.0f) * m_width), m_width - 1u);
+		auto y0 = glm::min((uint)(glm::clamp(smin.y, 0.0f, 1.0f) * m_height), m_height - 1u);
+		auto x1 = glm::min((uint)(glm::clamp(smax.x, 0.0f, 1.0f) * m_width), m_width - 1u);
+		auto y1 = glm::min((uint)(glm::clamp(smax.y, 0.0f, 1.0f) * m_height), m_height - 1u);
+
+		for (auto sty = y0 / SubtileHeight; sty <= y1 / SubtileHeight; ++sty)
+		{
+			auto rowMin = glm::max(y0, sty * SubtileHeight) - sty * SubtileHeight;
+			auto rowMax = glm::min(y1, sty * SubtileHeight + SubtileHeight - 1u) - sty * SubtileHeight;
+
+			for (auto stx = x0 / SubtileWidth; stx <= x1 / SubtileWidth; ++stx)
+			{
+				auto colMin = glm::max(x0, stx * SubtileWidth) - stx * SubtileWidth;
+				auto colMax = glm::min(x1, stx * SubtileWidth + SubtileWidth - 1u) - stx * SubtileWidth;
+				auto rowBits = (0xFFu >> (SubtileWidth - 1u - colMax)) & (0xFFu << colMin);
+				auto rectMask = 0u;
+
+				for (auto row = rowMin; row <= rowMax; ++row)
+				{
+					rectMask |= rowBits << (row * SubtileWidth);
+				}
+
+				auto index = stx + sty * m_subtileCountX;
+				auto depth = (rectMask & ~m_masks[index]) == 0u ? m_zMax1[index] : m_zMax0[index];
+
+				if (zmin <= depth)
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	float MaskedOcclusionBuffer::GetPixelDepth(uint x, uint y) const
+	{
+		auto index = x / SubtileWidth + (y / SubtileHeight) * m_subtileCountX;
+		auto bit = 1u << ((x % SubtileWidth) + (y % SubtileHeight) * SubtileWidth);
+		return (m_masks.at(index) & bit) ? m_zMax1.at(index) : m_zMax0.at(index);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include "Core/NoCopy.h"
+#include <vector>
+#include <hlslmath.h>
+
+namespace PK::Rendering::Culling
+{
+    using namespace PK::Math;
+
+    // Software occlusion buffer in the style of masked software occlusion culling.
+    // Source: https://www.intel.com/content/dam/develop/external/us/en/documents/masked-software-occlusion-culling.pdf
+    // Each 8x4 pixel subtile stores a coverage mask and two max depth layers. Coverage is evaluated 4 pixels at a time with sse.
+    class MaskedOcclusionBuffer : public PK::Core::NoCopy
+    {
+        public:
+            static constexpr uint SubtileWidth = 8;
+            static constexpr uint SubtileHeight = 4;
+
+            void Resize(uint width, uint height);
+
+            void Clear();
+
+            void RenderOccluder(const float4x4& localToWorld, const float3* vertices, const uint* indices, uint indexCount);
+
+            bool IsOccluded(const BoundingBox& aabb) const;
+
+            float GetPixelDepth(uint x, uint y) const;
+
+            inline void SetViewProjection(const float4x4& matrix) { m_viewProjection = matrix; }
+            inline uint GetWidth() const { return m_width; }
+            inline uint GetHeight() const { return m_height; }
+            inline uint GetTriangleCount() const { return m_triangleCount; }
+
+        private:
+            void RasterizeTriangle(const float3* p);
+
+            std::vector<uint> m_masks;
+            std::vector<float> m_zMax0;
+            std::vector<float> m_zMax1;
+            float4x4 m_viewProjection = PK_FLOAT4X4_IDENTITY;
+            uint m_width = 0;
+            uint m_height = 0;
+            uint m_subtileCountX = 0;
+            uint m_subtileCountY = 0;
+            uint m_triangleCount = 0;
+    };
+}
\ No newline at end of file
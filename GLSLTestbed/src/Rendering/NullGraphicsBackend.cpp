@@ -0,0 +1,817 @@
+#include "PrecompiledHeader.h"
+#include "Utilities/Log.h"
+#include "Rendering/NullGraphicsBackend.h"
+#include <glad/glad.h>
+#include <hlslmath.h>
+
+namespace PK::Rendering::NullGraphicsBackend
+{
+	static Counters s_counters;
+	static GLuint s_nextId = 1u;
+	static GLuint64 s_nextHandle = 1ull;
+	static std::unordered_map<GLuint, std::vector<char>> s_buffers;
+	static std::unordered_map<GLenum, GLuint> s_boundBuffers;
+
+	struct Uniform
+	{
+		std::string name;
+		GLenum type = GL_NONE;
+		GLint size = 1;
+		GLint location = 0;
+	};
+
+	struct Program
+	{
+		std::vector<GLuint> shaders;
+		std::vector<Uniform> uniforms;
+		// Array elements are stored at consecutive locations.
+		std::map<GLint, std::vector<char>> values;
+	};
+
+	static std::unordered_map<GLuint, std::string> s_shaderSources;
+	static std::unordered_map<GLuint, Program> s_programs;
+	static GLuint s_activeProgram = 0u;
+	static bool s_hashDrawState = false;
+
+	static const char* s_extensions[] =
+	{
+		"GL_ARB_bindless_texture",
+		"GL_ARB_compute_variable_group_size",
+		"GL_ARB_conservative_depth",
+		"GL_ARB_shader_viewport_layer_array",
+		"GL_ARB_sparse_buffer",
+		"GL_ARB_sparse_texture",
+		"GL_ARB_texture_filter_minmax",
+	};
+
+	static void GenerateIds(GLsizei n, GLuint* ids)
+	{
+		++s_counters.calls;
+
+		for (auto i = 0; i < n; ++i)
+		{
+			ids[i] = s_nextId++;
+		}
+	}
+
+	static char* ResizeBuffer(GLuint buffer, GLsizeiptr size, const void* data)
+	{
+		++s_counters.calls;
+		auto& storage = s_buffers[buffer];
+		storage.resize((size_t)size);
+
+		if (data != nullptr)
+		{
+			memcpy(storage.data(), data, (size_t)size);
+			s_counters.uploadBytes += (uint64_t)size;
+		}
+
+		return storage.data();
+	}
+
+	static char* MapBuffer(GLuint buffer, GLintptr offset, GLsizeiptr length)
+	{
+		++s_counters.calls;
+		auto& storage = s_buffers[buffer];
+
+		if (storage.size() < (size_t)(offset + length))
+		{
+			storage.resize((size_t)(offset + length));
+		}
+
+		s_counters.uploadBytes += (uint64_t)length;
+		return storage.data() + offset;
+	}
+
+	static uint64_t Hash(uint64_t hash, const void* data, size_t size)
+	{
+		// FNV-1a
+		auto bytes = reinterpret_cast<const unsigned char*>(data);
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	static void RecordDraw()
+	{
+		++s_counters.calls;
+		++s_counters.drawCalls;
+
+		if (!s_hashDrawState)
+		{
+			return;
+		}
+
+		auto hash = Hash(s_counters.drawStateHash, &s_activeProgram, sizeof(s_activeProgram));
+		auto program = s_programs.find(s_activeProgram);
+
+		if (program != s_programs.end())
+		{
+			for (auto& kv : program->second.values)
+			{
+				hash = Hash(hash, &kv.first, sizeof(kv.first));
+				hash = Hash(hash, kv.second.data(), kv.second.size());
+			}
+		}
+
+		s_counters.drawStateHash = hash;
+	}
+
+	static void WriteUniform(GLint location, GLsizei count, const void* value, size_t elementSize)
+	{
+		++s_counters.calls;
+		++s_counters.stateChanges;
+		++s_counters.uniformWrites;
+
+		auto program = s_programs.find(s_activeProgram);
+
+		if (program == s_programs.end() || location < 0)
+		{
+			return;
+		}
+
+		auto isRedundant = true;
+		auto bytes = reinterpret_cast<const char*>(value);
+
+		for (auto i = 0; i < count; ++i, bytes += elementSize)
+		{
+			auto& stored = program->second.values[location + i];
+
+			if (stored.size() == elementSize && memcmp(stored.data(), bytes, elementSize) == 0)
+			{
+				continue;
+			}
+
+			stored.assign(bytes, bytes + elementSize);
+			isRedundant = false;
+		}
+
+		if (isRedundant)
+		{
+			++s_counters.redundantUniformWrites;
+		}
+	}
+
+	static void ReadUniform(GLuint program, GLint location, void* params)
+	{
+		++s_counters.calls;
+		auto record = s_programs.find(program);
+
+		if (record != s_programs.end())
+		{
+			auto value = record->second.values.find(location);
+
+			if (value != record->second.values.end())
+			{
+				memcpy(params, value->second.data(), value->second.size());
+				return;
+			}
+		}
+
+		memset(params, 0, sizeof(GLint));
+	}
+
+	static bool IsIdentifierCharacter(char c) { return isalnum((unsigned char)c) || c == '_'; }
+
+	static size_t ReadIdentifier(const std::string& source, size_t position, std::string* identifier)
+	{
+		while (position < source.size() && isspace((unsigned char)source[position]))
+		{
+			++position;
+		}
+
+		auto begin = position;
+
+		while (position < source.size() && IsIdentifierCharacter(source[position]))
+		{
+			++position;
+		}
+
+		*identifier = source.substr(begin, position - begin);
+		return position;
+	}
+
+	// Resource types only need to be recognized as such. The renderer assigns slots to them.
+	static GLenum GetUniformType(const std::string& typeName)
+	{
+		if (typeName.find("sampler") != std::string::npos)
+		{
+			return GL_SAMPLER_2D;
+		}
+
+		if (typeName.find("image") != std::string::npos)
+		{
+			return GL_IMAGE_2D;
+		}
+
+		auto type = Math::Convert::FromUniformString(typeName.c_str());
+		return type >= Math::PK_TYPE::FLOAT && type <= Math::PK_TYPE::UINT4 ? (GLenum)Math::Convert::ToNativeEnum(type) : GL_NONE;
+	}
+
+	static void ReflectUniforms(const std::string& source, std::vector<Uniform>* uniforms)
+	{
+		static const std::unordered_set<std::string> qualifiers = { "highp", "mediump", "lowp", "readonly", "writeonly", "restrict", "coherent", "volatile" };
+
+		// Instanced properties are declared as regular uniforms in variants without instancing.
+		const char* declarators[] = { "uniform", "PK_INSTANCED_PROPERTY" };
+		auto declaratorCount = source.find("#define PK_ENABLE_INSTANCING") == std::string::npos ? 2 : 1;
+
+		for (auto i = 0; i < declaratorCount; ++i)
+		{
+			auto length = strlen(declarators[i]);
+
+			for (auto position = source.find(declarators[i]); position != std::string::npos; position = source.find(declarators[i], position + length))
+			{
+				if ((position > 0 && IsIdentifierCharacter(source[position - 1])) || IsIdentifierCharacter(source[position + length]))
+				{
+					continue;
+				}
+
+				std::string type;
+				std::string name;
+				auto cursor = ReadIdentifier(source, position + length, &type);
+
+				while (qualifiers.count(type) > 0)
+				{
+					cursor = ReadIdentifier(source, cursor, &type);
+				}
+
+				cursor = ReadIdentifier(source, cursor, &name);
+				GLint size = 1;
+
+				if (cursor < source.size() && source[cursor] == '[')
+				{
+					size = atoi(source.c_str() + cursor + 1);
+					cursor = source.find(']', cursor);
+					cursor = cursor == std::string::npos ? cursor : cursor + 1;
+				}
+
+				// Block declarations & macro definitions are not followed by a semicolon.
+				if (name.empty() || size < 1 || cursor >= source.size() || source[cursor] != ';')
+				{
+					continue;
+				}
+
+				auto glType = GetUniformType(type);
+				auto isDeclared = std::find_if(uniforms->begin(), uniforms->end(), [&](const Uniform& uniform) { return uniform.name == name; }) != uniforms->end();
+
+				if (glType != GL_NONE && !isDeclared)
+				{
+					uniforms->push_back({ name, glType, size, 0 });
+				}
+			}
+		}
+	}
+
+	#define PK_NULL_GL_CALL(name, params) static void APIENTRY Null##name params { ++s_counters.calls; }
+	#define PK_NULL_GL_STATE(name, params) static void APIENTRY Null##name params { ++s_counters.calls; ++s_counters.stateChanges; }
+	#define PK_NULL_GL_DRAW(name, params) static void APIENTRY Null##name params { RecordDraw(); }
+	#define PK_NULL_GL_DISPATCH(name, params) static void APIENTRY Null##name params { ++s_counters.calls; ++s_counters.dispatches; }
+	#define PK_NULL_GL_UNIFORM(name, type, components) static void APIENTRY NullUniform##name(GLint location, GLsizei count, const type* value) { WriteUniform(location, count, value, sizeof(type) * components); }
+	#define PK_NULL_GL_UNIFORM_MATRIX(name, components) static void APIENTRY NullUniform##name(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) { WriteUniform(location, count, value, sizeof(GLfloat) * components); }
+
+	PK_NULL_GL_STATE(BindBufferBase, (GLenum target, GLuint index, GLuint buffer))
+	PK_NULL_GL_STATE(BindFramebuffer, (GLenum target, GLuint framebuffer))
+	PK_NULL_GL_STATE(BindImageTexture, (GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format))
+	PK_NULL_GL_STATE(BindImageTextures, (GLuint first, GLsizei count, const GLuint* textures))
+	PK_NULL_GL_STATE(BindTexture, (GLenum target, GLuint texture))
+	PK_NULL_GL_STATE(BindTextureUnit, (GLuint unit, GLuint texture))
+	PK_NULL_GL_STATE(BindTextures, (GLuint first, GLsizei count, const GLuint* textures))
+	PK_NULL_GL_STATE(BindVertexArray, (GLuint array))
+	PK_NULL_GL_STATE(BlendFunc, (GLenum sfactor, GLenum dfactor))
+	PK_NULL_GL_DRAW(BlitNamedFramebuffer, (GLuint readFramebuffer, GLuint drawFramebuffer, GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter))
+	PK_NULL_GL_DRAW(Clear, (GLbitfield mask))
+	PK_NULL_GL_STATE(ClearColor, (GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha))
+	PK_NULL_GL_STATE(ClearDepth, (GLdouble depth))
+	PK_NULL_GL_CALL(ClearNamedBufferData, (GLuint buffer, GLenum internalformat, GLenum format, GLenum type, const void* data))
+	PK_NULL_GL_CALL(ClearTexImage, (GLuint texture, GLint level, GLenum format, GLenum type, const void* data))
+	PK_NULL_GL_STATE(ColorMask, (GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha))
+	PK_NULL_GL_CALL(CompileShader, (GLuint shader))
+	PK_NULL_GL_CALL(CopyImageSubData, (GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ, GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ, GLsizei srcWidth, GLsizei srcHeight, GLsizei srcDepth))
+	PK_NULL_GL_STATE(CullFace, (GLenum mode))
+	PK_NULL_GL_CALL(DebugMessageCallback, (GLDEBUGPROC callback, const void* userParam))
+	PK_NULL_GL_CALL(DeleteFramebuffers, (GLsizei n, const GLuint* framebuffers))
+	PK_NULL_GL_CALL(DeleteQueries, (GLsizei n, const GLuint* ids))
+	PK_NULL_GL_CALL(DeleteTextures, (GLsizei n, const GLuint* textures))
+	PK_NULL_GL_CALL(DeleteVertexArrays, (GLsizei n, const GLuint* arrays))
+	PK_NULL_GL_STATE(DepthFunc, (GLenum func))
+	PK_NULL_GL_STATE(DepthMask, (GLboolean flag))
+	PK_NULL_GL_STATE(Disable, (GLenum cap))
+	PK_NULL_GL_DISPATCH(DispatchCompute, (GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z))
+	PK_NULL_GL_DISPATCH(DispatchComputeIndirect, (GLintptr indirect))
+	PK_NULL_GL_DRAW(DrawArrays, (GLenum mode, GLint first, GLsizei count))
+	PK_NULL_GL_DRAW(DrawElements, (GLenum mode, GLsizei count, GLenum type, const void* indices))
+	PK_NULL_GL_DRAW(DrawElementsInstancedBaseInstance, (GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount, GLuint baseinstance))
+	PK_NULL_GL_STATE(Enable, (GLenum cap))
+	PK_NULL_GL_CALL(EnableVertexAttribArray, (GLuint index))
+	PK_NULL_GL_STATE(FrontFace, (GLenum mode))
+	PK_NULL_GL_CALL(InvalidateBufferData, (GLuint buffer))
+	PK_NULL_GL_CALL(InvalidateBufferSubData, (GLuint buffer, GLintptr offset, GLsizeiptr length))
+	PK_NULL_GL_CALL(InvalidateNamedFramebufferData, (GLuint framebuffer, GLsizei numAttachments, const GLenum* attachments))
+	PK_NULL_GL_CALL(MakeImageHandleNonResidentARB, (GLuint64 handle))
+	PK_NULL_GL_CALL(MakeImageHandleResidentARB, (GLuint64 handle, GLenum access))
+	PK_NULL_GL_CALL(MakeTextureHandleNonResidentARB, (GLuint64 handle))
+	PK_NULL_GL_CALL(MakeTextureHandleResidentARB, (GLuint64 handle))
+	PK_NULL_GL_STATE(MemoryBarrier, (GLbitfield barriers))
+	PK_NULL_GL_STATE(NamedFramebufferDrawBuffer, (GLuint framebuffer, GLenum buf))
+	PK_NULL_GL_STATE(NamedFramebufferDrawBuffers, (GLuint framebuffer, GLsizei n, const GLenum* bufs))
+	PK_NULL_GL_CALL(NamedFramebufferTexture, (GLuint framebuffer, GLenum attachment, GLuint texture, GLint level))
+	PK_NULL_GL_CALL(QueryCounter, (GLuint id, GLenum target))
+	PK_NULL_GL_CALL(ReadPixels, (GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels))
+	PK_NULL_GL_CALL(ShaderStorageBlockBinding, (GLuint program, GLuint storageBlockIndex, GLuint storageBlockBinding))
+	PK_NULL_GL_CALL(TexPageCommitmentARB, (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLboolean commit))
+	PK_NULL_GL_CALL(TexStorage2DMultisample, (GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height, GLboolean fixedsamplelocations))
+	PK_NULL_GL_CALL(TexStorage3DMultisample, (GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth, GLboolean fixedsamplelocations))
+	PK_NULL_GL_CALL(TextureParameterf, (GLuint texture, GLenum pname, GLfloat param))
+	PK_NULL_GL_CALL(TextureParameterfv, (GLuint texture, GLenum pname, const GLfloat* param))
+	PK_NULL_GL_CALL(TextureParameteri, (GLuint texture, GLenum pname, GLint param))
+	PK_NULL_GL_CALL(TextureStorage1D, (GLuint texture, GLsizei levels, GLenum internalformat, GLsizei width))
+	PK_NULL_GL_CALL(TextureStorage2D, (GLuint texture, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height))
+	PK_NULL_GL_CALL(TextureStorage3D, (GLuint texture, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth))
+	PK_NULL_GL_CALL(TextureSubImage1D, (GLuint texture, GLint level, GLint xoffset, GLsizei width, GLenum format, GLenum type, const void* pixels))
+	PK_NULL_GL_CALL(TextureSubImage2D, (GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels))
+	PK_NULL_GL_CALL(TextureSubImage3D, (GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels))
+	PK_NULL_GL_STATE(UniformBlockBinding, (GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding))
+	PK_NULL_GL_UNIFORM(1fv, GLfloat, 1)
+	PK_NULL_GL_UNIFORM(1iv, GLint, 1)
+	PK_NULL_GL_UNIFORM(1uiv, GLuint, 1)
+	PK_NULL_GL_UNIFORM(2fv, GLfloat, 2)
+	PK_NULL_GL_UNIFORM(2iv, GLint, 2)
+	PK_NULL_GL_UNIFORM(2uiv, GLuint, 2)
+	PK_NULL_GL_UNIFORM(3fv, GLfloat, 3)
+	PK_NULL_GL_UNIFORM(3iv, GLint, 3)
+	PK_NULL_GL_UNIFORM(3uiv, GLuint, 3)
+	PK_NULL_GL_UNIFORM(4fv, GLfloat, 4)
+	PK_NULL_GL_UNIFORM(4iv, GLint, 4)
+	PK_NULL_GL_UNIFORM(4uiv, GLuint, 4)
+	PK_NULL_GL_UNIFORM(Handleui64vARB, GLuint64, 1)
+	PK_NULL_GL_UNIFORM_MATRIX(Matrix2fv, 4)
+	PK_NULL_GL_UNIFORM_MATRIX(Matrix3fv, 9)
+	PK_NULL_GL_UNIFORM_MATRIX(Matrix4fv, 16)
+	PK_NULL_GL_CALL(VertexAttribDivisor, (GLuint index, GLuint divisor))
+	PK_NULL_GL_CALL(VertexAttribPointer, (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer))
+	PK_NULL_GL_STATE(Viewport, (GLint x, GLint y, GLsizei width, GLsizei height))
+	PK_NULL_GL_STATE(ViewportArrayv, (GLuint first, GLsizei count, const GLfloat* v))
+
+	#undef PK_NULL_GL_CALL
+	#undef PK_NULL_GL_STATE
+	#undef PK_NULL_GL_DRAW
+	#undef PK_NULL_GL_DISPATCH
+	#undef PK_NULL_GL_UNIFORM
+	#undef PK_NULL_GL_UNIFORM_MATRIX
+
+	static const GLubyte* APIENTRY NullGetString(GLenum name)
+	{
+		++s_counters.calls;
+
+		switch (name)
+		{
+			case GL_VERSION: return (const GLubyte*)"4.6.0 Null";
+			case GL_SHADING_LANGUAGE_VERSION: return (const GLubyte*)"4.60 Null";
+			default: return (const GLubyte*)"PK Null Backend";
+		}
+	}
+
+	static const GLubyte* APIENTRY NullGetStringi(GLenum name, GLuint index)
+	{
+		++s_counters.calls;
+		return name == GL_EXTENSIONS && index < sizeof(s_extensions) / sizeof(s_extensions[0]) ? (const GLubyte*)s_extensions[index] : nullptr;
+	}
+
+	static void APIENTRY NullGetIntegerv(GLenum pname, GLint* data)
+	{
+		++s_counters.calls;
+
+		switch (pname)
+		{
+			case GL_NUM_EXTENSIONS: *data = (GLint)(sizeof(s_extensions) / sizeof(s_extensions[0])); break;
+			case GL_MAJOR_VERSION: *data = 4; break;
+			case GL_MINOR_VERSION: *data = 6; break;
+			case GL_MAX_TEXTURE_IMAGE_UNITS: *data = 32; break;
+			case GL_MAX_UNIFORM_BUFFER_BINDINGS: *data = 84; break;
+			case GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS: *data = 96; break;
+			case GL_MAX_IMAGE_UNITS: *data = 8; break;
+			case GL_CURRENT_PROGRAM: *data = (GLint)s_activeProgram; break;
+			default: *data = 0; break;
+		}
+	}
+
+	static void APIENTRY NullGetInteger64v(GLenum pname, GLint64* data) { ++s_counters.calls; *data = 0; }
+	static void APIENTRY NullGetInternalformativ(GLenum target, GLenum internalformat, GLenum pname, GLsizei count, GLint* params) { ++s_counters.calls; *params = 128; }
+	static void APIENTRY NullGetQueryObjectiv(GLuint id, GLenum pname, GLint* params) { ++s_counters.calls; *params = GL_TRUE; }
+	static void APIENTRY NullGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64* params) { ++s_counters.calls; *params = 0ull; }
+
+	static void APIENTRY NullGenBuffers(GLsizei n, GLuint* buffers) { GenerateIds(n, buffers); }
+	static void APIENTRY NullGenQueries(GLsizei n, GLuint* ids) { GenerateIds(n, ids); }
+	static void APIENTRY NullGenTextures(GLsizei n, GLuint* textures) { GenerateIds(n, textures); }
+	static void APIENTRY NullCreateBuffers(GLsizei n, GLuint* buffers) { GenerateIds(n, buffers); }
+	static void APIENTRY NullCreateFramebuffers(GLsizei n, GLuint* framebuffers) { GenerateIds(n, framebuffers); }
+	static void APIENTRY NullCreateTextures(GLenum target, GLsizei n, GLuint* textures) { GenerateIds(n, textures); }
+	static void APIENTRY NullCreateVertexArrays(GLsizei n, GLuint* arrays) { GenerateIds(n, arrays); }
+	static GLuint APIENTRY NullCreateProgram() { ++s_counters.calls; return s_nextId++; }
+	static GLuint APIENTRY NullCreateShader(GLenum type) { ++s_counters.calls; return s_nextId++; }
+
+	static void APIENTRY NullShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length)
+	{
+		++s_counters.calls;
+		auto& source = s_shaderSources[shader];
+		source.clear();
+
+		for (auto i = 0; i < count; ++i)
+		{
+			if (length != nullptr && length[i] >= 0)
+			{
+				source.append(string[i], (size_t)length[i]);
+			}
+			else
+			{
+				source.append(string[i]);
+			}
+		}
+	}
+
+	static void APIENTRY NullDeleteShader(GLuint shader) { ++s_counters.calls; s_shaderSources.erase(shader); }
+	static void APIENTRY NullAttachShader(GLuint program, GLuint shader) { ++s_counters.calls; s_programs[program].shaders.push_back(shader); }
+	static void APIENTRY NullDeleteProgram(GLuint program) { ++s_counters.calls; s_programs.erase(program); }
+
+	static void APIENTRY NullDetachShader(GLuint program, GLuint shader)
+	{
+		++s_counters.calls;
+		auto& shaders = s_programs[program].shaders;
+		shaders.erase(std::remove(shaders.begin(), shaders.end(), shader), shaders.end());
+	}
+
+	static void APIENTRY NullLinkProgram(GLuint program)
+	{
+		++s_counters.calls;
+		auto& record = s_programs[program];
+		record.uniforms.clear();
+		record.values.clear();
+
+		for (auto shader : record.shaders)
+		{
+			ReflectUniforms(s_shaderSources[shader], &record.uniforms);
+		}
+
+		GLint location = 0;
+
+		for (auto& uniform : record.uniforms)
+		{
+			uniform.location = location;
+			location += uniform.size;
+		}
+	}
+
+	static void APIENTRY NullUseProgram(GLuint program)
+	{
+		++s_counters.calls;
+		++s_counters.stateChanges;
+		++s_counters.programBinds;
+
+		if (program == s_activeProgram)
+		{
+			++s_counters.redundantProgramBinds;
+		}
+
+		s_activeProgram = program;
+	}
+
+	static void APIENTRY NullDeleteBuffers(GLsizei n, const GLuint* buffers)
+	{
+		++s_counters.calls;
+
+		for (auto i = 0; i < n; ++i)
+		{
+			s_buffers.erase(buffers[i]);
+		}
+	}
+
+	static void APIENTRY NullBindBuffer(GLenum target, GLuint buffer) { ++s_counters.calls; ++s_counters.stateChanges; s_boundBuffers[target] = buffer; }
+	static void APIENTRY NullBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) { ResizeBuffer(s_boundBuffers[target], size, data); }
+	static void APIENTRY NullBufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags) { ResizeBuffer(s_boundBuffers[target], size, data); }
+	static void APIENTRY NullNamedBufferData(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage) { ResizeBuffer(buffer, size, data); }
+	static void APIENTRY NullNamedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data) { memcpy(MapBuffer(buffer, offset, size), data, (size_t)size); }
+	static void* APIENTRY NullMapNamedBuffer(GLuint buffer, GLenum access) { return MapBuffer(buffer, 0, (GLsizeiptr)s_buffers[buffer].size()); }
+	static void* APIENTRY NullMapNamedBufferRange(GLuint buffer, GLintptr offset, GLsizeiptr length, GLbitfield access) { return MapBuffer(buffer, offset, length); }
+	static GLboolean APIENTRY NullUnmapNamedBuffer(GLuint buffer) { ++s_counters.calls; return GL_TRUE; }
+
+	static void APIENTRY NullGetNamedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, void* data)
+	{
+		++s_counters.calls;
+		auto& storage = s_buffers[buffer];
+		memset(data, 0, (size_t)size);
+
+		if ((size_t)offset < storage.size())
+		{
+			auto available = storage.size() - (size_t)offset;
+			memcpy(data, storage.data() + offset, (size_t)size < available ? (size_t)size : available);
+		}
+	}
+
+	static void APIENTRY NullGetShaderiv(GLuint shader, GLenum pname, GLint* params) { ++s_counters.calls; *params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0; }
+	static void APIENTRY NullGetProgramiv(GLuint program, GLenum pname, GLint* params) { ++s_counters.calls; *params = pname == GL_LINK_STATUS ? GL_TRUE : 0; }
+	static GLuint APIENTRY NullGetProgramResourceIndex(GLuint program, GLenum programInterface, const GLchar* name) { ++s_counters.calls; return GL_INVALID_INDEX; }
+	static void APIENTRY NullGetUniformfv(GLuint program, GLint location, GLfloat* params) { ReadUniform(program, location, params); }
+	static void APIENTRY NullGetUniformiv(GLuint program, GLint location, GLint* params) { ReadUniform(program, location, params); }
+	static void APIENTRY NullGetUniformuiv(GLuint program, GLint location, GLuint* params) { ReadUniform(program, location, params); }
+
+	static void APIENTRY NullGetProgramInterfaceiv(GLuint program, GLenum programInterface, GLenum pname, GLint* params)
+	{
+		++s_counters.calls;
+		*params = 0;
+		auto record = s_programs.find(program);
+
+		if (programInterface != GL_UNIFORM || record == s_programs.end())
+		{
+			return;
+		}
+
+		for (auto& uniform : record->second.uniforms)
+		{
+			// Array names are reported with a [0] suffix.
+			auto nameLength = (GLint)uniform.name.size() + 4;
+			*params = pname == GL_ACTIVE_RESOURCES ? *params + 1 : pname == GL_MAX_NAME_LENGTH && nameLength > *params ? nameLength : *params;
+		}
+	}
+
+	static GLint APIENTRY NullGetUniformLocation(GLuint program, const GLchar* name)
+	{
+		++s_counters.calls;
+		auto record = s_programs.find(program);
+
+		if (record == s_programs.end())
+		{
+			return -1;
+		}
+
+		auto bracket = strchr(name, '[');
+		auto nameLength = bracket != nullptr ? (size_t)(bracket - name) : strlen(name);
+		auto element = bracket != nullptr ? atoi(bracket + 1) : 0;
+
+		for (auto& uniform : record->second.uniforms)
+		{
+			if (uniform.name.size() == nameLength && strncmp(uniform.name.c_str(), name, nameLength) == 0)
+			{
+				return element < uniform.size ? uniform.location + element : -1;
+			}
+		}
+
+		return -1;
+	}
+
+	static void APIENTRY NullGetActiveUniformsiv(GLuint program, GLsizei uniformCount, const GLuint* uniformIndices, GLenum pname, GLint* params)
+	{
+		++s_counters.calls;
+
+		// Reflected uniforms never belong to a uniform block.
+		for (auto i = 0; i < uniformCount; ++i)
+		{
+			params[i] = pname == GL_UNIFORM_BLOCK_INDEX ? -1 : 0;
+		}
+	}
+
+	static void WriteEmptyString(GLsizei bufSize, GLsizei* length, GLchar* value)
+	{
+		++s_counters.calls;
+
+		if (length != nullptr)
+		{
+			*length = 0;
+		}
+
+		if (value != nullptr && bufSize > 0)
+		{
+			value[0] = '\0';
+		}
+	}
+
+	static void APIENTRY NullGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog) { WriteEmptyString(bufSize, length, infoLog); }
+	static void APIENTRY NullGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog) { WriteEmptyString(bufSize, length, infoLog); }
+	static void APIENTRY NullGetProgramResourceName(GLuint program, GLenum programInterface, GLuint index, GLsizei bufSize, GLsizei* length, GLchar* name) { WriteEmptyString(bufSize, length, name); }
+
+	static void APIENTRY NullGetActiveUniform(GLuint program, GLuint index, GLsizei bufSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name)
+	{
+		WriteEmptyString(bufSize, length, name);
+		*size = 0;
+		*type = GL_NONE;
+
+		auto record = s_programs.find(program);
+
+		if (record == s_programs.end() || index >= record->second.uniforms.size())
+		{
+			return;
+		}
+
+		auto& uniform = record->second.uniforms.at(index);
+		auto fullName = uniform.size > 1 ? uniform.name + "[0]" : uniform.name;
+		auto written = (GLsizei)fullName.size() < bufSize ? (GLsizei)fullName.size() : bufSize - 1;
+
+		if (written >= 0)
+		{
+			memcpy(name, fullName.c_str(), (size_t)written);
+			name[written] = '\0';
+		}
+
+		if (length != nullptr)
+		{
+			*length = written > 0 ? written : 0;
+		}
+
+		*size = uniform.size;
+		*type = uniform.type;
+	}
+
+	static void APIENTRY NullGetProgramResourceiv(GLuint program, GLenum programInterface, GLuint index, GLsizei propCount, const GLenum* props, GLsizei count, GLsizei* length, GLint* params)
+	{
+		++s_counters.calls;
+		memset(params, 0, sizeof(GLint) * count);
+
+		if (length != nullptr)
+		{
+			*length = count;
+		}
+	}
+
+	static GLenum APIENTRY NullCheckNamedFramebufferStatus(GLuint framebuffer, GLenum target) { ++s_counters.calls; return GL_FRAMEBUFFER_COMPLETE; }
+	static GLuint64 APIENTRY NullGetTextureHandleARB(GLuint texture) { ++s_counters.calls; return s_nextHandle++; }
+	static GLuint64 APIENTRY NullGetImageHandleARB(GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum format) { ++s_counters.calls; return s_nextHandle++; }
+	static GLboolean APIENTRY NullIsTextureHandleResidentARB(GLuint64 handle) { ++s_counters.calls; return GL_FALSE; }
+	static GLboolean APIENTRY NullIsImageHandleResidentARB(GLuint64 handle) { ++s_counters.calls; return GL_FALSE; }
+
+	// Functions that are not listed here are left null. Calling one means that this table is missing an entry.
+	static void* GetProcAddress(const char* name)
+	{
+		#define PK_NULL_GL_ENTRY(name) { "gl" #name, reinterpret_cast<void*>(&Null##name) }
+
+		static const std::unordered_map<std::string, void*> procedures =
+		{
+			PK_NULL_GL_ENTRY(AttachShader),
+			PK_NULL_GL_ENTRY(BindBuffer),
+			PK_NULL_GL_ENTRY(BindBufferBase),
+			PK_NULL_GL_ENTRY(BindFramebuffer),
+			PK_NULL_GL_ENTRY(BindImageTexture),
+			PK_NULL_GL_ENTRY(BindImageTextures),
+			PK_NULL_GL_ENTRY(BindTexture),
+			PK_NULL_GL_ENTRY(BindTextureUnit),
+			PK_NULL_GL_ENTRY(BindTextures),
+			PK_NULL_GL_ENTRY(BindVertexArray),
+			PK_NULL_GL_ENTRY(BlendFunc),
+			PK_NULL_GL_ENTRY(BlitNamedFramebuffer),
+			PK_NULL_GL_ENTRY(BufferData),
+			PK_NULL_GL_ENTRY(BufferStorage),
+			PK_NULL_GL_ENTRY(CheckNamedFramebufferStatus),
+			PK_NULL_GL_ENTRY(Clear),
+			PK_NULL_GL_ENTRY(ClearColor),
+			PK_NULL_GL_ENTRY(ClearDepth),
+			PK_NULL_GL_ENTRY(ClearNamedBufferData),
+			PK_NULL_GL_ENTRY(ClearTexImage),
+			PK_NULL_GL_ENTRY(ColorMask),
+			PK_NULL_GL_ENTRY(CompileShader),
+			PK_NULL_GL_ENTRY(CopyImageSubData),
+			PK_NULL_GL_ENTRY(CreateBuffers),
+			PK_NULL_GL_ENTRY(CreateFramebuffers),
+			PK_NULL_GL_ENTRY(CreateProgram),
+			PK_NULL_GL_ENTRY(CreateShader),
+			PK_NULL_GL_ENTRY(CreateTextures),
+			PK_NULL_GL_ENTRY(CreateVertexArrays),
+			PK_NULL_GL_ENTRY(CullFace),
+			PK_NULL_GL_ENTRY(DebugMessageCallback),
+			PK_NULL_GL_ENTRY(DeleteBuffers),
+			PK_NULL_GL_ENTRY(DeleteFramebuffers),
+			PK_NULL_GL_ENTRY(DeleteProgram),
+			PK_NULL_GL_ENTRY(DeleteQueries),
+			PK_NULL_GL_ENTRY(DeleteShader),
+			PK_NULL_GL_ENTRY(DeleteTextures),
+			PK_NULL_GL_ENTRY(DeleteVertexArrays),
+			PK_NULL_GL_ENTRY(DepthFunc),
+			PK_NULL_GL_ENTRY(DepthMask),
+			PK_NULL_GL_ENTRY(DetachShader),
+			PK_NULL_GL_ENTRY(Disable),
+			PK_NULL_GL_ENTRY(DispatchCompute),
+			PK_NULL_GL_ENTRY(DispatchComputeIndirect),
+			PK_NULL_GL_ENTRY(DrawArrays),
+			PK_NULL_GL_ENTRY(DrawElements),
+			PK_NULL_GL_ENTRY(DrawElementsInstancedBaseInstance),
+			PK_NULL_GL_ENTRY(Enable),
+			PK_NULL_GL_ENTRY(EnableVertexAttribArray),
+			PK_NULL_GL_ENTRY(FrontFace),
+			PK_NULL_GL_ENTRY(GenBuffers),
+			PK_NULL_GL_ENTRY(GenQueries),
+			PK_NULL_GL_ENTRY(GenTextures),
+			PK_NULL_GL_ENTRY(GetActiveUniform),
+			PK_NULL_GL_ENTRY(GetActiveUniformsiv),
+			PK_NULL_GL_ENTRY(GetImageHandleARB),
+			PK_NULL_GL_ENTRY(GetInteger64v),
+			PK_NULL_GL_ENTRY(GetIntegerv),
+			PK_NULL_GL_ENTRY(GetInternalformativ),
+			PK_NULL_GL_ENTRY(GetNamedBufferSubData),
+			PK_NULL_GL_ENTRY(GetProgramInfoLog),
+			PK_NULL_GL_ENTRY(GetProgramInterfaceiv),
+			PK_NULL_GL_ENTRY(GetProgramResourceIndex),
+			PK_NULL_GL_ENTRY(GetProgramResourceName),
+			PK_NULL_GL_ENTRY(GetProgramResourceiv),
+			PK_NULL_GL_ENTRY(GetProgramiv),
+			PK_NULL_GL_ENTRY(GetQueryObjectiv),
+			PK_NULL_GL_ENTRY(GetQueryObjectui64v),
+			PK_NULL_GL_ENTRY(GetShaderInfoLog),
+			PK_NULL_GL_ENTRY(GetShaderiv),
+			PK_NULL_GL_ENTRY(GetString),
+			PK_NULL_GL_ENTRY(GetStringi),
+			PK_NULL_GL_ENTRY(GetTextureHandleARB),
+			PK_NULL_GL_ENTRY(GetUniformLocation),
+			PK_NULL_GL_ENTRY(GetUniformfv),
+			PK_NULL_GL_ENTRY(GetUniformiv),
+			PK_NULL_GL_ENTRY(GetUniformuiv),
+			PK_NULL_GL_ENTRY(InvalidateBufferData),
+			PK_NULL_GL_ENTRY(InvalidateBufferSubData),
+			PK_NULL_GL_ENTRY(InvalidateNamedFramebufferData),
+			PK_NULL_GL_ENTRY(IsImageHandleResidentARB),
+			PK_NULL_GL_ENTRY(IsTextureHandleResidentARB),
+			PK_NULL_GL_ENTRY(LinkProgram),
+			PK_NULL_GL_ENTRY(MakeImageHandleNonResidentARB),
+			PK_NULL_GL_ENTRY(MakeImageHandleResidentARB),
+			PK_NULL_GL_ENTRY(MakeTextureHandleNonResidentARB),
+			PK_NULL_GL_ENTRY(MakeTextureHandleResidentARB),
+			PK_NULL_GL_ENTRY(MapNamedBuffer),
+			PK_NULL_GL_ENTRY(MapNamedBufferRange),
+			PK_NULL_GL_ENTRY(MemoryBarrier),
+			PK_NULL_GL_ENTRY(NamedBufferData),
+			PK_NULL_GL_ENTRY(NamedBufferSubData),
+			PK_NULL_GL_ENTRY(NamedFramebufferDrawBuffer),
+			PK_NULL_GL_ENTRY(NamedFramebufferDrawBuffers),
+			PK_NULL_GL_ENTRY(NamedFramebufferTexture),
+			PK_NULL_GL_ENTRY(QueryCounter),
+			PK_NULL_GL_ENTRY(ReadPixels),
+			PK_NULL_GL_ENTRY(ShaderSource),
+			PK_NULL_GL_ENTRY(ShaderStorageBlockBinding),
+			PK_NULL_GL_ENTRY(TexPageCommitmentARB),
+			PK_NULL_GL_ENTRY(TexStorage2DMultisample),
+			PK_NULL_GL_ENTRY(TexStorage3DMultisample),
+			PK_NULL_GL_ENTRY(TextureParameterf),
+			PK_NULL_GL_ENTRY(TextureParameterfv),
+			PK_NULL_GL_ENTRY(TextureParameteri),
+			PK_NULL_GL_ENTRY(TextureStorage1D),
+			PK_NULL_GL_ENTRY(TextureStorage2D),
+			PK_NULL_GL_ENTRY(TextureStorage3D),
+			PK_NULL_GL_ENTRY(TextureSubImage1D),
+			PK_NULL_GL_ENTRY(TextureSubImage2D),
+			PK_NULL_GL_ENTRY(TextureSubImage3D),
+			PK_NULL_GL_ENTRY(Uniform1fv),
+			PK_NULL_GL_ENTRY(Uniform1iv),
+			PK_NULL_GL_ENTRY(Uniform1uiv),
+			PK_NULL_GL_ENTRY(Uniform2fv),
+			PK_NULL_GL_ENTRY(Uniform2iv),
+			PK_NULL_GL_ENTRY(Uniform2uiv),
+			PK_NULL_GL_ENTRY(Uniform3fv),
+			PK_NULL_GL_ENTRY(Uniform3iv),
+			PK_NULL_GL_ENTRY(Uniform3uiv),
+			PK_NULL_GL_ENTRY(Uniform4fv),
+			PK_NULL_GL_ENTRY(Uniform4iv),
+			PK_NULL_GL_ENTRY(Uniform4uiv),
+			PK_NULL_GL_ENTRY(UniformBlockBinding),
+			PK_NULL_GL_ENTRY(UniformHandleui64vARB),
+			PK_NULL_GL_ENTRY(UniformMatrix2fv),
+			PK_NULL_GL_ENTRY(UniformMatrix3fv),
+			PK_NULL_GL_ENTRY(UniformMatrix4fv),
+			PK_NULL_GL_ENTRY(UnmapNamedBuffer),
+			PK_NULL_GL_ENTRY(UseProgram),
+			PK_NULL_GL_ENTRY(VertexAttribDivisor),
+			PK_NULL_GL_ENTRY(VertexAttribPointer),
+			PK_NULL_GL_ENTRY(Viewport),
+			PK_NULL_GL_ENTRY(ViewportArrayv),
+		};
+
+		#undef PK_NULL_GL_ENTRY
+
+		auto iter = procedures.find(name);
+		return iter != procedures.end() ? iter->second : nullptr;
+	}
+
+	void Initialize()
+	{
+		auto gladstatus = gladLoadGLLoader((GLADloadproc)GetProcAddress);
+		PK_CORE_ASSERT(gladstatus, "Failed To Initialize The Null Graphics Backend");
+		PK_CORE_LOG_HEADER("Null Graphics Backend Initialized");
+		ResetCounters();
+	}
+
+	void Terminate()
+	{
+		s_buffers.clear();
+		s_boundBuffers.clear();
+		s_shaderSources.clear();
+		s_programs.clear();
+		s_activeProgram = 0u;
+	}
+
+	void SetDrawStateHashing(bool enabled) { s_hashDrawState = enabled; }
+
+	const Counters& GetCounters() { return s_counters; }
+
+	void ResetCounters() { s_counters = Counters(); }
+}
\ No newline at end of file
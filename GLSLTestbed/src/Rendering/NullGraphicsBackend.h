@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+
+// Loads no-op entry points for every gl function the renderer uses so that cpu side rendering code can run without a window or a driver.
+// Buffers keep a cpu side copy so that mapped writes have somewhere to go. Calls are counted per category for benchmark reports.
+// Program binds & uniform values are recorded so that redundant calls can be counted & skipped state can be read back.
+// Uniforms are reflected from a textual scan of the shader sources. Preprocessor branches are not evaluated.
+namespace PK::Rendering::NullGraphicsBackend
+{
+    struct Counters
+    {
+        uint64_t calls = 0;
+        uint64_t drawCalls = 0;
+        uint64_t dispatches = 0;
+        uint64_t stateChanges = 0;
+        uint64_t uploadBytes = 0;
+        uint64_t programBinds = 0;
+        uint64_t redundantProgramBinds = 0;
+        uint64_t uniformWrites = 0;
+        // Writes of a value that the uniform already had.
+        uint64_t redundantUniformWrites = 0;
+        // Order dependent hash of the bound program & its uniform values at each draw. Only updated while draw state hashing is enabled.
+        uint64_t drawStateHash = 0;
+    };
+
+    void Initialize();
+    void Terminate();
+
+    void SetDrawStateHashing(bool enabled);
+
+    const Counters& GetCounters();
+    void ResetCounters();
+}
\ No newline at end of file
@@ -72,7 +72,7 @@ namespace PK::Rendering::Objects
 		glNamedBufferSubData(m_graphicsId, 0, size, data);
 	}
 	
-	IndexBuffer::IndexBuffer(uint* indices, uint count, bool immutable) : m_count(count), m_immutable(immutable)
+	IndexBuffer::IndexBuffer(const uint* indices, uint count, bool immutable) : m_count(count), m_immutable(immutable)
 	{
 		glCreateBuffers(1, &m_graphicsId);
 		glBindBuffer(GL_ARRAY_BUFFER, m_graphicsId);
@@ -179,6 +179,11 @@ namespace PK::Rendering::Objects
 		glNamedBufferSubData(m_graphicsId, offset, size, data);
 	}
 
+	void ComputeBuffer::GetData(void* data, size_t offset, size_t size) const
+	{
+		glGetNamedBufferSubData(m_graphicsId, offset, size, data);
+	}
+
 	void ComputeBuffer::Clear(uint32_t clearValue) const
 	{
 		glClearNamedBufferData(m_graphicsId, GL_R32UI, GL_RED, GL_UNSIGNED_INT, &clearValue);
@@ -189,6 +194,12 @@ namespace PK::Rendering::Objects
 		return glMapNamedBufferRange(m_graphicsId, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
     }
 	
+	const void* ComputeBuffer::BeginMapBufferPersistentRead()
+	{
+		PK_CORE_ASSERT(m_immutable, "Cannot persistently map a mutable buffer!");
+		return glMapNamedBufferRange(m_graphicsId, 0, GetSize(), GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+	}
+	
 	void* ComputeBuffer::BeginMapBuffer()
 	{
 		return glMapNamedBuffer(m_graphicsId, GL_WRITE_ONLY | GL_MAP_INVALIDATE_BUFFER_BIT);
@@ -32,7 +32,7 @@ namespace PK::Rendering::Objects
 	class IndexBuffer : public GraphicsObject
 	{
 		public:
-			IndexBuffer(uint* indices, uint count, bool immutable);
+			IndexBuffer(const uint* indices, uint count, bool immutable);
 			~IndexBuffer();
 		
 			inline uint GetCount() const { return m_count; }
@@ -61,10 +61,14 @@ namespace PK::Rendering::Objects
 			void MapBuffer(const void* data, size_t offset, size_t size);
 			void MapBuffer(const void* data, size_t size);
 			void SubmitData(const void* data, size_t offset, size_t size);
+			void GetData(void* data, size_t offset, size_t size) const;
 			void Clear(uint32_t clearValue = 0u) const;
 
 			void* BeginMapBuffer();
 			void* BeginMapBufferRange(size_t offset, size_t size);
+			// The buffer must be immutable & created with GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT.
+			// Stays mapped while the gpu writes to it. Contents are only complete once a fence issued after the writes has signaled.
+			const void* BeginMapBufferPersistentRead();
 	
 			template<typename T>
 			Core::BufferView<T> BeginMapBuffer()
@@ -1,8 +1,10 @@
 #include "PrecompiledHeader.h"
 #include "Rendering/Objects/Material.h"
 #include "Rendering/Objects/TextureXD.h"
+#include "Rendering/TextureStreamer.h"
 #include "Core/Application.h"
 #include "Core/YamlSerializers.h"
+#include "Utilities/BinaryStream.h"
 #include <yaml-cpp/yaml.h>
 
 namespace YAML 
@@ -31,37 +33,67 @@ using namespace PK::Rendering::Structs;
 using namespace PK::Rendering::Objects;
 using namespace PK::Math;
 
+const char* Material::GetInstancedProperties() const
+{
+	auto& layout = m_shader->GetInstancingInfo().propertyLayout;
+
+	if (m_cachedInstancedVersion != GetVersion() || m_cachedInstancedProperties.size() != layout.GetPaddedStride())
+	{
+		m_cachedInstancedProperties.assign(layout.GetPaddedStride(), 0);
+		CopyBufferLayout(layout, m_cachedInstancedProperties.data());
+		m_cachedInstancedVersion = GetVersion();
+	}
+
+	return m_cachedInstancedProperties.data();
+}
+
 template<>
 bool AssetImporters::IsValidExtension<Material>(const std::filesystem::path& extension) { return extension.compare(".material") == 0; }
 
-template<>
-void AssetImporters::Import(const std::string& filepath, Ref<Material>& material)
+// Materials are parsed into the cooked layout. Uncooked imports go through the same path as cooked ones.
+static void SerializeMaterial(const YAML::Node& root, const std::string& filepath, std::vector<char>& data)
 {
-    material->Clear();
-
-	YAML::Node root = YAML::LoadFile(filepath);
+	BinaryWriter writer(data);
 
-	auto data = root["Material"];
-	PK_CORE_ASSERT(data, "Could not locate material (%s) header in file.", filepath.c_str());
+	auto material = root["Material"];
+	PK_CORE_ASSERT(material, "Could not locate material (%s) header in file.", filepath.c_str());
 	
-	auto shaderPathProp = data["Shader"];
+	auto shaderPathProp = material["Shader"];
 	PK_CORE_ASSERT(shaderPathProp, "Material (%s) doesn't define a shader.", filepath.c_str());
+	writer.WriteString(shaderPathProp.as<std::string>());
 
-	auto shaderPath = shaderPathProp.as<std::string>();
-	material->m_shader = Application::GetService<AssetDatabase>()->Load<Shader>(shaderPath);
-	material->m_cachedShaderAssetId = material->m_shader->GetAssetID();
+	auto queue = material["Queue"];
+	auto overrideRenderQueue = queue ? 1 : 0;
+	auto renderQueue = RenderQueue::Opaque;
 
-	auto keywords = data["Keywords"];
+	if (queue)
+	{
+		auto queueName = queue.as<std::string>();
+		PK_CORE_ASSERT(queueName == "Opaque" || queueName == "Transparent", "Material (%s) has an unknown render queue (%s).", filepath.c_str(), queueName.c_str());
+		renderQueue = GetRenderQueueFromString(queueName, RenderQueue::Opaque);
+	}
+
+	writer.Write((uint8_t)overrideRenderQueue);
+	writer.Write(renderQueue);
+
+	auto occluder = material["Occluder"];
+	writer.Write((uint8_t)(occluder ? occluder.as<bool>() : true));
+
+	auto keywords = material["Keywords"];
+	writer.Write((uint)(keywords ? keywords.size() : 0));
 	
 	if (keywords)
 	{
 		for (auto keyword : keywords)
 		{
-			material->SetKeyword(StringHashID::StringToID(keyword.as<std::string>()), true);
+			writer.WriteString(keyword.as<std::string>());
 		}
 	}
 
-	auto properties = data["Properties"];
+	std::vector<char> propertyData;
+	BinaryWriter propertyWriter(propertyData);
+	auto propertyCount = 0u;
+	auto properties = material["Properties"];
 
 	if (properties)
 	{
@@ -76,33 +108,106 @@ void AssetImporters::Import(const std::string& filepath, Ref<Material>& material
 				continue;
 			}
 
-			auto nameHash = StringHashID::StringToID(propertyName);
 			auto typeName = type.as<std::string>();
 			auto typeIdx = Convert::FromString(typeName.c_str());
 			auto values = property.second["Value"];
 
+			std::vector<char> value;
+			BinaryWriter valueWriter(value);
+
 			switch (typeIdx)
 			{
-				case PK_TYPE::FLOAT: material->SetFloat(nameHash, values.as<float>()); break;
-				case PK_TYPE::FLOAT2: material->SetFloat2(nameHash, values.as<float2>()); break;
-				case PK_TYPE::FLOAT3: material->SetFloat3(nameHash, values.as<float3>()); break;
-				case PK_TYPE::FLOAT4: material->SetFloat4(nameHash, values.as<float4>()); break;
-				case PK_TYPE::FLOAT2X2: material->SetFloat2x2(nameHash, values.as<float2x2>()); break;
-				case PK_TYPE::FLOAT3X3: material->SetFloat3x3(nameHash, values.as<float3x3>()); break;
-				case PK_TYPE::FLOAT4X4: material->SetFloat4x4(nameHash, values.as<float4x4>()); break;
-				case PK_TYPE::INT: material->SetInt(nameHash, values.as<int>()); break;
-				case PK_TYPE::INT2: material->SetInt2(nameHash, values.as<int2>()); break;
-				case PK_TYPE::INT3: material->SetInt3(nameHash, values.as<int3>()); break;
-				case PK_TYPE::INT4: material->SetInt4(nameHash, values.as<int4>()); break;
-				case PK_TYPE::TEXTURE: 
-				{
-					auto texture = values.as<TextureXD*>();
-					texture->MakeHandleResident();
-					auto handle = texture->GetBindlessHandle();
-					material->SetResourceHandle(nameHash, handle); break;
-				}
-				break;
+				case PK_TYPE::FLOAT: valueWriter.Write(values.as<float>()); break;
+				case PK_TYPE::FLOAT2: valueWriter.Write(values.as<float2>()); break;
+				case PK_TYPE::FLOAT3: valueWriter.Write(values.as<float3>()); break;
+				case PK_TYPE::FLOAT4: valueWriter.Write(values.as<float4>()); break;
+				case PK_TYPE::FLOAT2X2: valueWriter.Write(values.as<float2x2>()); break;
+				case PK_TYPE::FLOAT3X3: valueWriter.Write(values.as<float3x3>()); break;
+				case PK_TYPE::FLOAT4X4: valueWriter.Write(values.as<float4x4>()); break;
+				case PK_TYPE::INT: valueWriter.Write(values.as<int>()); break;
+				case PK_TYPE::INT2: valueWriter.Write(values.as<int2>()); break;
+				case PK_TYPE::INT3: valueWriter.Write(values.as<int3>()); break;
+				case PK_TYPE::INT4: valueWriter.Write(values.as<int4>()); break;
+				case PK_TYPE::TEXTURE: valueWriter.WriteString(values.as<std::string>()); break;
+				default: continue;
 			}
+
+			propertyWriter.WriteString(propertyName);
+			propertyWriter.Write(typeIdx);
+			propertyWriter.WriteArray(value.data(), value.size());
+			propertyCount++;
 		}
 	}
+
+	writer.Write(propertyCount);
+	writer.WriteArray(propertyData.data(), propertyData.size());
 }
+
+template<>
+bool AssetImporters::Cook<Material>(const std::string& filepath, const std::string& source, std::vector<char>& data)
+{
+	SerializeMaterial(YAML::Load(source), filepath, data);
+	return true;
+}
+
+template<>
+void AssetImporters::ImportCooked(const std::string& filepath, const char* data, size_t size, Ref<Material>& material)
+{
+    material->Clear();
+
+	BinaryReader reader(data, size);
+	auto shaderPath = reader.ReadString();
+	material->m_shader = Application::GetService<AssetDatabase>()->Load<Shader>(shaderPath);
+	material->m_cachedShaderAssetId = material->m_shader->GetAssetID();
+	material->m_overrideRenderQueue = reader.Read<uint8_t>() != 0;
+	material->m_renderQueue = reader.Read<RenderQueue>();
+	material->m_isOccluder = reader.Read<uint8_t>() != 0;
+
+	auto keywordCount = reader.Read<uint>();
+
+	for (auto i = 0u; i < keywordCount && reader.IsValid(); ++i)
+	{
+		material->SetKeyword(StringHashID::StringToID(reader.ReadString()), true);
+	}
+
+	auto propertyCount = reader.Read<uint>();
+
+	for (auto i = 0u; i < propertyCount && reader.IsValid(); ++i)
+	{
+		auto nameHash = StringHashID::StringToID(reader.ReadString());
+		auto type = reader.Read<PK_TYPE>();
+
+		if (type != PK_TYPE::TEXTURE)
+		{
+			char value[sizeof(float4x4)];
+			auto valueSize = Convert::Size(type);
+			PK_CORE_ASSERT(valueSize <= sizeof(value), "Material (%s) has an unsupported property type.", filepath.c_str());
+			reader.ReadArray(value, valueSize);
+			material->SetValue(nameHash, type, value, 1);
+			continue;
+		}
+
+		auto texturePath = reader.ReadString();
+		auto textureStreamer = PK::Rendering::TextureStreamer::Get();
+		auto assetDatabase = Application::GetService<AssetDatabase>();
+		auto texture = textureStreamer != nullptr ? textureStreamer->Load(texturePath) : assetDatabase->Load<TextureXD>(texturePath);
+		texture->MakeHandleResident();
+		auto handle = texture->GetBindlessHandle();
+		material->SetResourceHandle(nameHash, handle);
+
+		if (textureStreamer != nullptr)
+		{
+			textureStreamer->AddMaterialTexture(material.get(), nameHash, texture);
+		}
+	}
+
+	PK_CORE_ASSERT(reader.IsValid(), "Material (%s) data is truncated.", filepath.c_str());
+}
+
+template<>
+void AssetImporters::Import(const std::string& filepath, Ref<Material>& material)
+{
+	std::vector<char> data;
+	SerializeMaterial(YAML::LoadFile(filepath), filepath, data);
+	AssetImporters::ImportCooked<Material>(filepath, data.data(), data.size(), material);
+}
\ No newline at end of file
@@ -11,6 +11,7 @@ namespace PK::Rendering::Objects
     class Material : public ShaderPropertyBlock, public Asset
     {
         friend void AssetImporters::Import(const std::string& filepath, Ref<Material>& material);
+        friend void AssetImporters::ImportCooked(const std::string& filepath, const char* data, size_t size, Ref<Material>& material);
     
         public:
             Material() {}
@@ -20,10 +21,20 @@ namespace PK::Rendering::Objects
             inline bool SupportsKeyword(const uint32_t hashId) const { return m_shader->SupportsKeyword(hashId); }
             inline bool SupportsKeywords(const uint32_t* hashIds, const uint32_t count) const { return m_shader->SupportsKeywords(hashIds, count); }
             inline const bool SupportsInstancing() const { return m_shader->GetInstancingInfo().supportsInstancing; }
+            inline RenderQueue GetRenderQueue() const { return m_overrideRenderQueue ? m_renderQueue : m_shader->GetRenderQueue(); }
+            // Opaque materials occlude unless their file sets Occluder: false, e.g. for alpha tested surfaces. Other queues never occlude.
+            inline bool IsOccluder() const { return m_isOccluder && GetRenderQueue() == RenderQueue::Opaque; }
+
+            // Instanced properties packed in the instancing layout of the shader. Repacked only after the material has been written to.
+            const char* GetInstancedProperties() const;
 
         private:
-            std::vector<char> m_cachedInstancedProperties;
+            mutable std::vector<char> m_cachedInstancedProperties;
+            mutable ulong m_cachedInstancedVersion = ~0ull;
             AssetID m_cachedShaderAssetId = 0;
             Shader* m_shader = nullptr;
+            RenderQueue m_renderQueue = RenderQueue::Opaque;
+            bool m_overrideRenderQueue = false;
+            bool m_isOccluder = true;
     };
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "Rendering/Objects/Mesh.h"
 #include "Rendering/GraphicsAPI.h"
 #include "Rendering/MeshUtility.h"
+#include "Utilities/BinaryStream.h"
 #include <glad/glad.h>
 #include <hlslmath.h>
 #include <tinyobjloader/tiny_obj_loader.h>
@@ -106,90 +107,211 @@ namespace PK::Rendering::Objects
 		auto idx = glm::min((uint)submesh, (uint)m_indexRanges.size());
 		return m_indexRanges.at(idx);
 	}
-	
-}
-
-template<>
-bool PK::Core::AssetImporters::IsValidExtension<PK::Rendering::Objects::Mesh>(const std::filesystem::path& extension) { return extension.compare(".mdl") == 0; }
-
-template<>
-void PK::Core::AssetImporters::Import(const std::string& filepath, Ref<PK::Rendering::Objects::Mesh>& mesh)
-{
-	using namespace PK::Rendering::Objects;
-	using namespace PK::Rendering::Structs;
 
-	if (mesh->m_graphicsId)
+	void Mesh::SetOccluderGeometry(const float3* vertices, uint vertexCount, const uint* indices, uint indexCount)
 	{
-		glDeleteVertexArrays(1, &mesh->m_graphicsId);
+		m_occluderVertices.assign(vertices, vertices + vertexCount);
+		m_occluderIndices.assign(indices, indices + indexCount);
 	}
 
-	glCreateVertexArrays(1, &mesh->m_graphicsId);
+	void Mesh::ResetGeometry()
+	{
+		if (m_graphicsId)
+		{
+			glDeleteVertexArrays(1, &m_graphicsId);
+		}
 
-	mesh->m_vertexBufferIndex = 0;
-	mesh->m_vertexBuffers.clear();
-	mesh->m_indexBuffer = nullptr;
-	mesh->m_indexRanges.clear();
+		glCreateVertexArrays(1, &m_graphicsId);
+
+		m_vertexBufferIndex = 0;
+		m_vertexBuffers.clear();
+		m_indexBuffer = nullptr;
+		m_indexRanges.clear();
+		m_occluderVertices.clear();
+		m_occluderIndices.clear();
+	}
+
+	struct MeshGeometry
+	{
+		std::vector<Vertex_Full> vertices;
+		std::vector<uint> indices;
+		std::vector<IndexRange> submeshes;
+		BoundingBox bounds;
+	};
 
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string err;
+	static void ReadObjGeometry(const std::string& filepath, std::istream& stream, MeshGeometry* geometry)
+	{
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string err;
+		tinyobj::MaterialFileReader materialReader(Utilities::String::ReadDirectory(filepath));
 	
-	bool success = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filepath.c_str(), Utilities::String::ReadDirectory(filepath).c_str(), true);
+		bool success = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, &stream, &materialReader, true);
+
+		PK_CORE_ASSERT(err.empty(), err.c_str());
+		PK_CORE_ASSERT(!attrib.vertices.empty(), "Mesh doesn't contain vertices");
+		PK_CORE_ASSERT(!attrib.normals.empty(), "Mesh doesn't contain normals");
+		PK_CORE_ASSERT(!attrib.texcoords.empty(), "Mesh doesn't contain uvs");
+		PK_CORE_ASSERT(success, "Failed to load .obj");
 
-	PK_CORE_ASSERT(err.empty(), err.c_str());
-	PK_CORE_ASSERT(!attrib.vertices.empty(), "Mesh doesn't contain vertices");
-	PK_CORE_ASSERT(!attrib.normals.empty(), "Mesh doesn't contain normals");
-	PK_CORE_ASSERT(!attrib.texcoords.empty(), "Mesh doesn't contain uvs");
-	PK_CORE_ASSERT(success, "Failed to load .obj");
+		uint indexCount = 0;
+		auto& indices = geometry->indices;
+		auto& vertices = geometry->vertices;
+		float3 minpos =  PK_FLOAT3_ONE * std::numeric_limits<float>().max();
+		float3 maxpos = -PK_FLOAT3_ONE * std::numeric_limits<float>().max();
 
-	uint indexCount = 0;
-	std::vector<uint> indices;
-	std::vector<PK::Rendering::Structs::IndexRange> submeshes;
-	std::vector<PK::Rendering::Structs::Vertex_Full> vertices;
-	float3 minpos =  PK_FLOAT3_ONE * std::numeric_limits<float>().max();
-	float3 maxpos = -PK_FLOAT3_ONE * std::numeric_limits<float>().max();
+		auto invertices = attrib.vertices.data();
+		auto innormals = attrib.normals.data();
+		auto inuvs = attrib.texcoords.data();
 
-	auto invertices = attrib.vertices.data();
-	auto innormals = attrib.normals.data();
-	auto inuvs = attrib.texcoords.data();
+		auto index = 0;
 
-	auto index = 0;
+		for (size_t i = 0; i < shapes.size(); ++i) 
+		{
+			auto& tris = shapes.at(i).mesh.indices;
+			auto tcount = (uint)tris.size();
 
-	for (size_t i = 0; i < shapes.size(); ++i) 
+			geometry->submeshes.push_back({ indexCount, tcount });
+
+			for (uint j = 0; j < tcount; ++j)
+			{
+				auto& tri = tris.at(j);
+
+				indices.push_back(index++);
+
+				Vertex_Full v;
+				v.position = *reinterpret_cast<float3*>(invertices + tri.vertex_index * 3);
+				v.normal = *reinterpret_cast<float3*>(innormals + tri.normal_index * 3);
+				v.tangent = PK_FLOAT4_ZERO;
+				v.texcoord = *reinterpret_cast<float2*>(inuvs + tri.texcoord_index * 2);
+				vertices.push_back(v);
+
+				maxpos = glm::max(v.position, maxpos);
+				minpos = glm::min(v.position, minpos);
+			}
+
+			indexCount += tcount;
+		}
+
+		MeshUtility::CalculateTangents(reinterpret_cast<float*>(vertices.data()), sizeof(Vertex_Full) / 4, 0, 3, 6, 10, indices.data(), (uint)vertices.size(), (uint)indices.size());
+		geometry->bounds = Functions::CreateBoundsMinMax(minpos, maxpos);
+	}
+
+	// Obj faces are read with a vertex per index. Vertices that are equal in every attribute, tangents included, are merged.
+	static void WeldVertices(MeshGeometry* geometry)
 	{
-		auto& tris = shapes.at(i).mesh.indices;
-		auto tcount = (uint)tris.size();
+		struct VertexHash
+		{
+			size_t operator()(const Vertex_Full& v) const
+			{
+				// FNV-1a
+				auto bytes = reinterpret_cast<const unsigned char*>(&v);
+				auto hash = 14695981039346656037ull;
 
-		submeshes.push_back({ indexCount, tcount });
+				for (size_t i = 0; i < sizeof(Vertex_Full); ++i)
+				{
+					hash ^= bytes[i];
+					hash *= 1099511628211ull;
+				}
+
+				return (size_t)hash;
+			}
+		};
 
-		for (uint j = 0; j < tcount; ++j)
+		struct VertexEqual
 		{
-			auto& tri = tris.at(j);
+			bool operator()(const Vertex_Full& a, const Vertex_Full& b) const { return memcmp(&a, &b, sizeof(Vertex_Full)) == 0; }
+		};
 
-			indices.push_back(index++);
+		std::unordered_map<Vertex_Full, uint, VertexHash, VertexEqual> vertexIndices;
+		std::vector<Vertex_Full> vertices;
+		vertexIndices.reserve(geometry->vertices.size());
 
-			PK::Rendering::Structs::Vertex_Full v;
-			v.position = *reinterpret_cast<float3*>(invertices + tri.vertex_index * 3);
-			v.normal = *reinterpret_cast<float3*>(innormals + tri.normal_index * 3);
-			v.tangent = PK_FLOAT4_ZERO;
-			v.texcoord = *reinterpret_cast<float2*>(inuvs + tri.texcoord_index * 2);
-			vertices.push_back(v);
+		for (auto& index : geometry->indices)
+		{
+			auto& vertex = geometry->vertices.at(index);
+			auto iter = vertexIndices.find(vertex);
 
-			maxpos = glm::max(v.position, maxpos);
-			minpos = glm::min(v.position, minpos);
+			if (iter == vertexIndices.end())
+			{
+				iter = vertexIndices.emplace(vertex, (uint)vertices.size()).first;
+				vertices.push_back(vertex);
+			}
+
+			index = iter->second;
 		}
 
-		indexCount += tcount;
+		geometry->vertices.swap(vertices);
+	}
+
+	static void SetGeometry(Mesh* mesh, const MeshGeometry& geometry)
+	{
+		BufferLayout layout = { {PK_TYPE::FLOAT3, "POSITION"}, {PK_TYPE::FLOAT3, "NORMAL"}, {PK_TYPE::FLOAT4, "TANGENT"}, {PK_TYPE::FLOAT2, "TEXCOORD0"} };
+
+		mesh->SetLocalBounds(geometry.bounds);
+		mesh->AddVertexBuffer(CreateRef<VertexBuffer>(geometry.vertices.data(), geometry.vertices.size(), layout, true));
+		mesh->SetIndexBuffer(CreateRef<IndexBuffer>(geometry.indices.data(), (uint)geometry.indices.size(), true));
+		mesh->SetSubMeshes(geometry.submeshes);
+
+		// Low poly meshes keep a cpu side copy of their positions for software occlusion rasterization.
+		if (geometry.indices.size() / 3 <= Mesh::MaxOccluderTriangleCount)
+		{
+			std::vector<float3> positions;
+			positions.reserve(geometry.vertices.size());
+
+			for (auto& vertex : geometry.vertices)
+			{
+				positions.push_back(vertex.position);
+			}
+
+			mesh->SetOccluderGeometry(positions.data(), (uint)positions.size(), geometry.indices.data(), (uint)geometry.indices.size());
+		}
 	}
+}
 
+template<>
+bool PK::Core::AssetImporters::IsValidExtension<PK::Rendering::Objects::Mesh>(const std::filesystem::path& extension) { return extension.compare(".mdl") == 0; }
 
-	BufferLayout layout = { {PK_TYPE::FLOAT3, "POSITION"}, {PK_TYPE::FLOAT3, "NORMAL"}, {PK_TYPE::FLOAT4, "TANGENT"}, {PK_TYPE::FLOAT2, "TEXCOORD0"} };
+template<>
+void PK::Core::AssetImporters::Import(const std::string& filepath, Ref<PK::Rendering::Objects::Mesh>& mesh)
+{
+	mesh->ResetGeometry();
+
+	PK::Rendering::Objects::MeshGeometry geometry;
+	std::ifstream stream(filepath);
+	PK::Rendering::Objects::ReadObjGeometry(filepath, stream, &geometry);
+	PK::Rendering::Objects::SetGeometry(mesh.get(), geometry);
+}
+
+template<>
+bool PK::Core::AssetImporters::Cook<PK::Rendering::Objects::Mesh>(const std::string& filepath, const std::string& source, std::vector<char>& data)
+{
+	PK::Rendering::Objects::MeshGeometry geometry;
+	std::istringstream stream(source);
+	PK::Rendering::Objects::ReadObjGeometry(filepath, stream, &geometry);
+	PK::Rendering::Objects::WeldVertices(&geometry);
+
+	PK::Utilities::BinaryWriter writer(data);
+	writer.Write(geometry.bounds);
+	writer.WriteVector(geometry.submeshes);
+	writer.WriteVector(geometry.vertices);
+	writer.WriteVector(geometry.indices);
+	return true;
+}
+
+template<>
+void PK::Core::AssetImporters::ImportCooked(const std::string& filepath, const char* data, size_t size, Ref<PK::Rendering::Objects::Mesh>& mesh)
+{
+	mesh->ResetGeometry();
 
-	PK::Rendering::MeshUtility::CalculateTangents(reinterpret_cast<float*>(vertices.data()), layout.GetStride() / 4, 0, 3, 6, 10, indices.data(), (uint)vertices.size(), (uint)indices.size());
+	PK::Rendering::Objects::MeshGeometry geometry;
+	PK::Utilities::BinaryReader reader(data, size);
+	geometry.bounds = reader.Read<PK::Math::BoundingBox>();
+	reader.ReadVector(geometry.submeshes);
+	reader.ReadVector(geometry.vertices);
+	reader.ReadVector(geometry.indices);
 
-	mesh->SetLocalBounds(PK::Math::Functions::CreateBoundsMinMax(minpos, maxpos));
-	mesh->AddVertexBuffer(CreateRef<VertexBuffer>(vertices.data(), vertices.size(), layout, true));
-	mesh->SetIndexBuffer(CreateRef<IndexBuffer>(indices.data(), (uint)indices.size(), true));
-	mesh->SetSubMeshes(submeshes);
+	PK_CORE_ASSERT(reader.IsValid(), "Cooked mesh (%s) is truncated.", filepath.c_str());
+	PK::Rendering::Objects::SetGeometry(mesh.get(), geometry);
 }
\ No newline at end of file
@@ -13,8 +13,11 @@ namespace PK::Rendering::Objects
 	class Mesh : public GraphicsObject, public Asset
 	{
 		friend void AssetImporters::Import(const std::string& filepath, Ref<Mesh>& mesh);
+		friend void AssetImporters::ImportCooked(const std::string& filepath, const char* data, size_t size, Ref<Mesh>& mesh);
 	
 		public:
+			static constexpr uint MaxOccluderTriangleCount = 4096;
+
 			Mesh();
 			Mesh(const Ref<VertexBuffer>& vertexBuffer, const Ref<IndexBuffer>& indexBuffer);
 			~Mesh();
@@ -30,12 +33,21 @@ namespace PK::Rendering::Objects
 			inline const uint GetSubmeshCount() const { return glm::max(1, (int)m_indexRanges.size()); }
 			inline const BoundingBox& GetLocalBounds() const { return m_localBounds; }
 			inline void SetLocalBounds(const BoundingBox& bounds) { m_localBounds = bounds; }
+			inline bool HasOccluderGeometry() const { return !m_occluderIndices.empty(); }
+			inline const std::vector<float3>& GetOccluderVertices() const { return m_occluderVertices; }
+			inline const std::vector<uint>& GetOccluderIndices() const { return m_occluderIndices; }
+			void SetOccluderGeometry(const float3* vertices, uint vertexCount, const uint* indices, uint indexCount);
 	
 		private:
+			// Recreates the vertex array & releases all geometry. Used when the mesh is imported again.
+			void ResetGeometry();
+
 			uint32_t m_vertexBufferIndex = 0;
 			std::vector<Ref<VertexBuffer>> m_vertexBuffers;
 			Ref<IndexBuffer> m_indexBuffer;
 			std::vector<IndexRange> m_indexRanges;
 			BoundingBox m_localBounds;
+			std::vector<float3> m_occluderVertices;
+			std::vector<uint> m_occluderIndices;
 	};
 }
\ No newline at end of file
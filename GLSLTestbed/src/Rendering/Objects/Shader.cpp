@@ -4,6 +4,7 @@
 #include "Utilities/StringHashID.h"
 #include "Utilities/StringUtilities.h"
 #include "Utilities/Log.h"
+#include "Core/Profiler.h"
 #include <hlslmath.h>
 
 namespace PK::Rendering::Objects
@@ -12,28 +13,6 @@ namespace PK::Rendering::Objects
 	using namespace PK::Rendering::Structs;
 	using namespace PK::Math;
 
-	void ShaderVariantMap::Reset()
-	{
-		for (auto& i : directives)
-		{
-			i = i & 0xFFFFFF;
-		}
-	}
-	
-	void ShaderVariantMap::SetKeywords(const uint32_t* hashIds, size_t count)
-	{
-		for (size_t i = 0; i < count; ++i)
-		{
-			auto hashId = hashIds[i];
-	
-			if (keywords.count(hashId) > 0)
-			{
-				auto kv = keywords.at(hashId);
-				directives[kv >> 4] = ((kv & 0xF) << 24) | (directives[kv >> 4] & 0xFFFFFF);
-			}
-		}
-	}
-
 	void ShaderVariantMap::ListVariants()
 	{
 		std::vector<std::vector<std::string>> keywordlist;
@@ -41,8 +20,19 @@ namespace PK::Rendering::Objects
 		for (auto& kv : keywords)
 		{
 			auto keyword = StringHashID::IDToString(kv.first);
-			auto index0 = (kv.second >> 4) & 0xF;
-			auto index1 = kv.second & 0xF;
+			auto bit = 1ull << kv.second;
+			auto index0 = 0u;
+			auto index1 = 0u;
+
+			while (index0 < directivecount && (directivemasks[index0] & bit) == 0)
+			{
+				++index0;
+			}
+
+			while (directiveoffsets[index0] + index1 < directiveoffsets[index0 + 1] && (optionmasks[directiveoffsets[index0] + index1] & bit) == 0)
+			{
+				++index1;
+			}
 
 			if (keywordlist.size() <= index0)
 			{
@@ -97,23 +87,91 @@ namespace PK::Rendering::Objects
 		return true;
 	}
 
-	uint32_t ShaderVariantMap::GetActiveIndex() const
+	KeywordMask ShaderVariantMap::GetKeywordMask(const KeywordSet& keywordSet) const
+	{
+		KeywordMask mask = 0ull;
+
+		for (auto i = 0u; i < keywordSet.count; ++i)
+		{
+			auto iterator = keywords.find(keywordSet.hashIds[i]);
+
+			if (iterator != keywords.end())
+			{
+				mask |= 1ull << iterator->second;
+			}
+		}
+
+		return mask;
+	}
+
+	uint32_t ShaderVariantMap::GetVariantIndex(KeywordMask keywords0, KeywordMask keywords1, KeywordMask keywords2) const
 	{
 		uint32_t idx = 0;
 	
 		for (uint32_t i = 0; i < directivecount; ++i)
 		{
-			idx += (directives[i] & 0xFFFFFF) * (directives[i] >> 24);
+			auto mask = directivemasks[i];
+			auto bits = (keywords2 & mask) != 0 ? keywords2 & mask : (keywords1 & mask) != 0 ? keywords1 & mask : keywords0 & mask;
+
+			if (bits == 0)
+			{
+				continue;
+			}
+
+			for (auto j = directiveoffsets[i]; j < directiveoffsets[i + 1]; ++j)
+			{
+				if ((bits & optionmasks[j]) != 0)
+				{
+					idx += directives[i] * (j - directiveoffsets[i]);
+					break;
+				}
+			}
 		}
 	
 		return idx;
 	}
 	
 	
+	static bool IsCachedUniformType(PK_TYPE type) { return type >= PK_TYPE::FLOAT && type <= PK_TYPE::UINT4; }
+
+	// Reads the value of a skipped write back from the program. Only used when state validation is enabled.
+	static bool IsUniformValueCurrent(GraphicsID program, const ShaderBinding& info, const char* value)
+	{
+		// Large enough for a float4x4.
+		uint32_t current[16];
+
+		if (info.type <= PK_TYPE::FLOAT4X4)
+		{
+			glGetUniformfv(program, info.location, reinterpret_cast<float*>(current));
+		}
+		else if (info.type <= PK_TYPE::INT4)
+		{
+			glGetUniformiv(program, info.location, reinterpret_cast<int*>(current));
+		}
+		else
+		{
+			glGetUniformuiv(program, info.location, current);
+		}
+
+		return memcmp(current, value, Convert::Size(info.type)) == 0;
+	}
+
 	ShaderVariant::ShaderVariant(GraphicsID graphicsId, const std::map<uint32_t, ShaderPropertyInfo>& properties)
 	{
 		m_graphicsId = graphicsId;
 		m_properties = properties;
+
+		// Each cached value is prefixed by a byte that is set once the value has been written.
+		for (auto& kv : m_properties)
+		{
+			auto& info = kv.second;
+
+			if (info.arraySize == 1 && IsCachedUniformType(info.type))
+			{
+				info.cacheOffset = (uint32_t)m_uniformCache.size();
+				m_uniformCache.resize(m_uniformCache.size() + 1 + Convert::Size(info.type), 0);
+			}
+		}
 	}
 	
 	ShaderVariant::~ShaderVariant() { glDeleteProgram(m_graphicsId); }
@@ -126,45 +184,111 @@ namespace PK::Rendering::Objects
 		}
 	}
 	
-	void ShaderVariant::SetPropertyBlock(const ShaderPropertyBlock& propertyBlock)
+	bool ShaderVariant::UpdateUniformCache(const ShaderBinding& binding, const char* value)
 	{
-		for (auto& i : propertyBlock)
+		auto* cached = m_uniformCache.data() + binding.cacheOffset;
+		auto size = Convert::Size(binding.type);
+
+		if (cached[0] != 0 && GraphicsAPI::IsStateCachingEnabled() && memcmp(cached + 1, value, size) == 0)
 		{
-			auto& hashId = i.first;
-	
-			if (m_properties.count(hashId) < 1)
+			if (GraphicsAPI::IsStateValidationEnabled() && !IsUniformValueCurrent(m_graphicsId, binding, value))
+			{
+				++GraphicsAPI::GetStateCacheCounters().validationFailures;
+				PK_CORE_LOG_WARNING("Skipped uniform write does not match program state. program: %u, location: %u", m_graphicsId, binding.location);
+			}
+
+			return false;
+		}
+
+		cached[0] = 1;
+		memcpy(cached + 1, value, size);
+		return true;
+	}
+
+	const std::vector<ShaderBinding>& ShaderVariant::GetBindingTable(const ShaderPropertyBlock& propertyBlock)
+	{
+		auto iter = m_bindingTables.find(propertyBlock.GetLayoutHash());
+
+		if (iter != m_bindingTables.end())
+		{
+			return iter->second;
+		}
+
+		auto& table = m_bindingTables[propertyBlock.GetLayoutHash()];
+
+		for (auto& info : propertyBlock)
+		{
+			auto prop = m_properties.find(info.hashId);
+
+			if (prop == m_properties.end())
 			{
 				continue;
 			}
+
+			ShaderBinding binding;
+			binding.offset = info.offset;
+			binding.cacheOffset = prop->second.cacheOffset;
+			binding.location = prop->second.location;
+			binding.count = (ushort)(info.size / Convert::Size(info.type));
+			binding.type = info.type;
+			binding.isCached = binding.cacheOffset != 0xFFFFFFFF && info.type == prop->second.type && binding.count == 1;
+			table.push_back(binding);
+		}
+
+		return table;
+	}
+
+	void ShaderVariant::SetPropertyBlock(const ShaderPropertyBlock& propertyBlock)
+	{
+		auto& counters = GraphicsAPI::GetStateCacheCounters();
+		auto* data = propertyBlock.GetData();
+
+		for (auto& binding : GetBindingTable(propertyBlock))
+		{
+			auto* value = data + binding.offset;
+			auto location = binding.location;
+			auto count = binding.count;
+
+			if (binding.isCached)
+			{
+				if (!UpdateUniformCache(binding, value))
+				{
+					++counters.uniformWritesElided;
+					continue;
+				}
+			}
+			else if (binding.cacheOffset != 0xFFFFFFFF)
+			{
+				m_uniformCache[binding.cacheOffset] = 0;
+			}
+
+			if (binding.type <= PK_TYPE::HANDLE)
+			{
+				++counters.uniformWrites;
+			}
 	
-			const auto& prop = m_properties.at(hashId);
-
-			auto& info = i.second;
-			uint count = info.size / Convert::Size(info.type);
-			auto components = Convert::Components(info.type);
-	
-			switch (info.type)
-			{
-				case PK_TYPE::FLOAT: glUniform1fv(prop.location, count, propertyBlock.GetElementPtr<float>(info)); break;
-				case PK_TYPE::FLOAT2: glUniform2fv(prop.location, count, propertyBlock.GetElementPtr<float>(info)); break;
-				case PK_TYPE::FLOAT3: glUniform3fv(prop.location, count, propertyBlock.GetElementPtr<float>(info)); break;
-				case PK_TYPE::FLOAT4: glUniform4fv(prop.location, count, propertyBlock.GetElementPtr<float>(info)); break;
-				case PK_TYPE::FLOAT2X2: glUniformMatrix2fv(prop.location, count, GL_FALSE, propertyBlock.GetElementPtr<float>(info)); break;
-				case PK_TYPE::FLOAT3X3: glUniformMatrix3fv(prop.location, count, GL_FALSE, propertyBlock.GetElementPtr<float>(info)); break;
-				case PK_TYPE::FLOAT4X4: glUniformMatrix4fv(prop.location, count, GL_FALSE, propertyBlock.GetElementPtr<float>(info)); break;
-				case PK_TYPE::INT:  glUniform1iv(prop.location, count, propertyBlock.GetElementPtr<int>(info)); break;
-				case PK_TYPE::INT2: glUniform2iv(prop.location, count, propertyBlock.GetElementPtr<int>(info)); break;
-				case PK_TYPE::INT3: glUniform3iv(prop.location, count, propertyBlock.GetElementPtr<int>(info)); break;
-				case PK_TYPE::INT4: glUniform4iv(prop.location, count, propertyBlock.GetElementPtr<int>(info)); break;
-				case PK_TYPE::UINT:  glUniform1uiv(prop.location, count, propertyBlock.GetElementPtr<uint>(info)); break;
-				case PK_TYPE::UINT2: glUniform2uiv(prop.location, count, propertyBlock.GetElementPtr<uint>(info)); break;
-				case PK_TYPE::UINT3: glUniform3uiv(prop.location, count, propertyBlock.GetElementPtr<uint>(info)); break;
-				case PK_TYPE::UINT4: glUniform4uiv(prop.location, count, propertyBlock.GetElementPtr<uint>(info)); break;
-				case PK_TYPE::HANDLE: glUniformHandleui64vARB(prop.location, count, propertyBlock.GetElementPtr<ulong>(info)); break;
-				case PK_TYPE::TEXTURE: GraphicsAPI::BindTextures(prop.location, propertyBlock.GetElementPtr<GraphicsID>(info), count); break;
-				case PK_TYPE::IMAGE_PARAMS: GraphicsAPI::BindImages(prop.location, propertyBlock.GetElementPtr<ImageBindDescriptor>(info), count); break;
-				case PK_TYPE::CONSTANT_BUFFER: GraphicsAPI::BindBuffers(PK_TYPE::CONSTANT_BUFFER, prop.location, propertyBlock.GetElementPtr<GraphicsID>(info), count); break;
-				case PK_TYPE::COMPUTE_BUFFER: GraphicsAPI::BindBuffers(PK_TYPE::COMPUTE_BUFFER, prop.location, propertyBlock.GetElementPtr<GraphicsID>(info), count); break;
+			switch (binding.type)
+			{
+				case PK_TYPE::FLOAT: glUniform1fv(location, count, reinterpret_cast<const float*>(value)); break;
+				case PK_TYPE::FLOAT2: glUniform2fv(location, count, reinterpret_cast<const float*>(value)); break;
+				case PK_TYPE::FLOAT3: glUniform3fv(location, count, reinterpret_cast<const float*>(value)); break;
+				case PK_TYPE::FLOAT4: glUniform4fv(location, count, reinterpret_cast<const float*>(value)); break;
+				case PK_TYPE::FLOAT2X2: glUniformMatrix2fv(location, count, GL_FALSE, reinterpret_cast<const float*>(value)); break;
+				case PK_TYPE::FLOAT3X3: glUniformMatrix3fv(location, count, GL_FALSE, reinterpret_cast<const float*>(value)); break;
+				case PK_TYPE::FLOAT4X4: glUniformMatrix4fv(location, count, GL_FALSE, reinterpret_cast<const float*>(value)); break;
+				case PK_TYPE::INT:  glUniform1iv(location, count, reinterpret_cast<const int*>(value)); break;
+				case PK_TYPE::INT2: glUniform2iv(location, count, reinterpret_cast<const int*>(value)); break;
+				case PK_TYPE::INT3: glUniform3iv(location, count, reinterpret_cast<const int*>(value)); break;
+				case PK_TYPE::INT4: glUniform4iv(location, count, reinterpret_cast<const int*>(value)); break;
+				case PK_TYPE::UINT:  glUniform1uiv(location, count, reinterpret_cast<const uint*>(value)); break;
+				case PK_TYPE::UINT2: glUniform2uiv(location, count, reinterpret_cast<const uint*>(value)); break;
+				case PK_TYPE::UINT3: glUniform3uiv(location, count, reinterpret_cast<const uint*>(value)); break;
+				case PK_TYPE::UINT4: glUniform4uiv(location, count, reinterpret_cast<const uint*>(value)); break;
+				case PK_TYPE::HANDLE: glUniformHandleui64vARB(location, count, reinterpret_cast<const ulong*>(value)); break;
+				case PK_TYPE::TEXTURE: GraphicsAPI::BindTextures(location, reinterpret_cast<const GraphicsID*>(value), count); break;
+				case PK_TYPE::IMAGE_PARAMS: GraphicsAPI::BindImages(location, reinterpret_cast<const ImageBindDescriptor*>(value), count); break;
+				case PK_TYPE::CONSTANT_BUFFER: GraphicsAPI::BindBuffers(PK_TYPE::CONSTANT_BUFFER, location, reinterpret_cast<const GraphicsID*>(value), count); break;
+				case PK_TYPE::COMPUTE_BUFFER: GraphicsAPI::BindBuffers(PK_TYPE::COMPUTE_BUFFER, location, reinterpret_cast<const GraphicsID*>(value), count); break;
 				default: PK_CORE_ERROR("Invalid Shader Property Type");
 			}
 		}
@@ -173,12 +297,6 @@ namespace PK::Rendering::Objects
 	
 	Shader::~Shader() { m_variants.clear(); }
 	
-	const Ref<ShaderVariant>& Shader::GetActiveVariant()
-	{
-		m_activeIndex = m_variantMap.GetActiveIndex();
-		return m_variants.at(m_activeIndex);
-	}
-	
 	void Shader::ListProperties()
 	{
 		PK::Utilities::Debug::InsertNewLine();
@@ -193,14 +311,30 @@ namespace PK::Rendering::Objects
 		m_variantMap.ListVariants();
 	}
 	
-	void Shader::ResetKeywords() { m_variantMap.Reset(); }
-	
-	void Shader::SetKeywords(const std::vector<uint32_t>& keywords)
+	void Shader::SetKeywords(const KeywordSet& keywords0, const KeywordSet& keywords1, const KeywordSet& keywords2)
 	{
-		if (keywords.size() > 0)
+		if (keywords0 == m_activeKeywordSets[0] && keywords1 == m_activeKeywordSets[1] && keywords2 == m_activeKeywordSets[2])
 		{
-			m_variantMap.SetKeywords(&keywords.at(0), keywords.size());
+			return;
 		}
+
+		m_activeKeywordSets[0] = keywords0;
+		m_activeKeywordSets[1] = keywords1;
+		m_activeKeywordSets[2] = keywords2;
+
+		auto mask0 = m_variantMap.GetKeywordMask(keywords0);
+		auto mask1 = m_variantMap.GetKeywordMask(keywords1);
+		auto mask2 = m_variantMap.GetKeywordMask(keywords2);
+
+		if (mask0 == m_activeKeywords[0] && mask1 == m_activeKeywords[1] && mask2 == m_activeKeywords[2])
+		{
+			return;
+		}
+
+		m_activeKeywords[0] = mask0;
+		m_activeKeywords[1] = mask1;
+		m_activeKeywords[2] = mask2;
+		m_activeIndex = m_variantMap.GetVariantIndex(mask0, mask1, mask2);
 	}
 	
 	
@@ -533,6 +667,9 @@ namespace PK::Rendering::Objects
 
 			multicompilemap.variantcount = 1;
 			multicompilemap.directivecount = 0;
+			multicompilemap.directiveoffsets[0] = 0;
+			multicompilemap.keywordmask = 0ull;
+			multicompilemap.optionmasks.clear();
 			multicompilemap.keywords.clear();
 
 			while (true)
@@ -545,21 +682,39 @@ namespace PK::Rendering::Objects
 				}
 
 				auto directive = Utilities::String::Split(output, " ");
+				auto& directivemask = multicompilemap.directivemasks[multicompilemap.directivecount];
+				directivemask = 0ull;
 
 				for (auto j = 0; j < directive.size(); ++j)
 				{
 					auto& keyword = directive.at(j);
+					auto keywordbit = 0ull;
 
 					if (keyword != "_")
 					{
-						multicompilemap.keywords[StringHashID::StringToID(keyword)] = (multicompilemap.directivecount << 4) | (j & 0xF);
+						auto hashId = StringHashID::StringToID(keyword);
+						auto iterator = multicompilemap.keywords.find(hashId);
+
+						if (iterator == multicompilemap.keywords.end())
+						{
+							auto index = (uint32_t)multicompilemap.keywords.size();
+							PK_CORE_ASSERT(index < sizeof(KeywordMask) * 8, "Shader declares more than %u keywords!", (uint32_t)(sizeof(KeywordMask) * 8));
+							iterator = multicompilemap.keywords.emplace(hashId, (uint8_t)index).first;
+						}
+
+						keywordbit = 1ull << iterator->second;
 					}
+
+					directivemask |= keywordbit;
+					multicompilemap.optionmasks.push_back(keywordbit);
 				}
 	
 				keywords.push_back(directive);
-				multicompilemap.directives[multicompilemap.directivecount] = multicompilemap.variantcount & 0xFFFFFF;
+				multicompilemap.keywordmask |= directivemask;
+				multicompilemap.directives[multicompilemap.directivecount] = multicompilemap.variantcount;
 				multicompilemap.variantcount *= (uint32_t)directive.size();
 				multicompilemap.directivecount++;
+				multicompilemap.directiveoffsets[multicompilemap.directivecount] = (uint32_t)multicompilemap.optionmasks.size();
 			}
 		}
 	
@@ -636,6 +791,18 @@ namespace PK::Rendering::Objects
 			GetCullModeFromString(Utilities::String::Trim(valueCull), parameters.CullMode, parameters.CullEnabled);
 		}
 		
+		// Blended shaders default to the transparent queue. #Queue overrides the default.
+		static void ExtractRenderQueue(std::string& source, const FixedStateAttributes& parameters, RenderQueue& queue)
+		{
+			auto valueQueue = Utilities::String::ExtractToken("#Queue ", source, false);
+			queue = parameters.BlendEnabled ? RenderQueue::Transparent : RenderQueue::Opaque;
+
+			if (!valueQueue.empty())
+			{
+				queue = GetRenderQueueFromString(Utilities::String::Trim(valueQueue), queue);
+			}
+		}
+		
 		static void ProcessShaderVersion(std::string& source)
 		{
 			auto versionToken = Utilities::String::ExtractToken("#version ", source, true);
@@ -706,6 +873,7 @@ namespace PK::Rendering::Objects
 		
 		static void Compile(const std::string& filename, const std::unordered_map<GLenum, std::string>& shaderSources, std::map<uint32_t, ShaderPropertyInfo>& variablemap, GraphicsID& program)
 		{
+			PK_PROFILE_TRACE_SCOPE(filename, "shader");
 			program = glCreateProgram();
 			variablemap.clear();
 		
@@ -900,13 +1068,13 @@ namespace PK::Rendering::Objects
 						location = slot;
 					}
 		
-					variablemap[StringHashID::StringToID(name)] = { (ushort)location, cgtype };
+					variablemap[StringHashID::StringToID(name)] = { (ushort)location, cgtype, (ushort)size };
 		
 					// For array uniforms also map the variable name without the brackets
 					if (j == 0 && size > 1)
 					{
 						name[(int)length - 3] = '\0';
-						variablemap[StringHashID::StringToID(name)] = { (ushort)location, cgtype };
+						variablemap[StringHashID::StringToID(name)] = { (ushort)location, cgtype, (ushort)size };
 						name[(int)length - 3] = '[';
 					}
 				}
@@ -915,6 +1083,42 @@ namespace PK::Rendering::Objects
 			glUseProgram(currentProgram);
 		}
 	}
+
+	void Shader::ImportSource(std::string& source)
+	{
+		m_variants.clear();
+		m_activeIndex = 0;
+		memset(m_activeKeywords, 0, sizeof(m_activeKeywords));
+
+		for (auto& keywordSet : m_activeKeywordSets)
+		{
+			keywordSet.Clear();
+		}
+
+		// A lot of hacky stuff in this parser at the moment.
+		// @TODO Consider clean up once priorities allow it.
+		std::string sharedInclude;
+		std::string variantDefines;
+		std::vector<std::vector<std::string>> mckeywords;
+		std::unordered_map<GLenum, std::string> shaderSources;
+		std::map<uint32_t, ShaderPropertyInfo> properties;
+		GraphicsID programId;
+
+		ShaderCompiler::ExtractMulticompiles(source, mckeywords, m_variantMap);
+		ShaderCompiler::ExtractStateAttributes(source, m_stateAttributes);
+		ShaderCompiler::ExtractRenderQueue(source, m_stateAttributes, m_renderQueue);
+		ShaderCompiler::ExtractInstancingInfo(source, m_variantMap, m_instancingInfo);
+
+		ShaderCompiler::GetSharedInclude(source, sharedInclude);
+
+		for (uint32_t i = 0; i < m_variantMap.variantcount; ++i)
+		{
+			ShaderCompiler::GetVariantDefines(mckeywords, i, variantDefines);
+			ShaderCompiler::ProcessTypeSources(source, sharedInclude, variantDefines, shaderSources);
+			ShaderCompiler::Compile(GetFileName(), shaderSources, properties, programId);
+			m_variants.push_back(CreateRef<ShaderVariant>(programId, properties));
+		}
+	}
 }
 
 template<>
@@ -923,30 +1127,22 @@ bool PK::Core::AssetImporters::IsValidExtension<PK::Rendering::Objects::Shader>(
 template<> 
 void PK::Core::AssetImporters::Import(const std::string& filepath, PK::Utilities::Ref<PK::Rendering::Objects::Shader>& shader)
 {
-	shader->m_variants.clear();
-
-	// A lot of hacky stuff in this parser at the moment.
-	// @TODO Consider clean up once priorities allow it.
 	std::string source;
-	std::string sharedInclude;
-	std::string variantDefines;
-	std::vector<std::vector<std::string>> mckeywords;
-	std::unordered_map<GLenum, std::string> shaderSources;
-	std::map<uint32_t, PK::Rendering::Structs::ShaderPropertyInfo> properties;
-	PK::Rendering::Objects::GraphicsID programId;
-
 	PK::Rendering::Objects::ShaderCompiler::ReadFile(filepath, source);
-	PK::Rendering::Objects::ShaderCompiler::ExtractMulticompiles(source, mckeywords, shader->m_variantMap);
-	PK::Rendering::Objects::ShaderCompiler::ExtractStateAttributes(source, shader->m_stateAttributes);
-	PK::Rendering::Objects::ShaderCompiler::ExtractInstancingInfo(source, shader->m_variantMap, shader->m_instancingInfo);
+	shader->ImportSource(source);
+}
 
-	PK::Rendering::Objects::ShaderCompiler::GetSharedInclude(source, sharedInclude);
+// Cooked shaders are their source with includes expanded. Compilation needs a graphics context & is left to the import.
+template<>
+bool PK::Core::AssetImporters::Cook<PK::Rendering::Objects::Shader>(const std::string& filepath, const std::string& source, std::vector<char>& data)
+{
+	data.assign(source.begin(), source.end());
+	return true;
+}
 
-	for (uint32_t i = 0; i < shader->m_variantMap.variantcount; ++i)
-	{
-		PK::Rendering::Objects::ShaderCompiler::GetVariantDefines(mckeywords, i, variantDefines);
-		PK::Rendering::Objects::ShaderCompiler::ProcessTypeSources(source, sharedInclude, variantDefines, shaderSources);
-		PK::Rendering::Objects::ShaderCompiler::Compile(shader->GetFileName(), shaderSources, properties, programId);
-		shader->m_variants.push_back(CreateRef<PK::Rendering::Objects::ShaderVariant>(programId, properties));
-	}
+template<>
+void PK::Core::AssetImporters::ImportCooked(const std::string& filepath, const char* data, size_t size, PK::Utilities::Ref<PK::Rendering::Objects::Shader>& shader)
+{
+	std::string source(data, size);
+	shader->ImportSource(source);
 }
\ No newline at end of file
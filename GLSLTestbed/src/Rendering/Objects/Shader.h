@@ -14,8 +14,45 @@ namespace PK::Rendering::Objects
 	{
 		ushort location = 0xFFFF;
 		PK_TYPE type = PK_TYPE::INVALID;
+		ushort arraySize = 1;
+		// Offset of the last written value in the uniform cache of the variant. Only set for plain non array uniforms.
+		uint32_t cacheOffset = 0xFFFFFFFF;
 	};
 
+	// Precompiled record of a property block entry that the variant consumes.
+	struct ShaderBinding
+	{
+		uint32_t offset = 0;
+		uint32_t cacheOffset = 0xFFFFFFFF;
+		ushort location = 0xFFFF;
+		ushort count = 1;
+		PK_TYPE type = PK_TYPE::INVALID;
+		// False for entries whose type or size differs from the uniform. Those invalidate the cached value instead.
+		bool isCached = false;
+	};
+
+	enum class RenderQueue : uint8_t
+	{
+		Opaque,
+		Transparent,
+	};
+
+	// Unknown names keep the fallback queue.
+	inline RenderQueue GetRenderQueueFromString(const std::string& name, RenderQueue fallback)
+	{
+		if (name == "Opaque")
+		{
+			return RenderQueue::Opaque;
+		}
+
+		if (name == "Transparent")
+		{
+			return RenderQueue::Transparent;
+		}
+
+		return fallback;
+	}
+
 	struct ShaderInstancingInfo
 	{
 		bool supportsInstancing = false;
@@ -26,16 +63,24 @@ namespace PK::Rendering::Objects
 	class ShaderVariantMap
 	{
 		public:
-			void Reset();
-			void SetKeywords(const uint32_t* hashIds, size_t count);
 			void ListVariants();
 			inline bool SupportsKeyword(const uint32_t hashId) const { return keywords.count(hashId) > 0; }
 			bool SupportsKeywords(const uint32_t* hashIds, const uint32_t count) const;
-			uint32_t GetActiveIndex() const;
+			// Keywords that the shader does not declare are ignored.
+			KeywordMask GetKeywordMask(const KeywordSet& keywordSet) const;
+			// For each directive the first matching keyword of the highest precedence mask is selected. keywords2 has the highest precedence.
+			uint32_t GetVariantIndex(KeywordMask keywords0, KeywordMask keywords1, KeywordMask keywords2) const;
 	
 			uint32_t variantcount = 0;
 			uint32_t directivecount = 0;
+			// Variant index stride of each directive.
 			uint32_t directives[16];
+			// Range of each directive in optionmasks. An option without a keyword has an empty mask.
+			uint32_t directiveoffsets[17];
+			KeywordMask directivemasks[16];
+			KeywordMask keywordmask = 0ull;
+			std::vector<KeywordMask> optionmasks;
+			// Local bit index of each keyword hash. Assigned in declaration order when the shader is imported.
 			std::unordered_map<uint32_t, uint8_t> keywords;
 	};
 	
@@ -47,32 +92,49 @@ namespace PK::Rendering::Objects
 			void SetPropertyBlock(const ShaderPropertyBlock& propertyBlock);
 			void ListProperties();
 		private:
+			bool UpdateUniformCache(const ShaderBinding& binding, const char* value);
+			const std::vector<ShaderBinding>& GetBindingTable(const ShaderPropertyBlock& propertyBlock);
+
 			std::map<uint32_t, ShaderPropertyInfo> m_properties;
+			// Keyed by property block layout hash. Blocks with the same layout are bound with a linear walk of the same table.
+			std::unordered_map<ulong, std::vector<ShaderBinding>> m_bindingTables;
+			// Uniform values are program state. A write is skipped if it matches the value last written to the program.
+			std::vector<char> m_uniformCache;
 	};
 	
 	class Shader: public Asset
 	{
 		friend void AssetImporters::Import(const std::string& filepath, Ref<Shader>& shader);
+		friend void AssetImporters::ImportCooked(const std::string& filepath, const char* data, size_t size, Ref<Shader>& shader);
 	
 		public:
 			~Shader();
 			inline const FixedStateAttributes& GetFixedStateAttributes() const { return m_stateAttributes; }
 			inline const ShaderInstancingInfo& GetInstancingInfo() const { return m_instancingInfo; }
+			inline RenderQueue GetRenderQueue() const { return m_renderQueue; }
 			inline bool SupportsKeyword(const uint32_t hashId) const { return m_variantMap.SupportsKeyword(hashId); }
 			inline bool SupportsKeywords(const uint32_t* hashIds, const uint32_t count) const { return m_variantMap.SupportsKeywords(hashIds, count); }
-			const Ref<ShaderVariant>& GetActiveVariant();
+			inline const Ref<ShaderVariant>& GetActiveVariant() const { return m_variants.at(m_activeIndex); }
 	
 			inline void SetPropertyBlock(const ShaderPropertyBlock& propertyBlock) { m_variants.at(m_activeIndex)->SetPropertyBlock(propertyBlock); }
-			void ResetKeywords();
-			void SetKeywords(const std::vector<uint32_t>& keywords);
+			// Later sets take precedence. Sets equal to the previous call skip resolution.
+			// Otherwise they are mapped to local bits & the variant is only resolved again when a keyword declared by the shader changes.
+			void SetKeywords(const KeywordSet& keywords0, const KeywordSet& keywords1 = KeywordSet(), const KeywordSet& keywords2 = KeywordSet());
 			void ListProperties();
 			void ListVariants();
 	
 		private:
+			// Parses & compiles a source that has its includes expanded.
+			void ImportSource(std::string& source);
+
 			uint32_t m_activeIndex = 0;
+			KeywordSet m_activeKeywordSets[3];
+			// Local bits of the active sets. All zero masks resolve to variant 0.
+			KeywordMask m_activeKeywords[3] = {};
 			std::vector<Ref<ShaderVariant>> m_variants;
 			ShaderVariantMap m_variantMap = ShaderVariantMap();
 			FixedStateAttributes m_stateAttributes = FixedStateAttributes();
 			ShaderInstancingInfo m_instancingInfo = ShaderInstancingInfo();
+			RenderQueue m_renderQueue = RenderQueue::Opaque;
 	};
 }
\ No newline at end of file
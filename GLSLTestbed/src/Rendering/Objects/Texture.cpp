@@ -404,38 +404,45 @@ namespace PK::Rendering::Objects
     
     void Texture::GetDescirptorFromKTX(ktxTexture* tex, TextureDescriptor* desc, GLenum* channels)
     {
-        PK_CORE_ASSERT(tex->classId == ktxTexture1_c,"KTX2 is unsupported!")
-    
-        auto* tex1 = reinterpret_cast<ktxTexture1*>(tex);
-    
-        *channels = tex1->glFormat;
+        if (tex->classId == ktxTexture1_c)
+        {
+            auto* tex1 = reinterpret_cast<ktxTexture1*>(tex);
+            *channels = tex1->glFormat;
+            desc->colorFormat = tex1->glInternalformat;
+        }
+        else
+        {
+            // The color format of a ktx 2 texture is known once it has been uploaded.
+            const GLenum componentChannels[] = { GL_RGBA, GL_RED, GL_RG, GL_RGB, GL_RGBA };
+            auto componentCount = ktxTexture2_GetNumComponents(reinterpret_cast<ktxTexture2*>(tex));
+            *channels = componentChannels[componentCount <= 4 ? componentCount : 0];
+        }
     
-        desc->resolution = { tex1->baseWidth, tex1->baseHeight, tex1->baseDepth };
-        desc->colorFormat = tex1->glInternalformat;
+        desc->resolution = { tex->baseWidth, tex->baseHeight, tex->baseDepth };
         desc->wrapmodex = GL_CLAMP_TO_EDGE;
         desc->wrapmodey = GL_CLAMP_TO_EDGE;
         desc->wrapmodez = GL_CLAMP_TO_EDGE;
         desc->filtermin = GL_NEAREST;
         desc->filtermag = GL_LINEAR;
-        desc->miplevels = tex1->numLevels;
+        desc->miplevels = tex->numLevels;
         desc->anistropy = 16.0f;
     
-        if (tex1->numLevels > 1)
+        if (tex->numLevels > 1)
         {
             desc->filtermin = GL_LINEAR_MIPMAP_LINEAR;
         }
     
-        switch (tex1->numDimensions)
+        switch (tex->numDimensions)
         {
-            case 1: desc->dimension = tex1->isArray ? GL_TEXTURE_1D_ARRAY : GL_TEXTURE_1D; break;
-            case 2: desc->dimension = tex1->isArray ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D; break;
+            case 1: desc->dimension = tex->isArray ? GL_TEXTURE_1D_ARRAY : GL_TEXTURE_1D; break;
+            case 2: desc->dimension = tex->isArray ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D; break;
             case 3: desc->dimension = GL_TEXTURE_3D; break;
             default: PK_CORE_ERROR("Invalid Texture Dimension");
         }
     
-        if (tex1->isCubemap)
+        if (tex->isCubemap)
         {
-            desc->dimension = tex1->isArray ? GL_TEXTURE_CUBE_MAP_ARRAY : GL_TEXTURE_CUBE_MAP;
+            desc->dimension = tex->isArray ? GL_TEXTURE_CUBE_MAP_ARRAY : GL_TEXTURE_CUBE_MAP;
         }
     }
 }
\ No newline at end of file
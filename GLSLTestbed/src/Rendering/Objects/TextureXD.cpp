@@ -1,6 +1,8 @@
 #include "PrecompiledHeader.h"
 #include "Utilities/Log.h"
 #include "Rendering/Objects/TextureXD.h"
+#include "Rendering/TextureStreamer.h"
+#include "Rendering/TextureTranscoding.h"
 #include <KTX/ktx.h>
 
 namespace PK::Rendering::Objects
@@ -19,6 +21,11 @@ namespace PK::Rendering::Objects
 	
 	TextureXD::~TextureXD()
 	{
+		if (m_isStreamed && TextureStreamer::Get() != nullptr)
+		{
+			TextureStreamer::Get()->Release(this);
+		}
+
 		glDeleteTextures(1, &m_graphicsId);
 	}
 	
@@ -29,11 +36,61 @@ namespace PK::Rendering::Objects
 		auto dst = m_graphicsId;
 		glCopyImageSubData(src, srcDescriptor.dimension, 0, 0, 0, 0, dst, m_descriptor.dimension, miplevel, 0, 0, 0, srcDescriptor.resolution.x, srcDescriptor.resolution.y, srcDescriptor.resolution.z);
 	}
+
+	GraphicsID TextureXD::SetFirstResidentLevel(uint level)
+	{
+		auto previousId = m_graphicsId;
+		auto previousLevel = m_firstResidentLevel;
+		auto descriptor = m_descriptor;
+		descriptor.resolution = glm::max(m_descriptor.resolution >> level, uint3(1u, 1u, 0u));
+		descriptor.miplevels = m_descriptor.miplevels - level;
+
+		CreateTextureStorage(m_graphicsId, descriptor);
+		m_firstResidentLevel = level;
+
+		if (previousId == 0)
+		{
+			return 0;
+		}
+
+		for (auto i = glm::max(level, previousLevel); i < m_descriptor.miplevels; ++i)
+		{
+			auto resolution = glm::max(m_descriptor.resolution >> i, uint3(1u));
+			glCopyImageSubData(previousId, m_descriptor.dimension, i - previousLevel, 0, 0, 0, m_graphicsId, m_descriptor.dimension, i - level, 0, 0, 0, resolution.x, resolution.y, 1);
+		}
+
+		return previousId;
+	}
+
+	void TextureXD::UploadKTX(ktxTexture* kTexture, GLenum wrapmode)
+	{
+		GLenum target, glerror;
+
+		GetDescirptorFromKTX(kTexture, &m_descriptor, &m_channels);
+
+		glGenTextures(1, &m_graphicsId);
+
+		auto result = ktxTexture_GLUpload(kTexture, &m_graphicsId, &target, &glerror);
 	
+		PK_CORE_ASSERT(result == KTX_SUCCESS, "Failed to upload ktx!");
+
+		// The internal format of a ktx 2 texture depends on what it was transcoded to.
+		if (kTexture->classId == ktxTexture2_c)
+		{
+			GLint colorFormat;
+			glGetTextureLevelParameteriv(m_graphicsId, 0, GL_TEXTURE_INTERNAL_FORMAT, &colorFormat);
+			m_descriptor.colorFormat = (GLenum)colorFormat;
+		}
+
+		glTextureParameteri(m_graphicsId, GL_TEXTURE_MIN_FILTER, m_descriptor.filtermin);
+		glTextureParameteri(m_graphicsId, GL_TEXTURE_MAG_FILTER, m_descriptor.filtermag);
+		SetWrapMode(wrapmode, wrapmode, wrapmode);
+		SetAnistropy(m_descriptor.anistropy);
+	}
 }
 
 template<>
-bool PK::Core::AssetImporters::IsValidExtension<PK::Rendering::Objects::TextureXD>(const std::filesystem::path& extension) { return extension.compare(".ktx") == 0; }
+bool PK::Core::AssetImporters::IsValidExtension<PK::Rendering::Objects::TextureXD>(const std::filesystem::path& extension) { return extension.compare(".ktx") == 0 || extension.compare(".ktx2") == 0; }
 
 template<>
 void PK::Core::AssetImporters::Import(const std::string& filepath, Utilities::Ref<PK::Rendering::Objects::TextureXD>& texture)
@@ -44,27 +101,30 @@ void PK::Core::AssetImporters::Import(const std::string& filepath, Utilities::Re
 	}
 
 	auto wrapmode = PK::Rendering::Objects::Texture::GetWrapmodeFromString(filepath.c_str());
+	auto textureStreamer = PK::Rendering::TextureStreamer::Get();
+
+	if (textureStreamer != nullptr && textureStreamer->Import(filepath, texture.get(), wrapmode))
+	{
+		return;
+	}
 
 	ktxTexture* kTexture;
 	KTX_error_code result;
-	GLenum target, glerror;
 
-	result = ktxTexture_CreateFromNamedFile(filepath.c_str(), KTX_TEXTURE_CREATE_NO_FLAGS, &kTexture);
+	if (std::filesystem::path(filepath).extension().compare(".ktx2") == 0)
+	{
+		ktxTexture2* kTexture2 = nullptr;
+		result = PK::Rendering::TextureTranscoding::CreateTexture(filepath, &kTexture2);
+		kTexture = ktxTexture(kTexture2);
+	}
+	else
+	{
+		result = ktxTexture_CreateFromNamedFile(filepath.c_str(), KTX_TEXTURE_CREATE_NO_FLAGS, &kTexture);
+	}
 
 	PK_CORE_ASSERT(result == KTX_SUCCESS, "Failed to load ktx!");
 
-	PK::Rendering::Objects::Texture::GetDescirptorFromKTX(kTexture, &texture->m_descriptor, &texture->m_channels);
-
-	glGenTextures(1, &texture->m_graphicsId);
-
-	result = ktxTexture_GLUpload(kTexture, &texture->m_graphicsId, &target, &glerror);
-	
-	PK_CORE_ASSERT(result == KTX_SUCCESS, "Failed to upload ktx!");
-
-	glTextureParameteri(texture->m_graphicsId, GL_TEXTURE_MIN_FILTER, texture->m_descriptor.filtermin);
-	glTextureParameteri(texture->m_graphicsId, GL_TEXTURE_MAG_FILTER, texture->m_descriptor.filtermag);
-	texture->SetWrapMode(wrapmode, wrapmode, wrapmode);
-	texture->SetAnistropy(texture->m_descriptor.anistropy);
+	texture->UploadKTX(kTexture, wrapmode);
 
 	ktxTexture_Destroy(kTexture);
 }
\ No newline at end of file
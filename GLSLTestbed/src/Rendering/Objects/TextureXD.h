@@ -2,6 +2,11 @@
 #include "Core/AssetDataBase.h"
 #include "Rendering/Objects/Texture.h"
 
+namespace PK::Rendering
+{
+	class TextureStreamer;
+}
+
 namespace PK::Rendering::Objects
 {
 	using namespace Utilities;
@@ -9,6 +14,7 @@ namespace PK::Rendering::Objects
 	class TextureXD : public Texture, public Asset
 	{
 		friend void AssetImporters::Import(const std::string& filepath, Ref<TextureXD>& texture);
+		friend class PK::Rendering::TextureStreamer;
 	
 		public:
 			TextureXD();
@@ -16,5 +22,19 @@ namespace PK::Rendering::Objects
 			~TextureXD();
 		
 			void SetMipLevel(const Ref<TextureXD>& texture, uint32_t mipLevel);
+
+			// Streamed textures only store the levels from their first resident level. The descriptor still describes the full mip chain.
+			inline uint GetFirstResidentLevel() const { return m_firstResidentLevel; }
+
+		private:
+			// Replaces the storage with one that starts at the given level & copies the levels that both contain.
+			// Returns the previous storage. Bindless handles of it may still be in use by frames in flight.
+			GraphicsID SetFirstResidentLevel(uint level);
+
+			// Creates the storage from a ktx texture. The previous storage must have been deleted.
+			void UploadKTX(ktxTexture* kTexture, GLenum wrapmode);
+
+			uint m_firstResidentLevel = 0;
+			bool m_isStreamed = false;
 	};
 }
\ No newline at end of file
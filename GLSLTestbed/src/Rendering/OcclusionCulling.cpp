@@ -0,0 +1,132 @@
+#include "PrecompiledHeader.h"
+#include "OcclusionCulling.h"
+
+namespace PK::Rendering::Culling
+{
+	void DepthPyramid::Resize(uint width, uint height)
+	{
+		if (GetWidth() == width && GetHeight() == height)
+		{
+			return;
+		}
+
+		m_levels.clear();
+		m_isValid = false;
+
+		size_t offset = 0;
+
+		while (true)
+		{
+			m_levels.push_back({ width, height, offset });
+			offset += (size_t)width * height;
+
+			if (width == 1 && height == 1)
+			{
+				break;
+			}
+
+			width = (width + 1) / 2;
+			height = (height + 1) / 2;
+		}
+
+		m_depths.resize(offset);
+	}
+
+	void DepthPyramid::Clear(float depth)
+	{
+		std::fill(m_depths.begin(), m_depths.end(), depth);
+		m_isValid = false;
+	}
+
+	void DepthPyramid::BuildMipChain(const float4x4& viewProjection)
+	{
+		auto* depths = m_depths.data();
+
+		for (auto i = 1u; i < m_levels.size(); ++i)
+		{
+			auto& src = m_levels.at(i - 1);
+			auto& dst = m_levels.at(i);
+
+			for (auto y = 0u; y < dst.height; ++y)
+			{
+				for (auto x = 0u; x < dst.width; ++x)
+				{
+					auto x0 = x * 2u;
+					auto y0 = y * 2u;
+					auto x1 = glm::min(x0 + 1u, src.width - 1u);
+					auto y1 = glm::min(y0 + 1u, src.height - 1u);
+					auto* s = depths + src.offset;
+					auto d0 = glm::max(s[x0 + y0 * src.width], s[x1 + y0 * src.width]);
+					auto d1 = glm::max(s[x0 + y1 * src.width], s[x1 + y1 * src.width]);
+					depths[dst.offset + x + y * dst.width] = glm::max(d0, d1);
+				}
+			}
+		}
+
+		m_viewProjection = viewProjection;
+		m_isValid = !m_levels.empty();
+	}
+
+	bool DepthPyramid::IsOccluded(const BoundingBox& aabb) const
+	{
+		if (!m_isValid)
+		{
+			return false;
+		}
+
+		auto uvmin = float2(std::numeric_limits<float>().max());
+		auto uvmax = float2(-std::numeric_limits<float>().max());
+		auto zmin = 1.0f;
+
+		for (auto i = 0u; i < 8u; ++i)
+		{
+			auto corner = float3(i & 1 ? aabb.max.x : aabb.min.x, i & 2 ? aabb.max.y : aabb.min.y, i & 4 ? aabb.max.z : aabb.min.z);
+			auto clip = m_viewProjection * float4(corner, 1.0f);
+
+			// Bounds intersect the near plane. Cannot be tested.
+			if (clip.w <= 1e-5f)
+			{
+				return false;
+			}
+
+			auto ndc = float3(clip.xyz) / clip.w;
+			uvmin = glm::min(uvmin, float2(ndc.xy) * 0.5f + 0.5f);
+			uvmax = glm::max(uvmax, float2(ndc.xy) * 0.5f + 0.5f);
+			zmin = glm::min(zmin, ndc.z * 0.5f + 0.5f);
+		}
+
+		if (zmin <= 0.0f || uvmax.x < 0.0f || uvmax.y < 0.0f || uvmin.x > 1.0f || uvmin.y > 1.0f)
+		{
+			return false;
+		}
+
+		auto& base = m_levels.at(0);
+		auto x0 = glm::min((uint)(glm::clamp(uvmin.x, 0.0f, 1.0f) * base.width), base.width - 1u);
+		auto y0 = glm::min((uint)(glm::clamp(uvmin.y, 0.0f, 1.0f) * base.height), base.height - 1u);
+		auto x1 = glm::min((uint)(glm::clamp(uvmax.x, 0.0f, 1.0f) * base.width), base.width - 1u);
+		auto y1 = glm::min((uint)(glm::clamp(uvmax.y, 0.0f, 1.0f) * base.height), base.height - 1u);
+		auto level = 0u;
+
+		// Select the first level where the screen rect covers at most 2x2 texels.
+		while (level + 1 < m_levels.size() && (((x1 >> level) - (x0 >> level)) > 1u || ((y1 >> level) - (y0 >> level)) > 1u))
+		{
+			++level;
+		}
+
+		auto& mip = m_levels.at(level);
+		auto* depths = m_depths.data() + mip.offset;
+
+		for (auto y = y0 >> level; y <= (y1 >> level); ++y)
+		{
+			for (auto x = x0 >> level; x <= (x1 >> level); ++x)
+			{
+				if (zmin <= depths[x + y * mip.width])
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+#include "Core/NoCopy.h"
+#include <vector>
+#include <hlslmath.h>
+
+namespace PK::Rendering::Culling
+{
+    using namespace PK::Math;
+
+    // Max depth pyramid of a previously rendered depth buffer. Has no graphics api dependencies.
+    // The base level is filled from a gpu readback. Occluders rasterized on the cpu use MaskedOcclusionBuffer instead.
+    class DepthPyramid : public PK::Core::NoCopy
+    {
+        private:
+            struct DepthLevel
+            {
+                uint width = 0;
+                uint height = 0;
+                size_t offset = 0;
+            };
+
+        public:
+            void Resize(uint width, uint height);
+
+            void Clear(float depth = 1.0f);
+
+            void BuildMipChain(const float4x4& viewProjection);
+
+            bool IsOccluded(const BoundingBox& aabb) const;
+
+            inline void Invalidate() { m_isValid = false; }
+            inline bool IsValid() const { return m_isValid; }
+            inline float* GetBaseLevel() { return m_depths.data(); }
+            inline uint GetWidth() const { return m_levels.empty() ? 0u : m_levels.at(0).width; }
+            inline uint GetHeight() const { return m_levels.empty() ? 0u : m_levels.at(0).height; }
+            inline uint GetLevelCount() const { return (uint)m_levels.size(); }
+            inline float GetDepth(uint level, uint x, uint y) const { auto& l = m_levels.at(level); return m_depths.at(l.offset + x + y * l.width); }
+
+        private:
+            std::vector<float> m_depths;
+            std::vector<DepthLevel> m_levels;
+            float4x4 m_viewProjection = PK_FLOAT4X4_IDENTITY;
+            bool m_isValid = false;
+    };
+}
\ No newline at end of file
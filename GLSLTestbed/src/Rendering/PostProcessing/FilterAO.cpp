@@ -1,6 +1,7 @@
 #include "PrecompiledHeader.h"
 #include "FilterAO.h"
 #include "Rendering/GraphicsAPI.h"
+#include "Rendering/GPUProfiler.h"
 #include "Utilities/HashCache.h"
 
 namespace PK::Rendering::PostProcessing
@@ -67,6 +68,7 @@ namespace PK::Rendering::PostProcessing
 
     void FilterAO::Execute()
     {
+        PK_PROFILE_RENDER_SCOPE("AmbientOcclusion");
         m_properties.SetFloat3(HashCache::Get()->_AOParams, { m_intensity, m_radius, m_downsample ? 0.5f : 1.0f });
         m_properties.SetComputeBuffer(HashCache::Get()->_AOPassParams, m_passBuffer->GetGraphicsID());
 
@@ -2,6 +2,7 @@
 #include "FilterBloom.h"
 #include "Utilities/HashCache.h"
 #include "Rendering/GraphicsAPI.h"
+#include "Rendering/GPUProfiler.h"
 
 namespace PK::Rendering::PostProcessing
 {
@@ -163,6 +164,7 @@ namespace PK::Rendering::PostProcessing
     
     void FilterBloom::Execute(const RenderTexture* source, const RenderTexture* destination)
     {
+        PK_PROFILE_RENDER_SCOPE("Bloom");
         m_properties.SetComputeBuffer(HashCache::Get()->_BloomPassParams, m_passBuffer->GetGraphicsID());
 
         GraphicsAPI::Blit(m_filmGrainTexture.get(), m_computeFilmgrain, GL_TEXTURE_FETCH_BARRIER_BIT);
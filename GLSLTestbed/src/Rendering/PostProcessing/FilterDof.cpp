@@ -2,6 +2,7 @@
 #include "FilterDof.h"
 #include "Utilities/HashCache.h"
 #include "Rendering/GraphicsAPI.h"
+#include "Rendering/GPUProfiler.h"
 
 namespace PK::Rendering::PostProcessing
 {
@@ -74,6 +75,7 @@ namespace PK::Rendering::PostProcessing
     
     void FilterDof::Execute(const RenderTexture* source, const RenderTexture* destination)
     {
+        PK_PROFILE_RENDER_SCOPE("DepthOfField");
         GraphicsAPI::DispatchCompute(m_shaderAutoFocus, { 1,1,1 }, m_properties);
 
         m_properties.SetKeywords({ m_passKeywords[0] });
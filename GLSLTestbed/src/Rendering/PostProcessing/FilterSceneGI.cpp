@@ -1,6 +1,7 @@
 #include "PrecompiledHeader.h"
 #include "FilterSceneGI.h"
 #include "Rendering/GraphicsAPI.h"
+#include "Rendering/GPUProfiler.h"
 #include "ECS/Contextual/EntityViews/EntityViews.h"
 
 namespace PK::Rendering::PostProcessing
@@ -66,6 +67,7 @@ namespace PK::Rendering::PostProcessing
 
     void FilterSceneGI::Execute(Batching::DynamicBatchCollection* visibleBatches)
     {
+        PK_PROFILE_RENDER_SCOPE("SceneGI");
         uint4 viewports[3] = 
         { 
             {0u, 0u, m_voxelsDiffuse->GetWidth(),  m_voxelsDiffuse->GetHeight() },
@@ -2,6 +2,7 @@
 #include "FilterVolumetricFog.h"
 #include "Utilities/HashCache.h"
 #include "Rendering/GraphicsAPI.h"
+#include "Rendering/GPUProfiler.h"
 
 namespace PK::Rendering::PostProcessing
 {
@@ -58,6 +59,7 @@ namespace PK::Rendering::PostProcessing
     
     void FilterVolumetricFog::Execute(const RenderTexture* source, const RenderTexture* destination)
     {
+        PK_PROFILE_RENDER_SCOPE("VolumetricFog");
         auto depthCountX = (uint)std::ceilf(source->GetWidth() / 32.0f);
         auto depthCountY = (uint)std::ceilf(source->GetHeight() / 32.0f);
         auto groupsInject = uint3(VolumeResolution.x / InjectThreadCount.x, VolumeResolution.y / InjectThreadCount.y, VolumeResolution.z / InjectThreadCount.z);
@@ -3,8 +3,11 @@
 #include "Core/Application.h"
 #include "Utilities/HashCache.h"
 #include "Utilities/Utilities.h"
+#include "Utilities/FrameAllocator.h"
 #include "Rendering/RenderPipeline.h"
+#include "Rendering/FrameSetup.h"
 #include "Rendering/GraphicsAPI.h"
+#include "Rendering/GPUProfiler.h"
 #include "Rendering/MeshUtility.h"
 #include "ECS/Contextual/EntityViews/EntityViews.h"
 
@@ -26,46 +29,39 @@ namespace PK::Rendering
 		properties->SetFloat(hashCache->pk_SceneOEM_Exposure, exposure);
 	}
 	
-	static void UpdateDynamicBatches(ECS::EntityDatabase* entityDb, Culling::VisibilityCache& viscache, Batching::DynamicBatchCollection& batches)
-	{
-		Batching::ResetCollection(&batches);
-	
-		auto cullingResults = viscache.GetList(Culling::CullingGroup::CameraFrustum, (int)ECS::Components::RenderHandleFlags::Renderer);
-	
-		for (uint i = 0; i < cullingResults.count; ++i)
-		{
-			auto* view = entityDb->Query<ECS::EntityViews::MeshRenderable>(ECS::EGID(cullingResults[i], (uint)ECS::ENTITY_GROUPS::ACTIVE));
-			auto* materials = &view->materials->sharedMaterials;
-			auto mesh = view->mesh->sharedMesh;
-	
-			for (auto i = 0; i < materials->size(); ++i)
-			{
-				Batching::QueueDraw(&batches, mesh, i, materials->at(i), { &view->transform->localToWorld, 0.0f });
-			}
-		}
-	
-		Batching::UpdateBuffers(&batches);
-	}
-	
-	RenderPipeline::RenderPipeline(AssetDatabase* assetDatabase, ECS::EntityDatabase* entityDb, const ApplicationConfig* config) :
+	RenderPipeline::RenderPipeline(AssetDatabase* assetDatabase, ECS::EntityDatabase* entityDb, TextureStreamer* textureStreamer, const ApplicationConfig* config) :
 		m_filterBloom(assetDatabase, config),
 		m_filterDof(assetDatabase, config),
 		m_filterAO(assetDatabase, config),
 		m_filterFog(assetDatabase, config),
 		m_filterSceneGi(assetDatabase, entityDb, config),
-		m_lightsManager(assetDatabase, config)
+		m_lightsManager(assetDatabase, config),
+		m_cullingStep(entityDb, OccluderBufferSizeX, OccluderBufferSizeY, OccluderTriangleBudget)
 	{
 		m_entityDb = entityDb;
+		m_textureStreamer = textureStreamer;
 		m_context.BlitQuad = MeshUtility::GetQuad2D({ -1.0f,-1.0f }, { 1.0f, 1.0f });
 		m_context.BlitShader = assetDatabase->Find<Shader>("SH_VS_Internal_Blit");
 
 		m_depthNormalsShader = assetDatabase->Find<Shader>("SH_WS_DepthNormals");
+		m_computeOcclusionDepth = assetDatabase->Find<Shader>("CS_OcclusionDepthMax");
 		m_OEMBackgroundShader = assetDatabase->Find<Shader>("SH_VS_IBLBackground");
 		m_OEMTexture = assetDatabase->Load<TextureXD>(config->FileBackgroundTexture.value.c_str());
 		m_OEMExposure = config->BackgroundExposure;
 	
 		m_enableLightingDebug = config->EnableLightingDebug;
+		m_enableOcclusionCulling = config->EnableOcclusionCulling;
+		m_cullingStep.SetOccluderRasterization(config->EnableOccluderRasterization);
 		m_logframerate = config->EnableFrameRateLog;
+		Batching::SetInstanceTransformFormat(Batching::GetInstanceTransformFormatFromString(config->InstanceTransformFormat.value, Batching::InstanceTransformFormat::Float3x4));
+
+		m_occlusionPyramid.Resize(OcclusionDepthSizeX, OcclusionDepthSizeY);
+
+		for (auto& readback : m_occlusionReadbacks)
+		{
+			readback.buffer = CreateRef<ComputeBuffer>(BufferLayout({{PK_TYPE::UINT, "DEPTH"}}), OcclusionDepthSizeX * OcclusionDepthSizeY, true, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+			readback.depths = reinterpret_cast<const float*>(readback.buffer->BeginMapBufferPersistentRead());
+		}
 
 		auto renderTargetDescriptor = RenderTextureDescriptor();
 		renderTargetDescriptor.colorFormats = { GL_RGBA16F };
@@ -124,6 +120,11 @@ namespace PK::Rendering
 		m_constantsPerFrame->SetResourceHandle(HashCache::Get()->pk_ShadowmapAtlas, m_lightsManager.GetShadowmapAtlas()->GetColorBuffer(0)->GetBindlessHandleResident());
 	}
 	
+	RenderPipeline::~RenderPipeline()
+	{
+		DiscardOcclusionReadbacks();
+	}
+
 	void RenderPipeline::Step(Time* timeRef)
 	{
 		auto* hashCache = HashCache::Get();
@@ -144,6 +145,8 @@ namespace PK::Rendering
 	void RenderPipeline::Step(Input* inputRef)
 	{
 		m_constantsPerFrame->SetFloat4(HashCache::Get()->pk_CursorParams, { inputRef->GetMouseX(), inputRef->GetMouseY(), inputRef->GetMouseDeltaX(), inputRef->GetMouseDeltaY() });
+		// The camera has been updated by an earlier input step. The culling step may run on a thread without a graphics context.
+		m_cullingStep.SetViewProjection(GraphicsAPI::GetActiveViewProjectionMatrix());
 	}
 	
 	void RenderPipeline::Step(int condition)
@@ -152,17 +155,19 @@ namespace PK::Rendering
 	
 		switch (step)
 		{
-			case UpdateStep::OpenFrame: GraphicsAPI::OpenContext(&m_context); break;
+			case UpdateStep::OpenFrame: GraphicsAPI::OpenContext(&m_context); GPUProfiler::BeginFrame(); break;
 			case UpdateStep::PreRender: OnPreRender(); break;
-			case UpdateStep::Render: OnRender(); break;
+			case UpdateStep::Render: OnUpdateBatches(); OnRender(); break;
 			case UpdateStep::PostRender: GraphicsAPI::EndWindow(); break;
-			case UpdateStep::CloseFrame: GraphicsAPI::CloseContext(); break;
+			case UpdateStep::CloseFrame: GraphicsAPI::CloseContext(); FrameAllocator::NextFrame(); break;
 		}
 	}
 
 	void RenderPipeline::Step(AssetImportToken<ApplicationConfig>* token)
 	{
 		m_enableLightingDebug = token->asset->EnableLightingDebug;
+		m_enableOcclusionCulling = token->asset->EnableOcclusionCulling;
+		m_cullingStep.SetOccluderRasterization(token->asset->EnableOccluderRasterization);
 		m_logframerate = token->asset->EnableFrameRateLog;
 
 		m_OEMTexture = token->assetDatabase->Load<TextureXD>(token->asset->FileBackgroundTexture.value.c_str());
@@ -170,14 +175,30 @@ namespace PK::Rendering
 		m_filterFog.OnUpdateParameters(token->asset);
 		m_filterBloom.OnUpdateParameters(token->asset);
 		m_filterDof.OnUpdateParameters(token->asset);
+		m_textureStreamer->SetConfig(token->asset);
+	}
+
+	void RenderPipeline::Step(ConsoleCommandToken* token)
+	{
+		if (!token->isConsumed && token->argument == "log_shadowmap_atlas")
+		{
+			token->isConsumed = true;
+			m_lightsManager.LogShadowmapAtlas();
+		}
+
+		if (!token->isConsumed && token->argument == "log_shadow_culling")
+		{
+			token->isConsumed = true;
+			m_lightsManager.LogShadowCasterCulling();
+		}
 	}
 	
 	void RenderPipeline::OnPreRender()
 	{
+		PK_PROFILE_SCOPE("PreRender");
 		GraphicsAPI::StartWindow();
 		GraphicsAPI::ResetResourceBindings();
 		auto resolution = GraphicsAPI::GetActiveWindowResolution();
-		const float4x4& inverseViewProjection = *m_context.ShaderProperties.GetPropertyPtr<float4x4>(HashCache::Get()->pk_MATRIX_I_VP);
 		const float4 projParams = *m_context.ShaderProperties.GetPropertyPtr<float4>(HashCache::Get()->pk_ProjectionParams);
 
 		SetOEMTextures(m_OEMTexture, m_constantsPerFrame, 1, m_OEMExposure);
@@ -186,6 +207,7 @@ namespace PK::Rendering
 
 		if (m_GeometryBufferTarget->ValidateResolution(uint3(resolution, 0)))
 		{
+			DiscardOcclusionReadbacks();
 			m_constantsPerFrame->SetResourceHandle(HashCache::Get()->pk_ScreenDepth, m_GeometryBufferTarget->GetDepthBuffer()->GetBindlessHandleResident());
 			m_constantsPerFrame->SetResourceHandle(HashCache::Get()->pk_ScreenNormals, m_GeometryBufferTarget->GetColorBuffer(0)->GetBindlessHandleResident());
 		}
@@ -201,59 +223,81 @@ namespace PK::Rendering
 		m_constantsPerFrame->CopyFrom(m_context.ShaderProperties);
 		m_constantsPerFrame->FlushBuffer();
 		GraphicsAPI::SetGlobalConstantBuffer(HashCache::Get()->pk_PerFrameConstants, m_constantsPerFrame->GetGraphicsID());
-	
-		Culling::ResetEntityVisibilities(m_entityDb);
-		m_visibilityCache.Reset();
-		
-		Culling::BuildVisibilityCacheFrustum(m_entityDb, 
-			&m_visibilityCache, 
-			GraphicsAPI::GetActiveViewProjectionMatrix(), 
-			Culling::CullingGroup::CameraFrustum, 
-			(ushort)(ECS::Components::RenderHandleFlags::Renderer | ECS::Components::RenderHandleFlags::Light));
-	
-		UpdateDynamicBatches(m_entityDb, m_visibilityCache, m_dynamicBatches);
-
-		m_lightsManager.Preprocess(
-			m_entityDb, 
-			m_visibilityCache.GetList(Culling::CullingGroup::CameraFrustum, (int)ECS::Components::RenderHandleFlags::Light), 
-			resolution, 
-			inverseViewProjection, 
-			projParams.x, 
-			projParams.y);
+	}
+
+	void RenderPipeline::OnUpdateBatches()
+	{
+		PK_PROFILE_SCOPE("UpdateBatches");
+		auto resolution = GraphicsAPI::GetActiveWindowResolution();
+		const float4 projParams = *m_context.ShaderProperties.GetPropertyPtr<float4>(HashCache::Get()->pk_ProjectionParams);
+		const float4x4& projection = *m_context.ShaderProperties.GetPropertyPtr<float4x4>(HashCache::Get()->pk_MATRIX_P);
+
+		UpdateOcclusionPyramid();
+
+		ShadowCascadeReceivers receivers(m_lightsManager.GetCascadeZSplits(projParams.x, projParams.y));
+		FrameSetup::BuildDynamicBatches(m_entityDb, 
+			m_cullingStep.GetVisibilityCache(), 
+			m_occlusionPyramid.IsValid() ? &m_occlusionPyramid : nullptr, 
+			m_cullingStep.GetOccluders(), 
+			GraphicsAPI::GetActiveViewProjectionMatrix(),
+			0.5f * resolution.y * projection[1][1],
+			m_textureStreamer,
+			&m_dynamicBatches,
+			&receivers);
+
+		m_textureStreamer->Update();
+
+		FrameSetup::PreprocessLights(&m_lightsManager, m_entityDb, m_cullingStep.GetVisibilityCache(), m_context.ShaderProperties, resolution, &receivers);
 	}
 	
 	void RenderPipeline::OnRender()
 	{
-		GraphicsAPI::SetRenderTarget(m_GeometryBufferTarget.get());
-		GraphicsAPI::Clear(PK_COLOR_CLEAR, 1.0f, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		FixedStateAttributes depthNormalsAttributes;
-		depthNormalsAttributes.BlendEnabled = false;
-		depthNormalsAttributes.ColorMask = 255;
-		depthNormalsAttributes.CullEnabled = true;
-		depthNormalsAttributes.CullMode = GL_BACK;
-		depthNormalsAttributes.ZTest = GL_LEQUAL;
-		depthNormalsAttributes.ZTestEnabled = true;
-		depthNormalsAttributes.ZWriteEnabled = true;
-
-		Batching::DrawBatchesPredicated(&m_dynamicBatches, StringHashID::StringToID("PK_META_DEPTH_NORMALS"), m_depthNormalsShader, depthNormalsAttributes);
+		PK_PROFILE_RENDER_SCOPE("Render");
+
+		{
+			PK_PROFILE_RENDER_SCOPE("DepthPrepass");
+			GraphicsAPI::SetRenderTarget(m_GeometryBufferTarget.get());
+			GraphicsAPI::Clear(PK_COLOR_CLEAR, 1.0f, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			FixedStateAttributes depthNormalsAttributes;
+			depthNormalsAttributes.BlendEnabled = false;
+			depthNormalsAttributes.ColorMask = 255;
+			depthNormalsAttributes.CullEnabled = true;
+			depthNormalsAttributes.CullMode = GL_BACK;
+			depthNormalsAttributes.ZTest = GL_LEQUAL;
+			depthNormalsAttributes.ZTestEnabled = true;
+			depthNormalsAttributes.ZWriteEnabled = true;
+
+			Batching::DrawBatchesPredicated(&m_dynamicBatches, StringHashID::StringToID("PK_META_DEPTH_NORMALS"), m_depthNormalsShader, depthNormalsAttributes);
+		}
 		
+		UpdateOcclusionDepths();
 		m_lightsManager.UpdateLightTiles(m_GeometryBufferTarget->GetResolution2D());
 
 		m_filterAO.Execute();
 		m_filterSceneGi.Execute(&m_dynamicBatches);
 
-		GraphicsAPI::SetRenderTarget(m_HDRRenderTarget.get());
-		GraphicsAPI::Clear(PK_COLOR_CLEAR, 1.0f, GL_COLOR_BUFFER_BIT);
+		{
+			PK_PROFILE_RENDER_SCOPE("Forward");
+			GraphicsAPI::SetRenderTarget(m_HDRRenderTarget.get());
+			GraphicsAPI::Clear(PK_COLOR_CLEAR, 1.0f, GL_COLOR_BUFFER_BIT);
 
-		GraphicsAPI::CopyRenderTexture(m_GeometryBufferTarget.get(), m_HDRRenderTarget.get(), GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+			GraphicsAPI::CopyRenderTexture(m_GeometryBufferTarget.get(), m_HDRRenderTarget.get(), GL_DEPTH_BUFFER_BIT, GL_NEAREST);
 
-		GraphicsAPI::Blit(m_OEMBackgroundShader);
+			GraphicsAPI::Blit(m_OEMBackgroundShader);
 
-		// @Todo Implement render passes
-		Batching::DrawBatches(&m_dynamicBatches);
+			// @Todo Implement render passes
+			Batching::DrawBatches(&m_dynamicBatches);
+		}
 
 		m_filterFog.Execute(m_HDRRenderTarget.get(), m_HDRRenderTarget.get());
+
+		{
+			PK_PROFILE_RENDER_SCOPE("Transparent");
+			GraphicsAPI::SetRenderTarget(m_HDRRenderTarget.get());
+			Batching::DrawTransparent(&m_dynamicBatches);
+		}
+
 		m_filterDof.Execute(m_HDRRenderTarget.get(), m_HDRRenderTarget.get());
 		m_filterBloom.Execute(m_HDRRenderTarget.get(), GraphicsAPI::GetBackBuffer());
 
@@ -266,4 +310,88 @@ namespace PK::Rendering
 			m_lightsManager.DrawDebug();
 		}
 	}
+
+	void RenderPipeline::UpdateOcclusionPyramid()
+	{
+		if (!m_enableOcclusionCulling)
+		{
+			m_occlusionPyramid.Invalidate();
+			return;
+		}
+
+		// Newest finished readback first. Readbacks still in flight are skipped so that the cpu never waits for the gpu.
+		// Without a finished readback the pyramid of an earlier frame is kept. Objects disoccluded since then can be missing for a few frames.
+		for (auto i = 1u; i <= OcclusionReadbackCount; ++i)
+		{
+			auto& readback = m_occlusionReadbacks[(m_occlusionWriteIndex + OcclusionReadbackCount - i) % OcclusionReadbackCount];
+
+			if (readback.fence == nullptr)
+			{
+				continue;
+			}
+
+			auto status = glClientWaitSync(readback.fence, 0, 0);
+
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			{
+				continue;
+			}
+
+			memcpy(m_occlusionPyramid.GetBaseLevel(), readback.depths, sizeof(float) * OcclusionDepthSizeX * OcclusionDepthSizeY);
+			m_occlusionPyramid.BuildMipChain(readback.viewProjection);
+
+			// Older readbacks are superseded by this one.
+			for (auto j = i; j <= OcclusionReadbackCount; ++j)
+			{
+				auto& superseded = m_occlusionReadbacks[(m_occlusionWriteIndex + OcclusionReadbackCount - j) % OcclusionReadbackCount];
+
+				if (superseded.fence != nullptr)
+				{
+					glDeleteSync(superseded.fence);
+					superseded.fence = nullptr;
+				}
+			}
+
+			break;
+		}
+	}
+
+	void RenderPipeline::UpdateOcclusionDepths()
+	{
+		if (!m_enableOcclusionCulling)
+		{
+			DiscardOcclusionReadbacks();
+			return;
+		}
+
+		auto& readback = m_occlusionReadbacks[m_occlusionWriteIndex];
+
+		if (readback.fence != nullptr)
+		{
+			glDeleteSync(readback.fence);
+			readback.fence = nullptr;
+		}
+
+		auto groupCountX = (OcclusionDepthSizeX + 15u) / 16u;
+		auto groupCountY = (OcclusionDepthSizeY + 15u) / 16u;
+		GraphicsAPI::SetGlobalComputeBuffer(HashCache::Get()->pk_OcclusionDepths, readback.buffer->GetGraphicsID());
+		GraphicsAPI::DispatchCompute(m_computeOcclusionDepth, { groupCountX, groupCountY, 1 }, GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+		readback.viewProjection = *m_context.ShaderProperties.GetPropertyPtr<float4x4>(HashCache::Get()->pk_MATRIX_VP);
+		readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_occlusionWriteIndex = (m_occlusionWriteIndex + 1) % OcclusionReadbackCount;
+	}
+
+	void RenderPipeline::DiscardOcclusionReadbacks()
+	{
+		m_occlusionPyramid.Invalidate();
+
+		for (auto& readback : m_occlusionReadbacks)
+		{
+			if (readback.fence != nullptr)
+			{
+				glDeleteSync(readback.fence);
+				readback.fence = nullptr;
+			}
+		}
+	}
 }
\ No newline at end of file
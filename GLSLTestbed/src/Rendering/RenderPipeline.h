@@ -4,6 +4,7 @@
 #include "Core/IService.h"
 #include "Core/Time.h"
 #include "Core/Input.h"
+#include "Core/ConsoleCommandBinding.h"
 #include "ECS/EntityDatabase.h"
 #include "Core/ApplicationConfig.h"
 #include "Rendering/Objects/TextureXD.h"
@@ -11,12 +12,15 @@
 #include "Rendering/Structs/StructsCommon.h"
 #include "Rendering/Batching.h"
 #include "Rendering/Culling.h"
+#include "Rendering/OcclusionCulling.h"
+#include "Rendering/CullingStep.h"
 #include "Rendering/PostProcessing/FilterBloom.h"
 #include "Rendering/PostProcessing/FilterAO.h"
 #include "Rendering/PostProcessing/FilterVolumetricFog.h"
 #include "Rendering/PostProcessing/FilterDof.h"
 #include "Rendering/PostProcessing/FilterSceneGI.h"
 #include "Rendering/LightsManager.h"
+#include "Rendering/TextureStreamer.h"
 
 namespace PK::Rendering
 {
@@ -24,26 +28,56 @@ namespace PK::Rendering
                            public PK::ECS::ISimpleStep, 
                            public PK::ECS::IStep<Time>, 
                            public PK::ECS::IStep<Input>, 
-                           public PK::ECS::IStep<AssetImportToken<ApplicationConfig>>
+                           public PK::ECS::IStep<AssetImportToken<ApplicationConfig>>,
+                           public PK::ECS::IStep<ConsoleCommandToken>
     {
+        private:
+            // Gpu written occlusion depths that are read once their fence has signaled. Depths keep the view projection they were rendered with.
+            struct OcclusionReadback
+            {
+                Utilities::Ref<ComputeBuffer> buffer;
+                const float* depths = nullptr;
+                GLsync fence = nullptr;
+                float4x4 viewProjection = PK_FLOAT4X4_IDENTITY;
+            };
+
         public:
-            RenderPipeline(AssetDatabase* assetDatabase, PK::ECS::EntityDatabase* entityDb, const ApplicationConfig* config);
+            RenderPipeline(AssetDatabase* assetDatabase, PK::ECS::EntityDatabase* entityDb, TextureStreamer* textureStreamer, const ApplicationConfig* config);
+            ~RenderPipeline();
+
+            inline CullingStep* GetCullingStep() { return &m_cullingStep; }
     
             void Step(Time* token) override;
             void Step(Input* token) override;
             void Step(int condition) override;
             void Step(AssetImportToken<ApplicationConfig>* token) override;
+            void Step(ConsoleCommandToken* token) override;
     
         private:
             void OnPreRender();
+            void OnUpdateBatches();
             void OnRender();
+            void UpdateOcclusionPyramid();
+            void UpdateOcclusionDepths();
+            void DiscardOcclusionReadbacks();
+
+            const uint OcclusionDepthSizeX = 256;
+            const uint OcclusionDepthSizeY = 128;
+            const uint OccluderBufferSizeX = 320;
+            const uint OccluderBufferSizeY = 192;
+            const uint OccluderTriangleBudget = 8192;
+            static constexpr uint OcclusionReadbackCount = 3;
     
             bool m_enableLightingDebug;
+            bool m_enableOcclusionCulling;
             bool m_logframerate;
 
             GraphicsContext m_context;  
             PK::ECS::EntityDatabase* m_entityDb;
-            Culling::VisibilityCache m_visibilityCache;
+            TextureStreamer* m_textureStreamer;
+            // Culling results are owned by the culling step & only read by the render step.
+            CullingStep m_cullingStep;
+            Culling::DepthPyramid m_occlusionPyramid;
             Batching::DynamicBatchCollection m_dynamicBatches;
             LightsManager m_lightsManager;
             PostProcessing::FilterBloom m_filterBloom;
@@ -55,6 +89,9 @@ namespace PK::Rendering
             Utilities::Ref<RenderTexture> m_GeometryBufferTarget;
             Utilities::Ref<RenderTexture> m_HDRRenderTarget;
             Utilities::Ref<ConstantBuffer> m_constantsPerFrame;
+            OcclusionReadback m_occlusionReadbacks[OcclusionReadbackCount];
+            uint m_occlusionWriteIndex = 0;
+            Shader* m_computeOcclusionDepth;
             Shader* m_depthNormalsShader;
             Shader* m_OEMBackgroundShader;
             TextureXD* m_OEMTexture;
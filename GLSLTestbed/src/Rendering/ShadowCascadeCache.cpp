@@ -0,0 +1,78 @@
+#include "PrecompiledHeader.h"
+#include "ShadowCascadeCache.h"
+
+namespace PK::Rendering
+{
+	ShadowCascadeCache::ShadowCascadeCache(uint cascadeCount, uint resolution, uint farUpdateInterval, bool stable) :
+		m_cascadeCount(glm::min(cascadeCount, MaxCascadeCount)),
+		m_resolution(resolution),
+		m_farUpdateInterval(glm::max(farUpdateInterval, 1u)),
+		m_stable(stable)
+	{
+	}
+
+	void ShadowCascadeCache::BeginFrame()
+	{
+		++m_frameIndex;
+
+		// Lights that were not visible last frame are solved from scratch.
+		for (auto iter = m_entries.begin(); iter != m_entries.end();)
+		{
+			iter = iter->second.lastUsedFrame + 1 < m_frameIndex ? m_entries.erase(iter) : std::next(iter);
+		}
+	}
+
+	const ShadowCascadeCache::Cascades& ShadowCascadeCache::Update(uint lightId, const float4x4& worldToLocal, const float4x4& inverseViewProjection, const float* zPlanes, float zPadding, const BoundingBox* receiverBounds)
+	{
+		float4x4 matrices[MaxCascadeCount];
+		float depthRange;
+
+		if (m_stable)
+		{
+			depthRange = Functions::GetStableShadowCascadeMatrices(worldToLocal, inverseViewProjection, zPlanes, zPadding, m_resolution, m_cascadeCount, matrices);
+		}
+		else
+		{
+			depthRange = Functions::GetShadowCascadeMatrices(worldToLocal, inverseViewProjection, zPlanes, zPadding, m_cascadeCount, matrices, receiverBounds);
+		}
+
+		auto isNew = m_entries.count(lightId) == 0;
+		auto& entry = m_entries[lightId];
+
+		// Cascades can only lag behind when they do not depend on each other & the light has not moved.
+		auto updateAll = isNew || !m_stable || entry.cascades.depthRange != depthRange || entry.worldToLocal != worldToLocal;
+
+		entry.cascades.dirtyMask = 0u;
+		entry.cascades.depthRange = depthRange;
+		entry.worldToLocal = worldToLocal;
+		entry.lastUsedFrame = m_frameIndex;
+
+		for (auto i = 0u; i < m_cascadeCount; ++i)
+		{
+			// Offset by the cascade index so that infrequent updates do not land on the same frame.
+			if (!updateAll && (m_frameIndex + i) % GetUpdateInterval(i) != 0)
+			{
+				continue;
+			}
+
+			if (isNew || entry.cascades.matrices[i] != matrices[i])
+			{
+				entry.cascades.matrices[i] = matrices[i];
+				entry.cascades.dirtyMask |= 1u << i;
+			}
+		}
+
+		return entry.cascades;
+	}
+
+	const ShadowCascadeCache::Cascades* ShadowCascadeCache::Find(uint lightId) const
+	{
+		auto iter = m_entries.find(lightId);
+		return iter != m_entries.end() ? &iter->second.cascades : nullptr;
+	}
+
+	uint ShadowCascadeCache::GetUpdateInterval(uint cascade) const
+	{
+		return m_stable ? glm::max(1u, m_farUpdateInterval >> (m_cascadeCount - 1u - cascade)) : 1u;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+#include "Core/NoCopy.h"
+#include <unordered_map>
+#include <hlslmath.h>
+
+namespace PK::Rendering
+{
+    using namespace PK::Math;
+
+    // Cascade matrices of directional lights. Solved once per frame & kept across frames.
+    // Stable cascades are fit to bounding spheres & snapped to texels. Their matrices only change when the camera moves by a whole texel.
+    // Distant cascades can be updated at a lower frequency. They keep their previous matrix in between so that sampling matches the rendered shadowmap.
+    // Has no graphics api dependencies.
+    class ShadowCascadeCache : public PK::Core::NoCopy
+    {
+        public:
+            static constexpr uint MaxCascadeCount = 4;
+
+            struct Cascades
+            {
+                float4x4 matrices[MaxCascadeCount];
+                float depthRange = 0.0f;
+                // Cascades whose matrix changed in the last update.
+                uint dirtyMask = 0;
+            };
+
+        private:
+            struct Entry
+            {
+                Cascades cascades;
+                float4x4 worldToLocal = PK_FLOAT4X4_IDENTITY;
+                ulong lastUsedFrame = 0;
+            };
+
+        public:
+            // The last cascade is updated every farUpdateInterval frames. Each nearer cascade halves the interval.
+            ShadowCascadeCache(uint cascadeCount, uint resolution, uint farUpdateInterval, bool stable);
+
+            void BeginFrame();
+
+            // Receiver bounds are optional & given per cascade. Only used by unstable cascades.
+            const Cascades& Update(uint lightId, const float4x4& worldToLocal, const float4x4& inverseViewProjection, const float* zPlanes, float zPadding, const BoundingBox* receiverBounds);
+
+            const Cascades* Find(uint lightId) const;
+
+            uint GetUpdateInterval(uint cascade) const;
+
+            inline uint GetCascadeCount() const { return m_cascadeCount; }
+
+        private:
+            const uint m_cascadeCount;
+            const uint m_resolution;
+            const uint m_farUpdateInterval;
+            const bool m_stable;
+            std::unordered_map<uint, Entry> m_entries;
+            ulong m_frameIndex = 1;
+    };
+}
\ No newline at end of file
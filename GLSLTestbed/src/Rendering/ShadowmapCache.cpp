@@ -0,0 +1,346 @@
+#include "PrecompiledHeader.h"
+#include "ShadowmapCache.h"
+#include "Utilities/Log.h"
+
+namespace PK::Rendering
+{
+	constexpr static const uint InvalidOwner = 0xFFFFFFFF;
+
+	ShadowmapCache::ShadowmapCache(uint layerCount) : m_layerCount(layerCount)
+	{
+		m_nodeOwners.resize((size_t)layerCount * NodesPerLayer, InvalidOwner);
+		m_nodeUsedCells.resize((size_t)layerCount * NodesPerLayer, 0u);
+	}
+
+	void ShadowmapCache::BeginFrame()
+	{
+		++m_frameIndex;
+	}
+
+	bool ShadowmapCache::Allocate(uint lightId, uint layerCount, uint level, Tile* tile)
+	{
+		auto iter = m_entries.find(lightId);
+
+		if (iter != m_entries.end())
+		{
+			if (iter->second.layerCount == layerCount && iter->second.tile.level == level)
+			{
+				iter->second.lastUsedFrame = m_frameIndex;
+				*tile = iter->second.tile;
+				return true;
+			}
+
+			Release(lightId);
+		}
+
+		if (layerCount == 0 || layerCount > m_layerCount || layerCount > MaxLayerCount || level > MaxLevel || (layerCount > 1 && level != 0))
+		{
+			return false;
+		}
+
+		Tile result;
+		result.level = level;
+
+		while (layerCount > 1 ? !FindFreeLayers(layerCount, &result.layer) : !FindFreeTile(level, &result))
+		{
+			if (!EvictLeastRecentlyUsed())
+			{
+				return false;
+			}
+		}
+
+		for (auto i = 0u; i < layerCount; ++i)
+		{
+			auto layerTile = result;
+			layerTile.layer += i;
+			SetNodeOwner(layerTile, lightId);
+		}
+
+		auto& entry = m_entries[lightId];
+		entry.tile = result;
+		entry.layerCount = layerCount;
+		std::fill(entry.hashes, entry.hashes + MaxLayerCount, 0ull);
+		entry.lastUsedFrame = m_frameIndex;
+		entry.isValid = false;
+		*tile = result;
+		return true;
+	}
+
+	bool ShadowmapCache::TryGetLevel(uint lightId, uint* level) const
+	{
+		auto iter = m_entries.find(lightId);
+
+		if (iter == m_entries.end())
+		{
+			return false;
+		}
+
+		*level = iter->second.tile.level;
+		return true;
+	}
+
+	uint ShadowmapCache::ValidateLayers(uint lightId, const ulong* inputHashes, uint count)
+	{
+		auto allLayers = (1u << count) - 1u;
+		auto iter = m_entries.find(lightId);
+
+		if (iter == m_entries.end())
+		{
+			return allLayers;
+		}
+
+		auto& entry = iter->second;
+		auto dirtyMask = entry.isValid ? 0u : allLayers;
+		count = glm::min(count, MaxLayerCount);
+
+		for (auto i = 0u; i < count; ++i)
+		{
+			if (entry.hashes[i] != inputHashes[i])
+			{
+				entry.hashes[i] = inputHashes[i];
+				dirtyMask |= 1u << i;
+			}
+		}
+
+		entry.isValid = true;
+		return dirtyMask;
+	}
+
+	void ShadowmapCache::Invalidate(uint lightId)
+	{
+		auto iter = m_entries.find(lightId);
+
+		if (iter != m_entries.end())
+		{
+			iter->second.isValid = false;
+		}
+	}
+
+	void ShadowmapCache::Release(uint lightId)
+	{
+		auto iter = m_entries.find(lightId);
+
+		if (iter == m_entries.end())
+		{
+			return;
+		}
+
+		auto& entry = iter->second;
+
+		for (auto i = 0u; i < entry.layerCount; ++i)
+		{
+			auto layerTile = entry.tile;
+			layerTile.layer += i;
+			SetNodeOwner(layerTile, InvalidOwner);
+		}
+
+		m_entries.erase(iter);
+	}
+
+	void ShadowmapCache::Clear()
+	{
+		std::fill(m_nodeOwners.begin(), m_nodeOwners.end(), InvalidOwner);
+		std::fill(m_nodeUsedCells.begin(), m_nodeUsedCells.end(), 0u);
+		m_entries.clear();
+		m_allocatedCellCount = 0;
+	}
+
+	void ShadowmapCache::LogLayout() const
+	{
+		std::vector<std::pair<uint, const Entry*>> entries;
+		entries.reserve(m_entries.size());
+
+		for (auto& kv : m_entries)
+		{
+			entries.push_back({ kv.first, &kv.second });
+		}
+
+		std::sort(entries.begin(), entries.end(), [](const std::pair<uint, const Entry*>& a, const std::pair<uint, const Entry*>& b)
+		{
+			return a.second->tile.layer != b.second->tile.layer ? a.second->tile.layer < b.second->tile.layer : a.second->tile.level < b.second->tile.level;
+		});
+
+		PK_CORE_LOG_HEADER("Shadowmap atlas: %u layers, %u / %u cells allocated, %u lights, %u evictions", m_layerCount, m_allocatedCellCount, m_layerCount * CellsPerLayer, (uint)entries.size(), m_evictionCount);
+
+		for (auto& entry : entries)
+		{
+			auto& tile = entry.second->tile;
+			auto age = m_frameIndex - entry.second->lastUsedFrame;
+			PK_CORE_LOG("    light %u: layers %u-%u, level %u, tile (%u, %u), %s, last used %u frames ago",
+				entry.first,
+				tile.layer,
+				tile.layer + entry.second->layerCount - 1,
+				tile.level,
+				tile.x,
+				tile.y,
+				entry.second->isValid ? "valid" : "invalid",
+				(uint)age);
+		}
+
+		// Occupancy of the smallest cells per layer.
+		auto cellsPerRow = 1u << MaxLevel;
+
+		for (auto layer = 0u; layer < m_layerCount; ++layer)
+		{
+			std::string rows;
+
+			for (auto y = 0u; y < cellsPerRow; ++y)
+			{
+				if (y > 0)
+				{
+					rows += ' ';
+				}
+
+				for (auto x = 0u; x < cellsPerRow; ++x)
+				{
+					auto isUsed = false;
+
+					for (auto level = 0u; level <= MaxLevel && !isUsed; ++level)
+					{
+						auto shift = MaxLevel - level;
+						isUsed = m_nodeOwners[GetNodeIndex(layer, level, x >> shift, y >> shift)] != InvalidOwner;
+					}
+
+					rows += isUsed ? '#' : '.';
+				}
+			}
+
+			PK_CORE_LOG("    layer %u: %s", layer, rows.c_str());
+		}
+	}
+
+	uint ShadowmapCache::EncodeTile(const Tile& tile, uint layerOffset)
+	{
+		return ((tile.layer + layerOffset) & 0xFFFFu) | ((tile.level & 0xFu) << 16u) | ((tile.x & 0x3Fu) << 20u) | ((tile.y & 0x3Fu) << 26u);
+	}
+
+	ulong ShadowmapCache::Hash(ulong hash, const void* data, size_t size)
+	{
+		// FNV-1a
+		auto bytes = reinterpret_cast<const unsigned char*>(data);
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	bool ShadowmapCache::IsNodeFree(uint layer, uint level, uint x, uint y) const
+	{
+		if (m_nodeUsedCells[GetNodeIndex(layer, level, x, y)] != 0)
+		{
+			return false;
+		}
+
+		// A parent owning its whole quad does not propagate its cells downwards.
+		for (auto parentLevel = 0u; parentLevel < level; ++parentLevel)
+		{
+			auto shift = level - parentLevel;
+
+			if (m_nodeOwners[GetNodeIndex(layer, parentLevel, x >> shift, y >> shift)] != InvalidOwner)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void ShadowmapCache::SetNodeOwner(const Tile& tile, uint owner)
+	{
+		auto cells = 1u << (2 * (MaxLevel - tile.level));
+		m_nodeOwners[GetNodeIndex(tile.layer, tile.level, tile.x, tile.y)] = owner;
+
+		for (auto level = 0u; level <= tile.level; ++level)
+		{
+			auto shift = tile.level - level;
+			auto& usedCells = m_nodeUsedCells[GetNodeIndex(tile.layer, level, tile.x >> shift, tile.y >> shift)];
+			usedCells = owner != InvalidOwner ? usedCells + cells : usedCells - cells;
+		}
+
+		m_allocatedCellCount = owner != InvalidOwner ? m_allocatedCellCount + cells : m_allocatedCellCount - cells;
+	}
+
+	bool ShadowmapCache::FindFreeTile(uint level, Tile* tile) const
+	{
+		auto tilesPerRow = 1u << level;
+
+		// Prefer partially filled layers so that whole layers stay available for larger tiles.
+		for (auto pass = 0u; pass < 2u; ++pass)
+		{
+			for (auto layer = 0u; layer < m_layerCount; ++layer)
+			{
+				auto usedCells = m_nodeUsedCells[GetNodeIndex(layer, 0, 0, 0)];
+
+				if (usedCells == CellsPerLayer || (pass == 0) != (usedCells > 0))
+				{
+					continue;
+				}
+
+				for (auto y = 0u; y < tilesPerRow; ++y)
+				{
+					for (auto x = 0u; x < tilesPerRow; ++x)
+					{
+						if (IsNodeFree(layer, level, x, y))
+						{
+							tile->layer = layer;
+							tile->level = level;
+							tile->x = x;
+							tile->y = y;
+							return true;
+						}
+					}
+				}
+			}
+		}
+
+		return false;
+	}
+
+	bool ShadowmapCache::FindFreeLayers(uint layerCount, uint* firstLayer) const
+	{
+		auto runLength = 0u;
+
+		// Search from the end so that cascades & smaller tiles are packed on opposite sides of the atlas.
+		for (auto layer = m_layerCount; layer-- > 0u;)
+		{
+			runLength = m_nodeUsedCells[GetNodeIndex(layer, 0, 0, 0)] == 0 ? runLength + 1 : 0u;
+
+			if (runLength == layerCount)
+			{
+				*firstLayer = layer;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool ShadowmapCache::EvictLeastRecentlyUsed()
+	{
+		auto lightId = InvalidOwner;
+		auto oldestFrame = m_frameIndex;
+
+		// Tiles used this frame cannot be evicted.
+		for (auto& kv : m_entries)
+		{
+			if (kv.second.lastUsedFrame < oldestFrame)
+			{
+				oldestFrame = kv.second.lastUsedFrame;
+				lightId = kv.first;
+			}
+		}
+
+		if (lightId == InvalidOwner)
+		{
+			return false;
+		}
+
+		Release(lightId);
+		++m_evictionCount;
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+#include "Core/NoCopy.h"
+#include <vector>
+#include <unordered_map>
+#include <hlslmath.h>
+
+namespace PK::Rendering
+{
+    using namespace PK::Math;
+
+    // Persistent shadow atlas allocator. Tiles are kept across frames & only need to be rendered again when the hash of a light's inputs changes.
+    // Each atlas layer is a quadtree. Level 0 covers the whole layer & every level below halves the tile resolution.
+    // Multi layer allocations (cascades) always use full layers.
+    // Tiles of lights that were not used this frame are evicted in least recently used order when the atlas runs out of space.
+    // Has no graphics api dependencies.
+    class ShadowmapCache : public PK::Core::NoCopy
+    {
+        public:
+            static constexpr uint MaxLevel = 2;
+            static constexpr uint LevelCount = MaxLevel + 1;
+            static constexpr uint MaxLayerCount = 4;
+
+            struct Tile
+            {
+                uint layer = 0;
+                uint level = 0;
+                uint x = 0;
+                uint y = 0;
+            };
+
+        private:
+            struct Entry
+            {
+                Tile tile;
+                uint layerCount = 0;
+                ulong hashes[MaxLayerCount] = {};
+                ulong lastUsedFrame = 0;
+                bool isValid = false;
+            };
+
+        public:
+            ShadowmapCache(uint layerCount);
+
+            void BeginFrame();
+
+            // Allocates a tile of the given level for a light. Returns false if there is no space even after eviction.
+            // A light that already owns a tile with a different level or layer count is reallocated.
+            bool Allocate(uint lightId, uint layerCount, uint level, Tile* tile);
+
+            bool TryGetLevel(uint lightId, uint* level) const;
+
+            // Returns true if the light's tiles need to be rendered. Stores the hash as the current contents of the tiles.
+            inline bool Validate(uint lightId, ulong inputHash) { return ValidateLayers(lightId, &inputHash, 1u) != 0u; }
+
+            // Per layer variant of Validate for multi layer allocations. Returns a mask of the layers that need to be rendered.
+            uint ValidateLayers(uint lightId, const ulong* inputHashes, uint count);
+
+            void Invalidate(uint lightId);
+
+            void Release(uint lightId);
+
+            void Clear();
+
+            void LogLayout() const;
+
+            inline uint GetLayerCount() const { return m_layerCount; }
+            inline uint GetAllocatedCellCount() const { return m_allocatedCellCount; }
+            inline uint GetEvictionCount() const { return m_evictionCount; }
+
+            // Layer in the low 16 bits followed by the level & tile coordinates. Adding to the index offsets the layer.
+            static uint EncodeTile(const Tile& tile, uint layerOffset);
+
+            static ulong Hash(ulong hash, const void* data, size_t size);
+
+            template<typename T>
+            static ulong Hash(ulong hash, const T& value) { return Hash(hash, &value, sizeof(T)); }
+
+            static constexpr ulong HashSeed = 14695981039346656037ull;
+
+        private:
+            static constexpr uint NodesPerLayer = 21;
+            static constexpr uint CellsPerLayer = 1u << (2 * MaxLevel);
+
+            inline uint GetNodeIndex(uint layer, uint level, uint x, uint y) const { return layer * NodesPerLayer + ((1u << (2 * level)) - 1u) / 3u + y * (1u << level) + x; }
+            bool IsNodeFree(uint layer, uint level, uint x, uint y) const;
+            void SetNodeOwner(const Tile& tile, uint owner);
+            bool FindFreeTile(uint level, Tile* tile) const;
+            bool FindFreeLayers(uint layerCount, uint* firstLayer) const;
+            bool EvictLeastRecentlyUsed();
+
+            const uint m_layerCount;
+            std::vector<uint> m_nodeOwners;
+            std::vector<uint> m_nodeUsedCells;
+            std::unordered_map<uint, Entry> m_entries;
+            ulong m_frameIndex = 1;
+            uint m_allocatedCellCount = 0;
+            uint m_evictionCount = 0;
+    };
+}
\ No newline at end of file
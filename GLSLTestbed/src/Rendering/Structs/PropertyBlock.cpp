@@ -20,8 +20,7 @@ namespace PK::Rendering::Structs
 			//auto elementSize = Convert::Size(element.Type);
 			//ushort paddedSize = elementStride * (ushort)ceil((float)elementSize / elementStride);
 			//ushort paddedSizeFull = paddedSize * (element.Size / elementSize);
-			m_properties[element.NameHashId] = { element.Type, element.Size, m_currentByteOffset };
-			m_currentByteOffset += element.Size;
+			InsertProperty(element.NameHashId, element.Type, element.Size);
 		}
 	}
 	
@@ -37,59 +36,92 @@ namespace PK::Rendering::Structs
 		}
 	
 		auto size = (ushort)(Convert::Size(type) * count);
-		auto& info = m_properties[hashid];
+		auto info = std::lower_bound(m_properties.begin(), m_properties.end(), hashid, CompareHashId);
 	
-		if (info.size == 0)
+		if (info == m_properties.end() || info->hashId != hashid)
 		{
 			PK_CORE_ASSERT(!m_explicitLayout, "Cannot add elements to explicitly mapped property block!");
-	
-			if (m_currentByteOffset >= m_data.size())
-			{
-				m_data.resize(m_data.size() + size);
-			}
-	
-			info = { type, size, m_currentByteOffset };
-			m_currentByteOffset += size;
+			info = InsertProperty(hashid, type, size);
 		}
-		else if (info.size < size || info.type != type)
+		else if (info->size < size || info->type != type)
 		{
 			PK_CORE_ERROR("INVALID DATA FORMAT! %s", StringHashID::IDToString(hashid).c_str());
 		}
 	
-		memcpy(m_data.data() + info.offset, src, size);
+		memcpy(m_data.data() + info->offset, src, size);
+		++m_version;
+	}
+
+	const PropertyBlock::PropertyInfo* PropertyBlock::FindProperty(uint hashId) const
+	{
+		auto info = std::lower_bound(m_properties.begin(), m_properties.end(), hashId, CompareHashId);
+		return info != m_properties.end() && info->hashId == hashId ? &(*info) : nullptr;
+	}
+
+	std::vector<PropertyBlock::PropertyInfo>::iterator PropertyBlock::InsertProperty(uint hashId, PK_TYPE type, ushort size)
+	{
+		if (m_currentByteOffset + size > m_data.size())
+		{
+			m_data.resize(m_currentByteOffset + size);
+		}
+
+		auto info = m_properties.insert(std::lower_bound(m_properties.begin(), m_properties.end(), hashId, CompareHashId), { hashId, type, size, m_currentByteOffset });
+		m_currentByteOffset += size;
+
+		// FNV-1a over the sorted records.
+		m_layoutHash = 14695981039346656037ull;
+
+		for (auto& property : m_properties)
+		{
+			ulong values[] = { property.hashId, (ulong)property.type, property.size, property.offset };
+
+			for (auto value : values)
+			{
+				m_layoutHash ^= value;
+				m_layoutHash *= 1099511628211ull;
+			}
+		}
+
+		return info;
 	}
 	
 	void PropertyBlock::CopyFrom(PropertyBlock& from)
 	{
-		auto& propsm = m_properties;
-		auto& propst = from.m_properties;
+		auto theirs = from.m_properties.begin();
 	
-		for (auto& prop : propsm)
+		// Both property lists are sorted by hash id.
+		for (auto& mine : m_properties)
 		{
-			if (propst.count(prop.first) < 1)
+			while (theirs != from.m_properties.end() && theirs->hashId < mine.hashId)
 			{
-				continue;
+				++theirs;
 			}
-	
-			auto& theirs = propst.at(prop.first);
-			auto& mine = prop.second;
-	
+
+			if (theirs == from.m_properties.end())
+			{
+				break;
+			}
+
 			// missmatch
-			if (mine.size < theirs.size || mine.type != theirs.type)
+			if (theirs->hashId != mine.hashId || mine.size < theirs->size || mine.type != theirs->type)
 			{
 				continue;
 			}
 	
-			auto src = from.m_data.data() + theirs.offset;
+			auto src = from.m_data.data() + theirs->offset;
 			auto dst = m_data.data() + mine.offset;
 	
 			memcpy(dst, src, mine.size);
 		}
+
+		++m_version;
 	}
 	
 	void PropertyBlock::Clear()
 	{
 		m_currentByteOffset = 0;
+		m_layoutHash = 0;
 		m_properties.clear();
+		++m_version;
 	}
 }
\ No newline at end of file
@@ -12,10 +12,13 @@ namespace PK::Rendering::Structs
 		protected:
 			struct PropertyInfo
 			{
+				uint hashId = 0;
 				PK_TYPE type = PK_TYPE::INVALID;
 				ushort size = 0;
 				uint offset = 0;
 			};
+
+			static inline bool CompareHashId(const PropertyInfo& info, uint hashId) { return info.hashId < hashId; }
 			
 		public:
 	
@@ -59,6 +62,8 @@ namespace PK::Rendering::Structs
 			inline void SetUInt4(uint hashId, const uint4& value) { SetValue(hashId, PK_TYPE::UINT4, glm::value_ptr(value)); }
 			inline void SetResourceHandle(uint hashId, const ulong& value) { SetValue(hashId, PK_TYPE::HANDLE, &value); }
 	
+			void SetValue(uint hashid, PK_TYPE type, const void* src, uint count);
+	
 			void CopyFrom(PropertyBlock& from);
 	
 			virtual void Clear();
@@ -77,25 +82,35 @@ namespace PK::Rendering::Structs
 			template<typename T>
 			const T* GetPropertyPtr(const uint hashId) const
 			{
-				return GetElementPtr<T>(m_properties.at(hashId));
+				auto info = FindProperty(hashId);
+				PK_CORE_ASSERT(info != nullptr, "Property block does not contain the requested property!");
+				return GetElementPtr<T>(*info);
 			}
 
 			template<typename T>
 			const bool TryGetPropertyValue(const uint hashId, T& value) const
 			{
-				if (m_properties.count(hashId))
+				auto info = FindProperty(hashId);
+
+				if (info != nullptr)
 				{
-					value = *GetElementPtr<T>(m_properties.at(hashId));
+					value = *GetElementPtr<T>(*info);
 					return true;
 				}
 
 				return false;
 			}
+
+			// Changes only when properties are added or cleared. Blocks with equal layouts share shader binding tables.
+			inline ulong GetLayoutHash() const { return m_layoutHash; }
+			// Incremented by every write. Lets copies of the values detect changes without comparing them.
+			inline ulong GetVersion() const { return m_version; }
+			inline const char* GetData() const { return m_data.data(); }
+			inline size_t GetPropertyCount() const { return m_properties.size(); }
 	
-			std::unordered_map<uint, PropertyInfo>::iterator begin() { return m_properties.begin(); }
-			std::unordered_map<uint, PropertyInfo>::iterator end() { return m_properties.end(); }
-			std::unordered_map<uint, PropertyInfo>::const_iterator begin() const { return m_properties.begin(); }
-			std::unordered_map<uint, PropertyInfo>::const_iterator end() const { return m_properties.end(); }
+			// Properties are sorted by hash id.
+			std::vector<PropertyInfo>::const_iterator begin() const { return m_properties.begin(); }
+			std::vector<PropertyInfo>::const_iterator end() const { return m_properties.end(); }
 		
 		protected:
 			template<typename T>
@@ -104,11 +119,14 @@ namespace PK::Rendering::Structs
 				SetValue(hashId, type, reinterpret_cast<const void*>(src), count);
 			}
 		
-			void SetValue(uint hashid, PK_TYPE type, const void* src, uint count);
+			const PropertyInfo* FindProperty(uint hashId) const;
+			std::vector<PropertyInfo>::iterator InsertProperty(uint hashId, PK_TYPE type, ushort size);
 	
 			bool m_explicitLayout = false;
 			uint m_currentByteOffset = 0;
+			ulong m_layoutHash = 0;
+			ulong m_version = 0;
 			std::vector<char> m_data;
-			std::unordered_map<uint, PropertyInfo> m_properties;
+			std::vector<PropertyInfo> m_properties;
 	};
 }
\ No newline at end of file
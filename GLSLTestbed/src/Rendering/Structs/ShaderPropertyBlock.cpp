@@ -3,46 +3,71 @@
 
 namespace PK::Rendering::Structs
 {
-	void ShaderPropertyBlock::SetKeyword(uint32_t hashId, bool value)
+	void KeywordSet::Add(uint32_t hashId)
 	{
-		auto iterator = std::find(m_keywords.begin(), m_keywords.end(), hashId);
-	
-		if (iterator == m_keywords.end())
+		for (auto i = 0u; i < count; ++i)
 		{
-			if (value)
+			if (hashIds[i] == hashId)
 			{
-				m_keywords.push_back(hashId);
+				return;
 			}
-	
-			return;
 		}
-	
-		if (!value)
+
+		PK_CORE_ASSERT(count < MaxCount, "Keyword set is full!");
+		hashIds[count++] = hashId;
+	}
+
+	void KeywordSet::Remove(uint32_t hashId)
+	{
+		for (auto i = 0u; i < count; ++i)
+		{
+			if (hashIds[i] == hashId)
+			{
+				// Order is kept. Sets compare element wise so a reordered set only costs a variant cache miss.
+				memmove(hashIds + i, hashIds + i + 1, sizeof(uint32_t) * (count - i - 1));
+				--count;
+				return;
+			}
+		}
+	}
+
+	void ShaderPropertyBlock::SetKeyword(uint32_t hashId, bool value)
+	{
+		if (value)
 		{
-			m_keywords.erase(iterator);
+			m_keywords.Add(hashId);
+		}
+		else
+		{
+			m_keywords.Remove(hashId);
 		}
 	}
 
     void ShaderPropertyBlock::SetKeywords(std::initializer_list<uint32_t> hashIds)
     {
-		m_keywords.resize(hashIds.size());
-		memcpy(m_keywords.data(), hashIds.begin(), sizeof(uint32_t) * hashIds.size());
+		m_keywords.Clear();
+
+		for (auto hashId : hashIds)
+		{
+			m_keywords.Add(hashId);
+		}
     }
 
 	void ShaderPropertyBlock::CopyBufferLayout(const BufferLayout& layout, char* destination) const
 	{
 		for (auto& element : layout)
 		{
-			if (m_properties.count(element.NameHashId) < 1)
+			auto prop = FindProperty(element.NameHashId);
+
+			if (prop == nullptr)
 			{
 				continue;
 			}
 
-			const auto& prop = m_properties.at(element.NameHashId);
-			auto valueptr = GetElementPtr<void>(prop);
+			auto valueptr = GetElementPtr<void>(*prop);
 
-			PK_CORE_ASSERT(element.Type == prop.type, "Trying to map an incompatible type!");
-			PK_CORE_ASSERT(element.Size == prop.size, "Trying to map a property of differing size!");
+			PK_CORE_ASSERT(element.Type == prop->type, "Trying to map an incompatible type!");
+			PK_CORE_ASSERT(element.Size == prop->size, "Trying to map a property of differing size!");
 			memcpy(destination + element.Offset, valueptr, element.Size);
 		}
 	}
@@ -50,6 +75,6 @@ namespace PK::Rendering::Structs
 	void ShaderPropertyBlock::Clear()
 	{
 		PropertyBlock::Clear();
-		m_keywords.clear();
+		m_keywords.Clear();
 	}
 }
\ No newline at end of file
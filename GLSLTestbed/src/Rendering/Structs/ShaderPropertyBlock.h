@@ -8,6 +8,23 @@ namespace PK::Rendering::Structs
 {
 	using namespace Objects;
 
+	// One bit per keyword of a single shader. Bit indices are local to the shader & assigned when it is imported, see ShaderVariantMap.
+	typedef uint64_t KeywordMask;
+
+	// Keyword hashes enabled on a property block. Shaders map them to their local bits when resolving a variant.
+	struct KeywordSet
+	{
+		static constexpr uint32_t MaxCount = 8u;
+		uint32_t hashIds[MaxCount] = {};
+		uint32_t count = 0u;
+
+		void Add(uint32_t hashId);
+		void Remove(uint32_t hashId);
+		inline void Clear() { count = 0u; }
+		inline bool operator == (const KeywordSet& other) const { return count == other.count && memcmp(hashIds, other.hashIds, sizeof(uint32_t) * count) == 0; }
+		inline bool operator != (const KeywordSet& other) const { return !(*this == other); }
+	};
+
 	class ShaderPropertyBlock : public PropertyBlock
 	{
 	    public:
@@ -28,8 +45,8 @@ namespace PK::Rendering::Structs
 
 	        void Clear() override;
 	
-			inline const std::vector<uint32_t>& GetKeywords() const { return m_keywords; }
+			inline const KeywordSet& GetKeywords() const { return m_keywords; }
 	    private:
-			std::vector<uint32_t> m_keywords;
+			KeywordSet m_keywords;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,397 @@
+#include "PrecompiledHeader.h"
+#include "Core/Profiler.h"
+#include "Utilities/Log.h"
+#include "Utilities/StringHashID.h"
+#include "Rendering/TextureStreamer.h"
+#include <KTX/ktx.h>
+#include <fstream>
+
+namespace PK::Rendering
+{
+    using namespace PK::Utilities;
+
+    TextureStreamer::TextureStreamer(AssetDatabase* assetDatabase, const ApplicationConfig* config) : m_assetDatabase(assetDatabase), m_cache(0ull)
+    {
+        SetConfig(config);
+        m_threadPool = CreateScope<ThreadPool>(WorkerCount);
+    }
+
+    TextureStreamer::~TextureStreamer()
+    {
+        // Workers write to the jobs until they are joined.
+        m_threadPool = nullptr;
+        DeleteRetiredStorage(true);
+    }
+
+    TextureXD* TextureStreamer::Load(const std::string& filepath)
+    {
+        if (m_isEnabled)
+        {
+            m_streamedAssets.insert(StringHashID::StringToID(filepath));
+        }
+
+        return m_assetDatabase->Load<TextureXD>(filepath);
+    }
+
+    bool TextureStreamer::Import(const std::string& filepath, TextureXD* texture, GLenum wrapmode)
+    {
+        auto textureId = texture->GetAssetID();
+
+        // The importer has already deleted the storage of a reloaded texture.
+        texture->m_graphicsId = 0;
+
+        if (texture->m_isStreamed)
+        {
+            RemoveStreamedTexture(textureId);
+            texture->m_isStreamed = false;
+            texture->m_firstResidentLevel = 0;
+        }
+
+        if (m_streamedAssets.count(textureId) == 0)
+        {
+            return false;
+        }
+
+        StreamedTexture streamed;
+
+        if (!ReadLevelRanges(filepath, &streamed))
+        {
+            PK_CORE_LOG_WARNING("Texture (%s) is not an uncompressed 2D ktx with mips & is not streamed.", filepath.c_str());
+            return false;
+        }
+
+        ktxTexture* kTexture;
+        auto result = ktxTexture_CreateFromNamedFile(filepath.c_str(), KTX_TEXTURE_CREATE_NO_FLAGS, &kTexture);
+        PK_CORE_ASSERT(result == KTX_SUCCESS, "Failed to load ktx!");
+        TextureXD::GetDescirptorFromKTX(kTexture, &texture->m_descriptor, &texture->m_channels);
+        ktxTexture_Destroy(kTexture);
+
+        auto& descriptor = texture->m_descriptor;
+        auto maxResolution = glm::max(descriptor.resolution.x, descriptor.resolution.y);
+        auto tailLevel = 0u;
+
+        while (tailLevel + 1 < streamed.levelCount && (maxResolution >> tailLevel) > m_tailSize)
+        {
+            ++tailLevel;
+        }
+
+        if (tailLevel == 0)
+        {
+            return false;
+        }
+
+        descriptor.wrapmodex = wrapmode;
+        descriptor.wrapmodey = wrapmode;
+        descriptor.wrapmodez = wrapmode;
+        texture->m_firstResidentLevel = descriptor.miplevels;
+        texture->SetFirstResidentLevel(tailLevel);
+        texture->m_isStreamed = true;
+
+        ulong levelSizes[TextureStreamingCache::MaxLevelCount];
+
+        for (auto i = 0u; i < streamed.levelCount; ++i)
+        {
+            levelSizes[i] = streamed.levels[i].size;
+        }
+
+        streamed.texture = texture;
+        streamed.filepath = filepath;
+        streamed.generation = ++m_generation;
+
+        for (auto level = tailLevel; level < streamed.levelCount; ++level)
+        {
+            PK_CORE_ASSERT(ReadLevel(filepath, streamed.levels[level], m_uploadBuffer), "Failed to read level %u of ktx (%s)!", level, filepath.c_str());
+            UploadLevel(streamed, level, m_uploadBuffer.data());
+        }
+
+        m_textures[textureId] = streamed;
+        m_cache.Register(textureId, levelSizes, streamed.levelCount, tailLevel);
+        UpdateMaterialHandles(textureId);
+        return true;
+    }
+
+    void TextureStreamer::Release(TextureXD* texture)
+    {
+        auto textureId = texture->GetAssetID();
+        RemoveStreamedTexture(textureId);
+
+        auto iter = std::remove_if(m_materialTextures.begin(), m_materialTextures.end(), [textureId](const MaterialTexture& binding) { return binding.textureId == textureId; });
+        m_materialTextures.erase(iter, m_materialTextures.end());
+    }
+
+    void TextureStreamer::AddMaterialTexture(Material* material, uint propertyHashId, TextureXD* texture)
+    {
+        auto iter = std::remove_if(m_materialTextures.begin(), m_materialTextures.end(), [material, propertyHashId](const MaterialTexture& binding)
+        {
+            return binding.material == material && binding.propertyHashId == propertyHashId;
+        });
+
+        m_materialTextures.erase(iter, m_materialTextures.end());
+
+        if (texture->m_isStreamed)
+        {
+            m_materialTextures.push_back({ material, propertyHashId, texture->GetAssetID() });
+        }
+    }
+
+    void TextureStreamer::ReportMaterialUsage(const Material* material, float screenSize)
+    {
+        auto& maxScreenSize = m_materialUsage[material];
+        maxScreenSize = screenSize > maxScreenSize ? screenSize : maxScreenSize;
+    }
+
+    void TextureStreamer::Update()
+    {
+        PK_PROFILE_SCOPE("TextureStreaming");
+
+        auto freeJobCount = 0u;
+
+        for (auto& job : m_jobs)
+        {
+            if (job.isActive && job.isComplete.load(std::memory_order_acquire))
+            {
+                job.isActive = false;
+                auto iter = m_textures.find(job.textureId);
+
+                if (iter == m_textures.end() || iter->second.generation != job.generation)
+                {
+                    continue;
+                }
+
+                if (!job.isValid)
+                {
+                    PK_CORE_LOG_WARNING("Failed to read level %u of streamed texture (%s).", job.level, job.filepath.c_str());
+                    m_cache.CancelLoad(job.textureId);
+                    continue;
+                }
+
+                if (m_cache.CompleteLoad(job.textureId, job.level))
+                {
+                    SetFirstResidentLevel(iter->second, job.level);
+                    UploadLevel(iter->second, job.level, job.data.data());
+                }
+            }
+        }
+
+        for (auto& job : m_jobs)
+        {
+            freeJobCount += job.isActive ? 0u : 1u;
+        }
+
+        for (auto& usage : m_materialUsage)
+        {
+            for (auto& binding : m_materialTextures)
+            {
+                auto iter = m_textures.find(binding.textureId);
+
+                if (binding.material == usage.first && iter != m_textures.end())
+                {
+                    auto resolution = iter->second.texture->GetResolution2D();
+                    auto screenSize = usage.second > 1.0f ? usage.second : 1.0f;
+                    m_cache.ReportUsage(binding.textureId, glm::max(resolution.x, resolution.y) / screenSize);
+                }
+            }
+        }
+
+        m_materialUsage.clear();
+        m_loads.clear();
+        m_evictions.clear();
+        m_cache.Update(freeJobCount, &m_loads, &m_evictions);
+
+        // A texture may lose several levels in one update. Its storage is only reallocated once.
+        for (auto& eviction : m_evictions)
+        {
+            auto& streamed = m_textures.at(eviction.textureId);
+            uint level;
+
+            if (m_cache.TryGetResidentLevel(eviction.textureId, &level) && streamed.texture->m_firstResidentLevel < level)
+            {
+                SetFirstResidentLevel(streamed, level);
+            }
+        }
+
+        auto jobIndex = 0u;
+
+        for (auto& load : m_loads)
+        {
+            while (m_jobs[jobIndex].isActive)
+            {
+                ++jobIndex;
+            }
+
+            auto& streamed = m_textures.at(load.textureId);
+            auto& job = m_jobs[jobIndex];
+            job.filepath = streamed.filepath;
+            job.range = streamed.levels[load.level];
+            job.textureId = load.textureId;
+            job.level = load.level;
+            job.generation = streamed.generation;
+            job.isActive = true;
+            job.isValid = false;
+            job.isComplete.store(false, std::memory_order_relaxed);
+            m_threadPool->Enqueue({ ExecuteLoadJob, this, jobIndex });
+        }
+
+        DeleteRetiredStorage(false);
+        m_cache.BeginFrame();
+    }
+
+    void TextureStreamer::SetConfig(const ApplicationConfig* config)
+    {
+        m_isEnabled = config->EnableTextureStreaming;
+        m_tailSize = config->TextureStreamingTailSize;
+        m_cache.SetBudget((ulong)config->TextureStreamingBudget.value << 20ull);
+    }
+
+    void TextureStreamer::ExecuteLoadJob(void* context, uint32_t index)
+    {
+        auto& job = static_cast<TextureStreamer*>(context)->m_jobs[index];
+        job.isValid = ReadLevel(job.filepath, job.range, job.data);
+        job.isComplete.store(true, std::memory_order_release);
+    }
+
+    bool TextureStreamer::ReadLevelRanges(const std::string& filepath, StreamedTexture* texture)
+    {
+        const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+        unsigned char fileIdentifier[12];
+        uint32_t header[13];
+
+        std::ifstream file(filepath, std::ios::binary);
+        file.read(reinterpret_cast<char*>(fileIdentifier), sizeof(fileIdentifier));
+        file.read(reinterpret_cast<char*>(header), sizeof(header));
+
+        if (!file || memcmp(identifier, fileIdentifier, sizeof(identifier)) != 0 || header[0] != 0x04030201)
+        {
+            return false;
+        }
+
+        // glType, glFormat, pixelHeight, pixelDepth, numberOfArrayElements, numberOfFaces & numberOfMipmapLevels
+        auto levelCount = header[11];
+
+        if (header[1] == 0 || header[7] == 0 || header[8] != 0 || header[9] != 0 || header[10] != 1 || levelCount < 2 || levelCount > TextureStreamingCache::MaxLevelCount)
+        {
+            return false;
+        }
+
+        texture->type = header[1];
+        texture->format = header[3];
+        texture->levelCount = levelCount;
+
+        // Each level is prefixed by its size & padded to 4 bytes.
+        auto offset = (ulong)sizeof(fileIdentifier) + sizeof(header) + header[12];
+
+        for (auto i = 0u; i < levelCount; ++i)
+        {
+            uint32_t imageSize = 0;
+            file.seekg(offset);
+            file.read(reinterpret_cast<char*>(&imageSize), sizeof(imageSize));
+
+            if (!file)
+            {
+                return false;
+            }
+
+            texture->levels[i] = { offset + sizeof(imageSize), imageSize };
+            offset += sizeof(imageSize) + ((imageSize + 3ull) & ~3ull);
+        }
+
+        return true;
+    }
+
+    bool TextureStreamer::ReadLevel(const std::string& filepath, const LevelRange& range, std::vector<char>& data)
+    {
+        std::ifstream file(filepath, std::ios::binary);
+        data.resize(range.size);
+        file.seekg(range.offset);
+        file.read(data.data(), (std::streamsize)range.size);
+        return (bool)file;
+    }
+
+    void TextureStreamer::RemoveStreamedTexture(AssetID textureId)
+    {
+        auto iter = m_textures.find(textureId);
+
+        if (iter != m_textures.end())
+        {
+            m_cache.Release(textureId);
+            m_textures.erase(iter);
+        }
+    }
+
+    void TextureStreamer::SetFirstResidentLevel(StreamedTexture& streamed, uint level)
+    {
+        auto previousId = streamed.texture->SetFirstResidentLevel(level);
+
+        if (previousId != 0)
+        {
+            m_retiredStorage.push_back({ previousId, nullptr });
+        }
+
+        UpdateMaterialHandles(streamed.texture->GetAssetID());
+    }
+
+    void TextureStreamer::UploadLevel(const StreamedTexture& streamed, uint level, const void* data)
+    {
+        auto texture = streamed.texture;
+        auto resolution = glm::max(texture->GetResolution2D() >> level, uint2(1u));
+        glTextureSubImage2D(texture->GetGraphicsID(), level - texture->m_firstResidentLevel, 0, 0, resolution.x, resolution.y, streamed.format, streamed.type, data);
+    }
+
+    void TextureStreamer::UpdateMaterialHandles(AssetID textureId)
+    {
+        auto iter = m_textures.find(textureId);
+
+        if (iter == m_textures.end())
+        {
+            return;
+        }
+
+        auto handle = iter->second.texture->GetBindlessHandleResident();
+
+        for (auto& binding : m_materialTextures)
+        {
+            if (binding.textureId == textureId)
+            {
+                binding.material->SetResourceHandle(binding.propertyHashId, handle);
+            }
+        }
+    }
+
+    void TextureStreamer::DeleteRetiredStorage(bool deleteAll)
+    {
+        for (auto i = (int)m_retiredStorage.size() - 1; i >= 0; --i)
+        {
+            auto& retired = m_retiredStorage[i];
+
+            // Fenced one update after retirement so that the fence follows every frame that could still use the storage.
+            if (retired.fence == nullptr && !deleteAll)
+            {
+                retired.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                continue;
+            }
+
+            if (retired.fence != nullptr)
+            {
+                auto status = deleteAll ? GL_ALREADY_SIGNALED : glClientWaitSync(retired.fence, 0, 0);
+
+                if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                {
+                    continue;
+                }
+
+                glDeleteSync(retired.fence);
+            }
+
+            auto handle = glGetTextureHandleARB(retired.graphicsId);
+
+            if (glIsTextureHandleResidentARB(handle))
+            {
+                glMakeTextureHandleNonResidentARB(handle);
+            }
+
+            glDeleteTextures(1, &retired.graphicsId);
+            m_retiredStorage[i] = m_retiredStorage.back();
+            m_retiredStorage.pop_back();
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+#include "Core/IService.h"
+#include "Core/ISingleton.h"
+#include "Core/ApplicationConfig.h"
+#include "Utilities/Ref.h"
+#include "Utilities/ThreadPool.h"
+#include "Rendering/TextureStreamingCache.h"
+#include "Rendering/Objects/TextureXD.h"
+#include "Rendering/Objects/Material.h"
+#include <atomic>
+#include <unordered_set>
+
+namespace PK::Rendering
+{
+    using namespace PK::Rendering::Objects;
+
+    // Streams the mip levels of material textures from their ktx files on background threads.
+    // Textures loaded through Load are imported with only their mip tail. Finer levels follow the screen space size of the materials that use them. See TextureStreamingCache for the budget.
+    // Only uncompressed 2D ktx 1 textures with a mip chain are streamed. Anything else is imported in full.
+    // Storage is reallocated when the resident levels change. Previous storage is deleted once the frames that could still sample it have completed.
+    class TextureStreamer : public IService, public ISingleton<TextureStreamer>
+    {
+        public:
+            static constexpr uint MaxLoadCount = 4;
+            static constexpr uint WorkerCount = 2;
+
+        private:
+            struct LevelRange
+            {
+                ulong offset = 0;
+                ulong size = 0;
+            };
+
+            struct StreamedTexture
+            {
+                TextureXD* texture = nullptr;
+                std::string filepath;
+                LevelRange levels[TextureStreamingCache::MaxLevelCount];
+                uint levelCount = 0;
+                GLenum format = GL_RGBA;
+                GLenum type = GL_UNSIGNED_BYTE;
+                uint generation = 0;
+            };
+
+            struct MaterialTexture
+            {
+                Material* material = nullptr;
+                uint propertyHashId = 0;
+                AssetID textureId = 0;
+            };
+
+            struct LoadJob
+            {
+                std::string filepath;
+                LevelRange range;
+                std::vector<char> data;
+                AssetID textureId = 0;
+                uint level = 0;
+                uint generation = 0;
+                bool isActive = false;
+                bool isValid = false;
+                std::atomic<bool> isComplete = false;
+            };
+
+            struct RetiredStorage
+            {
+                GraphicsID graphicsId = 0;
+                GLsync fence = nullptr;
+            };
+
+        public:
+            TextureStreamer(AssetDatabase* assetDatabase, const ApplicationConfig* config);
+            ~TextureStreamer();
+
+            // Loads a texture that may be streamed. A texture that was already imported in full stays that way.
+            TextureXD* Load(const std::string& filepath);
+
+            // Called by the texture importer. Returns false if the texture should be imported in full.
+            bool Import(const std::string& filepath, TextureXD* texture, GLenum wrapmode);
+
+            void Release(TextureXD* texture);
+
+            // The handle property of the material is updated whenever the storage of the texture changes.
+            void AddMaterialTexture(Material* material, uint propertyHashId, TextureXD* texture);
+
+            // Size of a visible renderer that uses the material in screen pixels.
+            void ReportMaterialUsage(const Material* material, float screenSize);
+
+            // Uploads completed levels, requests the next ones & deletes storage that is no longer in use. Called once per frame after the usage has been reported.
+            void Update();
+
+            void SetConfig(const ApplicationConfig* config);
+
+            inline const TextureStreamingCache& GetCache() const { return m_cache; }
+
+        private:
+            static void ExecuteLoadJob(void* context, uint32_t index);
+            static bool ReadLevelRanges(const std::string& filepath, StreamedTexture* texture);
+            static bool ReadLevel(const std::string& filepath, const LevelRange& range, std::vector<char>& data);
+
+            void RemoveStreamedTexture(AssetID textureId);
+            void SetFirstResidentLevel(StreamedTexture& streamed, uint level);
+            void UploadLevel(const StreamedTexture& streamed, uint level, const void* data);
+            void UpdateMaterialHandles(AssetID textureId);
+            void DeleteRetiredStorage(bool deleteAll);
+
+            AssetDatabase* m_assetDatabase;
+            TextureStreamingCache m_cache;
+            std::unordered_map<AssetID, StreamedTexture> m_textures;
+            std::unordered_set<AssetID> m_streamedAssets;
+            std::unordered_map<const Material*, float> m_materialUsage;
+            std::vector<MaterialTexture> m_materialTextures;
+            std::vector<TextureStreamingCache::Request> m_loads;
+            std::vector<TextureStreamingCache::Request> m_evictions;
+            std::vector<RetiredStorage> m_retiredStorage;
+            std::vector<char> m_uploadBuffer;
+            LoadJob m_jobs[MaxLoadCount];
+            uint m_tailSize = 128;
+            uint m_generation = 0;
+            bool m_isEnabled = true;
+            Utilities::Scope<Utilities::ThreadPool> m_threadPool;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,244 @@
+#include "PrecompiledHeader.h"
+#include "TextureStreamingCache.h"
+
+namespace PK::Rendering
+{
+	void TextureStreamingCache::Register(uint textureId, const ulong* levelSizes, uint levelCount, uint tailLevel)
+	{
+		Release(textureId);
+
+		auto& entry = m_entries[textureId];
+		entry.levelCount = levelCount < MaxLevelCount ? levelCount : MaxLevelCount;
+		entry.tailLevel = tailLevel < entry.levelCount ? tailLevel : entry.levelCount - 1;
+		entry.residentLevel = entry.tailLevel;
+		entry.pendingLevel = entry.tailLevel;
+		entry.desiredLevel = entry.tailLevel;
+		std::copy(levelSizes, levelSizes + entry.levelCount, entry.levelSizes);
+		m_residentSize += GetChainSize(entry, entry.residentLevel);
+	}
+
+	void TextureStreamingCache::Release(uint textureId)
+	{
+		auto iter = m_entries.find(textureId);
+
+		if (iter == m_entries.end())
+		{
+			return;
+		}
+
+		CancelLoad(textureId);
+		m_residentSize -= GetChainSize(iter->second, iter->second.residentLevel);
+		m_entries.erase(iter);
+	}
+
+	void TextureStreamingCache::Clear()
+	{
+		m_entries.clear();
+		m_residentSize = 0;
+		m_pendingSize = 0;
+	}
+
+	void TextureStreamingCache::BeginFrame()
+	{
+		++m_frameIndex;
+	}
+
+	void TextureStreamingCache::ReportUsage(uint textureId, float texelsPerPixel)
+	{
+		auto iter = m_entries.find(textureId);
+
+		if (iter == m_entries.end())
+		{
+			return;
+		}
+
+		auto& entry = iter->second;
+
+		if (entry.lastUsedFrame != m_frameIndex || texelsPerPixel > entry.texelsPerPixel)
+		{
+			entry.texelsPerPixel = texelsPerPixel;
+			entry.desiredLevel = GetDesiredLevel(texelsPerPixel, entry.tailLevel);
+		}
+
+		entry.lastUsedFrame = m_frameIndex;
+	}
+
+	void TextureStreamingCache::Update(uint maxLoadCount, std::vector<Request>* loads, std::vector<Request>* evictions)
+	{
+		m_loadCandidates.clear();
+		m_evictionCandidates.clear();
+		auto frameIndex = m_frameIndex;
+		auto evictableSize = 0ull;
+
+		// Textures that were not used this frame only need their tail.
+		auto getWantedLevel = [frameIndex](const Entry& entry) { return entry.lastUsedFrame == frameIndex ? entry.desiredLevel : entry.tailLevel; };
+
+		for (auto& kv : m_entries)
+		{
+			auto& entry = kv.second;
+			auto wantedLevel = getWantedLevel(entry);
+
+			if (wantedLevel < entry.residentLevel && entry.pendingLevel == entry.residentLevel)
+			{
+				m_loadCandidates.push_back({ kv.first, &entry });
+			}
+			else if (wantedLevel > entry.residentLevel)
+			{
+				m_evictionCandidates.push_back({ kv.first, &entry });
+				evictableSize += GetChainSize(entry, entry.residentLevel) - GetChainSize(entry, wantedLevel);
+			}
+		}
+
+		std::sort(m_loadCandidates.begin(), m_loadCandidates.end(), [](const std::pair<uint, Entry*>& a, const std::pair<uint, Entry*>& b)
+		{
+			auto deficitA = a.second->residentLevel - a.second->desiredLevel;
+			auto deficitB = b.second->residentLevel - b.second->desiredLevel;
+
+			if (deficitA != deficitB)
+			{
+				return deficitA > deficitB;
+			}
+
+			return a.second->texelsPerPixel != b.second->texelsPerPixel ? a.second->texelsPerPixel > b.second->texelsPerPixel : a.first < b.first;
+		});
+
+		std::sort(m_evictionCandidates.begin(), m_evictionCandidates.end(), [](const std::pair<uint, Entry*>& a, const std::pair<uint, Entry*>& b)
+		{
+			if (a.second->lastUsedFrame != b.second->lastUsedFrame)
+			{
+				return a.second->lastUsedFrame < b.second->lastUsedFrame;
+			}
+
+			return a.second->residentLevel != b.second->residentLevel ? a.second->residentLevel < b.second->residentLevel : a.first < b.first;
+		});
+
+		auto evictionIndex = 0u;
+
+		auto evict = [&](ulong requiredSize)
+		{
+			while (m_residentSize + m_pendingSize + requiredSize > m_budget && evictionIndex < m_evictionCandidates.size())
+			{
+				auto& candidate = m_evictionCandidates[evictionIndex];
+				auto& entry = *candidate.second;
+
+				if (entry.residentLevel >= getWantedLevel(entry))
+				{
+					++evictionIndex;
+					continue;
+				}
+
+				// A load still in flight for the evicted texture would land above a missing level.
+				if (entry.pendingLevel != entry.residentLevel)
+				{
+					m_pendingSize -= entry.levelSizes[entry.pendingLevel];
+				}
+
+				auto size = entry.levelSizes[entry.residentLevel];
+				evictions->push_back({ candidate.first, entry.residentLevel });
+				m_residentSize -= size;
+				evictableSize -= size;
+				entry.residentLevel++;
+				entry.pendingLevel = entry.residentLevel;
+				m_evictionCount++;
+			}
+		};
+
+		// The budget may have been lowered since the last update.
+		evict(0ull);
+
+		for (auto& candidate : m_loadCandidates)
+		{
+			if (loads->size() >= maxLoadCount)
+			{
+				break;
+			}
+
+			auto& entry = *candidate.second;
+			auto level = entry.residentLevel - 1;
+			auto size = entry.levelSizes[level];
+
+			// Skipped without evicting anything if it would not fit even after evicting every unwanted level.
+			if (m_residentSize + m_pendingSize + size > m_budget + evictableSize)
+			{
+				continue;
+			}
+
+			evict(size);
+			entry.pendingLevel = level;
+			m_pendingSize += size;
+			loads->push_back({ candidate.first, level });
+		}
+	}
+
+	bool TextureStreamingCache::CompleteLoad(uint textureId, uint level)
+	{
+		auto iter = m_entries.find(textureId);
+
+		if (iter == m_entries.end())
+		{
+			return false;
+		}
+
+		auto& entry = iter->second;
+
+		if (entry.pendingLevel == entry.residentLevel || entry.pendingLevel != level)
+		{
+			return false;
+		}
+
+		auto size = entry.levelSizes[level];
+		m_pendingSize -= size;
+		m_residentSize += size;
+		entry.residentLevel = level;
+		return true;
+	}
+
+	void TextureStreamingCache::CancelLoad(uint textureId)
+	{
+		auto iter = m_entries.find(textureId);
+
+		if (iter == m_entries.end() || iter->second.pendingLevel == iter->second.residentLevel)
+		{
+			return;
+		}
+
+		m_pendingSize -= iter->second.levelSizes[iter->second.pendingLevel];
+		iter->second.pendingLevel = iter->second.residentLevel;
+	}
+
+	bool TextureStreamingCache::TryGetResidentLevel(uint textureId, uint* level) const
+	{
+		auto iter = m_entries.find(textureId);
+
+		if (iter == m_entries.end())
+		{
+			return false;
+		}
+
+		*level = iter->second.residentLevel;
+		return true;
+	}
+
+	uint TextureStreamingCache::GetDesiredLevel(float texelsPerPixel, uint tailLevel)
+	{
+		if (texelsPerPixel <= 1.0f)
+		{
+			return 0u;
+		}
+
+		auto level = (uint)glm::floor(glm::log2(texelsPerPixel));
+		return level < tailLevel ? level : tailLevel;
+	}
+
+	ulong TextureStreamingCache::GetChainSize(const Entry& entry, uint firstLevel)
+	{
+		auto size = 0ull;
+
+		for (auto i = firstLevel; i < entry.levelCount; ++i)
+		{
+			size += entry.levelSizes[i];
+		}
+
+		return size;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+#include "Core/NoCopy.h"
+#include <vector>
+#include <unordered_map>
+#include <hlslmath.h>
+
+namespace PK::Rendering
+{
+    using namespace PK::Math;
+
+    // Mip residency of streamed textures within a memory budget.
+    // Levels from the tail level to the end of the chain are always resident. Finer levels are loaded one at a time, coarse to fine.
+    // Loads are ordered by how many levels a texture is missing from the level its screen space texel density asks for.
+    // Levels finer than what a texture was last asked for are evicted in least recently used order when a load does not fit the budget.
+    // Has no graphics api dependencies.
+    class TextureStreamingCache : public PK::Core::NoCopy
+    {
+        public:
+            static constexpr uint MaxLevelCount = 16;
+
+            struct Request
+            {
+                uint textureId = 0;
+                uint level = 0;
+            };
+
+        private:
+            struct Entry
+            {
+                ulong levelSizes[MaxLevelCount] = {};
+                uint levelCount = 0;
+                uint tailLevel = 0;
+                uint residentLevel = 0;
+                uint pendingLevel = 0;
+                uint desiredLevel = 0;
+                float texelsPerPixel = 0.0f;
+                ulong lastUsedFrame = 0;
+            };
+
+        public:
+            TextureStreamingCache(ulong budget) : m_budget(budget) {}
+
+            // Level sizes are in bytes starting from level 0. The texture starts with only its tail resident.
+            void Register(uint textureId, const ulong* levelSizes, uint levelCount, uint tailLevel);
+
+            void Release(uint textureId);
+
+            void Clear();
+
+            void BeginFrame();
+
+            // Texels of level 0 per screen pixel along one axis. The densest use of a texture within a frame is kept.
+            void ReportUsage(uint textureId, float texelsPerPixel);
+
+            // Evicts levels to make room for the highest priority loads & marks the loads as pending. Evictions take effect immediately.
+            // Eviction levels are the levels that are no longer resident. Load levels become resident when they are completed.
+            void Update(uint maxLoadCount, std::vector<Request>* loads, std::vector<Request>* evictions);
+
+            // Returns false if the load is no longer pending, for example when the texture was released in the meantime.
+            bool CompleteLoad(uint textureId, uint level);
+
+            void CancelLoad(uint textureId);
+
+            void SetBudget(ulong budget) { m_budget = budget; }
+
+            bool TryGetResidentLevel(uint textureId, uint* level) const;
+
+            // Finest level at which a texel covers at least a pixel.
+            static uint GetDesiredLevel(float texelsPerPixel, uint tailLevel);
+
+            inline ulong GetBudget() const { return m_budget; }
+            inline ulong GetResidentSize() const { return m_residentSize; }
+            inline ulong GetPendingSize() const { return m_pendingSize; }
+            inline uint GetTextureCount() const { return (uint)m_entries.size(); }
+            inline uint GetEvictionCount() const { return m_evictionCount; }
+
+        private:
+            static ulong GetChainSize(const Entry& entry, uint firstLevel);
+
+            std::unordered_map<uint, Entry> m_entries;
+            std::vector<std::pair<uint, Entry*>> m_loadCandidates;
+            std::vector<std::pair<uint, Entry*>> m_evictionCandidates;
+            ulong m_budget = 0;
+            ulong m_residentSize = 0;
+            ulong m_pendingSize = 0;
+            ulong m_frameIndex = 1;
+            uint m_evictionCount = 0;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,246 @@
+#include "PrecompiledHeader.h"
+#include "Core/Profiler.h"
+#include "Utilities/Log.h"
+#include "Utilities/ThreadPool.h"
+#include "Rendering/TextureTranscoding.h"
+#include <atomic>
+
+namespace PK::Rendering::TextureTranscoding
+{
+	// Bumped whenever the transcoding output changes so that stale cache entries are not used.
+	static constexpr ulong CacheVersion = 1ull;
+	// KHR_DF_TRANSFER_SRGB
+	static constexpr ktx_uint32_t TransferSRGB = 2u;
+
+	static std::string s_cacheDirectory;
+
+	struct TranscodeBatch
+	{
+		const std::vector<std::string>* filepaths = nullptr;
+		std::atomic<uint> transcodedCount = 0;
+	};
+
+	static ulong Hash(ulong hash, const void* data, size_t size)
+	{
+		// FNV-1a
+		auto bytes = reinterpret_cast<const unsigned char*>(data);
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	static void ExecuteTranscodeJob(void* context, uint32_t index)
+	{
+		auto batch = reinterpret_cast<TranscodeBatch*>(context);
+		auto& filepath = batch->filepaths->at(index);
+		ktxTexture2* texture = nullptr;
+		auto wasTranscoded = false;
+
+		if (CreateTexture(filepath, &texture, &wasTranscoded) != KTX_SUCCESS)
+		{
+			PK_CORE_LOG_WARNING("Failed to transcode texture (%s).", filepath.c_str());
+			return;
+		}
+
+		ktxTexture_Destroy(ktxTexture(texture));
+
+		if (wasTranscoded)
+		{
+			batch->transcodedCount++;
+		}
+	}
+
+	void SetCacheDirectory(const std::string& directory)
+	{
+		s_cacheDirectory = directory;
+	}
+
+	const std::string& GetCacheDirectory()
+	{
+		return s_cacheDirectory;
+	}
+
+	ktx_transcode_fmt_e GetTargetFormat(ktxTexture2* texture)
+	{
+		// Bc4 & bc5 have no srgb variants.
+		if (ktxTexture2_GetOETF(texture) == TransferSRGB)
+		{
+			return KTX_TTF_BC7_RGBA;
+		}
+
+		switch (ktxTexture2_GetNumComponents(texture))
+		{
+			case 1: return KTX_TTF_BC4_R;
+			case 2: return KTX_TTF_BC5_RG;
+			default: return KTX_TTF_BC7_RGBA;
+		}
+	}
+
+	bool TryGetCachePath(const std::string& filepath, std::string* cachePath)
+	{
+		ktxTexture2* texture = nullptr;
+
+		if (ktxTexture2_CreateFromNamedFile(filepath.c_str(), KTX_TEXTURE_CREATE_NO_FLAGS, &texture) != KTX_SUCCESS)
+		{
+			return false;
+		}
+
+		auto needsTranscoding = ktxTexture2_NeedsTranscoding(texture);
+		auto format = GetTargetFormat(texture);
+		ktxTexture_Destroy(ktxTexture(texture));
+
+		if (!needsTranscoding || s_cacheDirectory.empty())
+		{
+			return needsTranscoding;
+		}
+
+		std::error_code error;
+		auto size = (ulong)std::filesystem::file_size(filepath, error);
+		auto modifiedTime = std::filesystem::last_write_time(filepath, error).time_since_epoch().count();
+
+		auto hash = Hash(14695981039346656037ull, filepath.data(), filepath.size());
+		hash = Hash(hash, &size, sizeof(size));
+		hash = Hash(hash, &modifiedTime, sizeof(modifiedTime));
+		hash = Hash(hash, &format, sizeof(format));
+		hash = Hash(hash, &CacheVersion, sizeof(CacheVersion));
+
+		char filename[32];
+		snprintf(filename, sizeof(filename), "%016llx.ktx2", hash);
+		*cachePath = (std::filesystem::path(s_cacheDirectory) / filename).string();
+		return true;
+	}
+
+	KTX_error_code CreateTexture(const std::string& filepath, ktxTexture2** texture, bool* wasTranscoded)
+	{
+		PK_PROFILE_FUNCTION();
+
+		if (wasTranscoded != nullptr)
+		{
+			*wasTranscoded = false;
+		}
+
+		std::string cachePath;
+
+		if (!TryGetCachePath(filepath, &cachePath))
+		{
+			// Zstd supercompression is inflated when the image data is loaded.
+			return ktxTexture2_CreateFromNamedFile(filepath.c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, texture);
+		}
+
+		if (!cachePath.empty() && std::filesystem::exists(cachePath) &&
+			ktxTexture2_CreateFromNamedFile(cachePath.c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, texture) == KTX_SUCCESS)
+		{
+			return KTX_SUCCESS;
+		}
+
+		auto result = ktxTexture2_CreateFromNamedFile(filepath.c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, texture);
+
+		if (result != KTX_SUCCESS)
+		{
+			return result;
+		}
+
+		result = ktxTexture2_TranscodeBasis(*texture, GetTargetFormat(*texture), 0);
+
+		if (result != KTX_SUCCESS)
+		{
+			ktxTexture_Destroy(ktxTexture(*texture));
+			*texture = nullptr;
+			return result;
+		}
+
+		if (wasTranscoded != nullptr)
+		{
+			*wasTranscoded = true;
+		}
+
+		if (cachePath.empty())
+		{
+			return KTX_SUCCESS;
+		}
+
+		// Written to a temporary file first so that an interrupted write is never read as a cache entry.
+		std::error_code error;
+		auto temporaryPath = cachePath + ".tmp";
+		std::filesystem::create_directories(s_cacheDirectory, error);
+
+		if (ktxTexture_WriteToNamedFile(ktxTexture(*texture), temporaryPath.c_str()) == KTX_SUCCESS)
+		{
+			std::filesystem::rename(temporaryPath, cachePath, error);
+		}
+		else
+		{
+			std::filesystem::remove(temporaryPath, error);
+			PK_CORE_LOG_WARNING("Failed to write transcoded texture (%s) to the cache.", filepath.c_str());
+		}
+
+		return KTX_SUCCESS;
+	}
+
+	uint TranscodeFiles(const std::vector<std::string>& filepaths, uint threadCount)
+	{
+		PK_PROFILE_FUNCTION();
+
+		std::vector<std::string> pending;
+		std::string cachePath;
+
+		for (auto& filepath : filepaths)
+		{
+			if (TryGetCachePath(filepath, &cachePath) && !cachePath.empty() && !std::filesystem::exists(cachePath))
+			{
+				pending.push_back(filepath);
+			}
+		}
+
+		if (pending.empty())
+		{
+			return 0u;
+		}
+
+		TranscodeBatch batch;
+		batch.filepaths = &pending;
+
+		// The first texture is transcoded on the calling thread as it initializes the transcoder tables that every job shares.
+		ExecuteTranscodeJob(&batch, 0u);
+
+		if (pending.size() > 1)
+		{
+			// The pool finishes its queue before it is destroyed.
+			Utilities::ThreadPool threadPool(threadCount > 0u ? threadCount : 1u);
+
+			for (auto i = 1u; i < pending.size(); ++i)
+			{
+				threadPool.Enqueue({ ExecuteTranscodeJob, &batch, i });
+			}
+		}
+
+		return batch.transcodedCount;
+	}
+
+	uint TranscodeDirectory(const std::string& directory, uint threadCount)
+	{
+		std::vector<std::string> filepaths;
+
+		for (const auto& entry : std::filesystem::directory_iterator(directory))
+		{
+			if (entry.path().extension().compare(".ktx2") == 0)
+			{
+				filepaths.push_back(entry.path().string());
+			}
+		}
+
+		auto transcodedCount = TranscodeFiles(filepaths, threadCount);
+
+		if (transcodedCount > 0)
+		{
+			PK_CORE_LOG("Transcoded %u textures in %s to the texture cache.", transcodedCount, directory.c_str());
+		}
+
+		return transcodedCount;
+	}
+}
\ No newline at end of file
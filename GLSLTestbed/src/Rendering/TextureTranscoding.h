@@ -0,0 +1,28 @@
+#pragma once
+#include "PrecompiledHeader.h"
+#include <KTX/ktx.h>
+
+// Imports ktx 2 textures with basis lz (etc1s) or uastc payloads.
+// Single channel data is transcoded to bc4, two channel data to bc5 & everything else, including all srgb data, to bc7.
+// Transcoded textures are written to a disk cache keyed by the source path, size, modification time & target format. Only the first import of a texture pays for transcoding.
+// libktx transcodes a texture as a whole. TranscodeFiles fills the cache for many textures in parallel before they are imported.
+namespace PK::Rendering::TextureTranscoding
+{
+    // An empty directory disables the cache.
+    void SetCacheDirectory(const std::string& directory);
+
+    const std::string& GetCacheDirectory();
+
+    ktx_transcode_fmt_e GetTargetFormat(ktxTexture2* texture);
+
+    // Returns false if the texture does not need transcoding.
+    bool TryGetCachePath(const std::string& filepath, std::string* cachePath);
+
+    // The returned texture has its image data loaded & is ready for upload. wasTranscoded is optional & is set to false when the cache was used or no transcoding was needed.
+    KTX_error_code CreateTexture(const std::string& filepath, ktxTexture2** texture, bool* wasTranscoded = nullptr);
+
+    // Transcodes the textures that are not cached yet on a pool of threadCount workers. Returns the number of transcoded textures.
+    uint TranscodeFiles(const std::vector<std::string>& filepaths, uint threadCount);
+
+    uint TranscodeDirectory(const std::string& directory, uint threadCount);
+}
\ No newline at end of file
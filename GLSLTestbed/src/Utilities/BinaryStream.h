@@ -0,0 +1,99 @@
+#pragma once
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace PK::Utilities
+{
+    // Appends trivially copyable values to a byte buffer. Values are stored unaligned in native byte order.
+    class BinaryWriter
+    {
+        public:
+            BinaryWriter(std::vector<char>& data) : m_data(data) {}
+
+            template<typename T>
+            void Write(const T& value) { WriteArray(&value, 1); }
+
+            template<typename T>
+            void WriteArray(const T* values, size_t count)
+            {
+                static_assert(std::is_trivially_copyable<T>::value, "Written type must be trivially copyable!");
+                auto bytes = reinterpret_cast<const char*>(values);
+                m_data.insert(m_data.end(), bytes, bytes + sizeof(T) * count);
+            }
+
+            template<typename T>
+            void WriteVector(const std::vector<T>& values)
+            {
+                Write((uint64_t)values.size());
+                WriteArray(values.data(), values.size());
+            }
+
+            void WriteString(const std::string& value)
+            {
+                Write((uint64_t)value.size());
+                WriteArray(value.data(), value.size());
+            }
+
+        private:
+            std::vector<char>& m_data;
+    };
+
+    // Reads values written by a BinaryWriter. Reading past the end zero fills the output & invalidates the reader instead of throwing.
+    class BinaryReader
+    {
+        public:
+            BinaryReader(const char* data, size_t size) : m_data(data), m_size(size) {}
+
+            template<typename T>
+            T Read()
+            {
+                T value;
+                ReadArray(&value, 1);
+                return value;
+            }
+
+            template<typename T>
+            void ReadArray(T* values, size_t count)
+            {
+                static_assert(std::is_trivially_copyable<T>::value, "Read type must be trivially copyable!");
+                auto size = sizeof(T) * count;
+
+                if (!m_isValid || size > m_size - m_head)
+                {
+                    m_isValid = false;
+                    memset(values, 0, size);
+                    return;
+                }
+
+                memcpy(values, m_data + m_head, size);
+                m_head += size;
+            }
+
+            template<typename T>
+            void ReadVector(std::vector<T>& values)
+            {
+                auto count = Read<uint64_t>();
+                values.resize(count <= (m_size - m_head) / sizeof(T) ? (size_t)count : 0);
+                m_isValid &= values.size() == count;
+                ReadArray(values.data(), values.size());
+            }
+
+            std::string ReadString()
+            {
+                std::vector<char> chars;
+                ReadVector(chars);
+                return std::string(chars.data(), chars.size());
+            }
+
+            inline bool IsValid() const { return m_isValid; }
+            inline bool IsAtEnd() const { return m_head == m_size; }
+
+        private:
+            const char* m_data;
+            size_t m_size;
+            size_t m_head = 0;
+            bool m_isValid = true;
+    };
+}
\ No newline at end of file
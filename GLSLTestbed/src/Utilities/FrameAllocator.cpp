@@ -0,0 +1,190 @@
+#include "PrecompiledHeader.h"
+#include "Utilities/FrameAllocator.h"
+#include <mutex>
+
+namespace PK::Utilities::FrameAllocator
+{
+    struct Block
+    {
+        char* memory = nullptr;
+        size_t capacity = 0;
+        std::atomic<size_t> head = 0;
+    };
+
+    // Blocks after the current one are unused during the frame. They are swapped into place when the current block runs out.
+    struct Arena
+    {
+        Block* blocks[MaxBlockCount] = {};
+        uint32_t blockCount = 0;
+        std::atomic<uint32_t> current = 0;
+        // Used to merge the blocks of an arena into one before it is reused.
+        bool isFragmented = false;
+    };
+
+    static Arena s_arenas[ArenaCount];
+    static std::mutex s_lock;
+    static std::atomic<uint64_t> s_frameIndex = 0;
+    static std::atomic<size_t> s_frameBytes = 0;
+    static std::atomic<uint64_t> s_frameAllocations = 0;
+    static std::atomic<uint64_t> s_frameHeapAllocations = 0;
+    static Statistics s_statistics;
+
+    static Block* CreateBlock(size_t capacity)
+    {
+        auto block = new Block();
+        block->memory = reinterpret_cast<char*>(malloc(capacity));
+        block->capacity = capacity;
+        PK_CORE_ASSERT(block->memory != nullptr, "Failed to allocate a frame allocator block of %zu bytes", capacity);
+        s_frameHeapAllocations.fetch_add(1ull, std::memory_order_relaxed);
+        return block;
+    }
+
+    static void DeleteBlock(Block* block)
+    {
+        free(block->memory);
+        delete block;
+    }
+
+    static void AdvanceBlock(Arena* arena, uint32_t index, size_t size)
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+
+        // Another thread already moved on from the block.
+        if (arena->current.load(std::memory_order_relaxed) != index)
+        {
+            return;
+        }
+
+        auto next = arena->blocks[index] == nullptr ? index : index + 1;
+
+        for (auto i = next; i < arena->blockCount; ++i)
+        {
+            if (arena->blocks[i]->capacity >= size)
+            {
+                std::swap(arena->blocks[i], arena->blocks[next]);
+                arena->current.store(next, std::memory_order_release);
+                return;
+            }
+        }
+
+        PK_CORE_ASSERT(arena->blockCount < MaxBlockCount, "Frame allocator block limit exceeded!");
+        arena->blocks[arena->blockCount] = CreateBlock(size > DefaultBlockSize ? size : DefaultBlockSize);
+        std::swap(arena->blocks[arena->blockCount], arena->blocks[next]);
+        arena->blockCount++;
+        arena->isFragmented = arena->blockCount > 1;
+        arena->current.store(next, std::memory_order_release);
+    }
+
+    void* Allocate(size_t size, size_t alignment)
+    {
+        auto* arena = &s_arenas[s_frameIndex.load(std::memory_order_relaxed) % ArenaCount];
+        auto paddedSize = (size > 0 ? size : 1) + alignment - 1;
+
+        while (true)
+        {
+            auto index = arena->current.load(std::memory_order_acquire);
+            auto* block = arena->blocks[index];
+
+            if (block != nullptr)
+            {
+                auto offset = block->head.fetch_add(paddedSize, std::memory_order_relaxed);
+
+                if (offset + paddedSize <= block->capacity)
+                {
+                    s_frameBytes.fetch_add(paddedSize, std::memory_order_relaxed);
+                    s_frameAllocations.fetch_add(1ull, std::memory_order_relaxed);
+                    auto address = reinterpret_cast<uintptr_t>(block->memory + offset);
+                    return reinterpret_cast<void*>((address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+                }
+            }
+
+            AdvanceBlock(arena, index, paddedSize);
+        }
+    }
+
+    uint64_t GetFrameIndex() { return s_frameIndex.load(std::memory_order_relaxed); }
+
+    void NextFrame()
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+
+        auto frameBytes = s_frameBytes.exchange(0, std::memory_order_relaxed);
+        s_statistics.frameBytes = frameBytes;
+        s_statistics.frameAllocations = s_frameAllocations.exchange(0ull, std::memory_order_relaxed);
+        s_statistics.frameHeapAllocations = s_frameHeapAllocations.exchange(0ull, std::memory_order_relaxed);
+        s_statistics.heapAllocations += s_statistics.frameHeapAllocations;
+        s_statistics.peakFrameBytes = frameBytes > s_statistics.peakFrameBytes ? frameBytes : s_statistics.peakFrameBytes;
+
+        auto frameIndex = s_frameIndex.load(std::memory_order_relaxed) + 1ull;
+        auto* arena = &s_arenas[frameIndex % ArenaCount];
+
+        // Data of the frame before the previous one is no longer referenced. A fragmented arena is merged into a single block.
+        if (arena->isFragmented)
+        {
+            size_t capacity = 0;
+
+            for (auto i = 0u; i < arena->blockCount; ++i)
+            {
+                capacity += arena->blocks[i]->capacity;
+                DeleteBlock(arena->blocks[i]);
+                arena->blocks[i] = nullptr;
+            }
+
+            arena->blocks[0] = CreateBlock(capacity);
+            arena->blockCount = 1;
+            arena->isFragmented = false;
+        }
+
+        for (auto i = 0u; i < arena->blockCount; ++i)
+        {
+            arena->blocks[i]->head.store(0, std::memory_order_relaxed);
+        }
+
+        arena->current.store(0, std::memory_order_relaxed);
+
+        s_statistics.reservedBytes = 0;
+
+        for (auto& reserved : s_arenas)
+        {
+            for (auto i = 0u; i < reserved.blockCount; ++i)
+            {
+                s_statistics.reservedBytes += reserved.blocks[i]->capacity;
+            }
+        }
+
+        s_frameIndex.store(frameIndex, std::memory_order_release);
+        s_statistics.frameIndex = frameIndex;
+    }
+
+    Statistics GetStatistics()
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        return s_statistics;
+    }
+
+    void LogStatistics()
+    {
+        auto statistics = GetStatistics();
+        PK_CORE_LOG_HEADER("Frame allocator: frame %llu", statistics.frameIndex);
+        PK_CORE_LOG("Last frame: %zu bytes, %llu allocations, %llu heap allocations", statistics.frameBytes, statistics.frameAllocations, statistics.frameHeapAllocations);
+        PK_CORE_LOG("Peak frame: %zu bytes, reserved: %zu bytes, heap allocations: %llu", statistics.peakFrameBytes, statistics.reservedBytes, statistics.heapAllocations);
+    }
+
+    void Release()
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+
+        for (auto& arena : s_arenas)
+        {
+            for (auto i = 0u; i < arena.blockCount; ++i)
+            {
+                DeleteBlock(arena.blocks[i]);
+                arena.blocks[i] = nullptr;
+            }
+
+            arena.blockCount = 0;
+            arena.isFragmented = false;
+            arena.current.store(0, std::memory_order_relaxed);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#pragma once
+#include "Utilities/Log.h"
+#include <hlslmath.h>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for transient data of a frame. Memory is never freed individually.
+// Two arenas are used in turns so that data written during a frame stays valid until the end of the next frame.
+// Allocation is lock free until a block runs out. Blocks are kept between frames so that a steady state frame does not touch the heap.
+namespace PK::Utilities::FrameAllocator
+{
+    constexpr uint32_t ArenaCount = 2;
+    constexpr uint32_t MaxBlockCount = 64;
+    constexpr size_t DefaultBlockSize = 4ull << 20ull;
+
+    struct Statistics
+    {
+        uint64_t frameIndex = 0;
+        // Of the last completed frame.
+        size_t frameBytes = 0;
+        uint64_t frameAllocations = 0;
+        uint64_t frameHeapAllocations = 0;
+        size_t peakFrameBytes = 0;
+        size_t reservedBytes = 0;
+        uint64_t heapAllocations = 0;
+    };
+
+    void* Allocate(size_t size, size_t alignment);
+
+    template<typename T>
+    inline T* Allocate(size_t count) { return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T))); }
+
+    uint64_t GetFrameIndex();
+
+    // Called once per frame at UpdateStep::CloseFrame. Recycles the arena that was used by the previous frame.
+    void NextFrame();
+
+    Statistics GetStatistics();
+
+    void LogStatistics();
+
+    void Release();
+}
+
+namespace PK::Utilities
+{
+    // Deallocation is a no op. Only for containers that do not outlive the frame after the one they were created in.
+    template<typename T>
+    class FrameSTLAllocator
+    {
+        public:
+            typedef T value_type;
+
+            FrameSTLAllocator() noexcept = default;
+
+            template<typename U>
+            FrameSTLAllocator(const FrameSTLAllocator<U>&) noexcept {}
+
+            inline T* allocate(size_t count) { return FrameAllocator::Allocate<T>(count); }
+            inline void deallocate(T* pointer, size_t count) noexcept {}
+
+            template<typename U>
+            inline bool operator ==(const FrameSTLAllocator<U>&) const noexcept { return true; }
+
+            template<typename U>
+            inline bool operator !=(const FrameSTLAllocator<U>&) const noexcept { return false; }
+    };
+
+    template<typename T>
+    using FrameVector = std::vector<T, FrameSTLAllocator<T>>;
+
+    // Frame allocated storage that can be a member of a long lived object.
+    // Storage from an earlier frame is never written to. ValidateSize moves to storage of the current frame first.
+    template<typename T>
+    class FrameArray
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Frame array elements are copied with memcpy & never destructed!");
+
+        public:
+            inline T* data() { return m_data; }
+            inline const T* data() const { return m_data; }
+            inline T* begin() { return m_data; }
+            inline const T* begin() const { return m_data; }
+            inline size_t capacity() const { return m_capacity; }
+            inline T& operator[](size_t index) { return m_data[index]; }
+            inline const T& operator[](size_t index) const { return m_data[index]; }
+
+            inline T& at(size_t index)
+            {
+                PK_CORE_ASSERT(index < m_capacity, "Frame array index out of range!");
+                return m_data[index];
+            }
+
+            inline const T& at(size_t index) const
+            {
+                PK_CORE_ASSERT(index < m_capacity, "Frame array index out of range!");
+                return m_data[index];
+            }
+
+            // The capacity of an earlier frame is reused as a size hint so that a steady state frame allocates once per array.
+            void ValidateSize(size_t newSize, size_t preserveCount)
+            {
+                auto frameIndex = FrameAllocator::GetFrameIndex();
+                auto isCurrent = m_frameIndex == frameIndex;
+
+                if (isCurrent && m_capacity >= newSize)
+                {
+                    return;
+                }
+
+                auto capacity = isCurrent ? PK::Math::Functions::GetNextExponentialSize(m_capacity, newSize) : (m_capacity > newSize ? m_capacity : newSize);
+                auto data = FrameAllocator::Allocate<T>(capacity);
+
+                if (preserveCount > 0)
+                {
+                    PK_CORE_ASSERT(m_frameIndex + FrameAllocator::ArenaCount > frameIndex, "Frame array contents have already been recycled!");
+                    memcpy(data, m_data, sizeof(T) * preserveCount);
+                }
+
+                m_data = data;
+                m_capacity = capacity;
+                m_frameIndex = frameIndex;
+            }
+
+            template<typename TCount>
+            inline void Push(const T& value, TCount* count)
+            {
+                ValidateSize((size_t)*count + 1ull, (size_t)*count);
+                m_data[(*count)++] = value;
+            }
+
+        private:
+            T* m_data = nullptr;
+            size_t m_capacity = 0;
+            uint64_t m_frameIndex = ~0ull;
+    };
+}
\ No newline at end of file
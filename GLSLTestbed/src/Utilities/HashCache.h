@@ -39,6 +39,7 @@ namespace PK::Utilities
         DEFINE_HASH_CACHE(pk_SceneOEM_Exposure)
 
         DEFINE_HASH_CACHE(pk_InstancingMatrices)
+        DEFINE_HASH_CACHE(pk_InstancingTransformStride)
         DEFINE_HASH_CACHE(pk_InstancingPropertyIndices)
         DEFINE_HASH_CACHE(pk_InstancedProperties)
         DEFINE_HASH_CACHE(PK_ENABLE_INSTANCING)
@@ -62,6 +63,7 @@ namespace PK::Utilities
         DEFINE_HASH_CACHE(pk_LightTiles)
         DEFINE_HASH_CACHE(pk_TileMaxDepths)
         DEFINE_HASH_CACHE(pk_GlobalListListIndex)
+        DEFINE_HASH_CACHE(pk_OcclusionDepths)
 
         DEFINE_HASH_CACHE(pk_MinLogLuminance)
         DEFINE_HASH_CACHE(pk_InvLogLuminanceRange)
@@ -122,6 +124,8 @@ namespace PK::Utilities
         DEFINE_HASH_CACHE(_ShadowmapBatchCube)
         DEFINE_HASH_CACHE(_ShadowmapBatch0)
         DEFINE_HASH_CACHE(_ShadowmapBatch1)
+        DEFINE_HASH_CACHE(pk_ShadowmapScratchLayer)
+        DEFINE_HASH_CACHE(pk_ShadowmapSourceScale)
 
         #undef DEFINE_HASH_CACHE
     };
@@ -70,7 +70,7 @@ namespace PK::Utilities::String
 		return filepath.substr(0, lastSlash);
     }
 
-	std::string ReadFileRecursiveInclude(const std::string& filepath, std::vector<std::string>& includes, bool isRecursive)
+	std::string ReadFileRecursiveInclude(const std::string& filepath, std::vector<std::string>& includes, std::vector<std::string>* dependencies, bool isRecursive)
 	{
 		auto includeOnceToken = "#pragma once";
 		auto includeToken = "#include ";
@@ -81,6 +81,11 @@ namespace PK::Utilities::String
 
 		PK_CORE_ASSERT(file, "Could not open file at: %s", filepath.c_str());
 
+		if (isRecursive && dependencies != nullptr && std::find(dependencies->begin(), dependencies->end(), filepath) == dependencies->end())
+		{
+			dependencies->push_back(filepath);
+		}
+
 		std::string result;
 		std::string lineBuffer;
 
@@ -106,7 +111,7 @@ namespace PK::Utilities::String
 			{
 				lineBuffer.erase(0, includepos + includeTokenLength);
 				lineBuffer.insert(0, filepath.substr(0, filepath.find_last_of("/\\") + 1));
-				result += ReadFileRecursiveInclude(lineBuffer, includes, true);
+				result += ReadFileRecursiveInclude(lineBuffer, includes, dependencies, true);
 				continue;
 			}
 
@@ -126,7 +131,13 @@ namespace PK::Utilities::String
 	std::string ReadFileRecursiveInclude(const std::string& filepath)
 	{
 		std::vector<std::string> includes;
-		return ReadFileRecursiveInclude(filepath, includes, false);
+		return ReadFileRecursiveInclude(filepath, includes, nullptr, false);
+	}
+
+	std::string ReadFileRecursiveInclude(const std::string& filepath, std::vector<std::string>* dependencies)
+	{
+		std::vector<std::string> includes;
+		return ReadFileRecursiveInclude(filepath, includes, dependencies, false);
 	}
 	
 	std::string ExtractToken(const char* token, std::string& source, bool includeToken)
@@ -9,6 +9,8 @@ namespace PK::Utilities::String
 	std::string ReadFileName(const std::string& filepath);
 	std::string ReadDirectory(const std::string& filepath);
 	std::string ReadFileRecursiveInclude(const std::string& filepath);
+	// Every included file is appended to dependencies once.
+	std::string ReadFileRecursiveInclude(const std::string& filepath, std::vector<std::string>* dependencies);
 	std::string ExtractToken(const char* token, std::string& source, bool includeToken);
 	size_t ExtractToken(size_t offset, const char* token, std::string& source, std::string& output, bool includeToken);
 	void ExtractTokens(const char* token, std::string& source, std::vector<std::string>& tokens, bool includeToken);
@@ -0,0 +1,132 @@
+#include "PrecompiledHeader.h"
+#include "Utilities/ThreadPool.h"
+
+namespace PK::Utilities
+{
+    ThreadPool::ThreadPool(uint32_t threadCount)
+    {
+        m_workers.reserve(threadCount);
+
+        for (auto i = 0u; i < threadCount; ++i)
+        {
+            m_workers.emplace_back([this]() { ExecuteJobs(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_isRunning = false;
+        }
+
+        m_condition.notify_all();
+
+        for (auto& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::Enqueue(const Job& job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_queue.push_back(job);
+        }
+
+        m_condition.notify_one();
+    }
+
+    void ThreadPool::Dispatch(void (*execute)(void* context, uint32_t index), void* context, uint32_t count, Batch* batch)
+    {
+        batch->remainingCount.fetch_add(count, std::memory_order_relaxed);
+
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            for (auto i = 0u; i < count; ++i)
+            {
+                m_queue.push_back({ execute, context, i, batch });
+            }
+        }
+
+        m_condition.notify_all();
+    }
+
+    void ThreadPool::Wait(Batch* batch)
+    {
+        while (true)
+        {
+            Job job;
+
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+                m_batchCondition.wait(lock, [this, batch]() { return m_queueHead < m_queue.size() || batch->remainingCount.load(std::memory_order_acquire) == 0; });
+
+                if (batch->remainingCount.load(std::memory_order_acquire) == 0)
+                {
+                    return;
+                }
+
+                job = DequeueJob();
+            }
+
+            ExecuteJob(job);
+        }
+    }
+
+    ThreadPool* ThreadPool::GetShared()
+    {
+        static ThreadPool pool(std::thread::hardware_concurrency() > 1u ? std::thread::hardware_concurrency() - 1u : 1u);
+        return &pool;
+    }
+
+    void ThreadPool::ExecuteJobs()
+    {
+        while (true)
+        {
+            Job job;
+
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+                m_condition.wait(lock, [this]() { return m_queueHead < m_queue.size() || !m_isRunning; });
+
+                if (m_queueHead == m_queue.size())
+                {
+                    return;
+                }
+
+                job = DequeueJob();
+            }
+
+            ExecuteJob(job);
+        }
+    }
+
+    void ThreadPool::ExecuteJob(const Job& job)
+    {
+        job.execute(job.context, job.index);
+
+        // The batch may be released as soon as its count reaches zero. Only the pool is touched after that.
+        if (job.batch != nullptr && job.batch->remainingCount.fetch_sub(1u, std::memory_order_acq_rel) == 1u)
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_batchCondition.notify_all();
+        }
+    }
+
+    ThreadPool::Job ThreadPool::DequeueJob()
+    {
+        auto job = m_queue[m_queueHead++];
+
+        // The queue is rewound whenever it runs empty so that its capacity is reused.
+        if (m_queueHead == m_queue.size())
+        {
+            m_queue.clear();
+            m_queueHead = 0;
+        }
+
+        return job;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+#include "Core/NoCopy.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace PK::Utilities
+{
+    // Fixed set of workers that take jobs in submission order.
+    // Jobs are a function pointer & context so that submitting one does not allocate once the queue has grown.
+    class ThreadPool : public PK::Core::NoCopy
+    {
+        public:
+            // Counts the unfinished jobs of one or more dispatches. Lives on the stack of the thread that waits for it.
+            struct Batch
+            {
+                std::atomic<uint32_t> remainingCount = 0;
+            };
+
+            struct Job
+            {
+                void (*execute)(void* context, uint32_t index) = nullptr;
+                void* context = nullptr;
+                uint32_t index = 0;
+                Batch* batch = nullptr;
+            };
+
+            ThreadPool(uint32_t threadCount);
+            ~ThreadPool();
+
+            void Enqueue(const Job& job);
+
+            // Enqueues a job for each index in [0, count) & adds them to the batch.
+            void Dispatch(void (*execute)(void* context, uint32_t index), void* context, uint32_t count, Batch* batch);
+
+            // Executes queued jobs on the calling thread until every job of the batch has finished.
+            // Helping instead of blocking keeps waits from inside a job of the same pool from deadlocking.
+            void Wait(Batch* batch);
+
+            inline uint32_t GetThreadCount() const { return (uint32_t)m_workers.size(); }
+
+            // Pool for data parallel work within a frame, such as culling. Created on first use.
+            // Has one worker less than there are hardware threads as the dispatching thread helps while it waits.
+            static ThreadPool* GetShared();
+
+        private:
+            void ExecuteJobs();
+            void ExecuteJob(const Job& job);
+            Job DequeueJob();
+
+            std::vector<std::thread> m_workers;
+            std::vector<Job> m_queue;
+            size_t m_queueHead = 0;
+            std::mutex m_lock;
+            std::condition_variable m_condition;
+            std::condition_variable m_batchCondition;
+            bool m_isRunning = true;
+    };
+}
\ No newline at end of file
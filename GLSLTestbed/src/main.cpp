@@ -7,6 +7,9 @@
 #endif 
 
 #include "Core/Application.h"
+#include "Core/Benchmark.h"
+#include "Core/AssetCooker.h"
+#include <thread>
 
 int main(int argc, char** argv)
 {
@@ -16,6 +19,19 @@ int main(int argc, char** argv)
 
 	//_CrtSetBreakAlloc(69727);
 
+	PK::Core::Benchmark::Settings benchmarkSettings;
+
+	if (PK::Core::AssetCooker::TryParseArguments(argc, argv))
+	{
+		PK::Core::AssetCooker::Run(std::thread::hardware_concurrency());
+		return 0;
+	}
+
+	if (PK::Core::Benchmark::TryParseArguments(argc, argv, &benchmarkSettings))
+	{
+		return PK::Core::Benchmark::Run(benchmarkSettings) > 0 ? 1 : 0;
+	}
+
 	auto app = new PK::Core::Application("PK Renderer");
 	app->Run();
 	delete app;